@@ -0,0 +1,73 @@
+#include "bench_async.h"
+#include "bench_helpers.h"
+#include <cstdlib>
+#include <unordered_map>
+
+/**
+ * Stands in for the parts of process startup that do not depend on the
+ * config, such as warming caches: fills a hash table with `entries`
+ * entries and returns a value that depends on them.
+ */
+size_t warm_cache(size_t entries)
+{
+	std::unordered_map<size_t, size_t> cache;
+	for (size_t i = 0; i < entries; i++)
+	{
+		cache[i * 2654435761U] = i;
+	}
+	return cache.size() + cache[0];
+}
+
+/**
+ * Aborts unless `result` holds a config.
+ */
+template<typename R>
+void check(const R &result)
+{
+	if (!std::holds_alternative<Config>(result))
+	{
+		std::abort();
+	}
+}
+
+/**
+ * Compares a startup that loads `count` synthetic tenant configs (default
+ * 64) and then warms a cache of `entries` entries (default 2000000) with
+ * one that starts loading the configs in the background, warms the cache
+ * and then collects the configs.
+ */
+int main(int argc, char **argv)
+{
+	size_t count = (argc > 1) ? std::strtoul(argv[1], nullptr, 10) : 64;
+	size_t entries =
+	  (argc > 2) ? std::strtoul(argv[2], nullptr, 10) : 2000000;
+	TenantSet tenants(count);
+	std::cout << "Loading " << count << " tenant configs and warming "
+	          << entries << " cache entries" << std::endl;
+	// Start the pool first so that both runs pay the same cost.
+	auto  &pool     = config::detail::ThreadPool::global();
+	size_t checksum = 0;
+
+	double blocking = time_ms([&]() {
+		for (auto &path : tenants.paths)
+		{
+			config::detail::InlineExecutor executor;
+			check(make_config_async(path, executor).get());
+		}
+		checksum += warm_cache(entries);
+	});
+	std::cout << "load then warm:     " << blocking << " ms" << std::endl;
+
+	double overlapped = time_ms([&]() {
+		auto futures = make_configs_async(tenants.paths, pool);
+		checksum += warm_cache(entries);
+		for (auto &future : futures)
+		{
+			check(future.get());
+		}
+	});
+	std::cout << "load while warming: " << overlapped << " ms ("
+	          << blocking / overlapped << "x)" << std::endl;
+	std::cout << "Checksum: " << checksum << std::endl;
+	return EXIT_SUCCESS;
+}
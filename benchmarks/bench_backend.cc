@@ -0,0 +1,120 @@
+#include "bench_backend.h"
+#include "bench_helpers.h"
+#include "config-simdjson.h"
+#include <cstdlib>
+#include <vector>
+
+/**
+ * Reads every property of a tenant config, through any backend, and returns
+ * a value that depends on all of them so that the reads are not optimised
+ * away.
+ */
+template<typename T>
+size_t walk(const T &conf)
+{
+	size_t sum = conf.name().size() + conf.rateLimit() +
+	             conf.timeoutMs().value_or(0);
+	auto tls = conf.tls();
+	sum += tls.certificate().size() + tls.key().size() +
+	       tls.minVersion().value_or("").size();
+	if (auto routes = conf.routes())
+	{
+		for (auto route : *routes)
+		{
+			sum += route.prefix().size() + route.backend().size() +
+			       route.weight().value_or(0);
+		}
+	}
+	return sum;
+}
+
+/**
+ * Compares loading JSON tenant configs with libucl, with and without schema
+ * validation, against the simdjson backend, reading every property of each
+ * config through the same generated class.
+ */
+int main(int argc, char **argv)
+{
+	size_t count  = (argc > 1) ? std::strtoul(argv[1], nullptr, 10) : 200;
+	size_t routes = (argc > 2) ? std::strtoul(argv[2], nullptr, 10) : 512;
+	std::vector<std::string> documents;
+	size_t                   bytes = 0;
+	for (size_t i = 0; i < count; i++)
+	{
+		auto               text = tenant_config(i, routes);
+		struct ucl_parser *p    = ucl_parser_new(UCL_PARSER_NO_IMPLICIT_ARRAYS);
+		ucl_parser_add_string(p, text.c_str(), text.size());
+		auto *obj  = ucl_parser_get_object(p);
+		auto *json = ucl_object_emit(obj, UCL_EMIT_JSON_COMPACT);
+		documents.emplace_back(reinterpret_cast<char *>(json));
+		bytes += documents.back().size();
+		free(json);
+		ucl_object_unref(obj);
+		ucl_parser_free(p);
+	}
+	std::cout << "Loading " << count << " JSON tenant configs, "
+	          << bytes / 1024 << " KiB" << std::endl;
+	auto report = [&](const char *name, double ms, double baseline) {
+		std::cout << name << ms << " ms, " << (bytes / 1048576.0) / (ms / 1000)
+		          << " MiB/s (" << baseline / ms << "x)" << std::endl;
+	};
+
+	size_t checksum  = 0;
+	double validated = time_ms([&]() {
+		for (auto &json : documents)
+		{
+			struct ucl_parser *p =
+			  ucl_parser_new(UCL_PARSER_NO_IMPLICIT_ARRAYS);
+			ucl_parser_add_string(p, json.data(), json.size());
+			auto *obj = ucl_parser_get_object(p);
+			ucl_parser_free(p);
+			auto conf = make_config(obj);
+			ucl_object_unref(obj);
+			if (!std::holds_alternative<Config>(conf))
+			{
+				std::abort();
+			}
+			checksum += walk(std::get<Config>(conf));
+		}
+	});
+	report("libucl + schema: ", validated, validated);
+
+	size_t uclChecksum = 0;
+	double ucl = time_ms([&]() {
+		for (auto &json : documents)
+		{
+			struct ucl_parser *p =
+			  ucl_parser_new(UCL_PARSER_NO_IMPLICIT_ARRAYS);
+			ucl_parser_add_string(p, json.data(), json.size());
+			auto *obj = ucl_parser_get_object(p);
+			ucl_parser_free(p);
+			Config conf(obj);
+			ucl_object_unref(obj);
+			uclChecksum += walk(conf);
+		}
+	});
+	report("libucl:          ", ucl, validated);
+
+	size_t jsonChecksum = 0;
+	double simdjson = time_ms([&]() {
+		for (auto &json : documents)
+		{
+			auto parsed = config::detail::parse_json(json);
+			if (!std::holds_alternative<config::detail::JsonNode>(parsed))
+			{
+				std::abort();
+			}
+			BasicConfig<config::detail::SimdjsonBackend> conf(
+			  std::get<config::detail::JsonNode>(parsed));
+			jsonChecksum += walk(conf);
+		}
+	});
+	report("simdjson:        ", simdjson, validated);
+
+	if ((checksum != uclChecksum) || (checksum != jsonChecksum))
+	{
+		std::cerr << "Backends disagree" << std::endl;
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
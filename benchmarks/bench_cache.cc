@@ -0,0 +1,57 @@
+#include "bench_cache.h"
+#include "bench_helpers.h"
+#include <cstdlib>
+
+/**
+ * Aborts unless every config in `results` loaded.
+ */
+template<typename R>
+void check(const R &results)
+{
+	for (auto &r : results)
+	{
+		if (!std::holds_alternative<Config>(r))
+		{
+			std::abort();
+		}
+	}
+}
+
+/**
+ * Compares loading a set of synthetic tenant configs on a single thread
+ * without a validation cache, with a cache that is empty, as on the first
+ * run, and with a cache that holds every config, as on a restart where no
+ * config has changed.
+ */
+int main(int argc, char **argv)
+{
+	size_t    count = (argc > 1) ? std::strtoul(argv[1], nullptr, 10) : 2000;
+	TenantSet tenants(count);
+	auto      cachePath = tenants.dir / "validation.cache";
+	std::cout << "Loading " << count << " tenant configs" << std::endl;
+
+	config::detail::InlineExecutor executor;
+	double uncached = time_ms([&]() {
+		check(load_configs(tenants.paths, executor));
+	});
+	std::cout << "no cache:   " << uncached << " ms" << std::endl;
+
+	double cold = time_ms([&]() {
+		config::detail::ValidationCache cache(cachePath);
+		check(load_configs(tenants.paths, executor, cache));
+	});
+	std::cout << "cold cache: " << cold << " ms (" << uncached / cold << "x)"
+	          << std::endl;
+
+	double warm = time_ms([&]() {
+		config::detail::ValidationCache cache(cachePath);
+		check(load_configs(tenants.paths, executor, cache));
+		if (cache.hits() != count)
+		{
+			std::abort();
+		}
+	});
+	std::cout << "warm cache: " << warm << " ms (" << uncached / warm << "x)"
+	          << std::endl;
+	return EXIT_SUCCESS;
+}
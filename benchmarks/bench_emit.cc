@@ -0,0 +1,103 @@
+#include "bench_emit.h"
+#include "bench_helpers.h"
+#include <cstdlib>
+#include <vector>
+
+/**
+ * Compares dumping configs with `ucl_object_emit` against the generated
+ * `write_json`, on both the config classes and materialized structs.
+ */
+int main(int argc, char **argv)
+{
+	size_t count  = (argc > 1) ? std::strtoul(argv[1], nullptr, 10) : 2000;
+	size_t rounds = 10;
+	std::vector<ucl_object_t *> objects;
+	std::vector<Config>         configs;
+	std::vector<ConfigData>     materialized;
+	for (size_t i = 0; i < count; i++)
+	{
+		auto               text = tenant_config(i);
+		struct ucl_parser *p    = ucl_parser_new(UCL_PARSER_NO_IMPLICIT_ARRAYS);
+		ucl_parser_add_string(p, text.c_str(), text.size());
+		objects.push_back(ucl_parser_get_object(p));
+		ucl_parser_free(p);
+		auto conf = make_config(objects.back());
+		if (!std::holds_alternative<Config>(conf))
+		{
+			std::abort();
+		}
+		configs.push_back(std::get<Config>(conf));
+		materialized.emplace_back(configs.back());
+	}
+	std::cout << "Emitting " << count << " tenant configs " << rounds
+	          << " times" << std::endl;
+
+	size_t bytes   = 0;
+	double emitted = time_ms([&]() {
+		for (size_t r = 0; r < rounds; r++)
+		{
+			for (auto *obj : objects)
+			{
+				auto *json = ucl_object_emit(obj, UCL_EMIT_JSON_COMPACT);
+				bytes += strlen(reinterpret_cast<char *>(json));
+				free(json);
+			}
+		}
+	});
+	auto report = [&](const char *name, double ms) {
+		std::cout << name << ms << " ms (" << bytes / 1e3 / ms << " MB/s, "
+		          << emitted / ms << "x)" << std::endl;
+	};
+	report("ucl_object_emit:      ", emitted);
+
+	std::string out;
+	bytes        = 0;
+	double typed = time_ms([&]() {
+		for (size_t r = 0; r < rounds; r++)
+		{
+			for (auto &conf : configs)
+			{
+				out.clear();
+				config::detail::StringSink sink(out);
+				conf.write_json(sink);
+				bytes += out.size();
+			}
+		}
+	});
+	report("write_json (string):  ", typed);
+
+	std::vector<char> buffer(1 << 20);
+	bytes           = 0;
+	double buffered = time_ms([&]() {
+		for (size_t r = 0; r < rounds; r++)
+		{
+			for (auto &conf : configs)
+			{
+				config::detail::BufferSink sink(buffer);
+				conf.write_json(sink);
+				bytes += sink.size();
+			}
+		}
+	});
+	report("write_json (buffer):  ", buffered);
+
+	bytes       = 0;
+	double data = time_ms([&]() {
+		for (size_t r = 0; r < rounds; r++)
+		{
+			for (auto &conf : materialized)
+			{
+				config::detail::BufferSink sink(buffer);
+				conf.write_json(sink);
+				bytes += sink.size();
+			}
+		}
+	});
+	report("write_json (struct):  ", data);
+
+	for (auto *obj : objects)
+	{
+		ucl_object_unref(obj);
+	}
+	return EXIT_SUCCESS;
+}
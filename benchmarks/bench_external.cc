@@ -0,0 +1,91 @@
+#include "bench_external.h"
+#include "bench_helpers.h"
+#include <cstdlib>
+
+/**
+ * Loads the service config at `path`, aborting if it is not valid.
+ */
+Config load(const std::filesystem::path &path)
+{
+	auto result = config::detail::load_config_file<Config>(
+	  path, [](ucl_object_t *obj) { return make_config(obj); });
+	if (!std::holds_alternative<Config>(result))
+	{
+		std::abort();
+	}
+	return std::get<Config>(result);
+}
+
+/**
+ * Returns the number of routes in `conf`, aborting if its routing table
+ * could not be loaded.
+ */
+size_t route_count(const Config &conf)
+{
+	auto routing = conf.routing();
+	if (!std::holds_alternative<Config::routingClass>(routing))
+	{
+		std::abort();
+	}
+	size_t count = 0;
+	for (auto route : std::get<Config::routingClass>(routing).routes())
+	{
+		count += route.weight() > 0;
+	}
+	return count;
+}
+
+/**
+ * Compares loading a service config whose routing table of `routes` routes
+ * (default 20000) is kept in a separate file and never read with loading it
+ * and reading the table, which costs as much as loading a config that holds
+ * the table inline.  Each is repeated `iterations` times (default 20).
+ */
+int main(int argc, char **argv)
+{
+	size_t routes = (argc > 1) ? std::strtoul(argv[1], nullptr, 10) : 20000;
+	size_t iterations =
+	  (argc > 2) ? std::strtoul(argv[2], nullptr, 10) : 20;
+	TenantSet   files(0);
+	std::string text    = tenant_config(0, routes);
+	size_t      split   = text.find("routes [");
+	auto        service = files.dir / "service.conf";
+	auto        routing = files.dir / "routing.conf";
+	std::ofstream(routing) << text.substr(split);
+	std::ofstream(service) << text.substr(0, split) << "routing = \""
+	                       << routing.string() << "\";\n";
+	std::cout << "Loading a config with " << routes
+	          << " routes in a separate file, " << iterations << " times"
+	          << std::endl;
+	size_t checksum = 0;
+
+	double eager = time_ms([&]() {
+		for (size_t i = 0; i < iterations; i++)
+		{
+			checksum += route_count(load(service));
+		}
+	});
+	std::cout << "load and read routes: " << eager / iterations << " ms"
+	          << std::endl;
+
+	double lazy = time_ms([&]() {
+		for (size_t i = 0; i < iterations; i++)
+		{
+			checksum += load(service).rateLimit();
+		}
+	});
+	std::cout << "load without routes:  " << lazy / iterations << " ms ("
+	          << eager / lazy << "x)" << std::endl;
+
+	auto   conf   = load(service);
+	double reread = time_ms([&]() {
+		for (size_t i = 0; i < iterations; i++)
+		{
+			checksum += route_count(conf);
+		}
+	});
+	std::cout << "reread loaded routes: " << reread / iterations << " ms"
+	          << std::endl;
+	std::cout << "Checksum: " << checksum << std::endl;
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,115 @@
+#include "bench_format.h"
+#include "bench_helpers.h"
+#include <arpa/inet.h>
+#include <cstdlib>
+#include <vector>
+
+/**
+ * Returns the text of a config with `count` backends.
+ */
+std::string backend_table(size_t count)
+{
+	std::string text = "backends [\n";
+	for (size_t i = 0; i < count; i++)
+	{
+		char address[64];
+		snprintf(address,
+		         sizeof(address),
+		         "2001:db8:%zx::%zx",
+		         (i >> 16) & 0xffff,
+		         i & 0xffff);
+		text += "  { address = \"";
+		text += address;
+		text += "\", url = \"https://backend-" + std::to_string(i) +
+		        ".internal:8443/api/v1/items?shard=" + std::to_string(i % 16) +
+		        "\" },\n";
+	}
+	text += "]\n";
+	return text;
+}
+
+/**
+ * Returns a value that depends on the parsed address and URI, so that
+ * parsing is not optimised away.
+ */
+size_t use(const in6_addr &address, config::detail::UriView url)
+{
+	return address.s6_addr[15] + url.host().size() + url.port().value_or(0);
+}
+
+/**
+ * Compares setting up `connections` connections (default 1000000) to
+ * backends chosen from a config of `count` (default 1000).  Each connection
+ * needs the backend's address and URI, which are re-parsed from strings,
+ * parsed by the accessors of the config class, or read pre-parsed from a
+ * materialized struct.
+ */
+int main(int argc, char **argv)
+{
+	size_t connections =
+	  (argc > 1) ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+	size_t count = (argc > 2) ? std::strtoul(argv[2], nullptr, 10) : 1000;
+	auto   text  = backend_table(count);
+	struct ucl_parser *p = ucl_parser_new(UCL_PARSER_NO_IMPLICIT_ARRAYS);
+	ucl_parser_add_string(p, text.c_str(), text.size());
+	auto *obj = ucl_parser_get_object(p);
+	ucl_parser_free(p);
+	auto confOrError = make_config(obj);
+	if (!std::holds_alternative<Config>(confOrError))
+	{
+		std::abort();
+	}
+	auto       conf = std::get<Config>(confOrError);
+	ConfigData data(conf);
+	std::vector<const ucl_object_t *> nodes;
+	std::vector<Config::backendsItemClass> backends;
+	ucl_object_iter_t                  it = nullptr;
+	while (auto *node = ucl_object_iterate(
+	         ucl_object_lookup(obj, "backends"), &it, true))
+	{
+		nodes.push_back(node);
+	}
+	for (auto backend : conf.backends())
+	{
+		backends.push_back(backend);
+	}
+	std::cout << "Setting up " << connections << " connections to " << count
+	          << " backends" << std::endl;
+
+	size_t checksum = 0;
+	double strings  = time_ms([&]() {
+		for (size_t i = 0; i < connections; i++)
+		{
+			auto    *node = nodes[i % count];
+			in6_addr address;
+			inet_pton(AF_INET6,
+			          ucl_object_tostring(ucl_object_lookup(node, "address")),
+			          &address);
+			auto url = config::detail::UriView::parse(
+			  ucl_object_tostring(ucl_object_lookup(node, "url")));
+			checksum += use(address, *url);
+		}
+	});
+	std::cout << "Parsing strings:     " << strings << " ms" << std::endl;
+	double accessors = time_ms([&]() {
+		for (size_t i = 0; i < connections; i++)
+		{
+			auto &backend = backends[i % count];
+			checksum += use(backend.address().address(), backend.url());
+		}
+	});
+	std::cout << "Config accessors:    " << accessors << " ms ("
+	          << strings / accessors << "x)" << std::endl;
+	double materialized = time_ms([&]() {
+		for (size_t i = 0; i < connections; i++)
+		{
+			auto &backend = data.backends()[i % count];
+			checksum += use(backend.address().address(), backend.url());
+		}
+	});
+	std::cout << "Materialized struct: " << materialized << " ms ("
+	          << strings / materialized << "x)" << std::endl;
+	std::cout << "Checksum: " << checksum << std::endl;
+	ucl_object_unref(obj);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,62 @@
+#include "bench_fragment.h"
+#include "bench_helpers.h"
+#include <cstdlib>
+#include <thread>
+
+/**
+ * Aborts unless every config in `results` loaded.
+ */
+template<typename R>
+void check(const R &results)
+{
+	for (auto &r : results)
+	{
+		if (!std::holds_alternative<Config>(r))
+		{
+			std::abort();
+		}
+	}
+}
+
+/**
+ * Compares loading a set of synthetic tenant configs that each include the
+ * same fragment, which holds the TLS settings and a route table of
+ * `routes` entries, with and without a fragment cache.
+ */
+int main(int argc, char **argv)
+{
+	size_t count  = (argc > 1) ? std::strtoul(argv[1], nullptr, 10) : 2000;
+	size_t routes = (argc > 2) ? std::strtoul(argv[2], nullptr, 10) : 512;
+	// The tenant set is used only for its directory, which it removes.
+	TenantSet tenants(0);
+	auto      fragment = tenants.dir / "shared.inc";
+	{
+		// Everything except the per-tenant name and limits is shared.
+		auto text = tenant_config(0, routes);
+		std::ofstream(fragment) << text.substr(text.find("tls {"));
+	}
+	std::vector<std::filesystem::path> paths;
+	for (size_t i = 0; i < count; i++)
+	{
+		paths.push_back(tenants.dir / ("tenant" + std::to_string(i) + ".conf"));
+		std::ofstream(paths.back())
+		  << "name = \"tenant" << i << "\";\nrateLimit = " << i % 5000
+		  << ";\n.include \"" << fragment.string() << "\"\n";
+	}
+	std::cout << "Loading " << count << " tenant configs including " << routes
+	          << " shared routes" << std::endl;
+
+	config::detail::ThreadPool pool(
+	  std::max(std::thread::hardware_concurrency(), 1U));
+	double uncached = time_ms([&]() { check(load_configs(paths, pool)); });
+	std::cout << "parsing each include: " << uncached << " ms" << std::endl;
+
+	config::detail::FragmentCache fragments;
+	double cached = time_ms([&]() {
+		check(load_configs(paths, pool, fragments));
+	});
+	std::cout << "fragment cache:       " << cached << " ms ("
+	          << uncached / cached << "x), " << fragments.misses()
+	          << " fragment parsed" << std::endl;
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,87 @@
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+/**
+ * Runs `f` and returns the wall-clock time that it took, in milliseconds.
+ */
+template<typename F>
+double time_ms(F &&f)
+{
+	auto start = std::chrono::steady_clock::now();
+	f();
+	auto end = std::chrono::steady_clock::now();
+	return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+/**
+ * Returns the text of a synthetic tenant config matching `bench_load.conf`.
+ * Most of each config is shared between tenants, as it is in real fleets,
+ * with a small per-tenant part.
+ */
+std::string tenant_config(size_t i, size_t routes = 32)
+{
+	std::string text;
+	text += "name = \"tenant" + std::to_string(i) + "\";\n";
+	text += "rateLimit = " + std::to_string((i * 37) % 5000) + ";\n";
+	text += "timeoutMs = " + std::to_string(100 + (i % 50) * 10) + ";\n";
+	text += "tls {\n"
+	        "  certificate = \"/etc/ssl/shared/fullchain.pem\";\n"
+	        "  key = \"/etc/ssl/shared/privkey.pem\";\n"
+	        "  minVersion = \"1.2\";\n"
+	        "}\n";
+	text += "routes [\n";
+	for (size_t r = 0; r < routes; r++)
+	{
+		text += "  { prefix = \"/api/v1/service" + std::to_string(r) +
+		        "\", backend = \"backend-" + std::to_string(r % 8) +
+		        ".internal:8080\", weight = " + std::to_string(r % 100) +
+		        " },\n";
+	}
+	text += "]\n";
+	return text;
+}
+
+/**
+ * A directory of synthetic tenant config files.  The files are deleted when
+ * this goes out of scope.
+ */
+struct TenantSet
+{
+	/**
+	 * The directory holding the files.
+	 */
+	std::filesystem::path dir;
+
+	/**
+	 * The paths of the generated files.
+	 */
+	std::vector<std::filesystem::path> paths;
+
+	/**
+	 * Writes `count` tenant configs to a fresh temporary directory.
+	 */
+	TenantSet(size_t count, size_t routes = 32)
+	  : dir(std::filesystem::temp_directory_path() /
+	        ("config-gen-bench-" + std::to_string(getpid())))
+	{
+		std::filesystem::create_directories(dir);
+		for (size_t i = 0; i < count; i++)
+		{
+			paths.push_back(dir / ("tenant" + std::to_string(i) + ".conf"));
+			std::ofstream(paths.back()) << tenant_config(i, routes);
+		}
+	}
+
+	/**
+	 * Removes the generated files.
+	 */
+	~TenantSet()
+	{
+		std::filesystem::remove_all(dir);
+	}
+};
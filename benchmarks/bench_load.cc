@@ -0,0 +1,103 @@
+#include "bench_load.h"
+#include "bench_helpers.h"
+#include <cstdlib>
+#include <thread>
+
+/**
+ * Returns the number of UCL nodes in the tree rooted at `obj`.
+ */
+size_t count_nodes(const ucl_object_t *obj)
+{
+	size_t            count = 1;
+	ucl_object_iter_t it    = nullptr;
+	auto              type  = ucl_object_type(obj);
+	if ((type == UCL_OBJECT) || (type == UCL_ARRAY))
+	{
+		while (auto *child = ucl_object_iterate(obj, &it, true))
+		{
+			count += count_nodes(child);
+		}
+	}
+	return count;
+}
+
+/**
+ * Compares loading a set of synthetic tenant configs serially, in the way
+ * that a simple loop over `ucl_parser_add_file` and `make_config` would, with
+ * `load_configs` on thread pools of increasing size.
+ */
+int main(int argc, char **argv)
+{
+	size_t    count = (argc > 1) ? std::strtoul(argv[1], nullptr, 10) : 2000;
+	TenantSet tenants(count);
+	std::cout << "Loading " << count << " tenant configs" << std::endl;
+
+	size_t nodes  = 0;
+	double serial = time_ms([&]() {
+		for (auto &path : tenants.paths)
+		{
+			struct ucl_parser *p =
+			  ucl_parser_new(UCL_PARSER_NO_IMPLICIT_ARRAYS);
+			ucl_parser_add_file(p, path.c_str());
+			auto obj = ucl_parser_get_object(p);
+			ucl_parser_free(p);
+			nodes += count_nodes(obj);
+			auto conf = make_config(obj);
+			ucl_object_unref(obj);
+			if (!std::holds_alternative<Config>(conf))
+			{
+				std::abort();
+			}
+		}
+	});
+	std::cout << "serial loop:       " << serial << " ms" << std::endl;
+
+	unsigned maxThreads = std::max(std::thread::hardware_concurrency(), 1U);
+	for (unsigned threads = 1; threads <= maxThreads; threads *= 2)
+	{
+		config::detail::ThreadPool pool(threads);
+		double ms = time_ms([&]() {
+			auto results = load_configs(tenants.paths, pool);
+			for (auto &r : results)
+			{
+				if (!std::holds_alternative<Config>(r))
+				{
+					std::abort();
+				}
+			}
+		});
+		std::cout << "load_configs x" << threads << ": " << ms << " ms ("
+		          << serial / ms << "x)" << std::endl;
+	}
+
+	// Break a parallel load down by phase.
+	config::detail::ThreadPool        pool(maxThreads);
+	config::detail::HistogramObserver observer;
+	load_configs(tenants.paths, pool, observer);
+	std::cout << "phases x" << maxThreads << ":" << std::endl;
+	for (auto phase : {config::detail::LoadPhase::Parse,
+	                   config::detail::LoadPhase::SchemaLoad,
+	                   config::detail::LoadPhase::Validate,
+	                   config::detail::LoadPhase::Materialize})
+	{
+		auto stats = observer.stats(phase);
+		std::cout << "  " << config::detail::phase_name(phase) << ": "
+		          << stats.total.count() / 1e6 << " ms total, p50 < "
+		          << stats.quantile(0.5).count() << " ns, p99 < "
+		          << stats.quantile(0.99).count() << " ns";
+		if (stats.bytes != 0)
+		{
+			std::cout << ", " << stats.bytes << " bytes";
+		}
+		std::cout << std::endl;
+	}
+
+	config::detail::InternTable table;
+	std::vector<std::variant<Config, config::detail::LoadError>> interned;
+	double ms = time_ms(
+	  [&]() { interned = load_configs(tenants.paths, pool, table); });
+	std::cout << "interned x" << maxThreads << ":   " << ms << " ms, "
+	          << table.size() << " distinct nodes out of " << nodes
+	          << std::endl;
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,94 @@
+#include "bench_msgpack.h"
+#include "bench_helpers.h"
+#include <cstdlib>
+#include <vector>
+
+/**
+ * Compares parsing and validating tenant configs from UCL text, and from the
+ * same configs in JSON, against loading their MessagePack encodings with
+ * `make_config_from_msgpack`.
+ */
+int main(int argc, char **argv)
+{
+	size_t count  = (argc > 1) ? std::strtoul(argv[1], nullptr, 10) : 2000;
+	size_t routes = (argc > 2) ? std::strtoul(argv[2], nullptr, 10) : 32;
+	std::vector<std::string>            texts;
+	std::vector<std::string>            jsons;
+	std::vector<std::vector<std::byte>> packed;
+	size_t textBytes = 0, jsonBytes = 0, packedBytes = 0;
+	for (size_t i = 0; i < count; i++)
+	{
+		texts.push_back(tenant_config(i, routes));
+		struct ucl_parser *p = ucl_parser_new(UCL_PARSER_NO_IMPLICIT_ARRAYS);
+		ucl_parser_add_string(p, texts.back().c_str(), texts.back().size());
+		auto *obj  = ucl_parser_get_object(p);
+		auto *json = ucl_object_emit(obj, UCL_EMIT_JSON_COMPACT);
+		jsons.emplace_back(reinterpret_cast<char *>(json));
+		free(json);
+		packed.push_back(config::detail::encode_msgpack(obj));
+		ucl_object_unref(obj);
+		ucl_parser_free(p);
+		textBytes += texts.back().size();
+		jsonBytes += jsons.back().size();
+		packedBytes += packed.back().size();
+	}
+	std::cout << "Loading " << count << " tenant configs: " << textBytes / 1024
+	          << " KiB of UCL, " << jsonBytes / 1024 << " KiB of JSON, "
+	          << packedBytes / 1024 << " KiB of MessagePack" << std::endl;
+
+	auto loadText = [](const std::string &text) {
+		struct ucl_parser *p = ucl_parser_new(UCL_PARSER_NO_IMPLICIT_ARRAYS);
+		ucl_parser_add_string(p, text.c_str(), text.size());
+		auto *obj = ucl_parser_get_object(p);
+		ucl_parser_free(p);
+		auto conf = make_config(obj);
+		ucl_object_unref(obj);
+		if (!std::holds_alternative<Config>(conf))
+		{
+			std::abort();
+		}
+	};
+	double ucl = time_ms([&]() {
+		for (auto &text : texts)
+		{
+			loadText(text);
+		}
+	});
+	std::cout << "UCL text:    " << ucl << " ms" << std::endl;
+	double json = time_ms([&]() {
+		for (auto &text : jsons)
+		{
+			loadText(text);
+		}
+	});
+	std::cout << "JSON text:   " << json << " ms (" << ucl / json << "x)"
+	          << std::endl;
+	double msgpack = time_ms([&]() {
+		for (auto &bytes : packed)
+		{
+			if (!std::holds_alternative<Config>(
+			      make_config_from_msgpack(bytes)))
+			{
+				std::abort();
+			}
+		}
+	});
+	std::cout << "MessagePack: " << msgpack << " ms (" << ucl / msgpack
+	          << "x)" << std::endl;
+
+	// Break the MessagePack load down by phase, to separate decoding from
+	// validation.
+	config::detail::HistogramObserver observer;
+	for (auto &bytes : packed)
+	{
+		make_config_from_msgpack(bytes, observer);
+	}
+	for (auto phase : {config::detail::LoadPhase::Parse,
+	                   config::detail::LoadPhase::Validate})
+	{
+		auto stats = observer.stats(phase);
+		std::cout << "  " << config::detail::phase_name(phase) << ": "
+		          << stats.total.count() / 1e6 << " ms total" << std::endl;
+	}
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,51 @@
+#include "bench_pattern.h"
+#include "bench_helpers.h"
+#include <cstdlib>
+
+/**
+ * Returns the text of a route table with `routes` entries.
+ */
+std::string route_table(size_t routes)
+{
+	static const char *methods[] = {"GET", "POST", "PUT", "DELETE"};
+	std::string        text      = "name = \"edge-router\";\nroutes [\n";
+	for (size_t r = 0; r < routes; r++)
+	{
+		text += "  { prefix = \"/api/v" + std::to_string(r % 3) + "/service" +
+		        std::to_string(r) + "/items\", backend = \"backend-" +
+		        std::to_string(r % 8) + ".internal:8080\", method = \"" +
+		        methods[r % 4] + "\" },\n";
+	}
+	text += "]\n";
+	return text;
+}
+
+/**
+ * Compares validating a route table of `routes` entries (default 100000)
+ * with libucl checking the patterns, against the generated matchers.
+ */
+int main(int argc, char **argv)
+{
+	size_t routes = (argc > 1) ? std::strtoul(argv[1], nullptr, 10) : 100000;
+	auto   text   = route_table(routes);
+	struct ucl_parser *p = ucl_parser_new(UCL_PARSER_NO_IMPLICIT_ARRAYS);
+	ucl_parser_add_string(p, text.c_str(), text.size());
+	auto *obj = ucl_parser_get_object(p);
+	ucl_parser_free(p);
+	std::cout << "Validating " << routes << " routes, "
+	          << routes * 3 + 1 << " strings with patterns" << std::endl;
+
+	bool   valid  = true;
+	double libucl = time_ms([&]() {
+		ucl_schema_error err;
+		valid &= ucl_object_validate(embedded_schema(), obj, &err);
+	});
+	std::cout << "libucl patterns:   " << libucl << " ms" << std::endl;
+	double compiled = time_ms([&]() {
+		valid &= std::holds_alternative<Config>(make_config(obj));
+	});
+	std::cout << "Compiled patterns: " << compiled << " ms ("
+	          << libucl / compiled << "x)" << std::endl;
+	ucl_object_unref(obj);
+	return valid ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,209 @@
+#include "bench_runtime_schema.h"
+#include "bench_helpers.h"
+#include "config-schema.h"
+#include <cstdlib>
+#include <vector>
+
+using namespace config::detail;
+
+/**
+ * Handles for every property of a tenant config, resolved once.
+ */
+struct TenantHandles
+{
+	PathHandle<std::string_view>            name;
+	PathHandle<int64_t>                     rateLimit;
+	PathHandle<int64_t>                     timeoutMs;
+	PathHandle<std::string_view>            certificate;
+	PathHandle<std::string_view>            key;
+	PathHandle<std::string_view>            minVersion;
+	PathHandle<RuntimeArray<RuntimeObject>> routes;
+	PathHandle<std::string_view>            prefix;
+	PathHandle<std::string_view>            backend;
+	PathHandle<int64_t>                     weight;
+};
+
+/**
+ * Resolves `path` in `schema`, aborting if it is not there.
+ */
+template<typename T>
+PathHandle<T> resolve(const RuntimeSchema &schema, std::string_view path)
+{
+	auto result = schema.resolve<T>(path);
+	if (!std::holds_alternative<PathHandle<T>>(result))
+	{
+		std::abort();
+	}
+	return std::get<PathHandle<T>>(result);
+}
+
+/**
+ * Reads every property of a tenant config through the generated class and
+ * returns a value that depends on all of them so that the reads are not
+ * optimised away.
+ */
+size_t walk(const Config &conf)
+{
+	size_t sum = conf.name().size() + conf.rateLimit() +
+	             conf.timeoutMs().value_or(0);
+	auto tls = conf.tls();
+	sum += tls.certificate().size() + tls.key().size() +
+	       tls.minVersion().value_or("").size();
+	if (auto routes = conf.routes())
+	{
+		for (auto route : *routes)
+		{
+			sum += route.prefix().size() + route.backend().size() +
+			       route.weight().value_or(0);
+		}
+	}
+	return sum;
+}
+
+/**
+ * Reads every property of a tenant config through runtime schema handles.
+ */
+size_t walk(const RuntimeObject &conf, const TenantHandles &h)
+{
+	size_t sum = conf.get_or(h.name, "").size() + conf.get_or(h.rateLimit, 0) +
+	             conf.get_or(h.timeoutMs, 0);
+	sum += conf.get_or(h.certificate, "").size() +
+	       conf.get_or(h.key, "").size() + conf.get_or(h.minVersion, "").size();
+	if (auto routes = conf.get(h.routes))
+	{
+		for (auto route : *routes)
+		{
+			sum += route.get_or(h.prefix, "").size() +
+			       route.get_or(h.backend, "").size() +
+			       route.get_or(h.weight, 0);
+		}
+	}
+	return sum;
+}
+
+/**
+ * Returns the property `key` of `obj`, as a plugin without a schema would.
+ */
+const ucl_object_t *lookup(const ucl_object_t *obj, const char *key)
+{
+	return (obj == nullptr) ? nullptr : ucl_object_lookup(obj, key);
+}
+
+/**
+ * Reads every property of a tenant config with string-keyed lookups.
+ */
+size_t walk(const ucl_object_t *conf)
+{
+	auto length = [](const ucl_object_t *o) {
+		return (o == nullptr) ? 0 : strlen(ucl_object_tostring(o));
+	};
+	auto integer = [](const ucl_object_t *o) {
+		return (o == nullptr) ? 0 : ucl_object_toint(o);
+	};
+	size_t sum = length(lookup(conf, "name")) +
+	             integer(lookup(conf, "rateLimit")) +
+	             integer(lookup(conf, "timeoutMs"));
+	sum += length(lookup(lookup(conf, "tls"), "certificate")) +
+	       length(lookup(lookup(conf, "tls"), "key")) +
+	       length(lookup(lookup(conf, "tls"), "minVersion"));
+	if (auto *routes = lookup(conf, "routes"))
+	{
+		ucl_object_iter_t it = nullptr;
+		while (auto *route = ucl_object_iterate(routes, &it, true))
+		{
+			sum += length(lookup(route, "prefix")) +
+			       length(lookup(route, "backend")) +
+			       integer(lookup(route, "weight"));
+		}
+	}
+	return sum;
+}
+
+/**
+ * Compares reading every property of tenant configs through generated
+ * accessors, through handles resolved from a schema loaded at run time, and
+ * with string-keyed lookups.  Each config is read `reads` times.
+ */
+int main(int argc, char **argv)
+{
+	size_t count = (argc > 1) ? std::strtoul(argv[1], nullptr, 10) : 200;
+	size_t reads = (argc > 2) ? std::strtoul(argv[2], nullptr, 10) : 20;
+	auto   schemaOrError = load_runtime_schema(BENCH_SCHEMA_FILE);
+	if (!std::holds_alternative<std::shared_ptr<const RuntimeSchema>>(
+	      schemaOrError))
+	{
+		return EXIT_FAILURE;
+	}
+	auto schema =
+	  std::get<std::shared_ptr<const RuntimeSchema>>(schemaOrError);
+	TenantHandles handles{
+	  resolve<std::string_view>(*schema, "name"),
+	  resolve<int64_t>(*schema, "rateLimit"),
+	  resolve<int64_t>(*schema, "timeoutMs"),
+	  resolve<std::string_view>(*schema, "tls.certificate"),
+	  resolve<std::string_view>(*schema, "tls.key"),
+	  resolve<std::string_view>(*schema, "tls.minVersion"),
+	  resolve<RuntimeArray<RuntimeObject>>(*schema, "routes"),
+	  resolve<std::string_view>(*schema, "routes[].prefix"),
+	  resolve<std::string_view>(*schema, "routes[].backend"),
+	  resolve<int64_t>(*schema, "routes[].weight")};
+
+	std::vector<Config>        generated;
+	std::vector<RuntimeObject> runtime;
+	for (size_t i = 0; i < count; i++)
+	{
+		auto               text = tenant_config(i);
+		struct ucl_parser *p    = ucl_parser_new(UCL_PARSER_NO_IMPLICIT_ARRAYS);
+		ucl_parser_add_string(p, text.c_str(), text.size());
+		auto *obj = ucl_parser_get_object(p);
+		ucl_parser_free(p);
+		auto conf = make_config(obj);
+		auto rt   = make_runtime_config(schema, obj);
+		ucl_object_unref(obj);
+		if (!std::holds_alternative<Config>(conf) ||
+		    !std::holds_alternative<RuntimeObject>(rt))
+		{
+			std::abort();
+		}
+		generated.push_back(std::get<Config>(conf));
+		runtime.push_back(std::get<RuntimeObject>(rt));
+	}
+	std::cout << "Reading " << count << " tenant configs " << reads
+	          << " times each" << std::endl;
+
+	size_t checksum = 0;
+	double accessors = time_ms([&]() {
+		for (size_t r = 0; r < reads; r++)
+		{
+			for (auto &conf : generated)
+			{
+				checksum += walk(conf);
+			}
+		}
+	});
+	std::cout << "Generated accessors: " << accessors << " ms" << std::endl;
+	double handleReads = time_ms([&]() {
+		for (size_t r = 0; r < reads; r++)
+		{
+			for (auto &conf : runtime)
+			{
+				checksum += walk(conf, handles);
+			}
+		}
+	});
+	std::cout << "Runtime handles:     " << handleReads << " ms ("
+	          << accessors / handleReads << "x)" << std::endl;
+	double lookups = time_ms([&]() {
+		for (size_t r = 0; r < reads; r++)
+		{
+			for (auto &conf : runtime)
+			{
+				checksum += walk(conf.object());
+			}
+		}
+	});
+	std::cout << "String lookups:      " << lookups << " ms ("
+	          << accessors / lookups << "x)" << std::endl;
+	std::cout << "Checksum: " << checksum << std::endl;
+	return EXIT_SUCCESS;
+}
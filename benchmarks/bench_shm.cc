@@ -0,0 +1,83 @@
+#include "bench_shm.h"
+#include "bench_helpers.h"
+#include <cstdlib>
+
+using namespace config::detail;
+
+/**
+ * Compares what each worker does on a reload: parsing and validating a
+ * tenant config itself, or reading the config that one process published to
+ * shared memory.
+ */
+int main(int argc, char **argv)
+{
+	size_t reloads = (argc > 1) ? std::strtoul(argv[1], nullptr, 10) : 2000;
+	size_t routes  = (argc > 2) ? std::strtoul(argv[2], nullptr, 10) : 512;
+	auto   text    = tenant_config(1, routes);
+	auto   name    = "/config-gen-bench-shm-" + std::to_string(getpid());
+	auto   region  = std::get<std::shared_ptr<SharedConfigRegion>>(
+	  SharedConfigRegion::create(name, 4 * 1024 * 1024));
+	auto reader =
+	  std::get<ConfigSharedReader>(ConfigSharedReader::attach(name));
+	auto parse = [&]() {
+		struct ucl_parser *p = ucl_parser_new(UCL_PARSER_NO_IMPLICIT_ARRAYS);
+		ucl_parser_add_string(p, text.c_str(), text.size());
+		auto *obj = ucl_parser_get_object(p);
+		ucl_parser_free(p);
+		return obj;
+	};
+	auto *obj   = parse();
+	auto  image = encode_flat(obj);
+	ucl_object_unref(obj);
+	std::cout << "Reloading a tenant config with " << routes << " routes "
+	          << reloads << " times: " << text.size() / 1024 << " KiB of UCL, "
+	          << image.size() / 1024 << " KiB flat image" << std::endl;
+
+	size_t checksum = 0;
+	double reparse  = time_ms([&]() {
+		for (size_t i = 0; i < reloads; i++)
+		{
+			auto *o    = parse();
+			auto  conf = make_config(o);
+			ucl_object_unref(o);
+			if (!std::holds_alternative<Config>(conf))
+			{
+				std::abort();
+			}
+			checksum += std::get<Config>(conf).rateLimit();
+		}
+	});
+	std::cout << "Parse and validate: " << reparse / reloads * 1000
+	          << " us per reload" << std::endl;
+	double publish = time_ms([&]() {
+		for (size_t i = 0; i < reloads; i++)
+		{
+			if (!std::holds_alternative<uint64_t>(region->publish(image)))
+			{
+				std::abort();
+			}
+		}
+	});
+	std::cout << "Publish:            " << publish / reloads * 1000
+	          << " us per reload, once for all workers" << std::endl;
+	double read = time_ms([&]() {
+		for (size_t i = 0; i < reloads; i++)
+		{
+			// Publish without timing the encoding, so that every read sees a
+			// new generation.
+			region->publish(image);
+			auto conf = reader.current();
+			if (!std::holds_alternative<ConfigShared>(conf))
+			{
+				std::abort();
+			}
+			checksum += std::get<ConfigShared>(conf).rateLimit();
+		}
+	});
+	double readOnly = read - publish;
+	std::cout << "Shared-memory read: " << readOnly / reloads * 1000
+	          << " us per reload (" << reparse / readOnly << "x)" << std::endl;
+	std::cout << "Checksum: " << checksum << std::endl;
+	SharedConfigRegion::remove(name);
+	return EXIT_SUCCESS;
+}
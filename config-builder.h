@@ -0,0 +1,383 @@
+// Copyright David Chisnall
+// SPDX-License-Identifier: MIT
+#pragma once
+
+#include "config-generic.h"
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstring>
+#include <initializer_list>
+#include <memory>
+#include <optional>
+#include <ranges>
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace CONFIG_DETAIL_NAMESPACE
+{
+	/**
+	 * Bump allocator for the strings in configs assembled by builders.
+	 * Memory is allocated in large chunks and is all freed together when the
+	 * arena is destroyed.
+	 *
+	 * libucl has no allocator hook, so the UCL nodes themselves are still
+	 * allocated individually by libucl and freed when the last config using
+	 * them is destroyed.  Only string payloads live in the arena.  Configs
+	 * built with an arena refer to its memory and must not outlive it.
+	 */
+	class Arena
+	{
+		/**
+		 * The chunks allocated so far.
+		 */
+		std::vector<std::unique_ptr<char[]>> chunks;
+
+		/**
+		 * The next free byte in the current chunk.
+		 */
+		char *cursor = nullptr;
+
+		/**
+		 * The number of free bytes in the current chunk.
+		 */
+		size_t remaining = 0;
+
+		/**
+		 * The size of each chunk.
+		 */
+		size_t chunkSize;
+
+		/**
+		 * The total number of bytes allocated from the arena.
+		 */
+		size_t used = 0;
+
+		public:
+		/**
+		 * Constructor.  Memory is requested from the system in chunks of
+		 * `chunk` bytes, or larger for allocations that do not fit.
+		 */
+		explicit Arena(size_t chunk = 64 * 1024) : chunkSize(chunk) {}
+
+		/**
+		 * Arenas cannot be copied.
+		 */
+		Arena(const Arena &) = delete;
+
+		/**
+		 * Returns `length` bytes of uninitialised memory.
+		 */
+		char *allocate(size_t length)
+		{
+			if (length > remaining)
+			{
+				size_t size = std::max(chunkSize, length);
+				chunks.push_back(std::make_unique<char[]>(size));
+				cursor    = chunks.back().get();
+				remaining = size;
+			}
+			char *result = cursor;
+			cursor += length;
+			remaining -= length;
+			used += length;
+			return result;
+		}
+
+		/**
+		 * Copies `str` into the arena, followed by a null terminator, and
+		 * returns the copy.
+		 */
+		std::string_view copy(std::string_view str)
+		{
+			char *buffer = allocate(str.size() + 1);
+			std::memcpy(buffer, str.data(), str.size());
+			buffer[str.size()] = '\0';
+			return {buffer, str.size()};
+		}
+
+		/**
+		 * Returns the number of bytes allocated from the arena.
+		 */
+		size_t size() const
+		{
+			return used;
+		}
+	};
+
+	/**
+	 * Returns a new UCL string node for `str`.  If `arena` is not null, the
+	 * payload is copied into it and, because libucl frees only payloads that
+	 * it allocated itself, is left to the arena.  Otherwise libucl copies the
+	 * string.
+	 */
+	inline ucl_object_t *make_node(Arena *arena, std::string_view str)
+	{
+		if (arena == nullptr)
+		{
+			return ucl_object_fromlstring(str.data(), str.size());
+		}
+		auto copy      = arena->copy(str);
+		auto node      = ucl_object_typed_new(UCL_STRING);
+		node->value.sv = copy.data();
+		node->len      = copy.size();
+		return node;
+	}
+
+	/**
+	 * Returns a new UCL boolean node.
+	 */
+	inline ucl_object_t *make_node(Arena *, bool value)
+	{
+		return ucl_object_frombool(value);
+	}
+
+	/**
+	 * Returns a new UCL number node.
+	 */
+	template<typename T>
+	requires(std::is_arithmetic_v<T> && !std::is_same_v<T, bool>)
+	ucl_object_t *make_node(Arena *, T value)
+	{
+		if constexpr (std::is_floating_point_v<T>)
+		{
+			return ucl_object_fromdouble(value);
+		}
+		else
+		{
+			return ucl_object_fromint(static_cast<int64_t>(value));
+		}
+	}
+
+	/**
+	 * Base class for generated builders.  A builder owns a UCL object that
+	 * it fills in as its setters are called, and records the first error
+	 * (an out-of-range value or, when it is finished, a missing required
+	 * property).  Builders can be moved but not copied.
+	 */
+	class BuilderBase
+	{
+		/**
+		 * The first error, if any.
+		 */
+		struct Error
+		{
+			/**
+			 * The error code.
+			 */
+			ucl_schema_error_code code;
+
+			/**
+			 * Description of the error, without the path.
+			 */
+			std::string message;
+
+			/**
+			 * The path of the property with the error, relative to this
+			 * builder.
+			 */
+			std::string path;
+		};
+
+		/**
+		 * The first error, if any.
+		 */
+		std::optional<Error> error;
+
+		protected:
+		/**
+		 * The arena that strings are copied into, or null if libucl should
+		 * own them.
+		 */
+		Arena *arena;
+
+		/**
+		 * The object being built.
+		 */
+		ucl_object_t *obj;
+
+		/**
+		 * Constructor, starts an empty object whose strings will be copied
+		 * into `a`, if it is not null.
+		 */
+		explicit BuilderBase(Arena *a)
+		  : arena(a), obj(ucl_object_typed_new(UCL_OBJECT))
+		{
+		}
+
+		/**
+		 * Move constructor.
+		 */
+		BuilderBase(BuilderBase &&other)
+		  : error(std::move(other.error)),
+		    arena(other.arena),
+		    obj(std::exchange(other.obj, ucl_object_typed_new(UCL_OBJECT)))
+		{
+		}
+
+		/**
+		 * Destructor, releases the object if it was never finished.
+		 */
+		~BuilderBase()
+		{
+			ucl_object_unref(obj);
+		}
+
+		/**
+		 * Records an error, unless one has already been recorded.
+		 */
+		void fail(ucl_schema_error_code code,
+		          std::string_view      message,
+		          std::string_view      path)
+		{
+			if (!error)
+			{
+				error = Error{code, std::string(message), std::string(path)};
+			}
+		}
+
+		/**
+		 * Records an error if `value` is outside `[min, max]`.
+		 */
+		template<typename T>
+		void check_range(T value, int64_t min, int64_t max, std::string_view key)
+		{
+			if (std::cmp_less(value, min) || std::cmp_greater(value, max))
+			{
+				fail(UCL_SCHEMA_CONSTRAINT, "value out of range for", key);
+			}
+		}
+
+		/**
+		 * Records an error if `value` is not in the format parsed by `F`.
+		 */
+		template<typename F>
+		void check_format(std::string_view value, std::string_view key)
+		{
+			if (!F::parse(value))
+			{
+				fail(UCL_SCHEMA_CONSTRAINT,
+				     "value does not match format for",
+				     key);
+			}
+		}
+
+		/**
+		 * Sets the property `key`, which must have static storage duration,
+		 * to `value`, taking ownership of `value`.
+		 */
+		template<size_t N>
+		void set_property(const char (&key)[N], ucl_object_t *value)
+		{
+			ucl_object_replace_key(obj, value, key, N - 1, false);
+		}
+
+		/**
+		 * Returns the array property `key`, creating it if necessary.
+		 */
+		template<size_t N>
+		ucl_object_t *array_property(const char (&key)[N])
+		{
+			auto *existing = ucl_object_lookup_len(obj, key, N - 1);
+			if ((existing != nullptr) &&
+			    (ucl_object_type(existing) == UCL_ARRAY))
+			{
+				return const_cast<ucl_object_t *>(existing);
+			}
+			auto *created = ucl_object_typed_new(UCL_ARRAY);
+			set_property(key, created);
+			return created;
+		}
+
+		/**
+		 * Finishes `child` and returns its object, taking ownership, or
+		 * null if it had an error.  Errors are copied into this builder with
+		 * `key` prefixed to their path.
+		 */
+		template<typename Builder>
+		ucl_object_t *adopt(Builder &child, std::string_view key)
+		{
+			auto *value = child.release();
+			if (value == nullptr)
+			{
+				auto &childError = static_cast<BuilderBase &>(child).error;
+				std::string path{key};
+				if (!childError->path.empty())
+				{
+					path += '.';
+					path += childError->path;
+				}
+				fail(childError->code, childError->message, path);
+				childError.reset();
+			}
+			return value;
+		}
+
+		/**
+		 * Finishes the object.  Checks that every property in `required` is
+		 * set and returns an owning reference to the object, or null if
+		 * there was an error.  Either way, the builder is left empty and can
+		 * be reused.
+		 */
+		ucl_object_t *finish(std::span<const std::string_view> required)
+		{
+			for (auto key : required)
+			{
+				if (ucl_object_lookup_len(obj, key.data(), key.size()) ==
+				    nullptr)
+				{
+					fail(UCL_SCHEMA_MISSING_PROPERTY,
+					     "missing required property",
+					     key);
+				}
+			}
+			auto *result = std::exchange(obj, ucl_object_typed_new(UCL_OBJECT));
+			if (error)
+			{
+				ucl_object_unref(result);
+				return nullptr;
+			}
+			return result;
+		}
+
+		/**
+		 * Finishes a root object and constructs `Config` from it, or returns
+		 * the first error.  The error does not refer to an object, because
+		 * the partly built object is discarded.
+		 */
+		template<typename Config>
+		std::variant<Config, ucl_schema_error>
+		build_config(std::span<const std::string_view> required)
+		{
+			auto *result = finish(required);
+			if (result == nullptr)
+			{
+				ucl_schema_error err{};
+				err.code = error->code;
+				snprintf(err.msg,
+				         sizeof(err.msg),
+				         "%s %s",
+				         error->message.c_str(),
+				         error->path.c_str());
+				err.obj = nullptr;
+				error.reset();
+				return err;
+			}
+			Config conf(result);
+			ucl_object_unref(result);
+			return conf;
+		}
+
+		public:
+		/**
+		 * Builders cannot be copied.
+		 */
+		BuilderBase(const BuilderBase &) = delete;
+	};
+
+} // namespace CONFIG_DETAIL_NAMESPACE
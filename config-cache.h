@@ -0,0 +1,582 @@
+// Copyright David Chisnall
+// SPDX-License-Identifier: MIT
+#pragma once
+
+#include "config-loader.h"
+#include <array>
+#include <atomic>
+#include <cctype>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <variant>
+#include <vector>
+
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace CONFIG_DETAIL_NAMESPACE
+{
+	/**
+	 * Key for a config in a validation cache: a 128-bit hash of the bytes of
+	 * the config file, seeded with the hash of the schema and checks that it
+	 * was validated with, the checker version and the identity of libucl.
+	 */
+	struct ValidationKey
+	{
+		/**
+		 * The first half of the hash.
+		 */
+		uint64_t first;
+
+		/**
+		 * The second half of the hash.
+		 */
+		uint64_t second;
+
+		/**
+		 * Keys are equal if both halves are equal.
+		 */
+		bool operator==(const ValidationKey &) const = default;
+	};
+
+	/**
+	 * Returns a hash identifying the libucl that validates configs in this
+	 * process.  libucl does not report its version, so this hashes the path,
+	 * inode, size and modification time of the file that
+	 * `ucl_object_validate` was loaded from, which change when libucl is
+	 * upgraded.  If libucl is linked statically, that file is the
+	 * executable, so rebuilding it also gives a new identity.
+	 */
+	inline uint64_t libucl_identity()
+	{
+		static const uint64_t identity = []() {
+			Dl_info info;
+			if ((dladdr(reinterpret_cast<void *>(&ucl_object_validate),
+			            &info) == 0) ||
+			    (info.dli_fname == nullptr))
+			{
+				return uint64_t(0);
+			}
+			uint64_t    h = hash_bytes(info.dli_fname, strlen(info.dli_fname));
+			struct stat sb;
+			if (stat(info.dli_fname, &sb) == 0)
+			{
+				for (uint64_t field : {uint64_t(sb.st_dev),
+				                       uint64_t(sb.st_ino),
+				                       uint64_t(sb.st_size),
+				                       uint64_t(sb.st_mtim.tv_sec),
+				                       uint64_t(sb.st_mtim.tv_nsec)})
+				{
+					h = hash_mix(h ^ field);
+				}
+			}
+			return h;
+		}();
+		return identity;
+	}
+
+	/**
+	 * What, other than its own bytes, the parsed value of a config may
+	 * depend on.
+	 */
+	enum class ConfigInputs
+	{
+		/**
+		 * Only the bytes of the file.
+		 */
+		Contents,
+
+		/**
+		 * The bytes and the path of the file, which the `$FILENAME` and
+		 * `$CURDIR` variables expand to.
+		 */
+		Path,
+
+		/**
+		 * Anything: the file uses a macro, which may read other files, or a
+		 * variable other than the file variables.
+		 */
+		Unknown,
+	};
+
+	/**
+	 * Returns what the config with `contents` may depend on.  This errs on
+	 * the side of finding macros and variables that are not there, for
+	 * example in strings and comments.  Any `.` at the start of a word that
+	 * is followed by a letter is taken as a macro, and any `$` that is
+	 * followed by a letter or `{` as a variable.
+	 */
+	inline ConfigInputs config_inputs(std::span<const std::byte> contents)
+	{
+		std::string_view text{reinterpret_cast<const char *>(contents.data()),
+		                      contents.size()};
+		auto isWord = [](char c) {
+			return isalnum(static_cast<unsigned char>(c)) || (c == '_');
+		};
+		ConfigInputs inputs = ConfigInputs::Contents;
+		for (size_t i = 0; i + 1 < text.size(); i++)
+		{
+			char next = text[i + 1];
+			if ((text[i] == '.') && isalpha(static_cast<unsigned char>(next)) &&
+			    ((i == 0) || (!isWord(text[i - 1]) && (text[i - 1] != '.'))))
+			{
+				return ConfigInputs::Unknown;
+			}
+			if ((text[i] != '$') ||
+			    ((next != '{') && !isalpha(static_cast<unsigned char>(next))))
+			{
+				continue;
+			}
+			size_t start = i + ((next == '{') ? 2 : 1);
+			size_t end   = start;
+			while ((end < text.size()) && isWord(text[end]))
+			{
+				end++;
+			}
+			auto name = text.substr(start, end - start);
+			if ((name != "FILENAME") && (name != "CURDIR"))
+			{
+				return ConfigInputs::Unknown;
+			}
+			inputs = ConfigInputs::Path;
+		}
+		return inputs;
+	}
+
+	/**
+	 * A set of configs that are known to pass validation, persisted in a file
+	 * so that configs that have not changed since the last run do not need to
+	 * be validated again.  Only configs that passed are recorded, so configs
+	 * that fail are validated each time and report the same errors.
+	 *
+	 * The file is read when the cache is constructed and rewritten by
+	 * `flush`, which writes a new file and renames it over the old one, so
+	 * readers never see a partial update.  Writers take an exclusive `flock`
+	 * on a lock file next to the cache and merge in the entries that other
+	 * processes have added since, so several processes can share a cache
+	 * without losing each other's entries.  A cache file that is missing or
+	 * not in the expected format is treated as empty.
+	 *
+	 * The hash is not cryptographic.  Anyone who can write the cache file can
+	 * make an invalid config skip validation, so it should be writable only
+	 * by the processes that load the configs.
+	 */
+	class ValidationCache
+	{
+		/**
+		 * The first eight bytes of a cache file.  Files written on a machine
+		 * with the other byte order do not match and are ignored.
+		 */
+		static constexpr uint64_t Magic = 0x31304843564c4355ULL;
+
+		/**
+		 * Hash for keys in `entries`.  Keys are already hashes, so this uses
+		 * one half directly.
+		 */
+		struct KeyHash
+		{
+			/**
+			 * Returns the first half of `key`.
+			 */
+			size_t operator()(const ValidationKey &key) const
+			{
+				return key.first;
+			}
+		};
+
+		/**
+		 * The path of the cache file.
+		 */
+		std::filesystem::path path;
+
+		/**
+		 * Guards `entries` and `added`.  Lookups, which are the common case,
+		 * take it shared.
+		 */
+		mutable std::shared_mutex lock;
+
+		/**
+		 * The keys of configs that are known to be valid.
+		 */
+		std::unordered_set<ValidationKey, KeyHash> entries;
+
+		/**
+		 * The number of keys added since the last successful flush.
+		 */
+		size_t added = 0;
+
+		/**
+		 * The number of lookups that found a key.
+		 */
+		std::atomic<size_t> hitCount{0};
+
+		/**
+		 * The number of lookups that did not find a key.
+		 */
+		std::atomic<size_t> missCount{0};
+
+		/**
+		 * Adds the keys in the cache file to `entries`.  The caller must hold
+		 * `lock` exclusively or be the constructor.
+		 */
+		void read_file()
+		{
+			auto mapped = MappedFile::open(path);
+			auto *file  = std::get_if<std::shared_ptr<const MappedFile>>(&mapped);
+			if (file == nullptr)
+			{
+				return;
+			}
+			auto     bytes = (*file)->bytes();
+			uint64_t magic;
+			if ((bytes.size() < sizeof(magic)) ||
+			    ((bytes.size() - sizeof(magic)) % sizeof(ValidationKey) != 0))
+			{
+				return;
+			}
+			memcpy(&magic, bytes.data(), sizeof(magic));
+			if (magic != Magic)
+			{
+				return;
+			}
+			for (size_t offset = sizeof(magic); offset < bytes.size();
+			     offset += sizeof(ValidationKey))
+			{
+				ValidationKey key;
+				memcpy(&key, bytes.data() + offset, sizeof(key));
+				entries.insert(key);
+			}
+		}
+
+		/**
+		 * Writes `length` bytes from `data` to `fd`, retrying short writes.
+		 * Returns false on error.
+		 */
+		static bool write_all(int fd, const void *data, size_t length)
+		{
+			auto *p = static_cast<const char *>(data);
+			while (length > 0)
+			{
+				ssize_t written = ::write(fd, p, length);
+				if (written < 0)
+				{
+					if (errno == EINTR)
+					{
+						continue;
+					}
+					return false;
+				}
+				p += written;
+				length -= static_cast<size_t>(written);
+			}
+			return true;
+		}
+
+		/**
+		 * Writes every entry to a new file and renames it over the cache
+		 * file.  The caller must hold `lock` exclusively and the lock file.
+		 * Returns false on error, leaving the cache file unchanged.
+		 */
+		bool write_file() const
+		{
+			std::vector<uint64_t> words;
+			words.reserve(1 + entries.size() * 2);
+			words.push_back(Magic);
+			for (auto &key : entries)
+			{
+				words.push_back(key.first);
+				words.push_back(key.second);
+			}
+			std::string temporary = path.string() + ".XXXXXX";
+			int         fd        = mkstemp(temporary.data());
+			if (fd < 0)
+			{
+				return false;
+			}
+			bool written =
+			  (fchmod(fd, 0644) == 0) &&
+			  write_all(fd, words.data(), words.size() * sizeof(uint64_t)) &&
+			  (fsync(fd) == 0);
+			written = (close(fd) == 0) && written;
+			if (!written || (rename(temporary.c_str(), path.c_str()) != 0))
+			{
+				unlink(temporary.c_str());
+				return false;
+			}
+			return true;
+		}
+
+		public:
+		/**
+		 * Constructor, uses the cache file at `p`, which need not exist.
+		 */
+		explicit ValidationCache(std::filesystem::path p) : path(std::move(p))
+		{
+			read_file();
+		}
+
+		/**
+		 * Caches cannot be copied.
+		 */
+		ValidationCache(const ValidationCache &) = delete;
+
+		/**
+		 * Destructor, writes any keys that have not been flushed.
+		 */
+		~ValidationCache()
+		{
+			flush();
+		}
+
+		/**
+		 * Returns the key for a config file with `contents`, validated
+		 * against the schema and checks whose hash is `schema`.  The key
+		 * also covers the version of the checks compiled into this program
+		 * and the libucl that it validates with, so upgrading either
+		 * invalidates the cache.  Configs whose value depends on their
+		 * location pass the canonical path of the file as `path`, which the
+		 * key then covers as well.
+		 */
+		static ValidationKey key(std::span<const std::byte> contents,
+		                         uint64_t                   schema,
+		                         std::string_view           path = {})
+		{
+			schema = hash_mix(hash_mix(schema ^ CheckerVersion) ^
+			                  libucl_identity());
+			if (!path.empty())
+			{
+				schema = hash_bytes(path.data(), path.size(), schema);
+			}
+			return {
+			  hash_bytes(contents.data(), contents.size(), hash_mix(schema)),
+			  hash_bytes(contents.data(),
+			             contents.size(),
+			             hash_mix(schema ^ 0x9e3779b97f4a7c15ULL))};
+		}
+
+		/**
+		 * Returns true if the config with `key` is known to be valid.
+		 */
+		bool contains(const ValidationKey &key)
+		{
+			bool found;
+			{
+				std::shared_lock guard(lock);
+				found = entries.contains(key);
+			}
+			(found ? hitCount : missCount)++;
+			return found;
+		}
+
+		/**
+		 * Records that the config with `key` is valid.  The key is written to
+		 * the file by the next `flush`.
+		 */
+		void insert(const ValidationKey &key)
+		{
+			std::unique_lock guard(lock);
+			if (entries.insert(key).second)
+			{
+				added++;
+			}
+		}
+
+		/**
+		 * Writes the cache file if keys have been added since it was last
+		 * written, merging in keys that other processes have written since
+		 * it was read.  Returns false if the file could not be written, in
+		 * which case the keys are kept for the next attempt.
+		 */
+		bool flush()
+		{
+			std::unique_lock guard(lock);
+			if (added == 0)
+			{
+				return true;
+			}
+			std::string lockPath = path.string() + ".lock";
+			int fd = ::open(lockPath.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+			if (fd < 0)
+			{
+				return false;
+			}
+			bool written = false;
+			if (flock(fd, LOCK_EX) == 0)
+			{
+				read_file();
+				written = write_file();
+			}
+			// Closing the lock file releases the lock.
+			close(fd);
+			if (written)
+			{
+				added = 0;
+			}
+			return written;
+		}
+
+		/**
+		 * Returns the number of keys in the cache.
+		 */
+		size_t size() const
+		{
+			std::shared_lock guard(lock);
+			return entries.size();
+		}
+
+		/**
+		 * Returns the number of lookups that found a key.
+		 */
+		size_t hits() const
+		{
+			return hitCount;
+		}
+
+		/**
+		 * Returns the number of lookups that did not find a key.
+		 */
+		size_t misses() const
+		{
+			return missCount;
+		}
+	};
+
+	/**
+	 * Parses the file at `path` and, unless `cache` records that a file with
+	 * the same contents passed validation against the schema whose hash is
+	 * `schema`, validates and constructs the config with `make`, which
+	 * should be the `make_config` function for the generated class.  Configs
+	 * that pass are added to `cache`.  Configs found in the cache are
+	 * constructed without validation by `trust`.  Configs that use file
+	 * variables are keyed by their canonical path as well as their
+	 * contents, and configs that use macros or other variables are always
+	 * validated.  Reports phases in the same way as
+	 * `load_config_file`, with hashing counted as part of parsing, so
+	 * configs found in the cache report no validation phase.
+	 */
+	template<typename Config,
+	         typename Make,
+	         typename Trust,
+	         LoadObserver O = NullObserver>
+	std::variant<Config, LoadError>
+	load_config_cached(const std::filesystem::path &path,
+	                   ValidationCache             &cache,
+	                   uint64_t                     schema,
+	                   Make                       &&make,
+	                   Trust                      &&trust,
+	                   O                          &&observer = O{})
+	{
+		ucl_object_t                *obj;
+		std::optional<ValidationKey> key;
+		{
+			ObservedPhase phase(observer, LoadPhase::Parse);
+			auto          mapped = MappedFile::open(path);
+			if (auto *err = std::get_if<LoadError>(&mapped))
+			{
+				return std::move(*err);
+			}
+			auto bytes = std::get<std::shared_ptr<const MappedFile>>(mapped)
+			               ->bytes();
+			struct ucl_parser *p = ucl_parser_new(UCL_PARSER_NO_IMPLICIT_ARRAYS);
+			// Relative includes are found next to the file, as they are when
+			// libucl reads the file itself.  The file variables expand to the
+			// canonical path, which the key covers for configs that use them.
+			ucl_parser_set_filevars(p, path.c_str(), true);
+			ucl_parser_add_chunk(
+			  p,
+			  reinterpret_cast<const unsigned char *>(bytes.data()),
+			  bytes.size());
+			if (const char *err = ucl_parser_get_error(p))
+			{
+				LoadError e{path.string() + ": " + err};
+				ucl_parser_free(p);
+				return e;
+			}
+			obj = ucl_parser_get_object(p);
+			ucl_parser_free(p);
+			if (obj == nullptr)
+			{
+				return LoadError{path.string() + ": empty config"};
+			}
+			phase.bytes = bytes.size();
+			switch (config_inputs(bytes))
+			{
+				case ConfigInputs::Contents:
+					key = ValidationCache::key(bytes, schema);
+					break;
+				case ConfigInputs::Path:
+				{
+					std::error_code ec;
+					auto canonical = std::filesystem::canonical(path, ec);
+					if (!ec)
+					{
+						key = ValidationCache::key(
+						  bytes, schema, canonical.native());
+					}
+					break;
+				}
+				case ConfigInputs::Unknown:
+					break;
+			}
+		}
+		auto result = [&]() -> std::variant<Config, LoadError> {
+			if (key && cache.contains(*key))
+			{
+				return trust(obj);
+			}
+			auto confOrError = make(obj);
+			if (auto *err = std::get_if<ucl_schema_error>(&confOrError))
+			{
+				return LoadError{*err};
+			}
+			if (key)
+			{
+				cache.insert(*key);
+			}
+			return std::get<Config>(confOrError);
+		}();
+		ucl_object_unref(obj);
+		return result;
+	}
+
+	/**
+	 * Loads every file in `paths` with `load_config_cached`, running on
+	 * `executor` as described for `load_each`, and then flushes `cache`, so
+	 * that the next run finds the configs that passed.
+	 */
+	template<typename Config,
+	         Executor E,
+	         typename Make,
+	         typename Trust,
+	         LoadObserver O = NullObserver>
+	std::vector<std::variant<Config, LoadError>>
+	load_configs_cached(std::span<const std::filesystem::path> paths,
+	                    E                                     &executor,
+	                    ValidationCache                       &cache,
+	                    uint64_t                               schema,
+	                    Make                                 &&make,
+	                    Trust                                &&trust,
+	                    O                                    &&observer = O{})
+	{
+		auto results = load_each<Config>(
+		  paths, executor, [&](const std::filesystem::path &path) {
+			  return load_config_cached<Config>(
+			    path, cache, schema, make, trust, observer);
+		  });
+		cache.flush();
+		return results;
+	}
+
+} // namespace CONFIG_DETAIL_NAMESPACE
@@ -0,0 +1,598 @@
+// Copyright David Chisnall
+// SPDX-License-Identifier: MIT
+#pragma once
+
+#include "config-generic.h"
+#include <algorithm>
+#include <cassert>
+#include <bit>
+#include <limits>
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+namespace CONFIG_DETAIL_NAMESPACE
+{
+	/**
+	 * A dense bitmap with one bit per row of a columnar store.  Used both for
+	 * the presence of optional values and for the set of rows selected by a
+	 * filter.
+	 */
+	class Bitmap
+	{
+		/**
+		 * The bits, 64 rows per word.  Bits past `bits` in the last word are
+		 * always zero.
+		 */
+		std::vector<uint64_t> words;
+
+		/**
+		 * The number of rows.
+		 */
+		size_t bits = 0;
+
+		public:
+		/**
+		 * Constructs a bitmap of `n` rows, all set to `value`.
+		 */
+		explicit Bitmap(size_t n = 0, bool value = false)
+		  : words((n + 63) / 64, value ? ~uint64_t(0) : 0), bits(n)
+		{
+			if (value && (n % 64 != 0))
+			{
+				words.back() = (uint64_t(1) << (n % 64)) - 1;
+			}
+		}
+
+		/**
+		 * Appends a row.
+		 */
+		void push_back(bool value)
+		{
+			if (bits % 64 == 0)
+			{
+				words.push_back(0);
+			}
+			words.back() |= uint64_t(value) << (bits % 64);
+			bits++;
+		}
+
+		/**
+		 * Reserves space for `n` rows.
+		 */
+		void reserve(size_t n)
+		{
+			words.reserve((n + 63) / 64);
+		}
+
+		/**
+		 * Returns the number of rows.
+		 */
+		size_t size() const
+		{
+			return bits;
+		}
+
+		/**
+		 * Returns whether row `i` is set.
+		 */
+		bool operator[](size_t i) const
+		{
+			return (words[i / 64] >> (i % 64)) & 1;
+		}
+
+		/**
+		 * Returns the underlying words, 64 rows per word.
+		 */
+		std::span<const uint64_t> data() const
+		{
+			return words;
+		}
+
+		/**
+		 * Returns the underlying words for modification.  Callers must keep
+		 * bits past `size()` clear.
+		 */
+		std::span<uint64_t> data()
+		{
+			return words;
+		}
+
+		/**
+		 * Returns the number of rows that are set.
+		 */
+		size_t count() const
+		{
+			size_t total = 0;
+			for (auto word : words)
+			{
+				total += std::popcount(word);
+			}
+			return total;
+		}
+
+		/**
+		 * Intersects this with `other`, which must have the same size.
+		 */
+		Bitmap &operator&=(const Bitmap &other)
+		{
+			for (size_t i = 0; i < words.size(); i++)
+			{
+				words[i] &= other.words[i];
+			}
+			return *this;
+		}
+
+		/**
+		 * Unions this with `other`, which must have the same size.
+		 */
+		Bitmap &operator|=(const Bitmap &other)
+		{
+			for (size_t i = 0; i < words.size(); i++)
+			{
+				words[i] |= other.words[i];
+			}
+			return *this;
+		}
+
+		/**
+		 * Returns the intersection of two bitmaps.
+		 */
+		friend Bitmap operator&(Bitmap a, const Bitmap &b)
+		{
+			return a &= b;
+		}
+
+		/**
+		 * Returns the union of two bitmaps.
+		 */
+		friend Bitmap operator|(Bitmap a, const Bitmap &b)
+		{
+			return a |= b;
+		}
+
+		/**
+		 * Calls `f` with the index of each row that is set, in order.
+		 */
+		template<typename F>
+		void for_each(F &&f) const
+		{
+			for (size_t w = 0; w < words.size(); w++)
+			{
+				for (uint64_t word = words[w]; word != 0; word &= word - 1)
+				{
+					f(w * 64 + std::countr_zero(word));
+				}
+			}
+		}
+	};
+
+	/**
+	 * Base for columns.  Tracks the presence of values in columns of optional
+	 * properties and provides the scan loop shared by all column types.
+	 */
+	class ColumnBase
+	{
+		protected:
+		/**
+		 * Which rows have a value.  Empty for columns of required
+		 * properties, which always have one.
+		 */
+		Bitmap present;
+
+		/**
+		 * True if this column holds an optional property.
+		 */
+		bool optional;
+
+		/**
+		 * Builds a bitmap with one bit per row, set if the row has a value
+		 * and `pred(i)` is true.  Rows are tested in blocks of 64 with no
+		 * branches inside a block, so that the compiler can vectorise the
+		 * predicate.
+		 */
+		template<typename Pred>
+		Bitmap scan(size_t rows, Pred &&pred) const
+		{
+			Bitmap result(rows);
+			auto   words = result.data();
+			for (size_t w = 0; w < words.size(); w++)
+			{
+				size_t   base  = w * 64;
+				size_t   count = std::min<size_t>(64, rows - base);
+				uint64_t word  = 0;
+				for (size_t i = 0; i < count; i++)
+				{
+					word |= uint64_t(bool(pred(base + i))) << i;
+				}
+				words[w] = word;
+			}
+			if (optional)
+			{
+				result &= present;
+			}
+			return result;
+		}
+
+		public:
+		/**
+		 * Constructor.  `isOptional` indicates whether rows may lack a value.
+		 */
+		explicit ColumnBase(bool isOptional) : optional(isOptional) {}
+
+		/**
+		 * Returns whether row `i` has a value.
+		 */
+		bool has(size_t i) const
+		{
+			return !optional || present[i];
+		}
+
+		/**
+		 * Returns the presence bitmap, or null if every row has a value.
+		 */
+		const Bitmap *presence() const
+		{
+			return optional ? &present : nullptr;
+		}
+	};
+
+	/**
+	 * Column of a scalar numeric or boolean property across many configs.
+	 * Values are stored contiguously, with rows that lack a value holding a
+	 * value-initialised placeholder.
+	 */
+	template<typename T>
+	class Column : public ColumnBase
+	{
+		/**
+		 * The type used to store values.  Booleans are stored as bytes to
+		 * avoid the packed `std::vector<bool>` specialisation, which cannot
+		 * be scanned as contiguous memory.
+		 */
+		using Storage = std::conditional_t<std::is_same_v<T, bool>, uint8_t, T>;
+
+		/**
+		 * The values, one per row.
+		 */
+		std::vector<Storage> values;
+
+		/**
+		 * Calls `f` with each value in the rows selected by `selection` and
+		 * present in this column, or in every row with a value if
+		 * `selection` is null.  Whole words of selected rows are handed to a
+		 * tight loop, so dense selections scan at memory speed.
+		 */
+		template<typename F>
+		void visit_selected(const Bitmap *selection, F &&f) const
+		{
+			if ((selection == nullptr) && !optional)
+			{
+				for (auto v : values)
+				{
+					f(v);
+				}
+				return;
+			}
+			Bitmap rows = (selection != nullptr) ? *selection
+			                                     : Bitmap(values.size(), true);
+			if (optional)
+			{
+				rows &= present;
+			}
+			auto words = rows.data();
+			for (size_t w = 0; w < words.size(); w++)
+			{
+				uint64_t word = words[w];
+				if (word == ~uint64_t(0))
+				{
+					for (size_t i = w * 64; i < w * 64 + 64; i++)
+					{
+						f(values[i]);
+					}
+					continue;
+				}
+				for (; word != 0; word &= word - 1)
+				{
+					f(values[w * 64 + std::countr_zero(word)]);
+				}
+			}
+		}
+
+		public:
+		/**
+		 * The type used to accumulate sums of this column.
+		 */
+		using Sum = std::conditional_t<
+		  std::is_floating_point_v<T>,
+		  double,
+		  std::conditional_t<std::is_signed_v<T>, int64_t, uint64_t>>;
+
+		/**
+		 * Constructor.  `isOptional` indicates whether rows may lack a value.
+		 */
+		explicit Column(bool isOptional = false) : ColumnBase(isOptional) {}
+
+		/**
+		 * Reserves space for `n` rows.
+		 */
+		void reserve(size_t n)
+		{
+			values.reserve(n);
+			if (optional)
+			{
+				present.reserve(n);
+			}
+		}
+
+		/**
+		 * Appends a row with a value.
+		 */
+		void push_back(T value)
+		{
+			values.push_back(value);
+			if (optional)
+			{
+				present.push_back(true);
+			}
+		}
+
+		/**
+		 * Appends a row without a value.
+		 */
+		void push_missing()
+		{
+			assert(optional);
+			values.push_back(T{});
+			present.push_back(false);
+		}
+
+		/**
+		 * Appends a row from an optional value.
+		 */
+		void push_back(const std::optional<T> &value)
+		{
+			if (value)
+			{
+				push_back(*value);
+			}
+			else
+			{
+				push_missing();
+			}
+		}
+
+		/**
+		 * Returns the number of rows.
+		 */
+		size_t size() const
+		{
+			return values.size();
+		}
+
+		/**
+		 * Returns the value in row `i`.  This is a placeholder if the row
+		 * has no value.
+		 */
+		T operator[](size_t i) const
+		{
+			return values[i];
+		}
+
+		/**
+		 * Returns the contiguous values, for custom scans.
+		 */
+		std::span<const Storage> data() const
+		{
+			return values;
+		}
+
+		/**
+		 * Returns the rows that have a value for which `pred` returns true.
+		 */
+		template<typename Pred>
+		Bitmap filter(Pred &&pred) const
+		{
+			const Storage *v = values.data();
+			return scan(values.size(),
+			            [&](size_t i) { return pred(static_cast<T>(v[i])); });
+		}
+
+		/**
+		 * Returns the number of rows in `selection` (or in total, if it is
+		 * null) that have a value.
+		 */
+		size_t count(const Bitmap *selection = nullptr) const
+		{
+			if (selection == nullptr)
+			{
+				return optional ? present.count() : values.size();
+			}
+			return optional ? (*selection & present).count()
+			                : selection->count();
+		}
+
+		/**
+		 * Returns the sum of the values in `selection`, or of all values.
+		 */
+		Sum sum(const Bitmap *selection = nullptr) const
+		{
+			Sum total = 0;
+			visit_selected(selection, [&](T v) { total += v; });
+			return total;
+		}
+
+		/**
+		 * Returns the smallest value in `selection`, or of all values, or
+		 * nothing if there are no values.
+		 */
+		std::optional<T> min(const Bitmap *selection = nullptr) const
+		{
+			std::optional<T> result;
+			T                best = std::numeric_limits<T>::max();
+			visit_selected(selection, [&](T v) {
+				best   = std::min(best, v);
+				result = best;
+			});
+			return result;
+		}
+
+		/**
+		 * Returns the largest value in `selection`, or of all values, or
+		 * nothing if there are no values.
+		 */
+		std::optional<T> max(const Bitmap *selection = nullptr) const
+		{
+			std::optional<T> result;
+			T                best = std::numeric_limits<T>::lowest();
+			visit_selected(selection, [&](T v) {
+				best   = std::max(best, v);
+				result = best;
+			});
+			return result;
+		}
+
+		/**
+		 * Returns a histogram of the values in `selection`, or of all values.
+		 * `bounds` must be sorted in ascending order.  Bucket 0 counts values
+		 * below `bounds[0]`, bucket `i` counts values in
+		 * `[bounds[i - 1], bounds[i])` and the last bucket counts values at or
+		 * above the last bound.
+		 */
+		std::vector<size_t> histogram(std::span<const T> bounds,
+		                              const Bitmap      *selection = nullptr) const
+		{
+			std::vector<size_t> buckets(bounds.size() + 1);
+			visit_selected(selection, [&](T v) {
+				size_t bucket = 0;
+				for (auto bound : bounds)
+				{
+					bucket += (v >= bound);
+				}
+				buckets[bucket]++;
+			});
+			return buckets;
+		}
+	};
+
+	/**
+	 * Column of a string property across many configs.  The strings are
+	 * copied into a single contiguous buffer, so the column does not refer to
+	 * the configs that it was built from.
+	 */
+	class StringColumn : public ColumnBase
+	{
+		/**
+		 * The contents of every string, back to back.
+		 */
+		std::string bytes;
+
+		/**
+		 * The end offset of each row's string in `bytes`.  Row `i` starts at
+		 * the end of row `i - 1`.
+		 */
+		std::vector<size_t> ends;
+
+		public:
+		/**
+		 * Constructor.  `isOptional` indicates whether rows may lack a value.
+		 */
+		explicit StringColumn(bool isOptional = false) : ColumnBase(isOptional)
+		{
+		}
+
+		/**
+		 * Reserves space for `n` rows.
+		 */
+		void reserve(size_t n)
+		{
+			ends.reserve(n);
+			if (optional)
+			{
+				present.reserve(n);
+			}
+		}
+
+		/**
+		 * Appends a row with a value.
+		 */
+		void push_back(std::string_view value)
+		{
+			bytes += value;
+			ends.push_back(bytes.size());
+			if (optional)
+			{
+				present.push_back(true);
+			}
+		}
+
+		/**
+		 * Appends a row without a value.
+		 */
+		void push_missing()
+		{
+			assert(optional);
+			ends.push_back(bytes.size());
+			present.push_back(false);
+		}
+
+		/**
+		 * Appends a row from an optional value.
+		 */
+		void push_back(const std::optional<std::string_view> &value)
+		{
+			if (value)
+			{
+				push_back(*value);
+			}
+			else
+			{
+				push_missing();
+			}
+		}
+
+		/**
+		 * Returns the number of rows.
+		 */
+		size_t size() const
+		{
+			return ends.size();
+		}
+
+		/**
+		 * Returns the string in row `i`.  This is empty if the row has no
+		 * value.
+		 */
+		std::string_view operator[](size_t i) const
+		{
+			size_t start = (i == 0) ? 0 : ends[i - 1];
+			return std::string_view(bytes).substr(start, ends[i] - start);
+		}
+
+		/**
+		 * Returns the rows that have a value for which `pred` returns true.
+		 */
+		template<typename Pred>
+		Bitmap filter(Pred &&pred) const
+		{
+			return scan(ends.size(), [&](size_t i) { return pred((*this)[i]); });
+		}
+
+		/**
+		 * Returns the number of rows in `selection` (or in total, if it is
+		 * null) that have a value.
+		 */
+		size_t count(const Bitmap *selection = nullptr) const
+		{
+			if (selection == nullptr)
+			{
+				return optional ? present.count() : ends.size();
+			}
+			return optional ? (*selection & present).count()
+			                : selection->count();
+		}
+	};
+
+} // namespace CONFIG_DETAIL_NAMESPACE
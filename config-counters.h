@@ -0,0 +1,149 @@
+// Copyright David Chisnall
+// SPDX-License-Identifier: MIT
+#pragma once
+
+#include "config-generic.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <ostream>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace CONFIG_DETAIL_NAMESPACE
+{
+	/**
+	 * The number of times that one property was read.
+	 */
+	struct AccessCount
+	{
+		/**
+		 * The full path of the property, for example `anObject.anInt`.
+		 * Elements of arrays are written as `anArray[]`.
+		 */
+		std::string_view path;
+
+		/**
+		 * The number of reads since the counters were last reset.
+		 */
+		uint64_t count;
+	};
+
+	/**
+	 * Access counters for the `N` properties of a generated config class.
+	 *
+	 * Each thread increments counters in one of a fixed number of shards,
+	 * with relaxed atomics, so that accessors on hot paths do not contend on
+	 * a shared cache line.  Reading the counts sums over all shards and is
+	 * therefore only approximate while other threads are reading properties.
+	 */
+	template<size_t N>
+	class AccessCounters
+	{
+		/**
+		 * The number of shards.  Threads are assigned to shards round robin.
+		 */
+		static constexpr size_t Shards = 16;
+
+		/**
+		 * One set of counters.  Shards are cache-line aligned so that threads
+		 * using different shards never share a line.
+		 */
+		struct alignas(64) Shard
+		{
+			/**
+			 * One counter per property.
+			 */
+			std::array<std::atomic<uint64_t>, N> counts = {};
+		};
+
+		/**
+		 * The shards.
+		 */
+		Shard shards[Shards];
+
+		/**
+		 * Returns the shard used by the calling thread.
+		 */
+		static size_t shard_index()
+		{
+			static std::atomic<size_t> nextThread;
+			thread_local size_t        index =
+			  nextThread.fetch_add(1, std::memory_order_relaxed) % Shards;
+			return index;
+		}
+
+		public:
+		/**
+		 * Records a read of property `i`.
+		 */
+		void increment(size_t i)
+		{
+			shards[shard_index()].counts[i].fetch_add(
+			  1, std::memory_order_relaxed);
+		}
+
+		/**
+		 * Returns the number of reads of property `i`.
+		 */
+		uint64_t count(size_t i) const
+		{
+			uint64_t total = 0;
+			for (auto &shard : shards)
+			{
+				total += shard.counts[i].load(std::memory_order_relaxed);
+			}
+			return total;
+		}
+
+		/**
+		 * Resets all counters to zero.
+		 */
+		void reset()
+		{
+			for (auto &shard : shards)
+			{
+				for (auto &counter : shard.counts)
+				{
+					counter.store(0, std::memory_order_relaxed);
+				}
+			}
+		}
+
+		/**
+		 * Returns the count for every property, given the property paths in
+		 * index order.  The result is sorted with the most frequently read
+		 * properties first, with properties that were never read at the end.
+		 */
+		std::vector<AccessCount>
+		snapshot(std::span<const std::string_view, N> paths) const
+		{
+			std::vector<AccessCount> result;
+			result.reserve(N);
+			for (size_t i = 0; i < N; i++)
+			{
+				result.push_back({paths[i], count(i)});
+			}
+			std::stable_sort(
+			  result.begin(), result.end(), [](auto &a, auto &b) {
+				  return a.count > b.count;
+			  });
+			return result;
+		}
+	};
+
+	/**
+	 * Writes a report of access counts, one property per line with the count
+	 * first, hottest first.
+	 */
+	inline void write_access_report(std::ostream                &out,
+	                                std::span<const AccessCount> counts)
+	{
+		for (auto &c : counts)
+		{
+			out << c.count << '\t' << c.path << '\n';
+		}
+	}
+
+} // namespace CONFIG_DETAIL_NAMESPACE
@@ -0,0 +1,138 @@
+// Copyright David Chisnall
+// SPDX-License-Identifier: MIT
+#pragma once
+
+#include "config-loader.h"
+#include <atomic>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <variant>
+
+namespace CONFIG_DETAIL_NAMESPACE
+{
+	/**
+	 * A section of a config that is kept in a separate file.  Schemas mark
+	 * these sections with `x-external`, and configs give the path of the
+	 * file in place of the section.  The file is parsed, validated against
+	 * the section's own schema and wrapped in a `Section` the first time
+	 * that the section is read.  If several threads read it at once, one
+	 * loads it and the others wait.  The result, including any error, is
+	 * kept, so each file is read at most once for each config.
+	 *
+	 * Relative paths are resolved against the working directory, as libucl
+	 * resolves includes.
+	 */
+	template<typename Section>
+	class ExternalSection
+	{
+		public:
+		/**
+		 * Returns the schema that sections are validated against.
+		 */
+		using Schema = const ucl_object_t *(*)();
+
+		/**
+		 * Checks a section after the schema, for the checks that libucl does
+		 * not make.  Returns false and describes the failure in the error on
+		 * failure.
+		 */
+		using Check = bool (*)(const ucl_object_t *, ucl_schema_error *);
+
+		private:
+		/**
+		 * The schema for the section.
+		 */
+		Schema schema;
+
+		/**
+		 * The extra checks for the section, or null if there are none.
+		 */
+		Check check;
+
+		/**
+		 * Guards loading the section.
+		 */
+		std::once_flag loading;
+
+		/**
+		 * The section or the reason that it could not be loaded, set once
+		 * it has been loaded.
+		 */
+		std::optional<std::variant<Section, LoadError>> result;
+
+		/**
+		 * Set once `result` is set.
+		 */
+		std::atomic<bool> ready = false;
+
+		/**
+		 * Loads the section from the file named by the string `path`.  The
+		 * path is read in place: `ucl_object_tostring` would copy a string
+		 * parsed without copying into the node, which other configs built
+		 * from the same tree may be reading.
+		 */
+		std::variant<Section, LoadError> load(const ucl_object_t *path)
+		{
+			std::filesystem::path file{
+			  static_cast<std::string_view>(StringViewAdaptor(path))};
+			auto                  parsed = parse_file(file);
+			if (auto *err = std::get_if<LoadError>(&parsed))
+			{
+				return std::move(*err);
+			}
+			auto            *obj = std::get<ucl_object_t *>(parsed);
+			ucl_schema_error err;
+			if (!ucl_object_validate(schema(), obj, &err) ||
+			    ((check != nullptr) && !check(obj, &err)))
+			{
+				LoadError e{err};
+				e.message = file.string() + ": " + e.message;
+				ucl_object_unref(obj);
+				return e;
+			}
+			Section section{obj};
+			ucl_object_unref(obj);
+			return section;
+		}
+
+		public:
+		/**
+		 * Constructor, validates sections against `s` and then checks them
+		 * with `c`, if it is not null.
+		 */
+		ExternalSection(Schema s, Check c = nullptr) : schema(s), check(c) {}
+
+		/**
+		 * Sections cannot be copied.  Configs share them instead, so that
+		 * copies do not load the section again.
+		 */
+		ExternalSection(const ExternalSection &) = delete;
+
+		/**
+		 * Returns the section from the file named by the string `path`,
+		 * loading it if this is the first read.  `path` must be the same
+		 * each time.
+		 */
+		std::variant<Section, LoadError> get(const ucl_object_t *path)
+		{
+			std::call_once(loading, [&]() {
+				result.emplace(load(path));
+				ready.store(true, std::memory_order_release);
+			});
+			return *result;
+		}
+
+		/**
+		 * Returns true if the section has been loaded, or has failed to
+		 * load.
+		 */
+		bool loaded() const
+		{
+			return ready.load(std::memory_order_acquire);
+		}
+	};
+
+} // namespace CONFIG_DETAIL_NAMESPACE
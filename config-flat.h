@@ -0,0 +1,735 @@
+// Copyright David Chisnall
+// SPDX-License-Identifier: MIT
+#pragma once
+
+#include "config-loader.h"
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <span>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+namespace CONFIG_DETAIL_NAMESPACE
+{
+	/**
+	 * The types of value in a flat image.
+	 */
+	enum class FlatType : uint8_t
+	{
+		Null,
+		Object,
+		Array,
+		String,
+		Integer,
+		Float,
+		Boolean,
+	};
+
+	/**
+	 * A value in a flat image.  Scalars are stored inline.  Strings,
+	 * objects and arrays store the offset of their contents from the start
+	 * of the image.
+	 */
+	struct FlatValue
+	{
+		/**
+		 * The type of the value.
+		 */
+		FlatType type;
+
+		/**
+		 * The number of bytes in a string (excluding the null terminator
+		 * that follows it), members of an object or elements of an array.
+		 */
+		uint32_t length;
+
+		/**
+		 * The value of an integer or boolean, the bits of a floating-point
+		 * number, or the offset of the contents of anything else.
+		 */
+		uint64_t payload;
+	};
+
+	/**
+	 * A member of an object in a flat image.  The members of each object are
+	 * sorted by key.
+	 */
+	struct FlatMember
+	{
+		/**
+		 * The offset of the key, which is followed by a null terminator.
+		 */
+		uint32_t keyOffset;
+
+		/**
+		 * The length of the key.
+		 */
+		uint32_t keyLength;
+
+		/**
+		 * The value.
+		 */
+		FlatValue value;
+	};
+
+	/**
+	 * The start of a flat image.
+	 */
+	struct FlatHeader
+	{
+		/**
+		 * Identifies flat images.
+		 */
+		static constexpr uint32_t Magic = 0x544c4643;
+
+		/**
+		 * The version of the encoding.
+		 */
+		static constexpr uint32_t CurrentVersion = 1;
+
+		/**
+		 * `Magic`.
+		 */
+		uint32_t magic;
+
+		/**
+		 * `CurrentVersion`.
+		 */
+		uint32_t version;
+
+		/**
+		 * The size of the image, including this header.
+		 */
+		uint64_t size;
+
+		/**
+		 * The root object.
+		 */
+		FlatValue root;
+	};
+
+	/**
+	 * A flat image in memory owned by this process.  Flat images contain no
+	 * pointers, so they can be copied between address spaces and read in
+	 * place.
+	 */
+	class FlatImage
+	{
+		/**
+		 * The image, in words so that every value is aligned.
+		 */
+		std::unique_ptr<uint64_t[]> words;
+
+		/**
+		 * The size of the image in bytes.
+		 */
+		size_t length;
+
+		public:
+		/**
+		 * Constructor, allocates an uninitialised image of `size` bytes.
+		 */
+		explicit FlatImage(size_t size)
+		  : words(new uint64_t[(size + 7) / 8]), length(size)
+		{
+		}
+
+		/**
+		 * Returns the image.
+		 */
+		std::byte *data()
+		{
+			return reinterpret_cast<std::byte *>(words.get());
+		}
+
+		/**
+		 * Returns the image.
+		 */
+		const std::byte *data() const
+		{
+			return reinterpret_cast<const std::byte *>(words.get());
+		}
+
+		/**
+		 * Returns the size of the image in bytes.
+		 */
+		size_t size() const
+		{
+			return length;
+		}
+
+		/**
+		 * Returns the image as a span of bytes.
+		 */
+		std::span<const std::byte> bytes() const
+		{
+			return {data(), length};
+		}
+
+		/**
+		 * Returns the value at `offset` from the start of the image.
+		 */
+		template<typename T>
+		const T *at(uint64_t offset) const
+		{
+			return reinterpret_cast<const T *>(data() + offset);
+		}
+	};
+
+	/**
+	 * Handle to a value in a flat image.  Every handle shares ownership of
+	 * its image, so values remain valid for as long as any config refers to
+	 * them.  A default-constructed handle represents an absent value.
+	 */
+	class FlatNode
+	{
+		/**
+		 * The image that contains the value.
+		 */
+		std::shared_ptr<const FlatImage> image;
+
+		/**
+		 * The value, or null if this is absent.
+		 */
+		const FlatValue *value = nullptr;
+
+		public:
+		/**
+		 * Default constructor, represents an absent value.
+		 */
+		FlatNode() = default;
+
+		/**
+		 * Constructor, refers to the value `v` in `i`.
+		 */
+		FlatNode(std::shared_ptr<const FlatImage> i, const FlatValue *v)
+		  : image(std::move(i)), value(v)
+		{
+		}
+
+		/**
+		 * Returns true if this refers to a value.
+		 */
+		explicit operator bool() const
+		{
+			return value != nullptr;
+		}
+
+		/**
+		 * Returns the value.  Must not be called on an absent value.
+		 */
+		const FlatValue &get() const
+		{
+			return *value;
+		}
+
+		/**
+		 * Returns the image that contains the value.
+		 */
+		const std::shared_ptr<const FlatImage> &owner() const
+		{
+			return image;
+		}
+
+		/**
+		 * Looks up the property `key` of this object, with a binary search.
+		 * Returns an absent value if this is absent, is not an object, or
+		 * has no such property.
+		 */
+		FlatNode operator[](std::string_view key) const
+		{
+			if ((value == nullptr) || (value->type != FlatType::Object))
+			{
+				return {};
+			}
+			auto *members = image->at<FlatMember>(value->payload);
+			auto  keyOf   = [&](const FlatMember &m) {
+				return std::string_view(image->at<char>(m.keyOffset),
+				                        m.keyLength);
+			};
+			auto *end   = members + value->length;
+			auto *found = std::lower_bound(
+			  members, end, key, [&](const FlatMember &m, std::string_view k) {
+				  return keyOf(m) < k;
+			  });
+			if ((found == end) || (keyOf(*found) != key))
+			{
+				return {};
+			}
+			return {image, &found->value};
+		}
+	};
+
+	/**
+	 * Range over the elements of an array in a flat image.  Each element is
+	 * exposed as a `T`, constructed with `Adaptor`.  Absent values and values
+	 * that are not arrays are empty ranges.
+	 */
+	template<typename T, typename Adaptor>
+	class FlatRange
+	{
+		/**
+		 * The array.
+		 */
+		FlatNode array;
+
+		/**
+		 * Iterator type for this range.
+		 */
+		class Iter
+		{
+			/**
+			 * The image that contains the array.
+			 */
+			const std::shared_ptr<const FlatImage> *image;
+
+			/**
+			 * The current element.
+			 */
+			const FlatValue *current;
+
+			public:
+			/**
+			 * Constructor, iterates from `c` in an array in `i`.
+			 */
+			Iter(const std::shared_ptr<const FlatImage> *i, const FlatValue *c)
+			  : image(i), current(c)
+			{
+			}
+
+			/**
+			 * Dereference operator, uses `Adaptor` to expose the current
+			 * element as a `T`.
+			 */
+			T operator*()
+			{
+				return Adaptor(FlatNode(*image, current));
+			}
+
+			/**
+			 * Pre-increment operator, advances to the next element.
+			 */
+			Iter &operator++()
+			{
+				++current;
+				return *this;
+			}
+
+			/**
+			 * Non-equality comparison, used to terminate range-based for
+			 * loops.
+			 */
+			bool operator!=(const Iter &other) const
+			{
+				return current != other.current;
+			}
+		};
+
+		/**
+		 * Returns the elements of the array, or an empty span if this does
+		 * not refer to one.
+		 */
+		std::span<const FlatValue> elements()
+		{
+			if (!array || (array.get().type != FlatType::Array))
+			{
+				return {};
+			}
+			return {array.owner()->template at<FlatValue>(array.get().payload),
+			        array.get().length};
+		}
+
+		public:
+		/**
+		 * Constructor.  Constructs a range from a node.
+		 */
+		FlatRange(FlatNode a) : array(std::move(a)) {}
+
+		/**
+		 * Returns an iterator to the start of the range.
+		 */
+		Iter begin()
+		{
+			return {&array.owner(), elements().data()};
+		}
+
+		/**
+		 * Returns an iterator to the end of the range.
+		 */
+		Iter end()
+		{
+			auto e = elements();
+			return {&array.owner(), e.data() + e.size()};
+		}
+
+		/**
+		 * Returns true if this is an empty range.
+		 */
+		bool empty()
+		{
+			return elements().empty();
+		}
+	};
+
+	/**
+	 * Backend that reads configs from flat images.  Images are written by
+	 * `encode_flat` from configs that have already been validated, so they
+	 * are not validated again.
+	 */
+	struct FlatBackend
+	{
+		/**
+		 * Nodes share ownership of their image.
+		 */
+		using Node = FlatNode;
+
+		/**
+		 * Generated classes hold nodes directly.
+		 */
+		using Ptr = FlatNode;
+
+		/**
+		 * Arrays are exposed as flat ranges.
+		 */
+		template<typename T, typename Adaptor>
+		using Range = FlatRange<T, Adaptor>;
+
+		/**
+		 * Returns true if `node` is absent.
+		 */
+		static bool is_null(const Node &node)
+		{
+			return !node;
+		}
+
+		/**
+		 * Returns the value of `node` as a string, or an empty string if it
+		 * is not a string.
+		 */
+		static std::string_view to_string(const Node &node)
+		{
+			if (!node || (node.get().type != FlatType::String))
+			{
+				return {};
+			}
+			return {node.owner()->at<char>(node.get().payload),
+			        node.get().length};
+		}
+
+		/**
+		 * Returns the value of `node` as an integer.  Floating-point values
+		 * are truncated.
+		 */
+		static int64_t to_int(const Node &node)
+		{
+			if (!node)
+			{
+				return 0;
+			}
+			switch (node.get().type)
+			{
+				case FlatType::Integer:
+				case FlatType::Boolean:
+					return static_cast<int64_t>(node.get().payload);
+				case FlatType::Float:
+					return static_cast<int64_t>(to_double(node));
+				default:
+					return 0;
+			}
+		}
+
+		/**
+		 * Returns the value of `node` as a floating-point number.
+		 */
+		static double to_double(const Node &node)
+		{
+			if (!node)
+			{
+				return 0;
+			}
+			switch (node.get().type)
+			{
+				case FlatType::Float:
+				{
+					double result;
+					memcpy(&result, &node.get().payload, sizeof(result));
+					return result;
+				}
+				case FlatType::Integer:
+				case FlatType::Boolean:
+					return static_cast<double>(to_int(node));
+				default:
+					return 0;
+			}
+		}
+
+		/**
+		 * Returns the value of `node` as a boolean.
+		 */
+		static bool to_bool(const Node &node)
+		{
+			return to_int(node) != 0;
+		}
+	};
+
+	/**
+	 * Writes UCL trees as flat images.
+	 */
+	class FlatEncoder
+	{
+		/**
+		 * The image so far.
+		 */
+		std::vector<std::byte> out;
+
+		/**
+		 * Reserves `size` bytes, aligned to `align`, and returns their
+		 * offset.
+		 */
+		size_t allocate(size_t size, size_t align = alignof(FlatValue))
+		{
+			size_t offset = (out.size() + align - 1) & ~(align - 1);
+			out.resize(offset + size);
+			return offset;
+		}
+
+		/**
+		 * Copies `value` into the image at `offset`.
+		 */
+		template<typename T>
+		void store(size_t offset, const T &value)
+		{
+			memcpy(out.data() + offset, &value, sizeof(T));
+		}
+
+		/**
+		 * Copies `length` bytes of `str`, and a null terminator, into the
+		 * image and returns their offset.
+		 */
+		size_t string(const char *str, size_t length)
+		{
+			size_t offset = allocate(length + 1, 1);
+			memcpy(out.data() + offset, str, length);
+			out[offset + length] = std::byte{0};
+			return offset;
+		}
+
+		/**
+		 * Encodes `obj`, and anything that it contains, and returns its
+		 * value.
+		 */
+		FlatValue value(const ucl_object_t *obj)
+		{
+			FlatValue result{FlatType::Null, 0, 0};
+			switch (ucl_object_type(obj))
+			{
+				case UCL_OBJECT:
+				{
+					std::vector<std::pair<std::string_view, const ucl_object_t *>>
+					                  children;
+					ucl_object_iter_t it = nullptr;
+					while (auto *child = ucl_object_iterate(obj, &it, true))
+					{
+						size_t      keyLength;
+						const char *key = ucl_object_keyl(child, &keyLength);
+						children.emplace_back(std::string_view(key, keyLength),
+						                      child);
+					}
+					std::sort(children.begin(),
+					          children.end(),
+					          [](auto &a, auto &b) { return a.first < b.first; });
+					size_t members =
+					  allocate(children.size() * sizeof(FlatMember));
+					for (size_t i = 0; i < children.size(); i++)
+					{
+						auto      &[key, child] = children[i];
+						FlatMember member{};
+						member.keyOffset = string(key.data(), key.size());
+						member.keyLength = key.size();
+						member.value     = value(child);
+						store(members + i * sizeof(FlatMember), member);
+					}
+					result = {FlatType::Object,
+					          static_cast<uint32_t>(children.size()),
+					          members};
+					break;
+				}
+				case UCL_ARRAY:
+				{
+					size_t count    = obj->len;
+					size_t elements = allocate(count * sizeof(FlatValue));
+					for (size_t i = 0; i < count; i++)
+					{
+						store(elements + i * sizeof(FlatValue),
+						      value(ucl_array_find_index(obj, i)));
+					}
+					result = {
+					  FlatType::Array, static_cast<uint32_t>(count), elements};
+					break;
+				}
+				case UCL_STRING:
+				{
+					size_t      length;
+					const char *str = ucl_object_tolstring(obj, &length);
+					result          = {FlatType::String,
+					                   static_cast<uint32_t>(length),
+					                   string(str, length)};
+					break;
+				}
+				case UCL_INT:
+					result = {FlatType::Integer,
+					          0,
+					          static_cast<uint64_t>(ucl_object_toint(obj))};
+					break;
+				case UCL_FLOAT:
+				case UCL_TIME:
+				{
+					double d = ucl_object_todouble(obj);
+					result   = {FlatType::Float, 0, 0};
+					memcpy(&result.payload, &d, sizeof(d));
+					break;
+				}
+				case UCL_BOOLEAN:
+					result = {FlatType::Boolean, 0, ucl_object_toboolean(obj)};
+					break;
+				default:
+					break;
+			}
+			return result;
+		}
+
+		public:
+		/**
+		 * Encodes the tree rooted at `obj` and returns the image.
+		 */
+		std::vector<std::byte> encode(const ucl_object_t *obj)
+		{
+			out.clear();
+			size_t     header = allocate(sizeof(FlatHeader));
+			FlatHeader h{FlatHeader::Magic, FlatHeader::CurrentVersion, 0, {}};
+			h.root = value(obj);
+			h.size = out.size();
+			store(header, h);
+			return std::move(out);
+		}
+	};
+
+	/**
+	 * Returns the flat image of the tree rooted at `obj`.
+	 */
+	inline std::vector<std::byte> encode_flat(const ucl_object_t *obj)
+	{
+		return FlatEncoder().encode(obj);
+	}
+
+	/**
+	 * Returns true if `value`, and everything that it contains, lies within
+	 * an image of `size` bytes.  Nesting deeper than `depth` is rejected, so
+	 * that images with cycles cannot exhaust the stack.
+	 */
+	inline bool
+	check_flat_value(const FlatImage &image, const FlatValue &value, int depth)
+	{
+		auto fits = [&](uint64_t offset, uint64_t count, uint64_t size) {
+			return (offset <= image.size()) &&
+			       (count <= (image.size() - offset) / size);
+		};
+		auto aligned = [](uint64_t offset) {
+			return (offset % alignof(FlatValue)) == 0;
+		};
+		if (depth == 0)
+		{
+			return false;
+		}
+		switch (value.type)
+		{
+			case FlatType::String:
+				return fits(value.payload, uint64_t(value.length) + 1, 1);
+			case FlatType::Object:
+			{
+				if (!aligned(value.payload) ||
+				    !fits(value.payload, value.length, sizeof(FlatMember)))
+				{
+					return false;
+				}
+				auto *members = image.at<FlatMember>(value.payload);
+				for (uint32_t i = 0; i < value.length; i++)
+				{
+					if (!fits(members[i].keyOffset,
+					          uint64_t(members[i].keyLength) + 1,
+					          1) ||
+					    !check_flat_value(image, members[i].value, depth - 1))
+					{
+						return false;
+					}
+				}
+				return true;
+			}
+			case FlatType::Array:
+			{
+				if (!aligned(value.payload) ||
+				    !fits(value.payload, value.length, sizeof(FlatValue)))
+				{
+					return false;
+				}
+				auto *elements = image.at<FlatValue>(value.payload);
+				for (uint32_t i = 0; i < value.length; i++)
+				{
+					if (!check_flat_value(image, elements[i], depth - 1))
+					{
+						return false;
+					}
+				}
+				return true;
+			}
+			case FlatType::Null:
+			case FlatType::Integer:
+			case FlatType::Float:
+			case FlatType::Boolean:
+				return true;
+		}
+		return false;
+	}
+
+	/**
+	 * Returns the root of the flat image `image`, or a `LoadError` if it is
+	 * not a well-formed image.  Every offset in the image is checked, which
+	 * costs one pass over its values but no allocation.
+	 */
+	inline std::variant<FlatNode, LoadError>
+	open_flat(std::shared_ptr<const FlatImage> image)
+	{
+		if (image->size() < sizeof(FlatHeader))
+		{
+			return LoadError{"flat image is truncated"};
+		}
+		auto *header = image->at<FlatHeader>(0);
+		if ((header->magic != FlatHeader::Magic) ||
+		    (header->version != FlatHeader::CurrentVersion))
+		{
+			return LoadError{"not a flat image"};
+		}
+		if ((header->size != image->size()) ||
+		    (header->root.type != FlatType::Object) ||
+		    !check_flat_value(*image, header->root, 256))
+		{
+			return LoadError{"flat image is corrupt"};
+		}
+		return FlatNode{image, &header->root};
+	}
+
+	/**
+	 * Copies `data` into a new image and returns its root, or a `LoadError`
+	 * if it is not a well-formed image.
+	 */
+	inline std::variant<FlatNode, LoadError>
+	open_flat(std::span<const std::byte> data)
+	{
+		auto image = std::make_shared<FlatImage>(data.size());
+		memcpy(image->data(), data.data(), data.size());
+		return open_flat(std::move(image));
+	}
+
+} // namespace CONFIG_DETAIL_NAMESPACE
@@ -0,0 +1,1361 @@
+// Copyright David Chisnall
+// SPDX-License-Identifier: MIT
+#pragma once
+
+#include "config-generic.h"
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <netinet/in.h>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+
+namespace CONFIG_DETAIL_NAMESPACE
+{
+	/**
+	 * Cursor over the text of a string with a `format`, used by the parsers
+	 * below.
+	 */
+	class FormatReader
+	{
+		/**
+		 * The text being parsed.
+		 */
+		std::string_view text;
+
+		/**
+		 * The offset of the next character.
+		 */
+		size_t position = 0;
+
+		public:
+		/**
+		 * Constructor, reads `t` from the start.
+		 */
+		constexpr FormatReader(std::string_view t) : text(t) {}
+
+		/**
+		 * Returns true if every character has been read.
+		 */
+		constexpr bool done() const
+		{
+			return position == text.size();
+		}
+
+		/**
+		 * Returns the next character, or a null character at the end.
+		 */
+		constexpr char peek() const
+		{
+			return done() ? '\0' : text[position];
+		}
+
+		/**
+		 * Returns the offset of the next character.
+		 */
+		constexpr size_t offset() const
+		{
+			return position;
+		}
+
+		/**
+		 * Moves back to `offset`, which must have been returned by
+		 * `offset()`.
+		 */
+		constexpr void rewind(size_t offset)
+		{
+			position = offset;
+		}
+
+		/**
+		 * Returns the text from `start` to the next character.
+		 */
+		constexpr std::string_view since(size_t start) const
+		{
+			return text.substr(start, position - start);
+		}
+
+		/**
+		 * Reads `c` if it is the next character.  Letters match either case
+		 * if `anyCase` is set.
+		 */
+		constexpr bool accept(char c, bool anyCase = false)
+		{
+			char next = peek();
+			if (anyCase && (next >= 'a') && (next <= 'z'))
+			{
+				next = static_cast<char>(next - 'a' + 'A');
+			}
+			if (done() || (next != c))
+			{
+				return false;
+			}
+			position++;
+			return true;
+		}
+
+		/**
+		 * Reads a decimal number of between `min` and `max` digits, which
+		 * must be at most 18.
+		 */
+		constexpr std::optional<uint64_t> digits(size_t min, size_t max)
+		{
+			uint64_t value = 0;
+			size_t   count = 0;
+			while ((count < max) && (peek() >= '0') && (peek() <= '9'))
+			{
+				value = value * 10 + (text[position++] - '0');
+				count++;
+			}
+			if (count < min)
+			{
+				return std::nullopt;
+			}
+			return value;
+		}
+
+		/**
+		 * Reads a hexadecimal number of between one and four digits.
+		 */
+		constexpr std::optional<uint16_t> hex_group()
+		{
+			uint16_t value = 0;
+			size_t   count = 0;
+			while (count < 4)
+			{
+				int digit = hex_value(peek());
+				if (digit < 0)
+				{
+					break;
+				}
+				value = static_cast<uint16_t>(value * 16 + digit);
+				position++;
+				count++;
+			}
+			if (count == 0)
+			{
+				return std::nullopt;
+			}
+			return value;
+		}
+
+		/**
+		 * Returns the value of the hexadecimal digit `c`, or -1 if it is not
+		 * one.
+		 */
+		static constexpr int hex_value(char c)
+		{
+			if ((c >= '0') && (c <= '9'))
+			{
+				return c - '0';
+			}
+			if ((c >= 'a') && (c <= 'f'))
+			{
+				return c - 'a' + 10;
+			}
+			if ((c >= 'A') && (c <= 'F'))
+			{
+				return c - 'A' + 10;
+			}
+			return -1;
+		}
+	};
+
+	/**
+	 * Writes `text` to `sink` as a JSON string.  The formatted values below
+	 * are written only with characters that do not need escaping.
+	 */
+	template<typename S>
+	void write_format_text(S &sink, std::string_view text)
+	{
+		sink.write("\"", 1);
+		sink.write(text.data(), text.size());
+		sink.write("\"", 1);
+	}
+
+	/**
+	 * Appends `micro`, a number of microseconds less than a second, to
+	 * `out` as a decimal fraction without trailing zeros, or nothing if it
+	 * is zero.
+	 */
+	inline void append_fraction(std::string &out, int64_t micro)
+	{
+		if (micro == 0)
+		{
+			return;
+		}
+		char buffer[8];
+		snprintf(buffer, sizeof(buffer), ".%06lld", (long long)micro);
+		std::string_view fraction{buffer};
+		out += fraction.substr(0, fraction.find_last_not_of('0') + 1);
+	}
+
+	/**
+	 * An address in the `ipv4` format, parsed from dotted-quad notation.
+	 * Parts with leading zeros are rejected, as they are by `inet_pton`.
+	 */
+	struct Ipv4Address
+	{
+		/**
+		 * The name of the format.
+		 */
+		static constexpr const char *FormatName = "ipv4";
+
+		/**
+		 * The address, in network byte order.
+		 */
+		std::array<uint8_t, 4> bytes = {};
+
+		/**
+		 * Returns the address as a socket address structure.
+		 */
+		in_addr address() const
+		{
+			in_addr result;
+			memcpy(&result, bytes.data(), sizeof(result));
+			return result;
+		}
+
+		/**
+		 * Reads an address from `reader`, leaving anything after it.
+		 */
+		static constexpr std::optional<Ipv4Address> read(FormatReader &reader)
+		{
+			Ipv4Address result;
+			for (size_t i = 0; i < result.bytes.size(); i++)
+			{
+				if ((i > 0) && !reader.accept('.'))
+				{
+					return std::nullopt;
+				}
+				size_t start = reader.offset();
+				auto   part  = reader.digits(1, 3);
+				if (!part || (*part > 255) ||
+				    ((reader.since(start).size() > 1) &&
+				     (reader.since(start)[0] == '0')))
+				{
+					return std::nullopt;
+				}
+				result.bytes[i] = static_cast<uint8_t>(*part);
+			}
+			return result;
+		}
+
+		/**
+		 * Parses `str`, returning nothing if it is not an IPv4 address.
+		 */
+		static constexpr std::optional<Ipv4Address> parse(std::string_view str)
+		{
+			FormatReader reader(str);
+			auto         result = read(reader);
+			if (!reader.done())
+			{
+				return std::nullopt;
+			}
+			return result;
+		}
+
+		/**
+		 * Addresses are equal if their bytes are.
+		 */
+		constexpr bool operator==(const Ipv4Address &) const = default;
+
+		/**
+		 * Returns the address in dotted-quad notation.
+		 */
+		std::string to_string() const
+		{
+			char buffer[16];
+			int  length = snprintf(buffer,
+			                       sizeof(buffer),
+			                       "%u.%u.%u.%u",
+			                       bytes[0],
+			                       bytes[1],
+			                       bytes[2],
+			                       bytes[3]);
+			return {buffer, size_t(length)};
+		}
+
+		/**
+		 * Returns a hash of the address.
+		 */
+		uint64_t hash() const
+		{
+			return hash_bytes(bytes.data(), bytes.size(), 0x34);
+		}
+
+		/**
+		 * Writes the address as a JSON string.
+		 */
+		template<typename S>
+		void write_json(S &sink) const
+		{
+			write_format_text(sink, to_string());
+		}
+	};
+
+	/**
+	 * An address in the `ipv6` format, parsed from the text forms in RFC
+	 * 4291, including `::` and a trailing IPv4 address.  Zone identifiers
+	 * are not accepted.
+	 */
+	struct Ipv6Address
+	{
+		/**
+		 * The name of the format.
+		 */
+		static constexpr const char *FormatName = "ipv6";
+
+		/**
+		 * The address, in network byte order.
+		 */
+		std::array<uint8_t, 16> bytes = {};
+
+		/**
+		 * Returns the address as a socket address structure.
+		 */
+		in6_addr address() const
+		{
+			in6_addr result;
+			memcpy(&result, bytes.data(), sizeof(result));
+			return result;
+		}
+
+		/**
+		 * Parses `str`, returning nothing if it is not an IPv6 address.
+		 */
+		static constexpr std::optional<Ipv6Address> parse(std::string_view str)
+		{
+			FormatReader             reader(str);
+			std::array<uint16_t, 8> groups = {};
+			size_t                   count  = 0;
+			// The number of groups before `::`, if there is one.
+			std::optional<size_t> gap;
+			if (reader.accept(':'))
+			{
+				if (!reader.accept(':'))
+				{
+					return std::nullopt;
+				}
+				gap = 0;
+			}
+			while (!reader.done())
+			{
+				if (count == groups.size())
+				{
+					return std::nullopt;
+				}
+				size_t start = reader.offset();
+				auto   group = reader.hex_group();
+				if (!group)
+				{
+					return std::nullopt;
+				}
+				if (reader.peek() == '.')
+				{
+					// A trailing IPv4 address fills the last two groups.
+					reader.rewind(start);
+					auto v4 = Ipv4Address::read(reader);
+					if (!v4 || (count > groups.size() - 2) || !reader.done())
+					{
+						return std::nullopt;
+					}
+					groups[count++] = (v4->bytes[0] << 8) | v4->bytes[1];
+					groups[count++] = (v4->bytes[2] << 8) | v4->bytes[3];
+					break;
+				}
+				groups[count++] = *group;
+				if (reader.done())
+				{
+					break;
+				}
+				if (!reader.accept(':'))
+				{
+					return std::nullopt;
+				}
+				if (reader.accept(':'))
+				{
+					if (gap)
+					{
+						return std::nullopt;
+					}
+					gap = count;
+				}
+				else if (reader.done())
+				{
+					return std::nullopt;
+				}
+			}
+			// `::` stands for at least one group.
+			if (gap ? (count == groups.size()) : (count != groups.size()))
+			{
+				return std::nullopt;
+			}
+			Ipv6Address result;
+			size_t      tail = gap ? count - *gap : 0;
+			for (size_t i = 0; i < count; i++)
+			{
+				size_t slot = (gap && (i >= *gap))
+				                ? groups.size() - tail + (i - *gap)
+				                : i;
+				result.bytes[slot * 2]     = groups[i] >> 8;
+				result.bytes[slot * 2 + 1] = groups[i] & 0xff;
+			}
+			return result;
+		}
+
+		/**
+		 * Addresses are equal if their bytes are.
+		 */
+		constexpr bool operator==(const Ipv6Address &) const = default;
+
+		/**
+		 * Returns the address in the canonical form from RFC 5952: the
+		 * longest run of two or more zero groups is written as `::`, and
+		 * IPv4-mapped addresses end in dotted-quad notation.
+		 */
+		std::string to_string() const
+		{
+			std::array<uint16_t, 8> groups;
+			for (size_t i = 0; i < groups.size(); i++)
+			{
+				groups[i] = (bytes[i * 2] << 8) | bytes[i * 2 + 1];
+			}
+			size_t runStart = groups.size(), runLength = 1;
+			for (size_t i = 0; i < groups.size();)
+			{
+				size_t end = i;
+				while ((end < groups.size()) && (groups[end] == 0))
+				{
+					end++;
+				}
+				if (end - i > runLength)
+				{
+					runStart  = i;
+					runLength = end - i;
+				}
+				i = std::max(end, i + 1);
+			}
+			bool mapped = (runStart == 0) && (runLength == 5) &&
+			              (groups[5] == 0xffff);
+			std::string result;
+			char        buffer[8];
+			for (size_t i = 0; i < (mapped ? 6 : groups.size()); i++)
+			{
+				if (i == runStart)
+				{
+					result += "::";
+					i += runLength - 1;
+					continue;
+				}
+				if (!result.empty() && (result.back() != ':'))
+				{
+					result += ':';
+				}
+				snprintf(buffer, sizeof(buffer), "%x", groups[i]);
+				result += buffer;
+			}
+			if (mapped)
+			{
+				Ipv4Address v4{{bytes[12], bytes[13], bytes[14], bytes[15]}};
+				result += ':';
+				result += v4.to_string();
+			}
+			return result;
+		}
+
+		/**
+		 * Returns a hash of the address.
+		 */
+		uint64_t hash() const
+		{
+			return hash_bytes(bytes.data(), bytes.size(), 0x36);
+		}
+
+		/**
+		 * Writes the address as a JSON string.
+		 */
+		template<typename S>
+		void write_json(S &sink) const
+		{
+			write_format_text(sink, to_string());
+		}
+	};
+
+	/**
+	 * A string in the `hostname` format, a name made of labels of up to 63
+	 * letters, digits and hyphens, as described in RFC 1123.  Hostnames are
+	 * only checked and are returned as strings.
+	 */
+	struct Hostname
+	{
+		/**
+		 * The name of the format.
+		 */
+		static constexpr const char *FormatName = "hostname";
+
+		/**
+		 * Returns `str` if it is a hostname, or nothing if not.
+		 */
+		static constexpr std::optional<std::string_view>
+		parse(std::string_view str)
+		{
+			if (str.empty() || (str.size() > 253))
+			{
+				return std::nullopt;
+			}
+			size_t label = 0;
+			for (size_t i = 0; i <= str.size(); i++)
+			{
+				char c = (i < str.size()) ? str[i] : '.';
+				if (c == '.')
+				{
+					if ((label == 0) || (label > 63) || (str[i - 1] == '-'))
+					{
+						return std::nullopt;
+					}
+					label = 0;
+					continue;
+				}
+				bool alnum = ((c >= 'a') && (c <= 'z')) ||
+				             ((c >= 'A') && (c <= 'Z')) ||
+				             ((c >= '0') && (c <= '9'));
+				if (!alnum && ((c != '-') || (label == 0)))
+				{
+					return std::nullopt;
+				}
+				label++;
+			}
+			return str;
+		}
+	};
+
+	template<typename S>
+	class BasicUri;
+
+	/**
+	 * A URI that refers to the string that it was parsed from.
+	 */
+	using UriView = BasicUri<std::string_view>;
+
+	/**
+	 * A URI that owns a copy of its text, used by materialized structs.
+	 */
+	using Uri = BasicUri<std::string>;
+
+	/**
+	 * A string in the `uri` format, an absolute URI as described in RFC
+	 * 3986, parsed into its components.  The components are stored as
+	 * offsets into the text, which is held as an `S`, so reading them costs
+	 * nothing.  Ports above 65535 are rejected.
+	 */
+	template<typename S>
+	class BasicUri
+	{
+		template<typename>
+		friend class BasicUri;
+
+		public:
+		/**
+		 * The name of the format.
+		 */
+		static constexpr const char *FormatName = "uri";
+
+		private:
+		/**
+		 * The text of the URI.
+		 */
+		S uri;
+
+		/**
+		 * The offset of the `:` after the scheme.
+		 */
+		uint32_t schemeEnd = 0;
+
+		/**
+		 * The offset of the start of the authority, after `//`, if there is
+		 * one.
+		 */
+		uint32_t authorityStart = 0;
+
+		/**
+		 * The offsets of the start and end of the host.  Brackets around IP
+		 * literals are not included.
+		 */
+		uint32_t hostStart = 0, hostEnd = 0;
+
+		/**
+		 * The offsets of the start and end of the path.
+		 */
+		uint32_t pathStart = 0, pathEnd = 0;
+
+		/**
+		 * The offset of the end of the query, which is `pathEnd` if there is
+		 * no query.
+		 */
+		uint32_t queryEnd = 0;
+
+		/**
+		 * The port, or -1 if there is none.
+		 */
+		int32_t portNumber = -1;
+
+		/**
+		 * The offset of the `@` after the user information, if there is any.
+		 */
+		uint32_t userinfoEnd = 0;
+
+		/**
+		 * True if the URI has an authority.
+		 */
+		bool hasAuthority = false;
+
+		/**
+		 * True if the authority has user information.
+		 */
+		bool hasUserinfo = false;
+
+		/**
+		 * True if the URI has a query, which may be empty.
+		 */
+		bool hasQuery = false;
+
+		/**
+		 * True if the URI has a fragment, which may be empty.
+		 */
+		bool hasFragment = false;
+
+		/**
+		 * Reads characters that are unreserved, percent-encoded, sub-delims
+		 * or in `extra`, as most components of a URI are made from.
+		 * Returns false if a percent sign is not followed by two
+		 * hexadecimal digits.
+		 */
+		static constexpr bool read_chars(FormatReader    &reader,
+		                                 std::string_view extra)
+		{
+			constexpr std::string_view allowed = "-._~!$&'()*+,;=";
+			while (!reader.done())
+			{
+				char c = reader.peek();
+				if (c == '%')
+				{
+					reader.accept('%');
+					for (int i = 0; i < 2; i++)
+					{
+						if (FormatReader::hex_value(reader.peek()) < 0)
+						{
+							return false;
+						}
+						reader.accept(reader.peek());
+					}
+					continue;
+				}
+				bool alnum = ((c >= 'a') && (c <= 'z')) ||
+				             ((c >= 'A') && (c <= 'Z')) ||
+				             ((c >= '0') && (c <= '9'));
+				if (!alnum && (allowed.find(c) == std::string_view::npos) &&
+				    (extra.find(c) == std::string_view::npos))
+				{
+					return true;
+				}
+				reader.accept(c);
+			}
+			return true;
+		}
+
+		/**
+		 * Returns the text from `start` to `end`.
+		 */
+		constexpr std::string_view slice(uint32_t start, uint32_t end) const
+		{
+			return text().substr(start, end - start);
+		}
+
+		public:
+		/**
+		 * Default constructor, an empty URI that no valid string parses to.
+		 */
+		constexpr BasicUri() = default;
+
+		/**
+		 * Converting constructor, copies the components of `other`.  This
+		 * copies the text from a view, and refers to the text of an owning
+		 * URI.
+		 */
+		template<typename T>
+		constexpr BasicUri(const BasicUri<T> &other)
+		  : uri(other.uri),
+		    schemeEnd(other.schemeEnd),
+		    authorityStart(other.authorityStart),
+		    hostStart(other.hostStart),
+		    hostEnd(other.hostEnd),
+		    pathStart(other.pathStart),
+		    pathEnd(other.pathEnd),
+		    queryEnd(other.queryEnd),
+		    portNumber(other.portNumber),
+		    userinfoEnd(other.userinfoEnd),
+		    hasAuthority(other.hasAuthority),
+		    hasUserinfo(other.hasUserinfo),
+		    hasQuery(other.hasQuery),
+		    hasFragment(other.hasFragment)
+		{
+		}
+
+		/**
+		 * Parses `str`, returning nothing if it is not an absolute URI.
+		 */
+		static constexpr std::optional<BasicUri> parse(std::string_view str)
+		{
+			if (str.size() > UINT32_MAX)
+			{
+				return std::nullopt;
+			}
+			BasicUri<std::string_view> result;
+			result.uri = str;
+			FormatReader reader(str);
+			auto         isAlpha = [](char c) {
+				return ((c >= 'a') && (c <= 'z')) || ((c >= 'A') && (c <= 'Z'));
+			};
+			if (!isAlpha(reader.peek()))
+			{
+				return std::nullopt;
+			}
+			while (isAlpha(reader.peek()) ||
+			       ((reader.peek() >= '0') && (reader.peek() <= '9')) ||
+			       (reader.peek() == '+') || (reader.peek() == '-') ||
+			       (reader.peek() == '.'))
+			{
+				reader.accept(reader.peek());
+			}
+			result.schemeEnd = reader.offset();
+			if (!reader.accept(':'))
+			{
+				return std::nullopt;
+			}
+			size_t afterScheme = reader.offset();
+			if (reader.accept('/') && reader.accept('/'))
+			{
+				result.hasAuthority   = true;
+				result.authorityStart = reader.offset();
+				// Read a user name if there is one, or go back and read
+				// the same characters as the host.
+				if (!read_chars(reader, ":"))
+				{
+					return std::nullopt;
+				}
+				if (reader.peek() == '@')
+				{
+					result.hasUserinfo = true;
+					result.userinfoEnd = reader.offset();
+					reader.accept('@');
+				}
+				else
+				{
+					reader.rewind(result.authorityStart);
+				}
+				if (reader.accept('['))
+				{
+					result.hostStart = reader.offset();
+					while (!reader.done() && (reader.peek() != ']'))
+					{
+						reader.accept(reader.peek());
+					}
+					result.hostEnd = reader.offset();
+					if (!reader.accept(']') ||
+					    !Ipv6Address::parse(str.substr(
+					      result.hostStart, result.hostEnd - result.hostStart)))
+					{
+						return std::nullopt;
+					}
+				}
+				else
+				{
+					result.hostStart = reader.offset();
+					if (!read_chars(reader, ""))
+					{
+						return std::nullopt;
+					}
+					result.hostEnd = reader.offset();
+				}
+				if (reader.accept(':'))
+				{
+					size_t start = reader.offset();
+					auto   port  = reader.digits(0, 5);
+					if (!reader.since(start).empty())
+					{
+						if (*port > 65535)
+						{
+							return std::nullopt;
+						}
+						result.portNumber = static_cast<int32_t>(*port);
+					}
+				}
+				if (!reader.done() && (reader.peek() != '/') &&
+				    (reader.peek() != '?') && (reader.peek() != '#'))
+				{
+					return std::nullopt;
+				}
+			}
+			else
+			{
+				reader.rewind(afterScheme);
+			}
+			result.pathStart = reader.offset();
+			if (!read_chars(reader, ":@/"))
+			{
+				return std::nullopt;
+			}
+			result.pathEnd = result.queryEnd = reader.offset();
+			if (reader.accept('?'))
+			{
+				result.hasQuery = true;
+				if (!read_chars(reader, ":@/?"))
+				{
+					return std::nullopt;
+				}
+				result.queryEnd = reader.offset();
+			}
+			if (reader.accept('#'))
+			{
+				result.hasFragment = true;
+				if (!read_chars(reader, ":@/?"))
+				{
+					return std::nullopt;
+				}
+			}
+			if (!reader.done())
+			{
+				return std::nullopt;
+			}
+			return BasicUri(result);
+		}
+
+		/**
+		 * Returns the whole URI.
+		 */
+		constexpr std::string_view text() const
+		{
+			return uri;
+		}
+
+		/**
+		 * Returns the scheme, without the `:`.
+		 */
+		constexpr std::string_view scheme() const
+		{
+			return slice(0, schemeEnd);
+		}
+
+		/**
+		 * Returns the authority (user information, host and port), if the
+		 * URI has one.
+		 */
+		constexpr std::optional<std::string_view> authority() const
+		{
+			if (!hasAuthority)
+			{
+				return std::nullopt;
+			}
+			return slice(authorityStart, pathStart);
+		}
+
+		/**
+		 * Returns the user information, without the `@`, if the URI has
+		 * any.
+		 */
+		constexpr std::optional<std::string_view> userinfo() const
+		{
+			if (!hasUserinfo)
+			{
+				return std::nullopt;
+			}
+			return slice(authorityStart, userinfoEnd);
+		}
+
+		/**
+		 * Returns the host, which is empty if the URI has no authority.  IP
+		 * literals are returned without their brackets.
+		 */
+		constexpr std::string_view host() const
+		{
+			return slice(hostStart, hostEnd);
+		}
+
+		/**
+		 * Returns the port, if the URI has one.
+		 */
+		constexpr std::optional<uint16_t> port() const
+		{
+			if (portNumber < 0)
+			{
+				return std::nullopt;
+			}
+			return static_cast<uint16_t>(portNumber);
+		}
+
+		/**
+		 * Returns the path, which may be empty.
+		 */
+		constexpr std::string_view path() const
+		{
+			return slice(pathStart, pathEnd);
+		}
+
+		/**
+		 * Returns the query, without the `?`, if the URI has one.
+		 */
+		constexpr std::optional<std::string_view> query() const
+		{
+			if (!hasQuery)
+			{
+				return std::nullopt;
+			}
+			return slice(pathEnd + 1, queryEnd);
+		}
+
+		/**
+		 * Returns the fragment, without the `#`, if the URI has one.
+		 */
+		constexpr std::optional<std::string_view> fragment() const
+		{
+			if (!hasFragment)
+			{
+				return std::nullopt;
+			}
+			return text().substr(queryEnd + 1);
+		}
+
+		/**
+		 * URIs are equal if their text is.
+		 */
+		template<typename T>
+		constexpr bool operator==(const BasicUri<T> &other) const
+		{
+			return text() == other.text();
+		}
+
+		/**
+		 * Returns a hash of the URI.
+		 */
+		uint64_t hash() const
+		{
+			return hash_bytes(uri.data(), uri.size(), 0x75);
+		}
+
+		/**
+		 * Writes the URI as a JSON string.  URIs cannot contain characters
+		 * that need escaping.
+		 */
+		template<typename Sink>
+		void write_json(Sink &sink) const
+		{
+			write_format_text(sink, text());
+		}
+	};
+
+	/**
+	 * A time in the `date-time` format, parsed from RFC 3339 text to the
+	 * microsecond, and converted to UTC.  This is a `std::chrono` time
+	 * point and can be used as one.  Leap seconds are counted as the first
+	 * second of the next minute.
+	 */
+	struct DateTime : std::chrono::sys_time<std::chrono::microseconds>
+	{
+		/**
+		 * The time point type that this extends.
+		 */
+		using TimePoint = std::chrono::sys_time<std::chrono::microseconds>;
+
+		/**
+		 * The name of the format.
+		 */
+		static constexpr const char *FormatName = "date-time";
+
+		/**
+		 * Default constructor, the start of the epoch.
+		 */
+		constexpr DateTime() = default;
+
+		/**
+		 * Constructor, wraps the time point `t`.
+		 */
+		constexpr DateTime(TimePoint t) : TimePoint(t) {}
+
+		/**
+		 * Parses `str`, returning nothing if it is not an RFC 3339 date and
+		 * time.
+		 */
+		static constexpr std::optional<DateTime> parse(std::string_view str)
+		{
+			using namespace std::chrono;
+			FormatReader reader(str);
+			auto         yearValue = reader.digits(4, 4);
+			if (!yearValue || !reader.accept('-'))
+			{
+				return std::nullopt;
+			}
+			auto monthValue = reader.digits(2, 2);
+			if (!monthValue || !reader.accept('-'))
+			{
+				return std::nullopt;
+			}
+			auto dayValue = reader.digits(2, 2);
+			if (!dayValue || !reader.accept('T', true))
+			{
+				return std::nullopt;
+			}
+			year_month_day date{year(int(*yearValue)),
+			                    month(unsigned(*monthValue)),
+			                    day(unsigned(*dayValue))};
+			if (!date.ok())
+			{
+				return std::nullopt;
+			}
+			auto hour = reader.digits(2, 2);
+			if (!hour || (*hour > 23) || !reader.accept(':'))
+			{
+				return std::nullopt;
+			}
+			auto minute = reader.digits(2, 2);
+			if (!minute || (*minute > 59) || !reader.accept(':'))
+			{
+				return std::nullopt;
+			}
+			auto second = reader.digits(2, 2);
+			if (!second || (*second > 60))
+			{
+				return std::nullopt;
+			}
+			int64_t fraction = 0;
+			if (reader.accept('.'))
+			{
+				// Digits beyond microseconds are read and discarded.
+				size_t start = reader.offset();
+				auto   micro = reader.digits(1, 6);
+				if (!micro)
+				{
+					return std::nullopt;
+				}
+				fraction = int64_t(*micro);
+				for (size_t i = reader.since(start).size(); i < 6; i++)
+				{
+					fraction *= 10;
+				}
+				while ((reader.peek() >= '0') && (reader.peek() <= '9'))
+				{
+					reader.accept(reader.peek());
+				}
+			}
+			microseconds offset{0};
+			if (!reader.accept('Z', true))
+			{
+				int sign = reader.accept('+') ? -1 : 1;
+				if ((sign == 1) && !reader.accept('-'))
+				{
+					return std::nullopt;
+				}
+				auto offsetHours = reader.digits(2, 2);
+				if (!offsetHours || (*offsetHours > 23) || !reader.accept(':'))
+				{
+					return std::nullopt;
+				}
+				auto offsetMinutes = reader.digits(2, 2);
+				if (!offsetMinutes || (*offsetMinutes > 59))
+				{
+					return std::nullopt;
+				}
+				offset = sign * (hours(*offsetHours) + minutes(*offsetMinutes));
+			}
+			if (!reader.done())
+			{
+				return std::nullopt;
+			}
+			return DateTime(TimePoint(sys_days(date)) + hours(*hour) +
+			                minutes(*minute) + seconds(*second) +
+			                microseconds(fraction) + offset);
+		}
+
+		/**
+		 * Returns the time in RFC 3339 form, in UTC, with a fraction only if
+		 * the time is not a whole number of seconds.
+		 */
+		std::string to_string() const
+		{
+			using namespace std::chrono;
+			auto           midnight = floor<days>(*this);
+			year_month_day date{midnight};
+			hh_mm_ss       time{*this - midnight};
+			char           buffer[40];
+			int            length =
+			  snprintf(buffer,
+			           sizeof(buffer),
+			           "%04d-%02u-%02uT%02d:%02d:%02lld",
+			           int(date.year()),
+			           unsigned(date.month()),
+			           unsigned(date.day()),
+			           int(time.hours().count()),
+			           int(time.minutes().count()),
+			           static_cast<long long>(time.seconds().count()));
+			std::string result{buffer, size_t(length)};
+			append_fraction(result, time.subseconds().count());
+			result += 'Z';
+			return result;
+		}
+
+		/**
+		 * Returns a hash of the time.
+		 */
+		uint64_t hash() const
+		{
+			return hash_mix(static_cast<uint64_t>(time_since_epoch().count()) ^
+			                0x74);
+		}
+
+		/**
+		 * Writes the time as a JSON string.
+		 */
+		template<typename S>
+		void write_json(S &sink) const
+		{
+			write_format_text(sink, to_string());
+		}
+	};
+
+	/**
+	 * A length of time in the `duration` format, parsed from ISO 8601 text
+	 * such as `PT1H30M` or `P2W` to the microsecond.  Years and months have
+	 * no fixed length, so durations that use them are rejected.  Days are
+	 * 24 hours.  This is a `std::chrono` duration and can be used as one.
+	 */
+	struct Duration : std::chrono::microseconds
+	{
+		/**
+		 * The name of the format.
+		 */
+		static constexpr const char *FormatName = "duration";
+
+		/**
+		 * Default constructor, a zero duration.
+		 */
+		constexpr Duration() = default;
+
+		/**
+		 * Constructor, wraps `d`.
+		 */
+		constexpr Duration(std::chrono::microseconds d)
+		  : std::chrono::microseconds(d)
+		{
+		}
+
+		/**
+		 * Parses `str`, returning nothing if it is not an ISO 8601 duration
+		 * with a fixed length.
+		 */
+		static constexpr std::optional<Duration> parse(std::string_view str)
+		{
+			// The designators, in the order that they must appear, and the
+			// length of each unit in microseconds.
+			constexpr std::string_view dateUnits = "WD";
+			constexpr std::string_view timeUnits = "HMS";
+			constexpr int64_t dateLengths[] = {604800000000LL, 86400000000LL};
+			constexpr int64_t timeLengths[] = {
+			  3600000000LL, 60000000LL, 1000000LL};
+			FormatReader reader(str);
+			if (!reader.accept('P'))
+			{
+				return std::nullopt;
+			}
+			int64_t total       = 0;
+			size_t  components  = 0;
+			size_t  next        = 0;
+			bool    inTime      = false;
+			bool    weeks       = false;
+			size_t  timeStarted = 0;
+			while (!reader.done())
+			{
+				if (!inTime && reader.accept('T'))
+				{
+					inTime      = true;
+					next        = 0;
+					timeStarted = components;
+					continue;
+				}
+				auto value = reader.digits(1, 12);
+				if (!value)
+				{
+					return std::nullopt;
+				}
+				int64_t fraction = 0;
+				bool    hasFraction = false;
+				if (inTime && reader.accept('.'))
+				{
+					size_t start = reader.offset();
+					auto   micro = reader.digits(1, 6);
+					if (!micro)
+					{
+						return std::nullopt;
+					}
+					fraction = int64_t(*micro);
+					for (size_t i = reader.since(start).size(); i < 6; i++)
+					{
+						fraction *= 10;
+					}
+					while ((reader.peek() >= '0') && (reader.peek() <= '9'))
+					{
+						reader.accept(reader.peek());
+					}
+					hasFraction = true;
+				}
+				auto units   = inTime ? timeUnits : dateUnits;
+				auto lengths = inTime ? timeLengths : dateLengths;
+				auto unit    = units.find(reader.peek(), next);
+				if ((unit == std::string_view::npos) || weeks ||
+				    (hasFraction && (units[unit] != 'S')))
+				{
+					return std::nullopt;
+				}
+				reader.accept(units[unit]);
+				weeks = !inTime && (unit == 0);
+				if (weeks && (components > 0))
+				{
+					return std::nullopt;
+				}
+				next = unit + 1;
+				if (int64_t(*value) >
+				    (INT64_MAX - total - fraction) / lengths[unit])
+				{
+					return std::nullopt;
+				}
+				total += int64_t(*value) * lengths[unit] + fraction;
+				components++;
+			}
+			if ((components == 0) || (inTime && (components == timeStarted)))
+			{
+				return std::nullopt;
+			}
+			return Duration(std::chrono::microseconds(total));
+		}
+
+		/**
+		 * Returns the duration in ISO 8601 form, in days, hours, minutes
+		 * and seconds.
+		 */
+		std::string to_string() const
+		{
+			int64_t     remaining = count();
+			std::string result    = "P";
+			auto        append    = [&](int64_t length, char unit) {
+				int64_t value = remaining / length;
+				remaining %= length;
+				if (value != 0)
+				{
+					result += std::to_string(value);
+					result += unit;
+				}
+			};
+			append(86400000000LL, 'D');
+			result += 'T';
+			append(3600000000LL, 'H');
+			append(60000000LL, 'M');
+			if ((remaining != 0) || (result == "PT"))
+			{
+				result += std::to_string(remaining / 1000000);
+				append_fraction(result, remaining % 1000000);
+				result += 'S';
+			}
+			if (result.back() == 'T')
+			{
+				result.pop_back();
+			}
+			return result;
+		}
+
+		/**
+		 * Returns a hash of the duration.
+		 */
+		uint64_t hash() const
+		{
+			return hash_mix(static_cast<uint64_t>(count()) ^ 0x64);
+		}
+
+		/**
+		 * Writes the duration as a JSON string.
+		 */
+		template<typename S>
+		void write_json(S &sink) const
+		{
+			write_format_text(sink, to_string());
+		}
+	};
+
+	/**
+	 * The type of the value parsed from a string with the format described
+	 * by `F`.
+	 */
+	template<typename F>
+	using FormatValue =
+	  typename decltype(F::parse(std::string_view{}))::value_type;
+
+	/**
+	 * Adaptor that exposes a UCL string as the value parsed from it by the
+	 * format `F`.  Strings that do not parse, which `make_config` rejects,
+	 * are returned as a value-initialised value.
+	 *
+	 * Adaptors are intended to be short-lived, created only as temporaries,
+	 * and must not outlive the object that they are adapting.
+	 */
+	template<typename F>
+	class FormatAdaptor
+	{
+		/**
+		 * Non-owning pointer to the UCL object that this adaptor is wrapping.
+		 */
+		const ucl_object_t *obj;
+
+		public:
+		/**
+		 * Constructor, captures a non-owning reference to a UCL object.
+		 */
+		FormatAdaptor(const ucl_object_t *o) : obj(o) {}
+
+		/**
+		 * Implicit cast operator, parses the string.
+		 */
+		operator FormatValue<F>()
+		{
+			return F::parse(StringViewAdaptor(obj)).value_or(FormatValue<F>{});
+		}
+	};
+
+	/**
+	 * Checks that the strings at the end of `path`, starting from `node`,
+	 * are in the format `F`.  Returns false and describes the first string
+	 * that is not in `err`, if there is one.
+	 */
+	template<typename F>
+	bool check_format(const ucl_object_t        *node,
+	                  std::span<const PathStep> path,
+	                  ucl_schema_error          *err)
+	{
+		return check_strings(
+		  node, path, [&](const ucl_object_t *str, std::string_view value) {
+			  if (F::parse(value))
+			  {
+				  return true;
+			  }
+			  err->code = UCL_SCHEMA_CONSTRAINT;
+			  err->obj  = str;
+			  snprintf(err->msg,
+			           sizeof(err->msg),
+			           "string doesn't match format %s",
+			           F::FormatName);
+			  return false;
+		  });
+	}
+
+} // namespace CONFIG_DETAIL_NAMESPACE
@@ -1,576 +1,3323 @@
 // Copyright David Chisnall
 // SPDX-License-Identifier: MIT
 #include "config-generic.h"
+#include "config-schema.h"
+#include "config-pattern.h"
+#include <bit>
+#include <bitset>
+#include <cmath>
 #include <fstream>
+#include <functional>
 #include <getopt.h>
 #include <iostream>
+#include <map>
+#include <memory>
+#include <ranges>
 #include <sstream>
+#include <unordered_map>
 #include <unordered_set>
+#include <utility>
+#include <vector>
 
 using namespace config;
 using namespace config::detail;
+using namespace config::detail::Schema;
 
-namespace Schema
+namespace
 {
-	struct Object;
-	struct Array;
-	struct String;
-	struct Integer;
-	struct Boolean;
-	struct Number;
-
 	/**
-	 * Base class for parts of a JSON Schema.
+	 * The namespace for the helpers defined in `config-generic.h`.  This can
+	 * be overridden on the command line.
 	 */
-	class SchemaBase
-	{
-		protected:
-		/**
-		 * The UCL object that this represents.
-		 */
-		UCLPtr obj;
-
-		public:
-		/**
-		 * Constructor, captures an owning reference to a UCL object.
-		 */
-		SchemaBase(const ucl_object_t *o) : obj(o) {}
-
-		/**
-		 * Type adaptor, allows dispatching to a visitor with overloads to all
-		 * of the basic types of schema depending on the value of the `type`
-		 * property.
-		 */
-		using TypeAdaptor = NamedTypeAdaptor<"type",
-		                                     NamedType<"object", Object>,
-		                                     NamedType<"array", Array>,
-		                                     NamedType<"string", String>,
-		                                     NamedType<"integer", Integer>,
-		                                     NamedType<"boolean", Boolean>,
-		                                     NamedType<"number", Number>>;
+	const char *configNamespace = "::config::detail::";
 
-		/**
-		 * Returns a type adaptor for this object that can be used to dispatch
-		 * based on the value of the `type` field.
-		 */
-		TypeAdaptor get()
-		{
-			return TypeAdaptor(obj);
-		}
+	/**
+	 * The name of the class that holds access counters for the generated
+	 * accessors.  If this is empty, accessors do not count reads.
+	 */
+	std::string accessCountersClass;
 
-		/**
-		 * Types of JSON sub-schema.
-		 */
-		enum Type
-		{
-			/**
-			 * A JSON object.
-			 */
-			TypeObject,
-			/**
-			 * A JSON string.
-			 */
-			TypeString,
-			/**
-			 * A JSON array.
-			 */
-			TypeArray,
-			/**
-			 * A JSON number.
-			 */
-			TypeNumber,
-			/**
-			 * An integer.  This is shorthand for a number with the constraint
-			 * that it must increment in units of 1.
-			 */
-			TypeInteger,
-			/**
-			 * A JSON boolean.
-			 */
-			TypeBool,
-		};
+	/**
+	 * The full path of each property that has an access counter, indexed by
+	 * counter.
+	 */
+	std::vector<std::string> accessCounterPaths;
 
-		/**
-		 * Enum adaptor type, maps from a string value from a JSON schema to a
-		 * value in the `Type` `enum`.
-		 */
-		using TypeEnumAdaptor =
-		  EnumAdaptor<Type,
-		              EnumValueMap<Enum{"object", TypeObject},
-		                           Enum{"array", TypeArray},
-		                           Enum{"string", TypeString},
-		                           Enum{"integer", TypeInteger},
-		                           Enum{"boolean", TypeBool},
-		                           Enum{"number", TypeNumber}>>;
+	/**
+	 * If true, generated classes report their memory usage and root classes
+	 * register with the live config registry.
+	 */
+	bool memoryAccounting = false;
 
-		/**
-		 * Returns the type of this schema.
-		 */
-		Type type()
-		{
-			return TypeEnumAdaptor(obj["type"]);
-		}
+	/**
+	 * If true, generated classes and structs have a `write_json` method.
+	 */
+	bool writeJson = false;
 
-		/**
-		 * Returns the title of this schema.
-		 */
-		std::string_view title()
-		{
-			return StringViewAdaptor(obj["title"]);
-		}
+	/**
+	 * If true, the root class is a template over the storage backend, with
+	 * libucl as the default.
+	 */
+	bool genericBackend = false;
 
-		/**
-		 * Returns the description of this schame.
-		 */
-		std::optional<std::string_view> description()
-		{
-			return make_optional<StringViewAdaptor>(obj["description"]);
-		}
-	};
+	/**
+	 * If true, root classes can hold the memory that a config was parsed
+	 * from without copying, and the generated loader maps files and parses
+	 * them in place.
+	 */
+	bool zeroCopy = false;
 
 	/**
-	 * Array.  Represents a JSON schema array.  This defines a field `items`
-	 * that describes elements of the array.
-	 *
-	 * *Note*: We currently support only a single element in the items
-	 * property, describing the type of all items.
+	 * If true, generated classes have a table describing their properties,
+	 * and can visit them and read them by ID.
 	 */
-	struct Array : public SchemaBase
-	{
-		using SchemaBase::SchemaBase;
+	bool reflection = false;
 
-		/**
-		 * The schema for the items of this array.
-		 */
-		SchemaBase items()
-		{
-			// FIXME: This only handles arrays that are arrays.
-			// For config files, this is probably fine because arrays that are
-			// tuples are better represented as objects.
-			return SchemaBase(obj["items"]);
-		}
-	};
+	/**
+	 * If true, strings whose `format` has a parser in `config-format.h` are
+	 * checked when configs are loaded and returned as the parsed value.
+	 */
+	bool parseFormats = false;
 
 	/**
-	 * A JSON schema string.  This is a trivial type.
+	 * If true, generated classes have a structural `hash` and `operator==`,
+	 * and root classes cache their property hashes when constructed.
 	 */
-	struct String : public SchemaBase
-	{
-		using SchemaBase::SchemaBase;
-	};
+	bool structuralHash = false;
 
 	/**
-	 * A JSON schema number.  This can define an allowed range, and a step size.
+	 * Returns a C++ string literal containing the JSON for the key `key`,
+	 * preceded by a comma and followed by a colon, as expected by
+	 * `write_key`.
 	 */
-	struct Number : public SchemaBase
+	std::string json_key_literal(std::string_view key)
 	{
-		using SchemaBase::SchemaBase;
-
-		/**
-		 * The minimum value.  Valid numbers are >= this value.
-		 */
-		std::optional<double> minimum()
-		{
-			return make_optional<DoubleAdaptor>(obj["minimum"]);
-		}
-
-		/**
-		 * The exclusive minimum value.  Valid numbers are > this value.
-		 */
-		std::optional<double> exclusiveMinimum()
+		std::string json = ",\"";
+		for (char c : key)
 		{
-			return make_optional<DoubleAdaptor>(obj["exclusiveMinimum"]);
+			if ((c == '"') || (c == '\\'))
+			{
+				json += '\\';
+				json += c;
+			}
+			else if (static_cast<unsigned char>(c) < 0x20)
+			{
+				char escape[8];
+				snprintf(escape, sizeof(escape), "\\u%04x", c);
+				json += escape;
+			}
+			else
+			{
+				json += c;
+			}
 		}
-
-		/**
-		 * The maximum value.  Valid numbers are <= this value.
-		 */
-		std::optional<double> maximum()
+		json += "\":";
+		std::string literal = "\"";
+		for (char c : json)
 		{
-			return make_optional<DoubleAdaptor>(obj["maximum"]);
+			if ((c == '"') || (c == '\\'))
+			{
+				literal += '\\';
+			}
+			literal += c;
 		}
+		literal += '"';
+		return literal;
+	}
 
-		/**
-		 * The exclusive maximum value.  Valid numbers are < this value.
-		 */
-		std::optional<double> exclusiveMaximum()
+	/**
+	 * Returns the statements that write the property with accessor `method`
+	 * and key `key` to a sink named `sink`, as part of a `write_json` method.
+	 * Optional properties are omitted if they are not present.
+	 */
+	std::string json_property_writer(std::string_view method,
+	                                 std::string_view key,
+	                                 bool             optional)
+	{
+		std::string writer;
+		std::string value = "this->";
+		value += method;
+		value += "()";
+		if (optional)
 		{
-			return make_optional<DoubleAdaptor>(obj["exclusiveMaximum"]);
+			writer = "if (auto v = " + value + ") {";
+			value  = "*v";
 		}
-
-		/**
-		 * The step size.  A valid value % this value == 0.
-		 */
-		std::optional<double> multipleOf()
+		writer += configNamespace;
+		writer += "write_key(sink, first, " + json_key_literal(key) + ");\n";
+		writer += configNamespace;
+		writer += "write_json_value(sink, " + value + ");";
+		if (optional)
 		{
-			return make_optional<DoubleAdaptor>(obj["multipleOf"]);
+			writer += "}";
 		}
-	};
+		writer += "\n";
+		return writer;
+	}
 
 	/**
-	 * Integer, a kind of number.
+	 * Returns a `write_json` method that runs the property writers in
+	 * `writers`.
 	 */
-	struct Integer : public Number
+	std::string json_writer(std::string_view writers)
 	{
-		using Number::Number;
-	};
+		std::string method = "template<";
+		method += configNamespace;
+		method += "Sink S>\nvoid write_json(S &sink) const {"
+		          "[[maybe_unused]] bool first = true;\n";
+		method += configNamespace;
+		method += "write_literal(sink, \"{\");\n";
+		method += writers;
+		method += configNamespace;
+		method += "write_literal(sink, \"}\");}\n";
+		return method;
+	}
 
 	/**
-	 * Boolean, a trivial type in JSON schema.
+	 * Access counts for each property path, read from a layout profile.  If
+	 * this is empty, materialised structs are laid out in schema order.
 	 */
-	struct Boolean : public SchemaBase
-	{
-		using SchemaBase::SchemaBase;
-	};
+	std::unordered_map<std::string, uint64_t> layoutProfile;
 
 	/**
-	 * A JSON Schema object, contains a set of properties some of which may be
-	 * required, some optional.
+	 * The largest access count in the layout profile.
 	 */
-	struct Object : public SchemaBase
+	uint64_t layoutHottest = 0;
+
+	/**
+	 * The tables of a `PatternDfa`, as built by the generator.
+	 */
+	struct DfaTables
 	{
-		public:
-		using SchemaBase::SchemaBase;
+		/**
+		 * The class of each ASCII byte.
+		 */
+		std::array<uint8_t, 128> classes{};
 
 		/**
-		 * The type for the properties.  This provides an iterable range of
-		 * key-value pairs mapping from name to property.
+		 * The number of classes.
 		 */
-		using Properties =
-		  Range<PropertyAdaptor<SchemaBase>, PropertyAdaptor<SchemaBase>, true>;
+		uint16_t classCount = 0;
 
 		/**
-		 * The properties of this object.
+		 * The next state for each state and class.
 		 */
-		Properties properties()
-		{
-			return Properties(obj["properties"]);
-		}
+		std::vector<uint16_t> transitions;
 
 		/**
-		 * The names of any properties that are required.  Properties not
-		 * specified by this collection are optional.
+		 * The flags for each state.
 		 */
-		std::optional<Range<std::string_view, StringViewAdaptor>> required()
-		{
-			return make_optional<Range<std::string_view, StringViewAdaptor>>(
-			  obj["required"]);
-		}
+		std::vector<uint8_t> flags;
 	};
 
 	/**
-	 * The root of a schema.  This is an object that also defines a schema and a
-	 * unique id.
+	 * Compiler from `pattern`s to automata.  This understands the subset of
+	 * POSIX extended regular expressions that schemas for config files use:
+	 * literals, `.`, bracket expressions without named classes, escaped
+	 * special characters, groups, alternation, the `*`, `+`, `?` and `{m,n}`
+	 * quantifiers, and `^` and `$` anchors.  It gives up on anything else,
+	 * and on automata that would be too large, in which case the pattern is
+	 * matched with the regular expression library at run time.
+	 *
+	 * The pattern is parsed into a tree, the tree into a Thompson NFA, and
+	 * the NFA into a DFA by the subset construction.  Like `regexec`, the
+	 * DFA searches for a match anywhere in the string, so it restarts the
+	 * NFA at every position.
 	 */
-	class Root : public Object
+	class PatternCompiler
 	{
-		public:
 		/**
-		 * Constructor, takes an owning reference to a UCL object.
+		 * A set of ASCII characters.
 		 */
-		Root(ucl_object_t *o) : Object(o) {}
+		using CharSet = std::bitset<128>;
 
 		/**
-		 * The schema property.  Should match the JSON Schema schema
+		 * A node in the syntax tree.
 		 */
-		std::string_view schema()
+		struct Node
 		{
-			return StringViewAdaptor(obj["$schema"]);
-		}
+			/**
+			 * The kinds of node.
+			 */
+			enum Kind
+			{
+				/**
+				 * One character from `set`.
+				 */
+				Chars,
 
-		/**
-		 * The id property.
-		 */
-		std::string_view id()
-		{
-			return StringViewAdaptor(obj["$id"]);
-		}
-	};
-} // namespace Schema
+				/**
+				 * The children in sequence.
+				 */
+				Sequence,
 
-using namespace Schema;
+				/**
+				 * Any one of the children.
+				 */
+				Alternatives,
 
-namespace
-{
-	/**
-	 * The namespace for the helpers defined in `config-generic.h`.  This can
-	 * be overridden on the command line.
-	 */
-	const char *configNamespace = "::config::detail::";
+				/**
+				 * The only child, repeated from `min` to `max` times.
+				 */
+				Repeat,
 
-	template<typename T>
-	void emit_class(Object o, std::string_view name, T &out);
+				/**
+				 * The start of the string.
+				 */
+				Begin,
 
+				/**
+				 * The end of the string.
+				 */
+				End
+			} kind;
+
+			/**
+			 * The characters, for `Chars` nodes.
+			 */
+			CharSet set;
+
+			/**
+			 * The children.
+			 */
+			std::vector<Node> children;
+
+			/**
+			 * The bounds of `Repeat` nodes.  `max` is `Unbounded` for no
+			 * upper bound.
+			 */
+			unsigned min = 0, max = 0;
+		};
 
-	/**
-	 * Schema visitor.  This visits a schema and collects the information
-	 * required to provide the accessor for the described type.
-	 */
-	class SchemaVisitor
-	{
 		/**
-		 * The name of a class emitted by this schema.  This exists because all
-		 * of the other properties are non-owning string views and sometimes
-		 * they need an owned string to reference.
+		 * The upper bound of unbounded repetitions.
 		 */
-		std::string        className;
+		static constexpr unsigned Unbounded = ~0U;
 
-		public:
 		/**
-		 * The return type for the accessor for this schema.
+		 * The largest bound that a repetition may have, because bounded
+		 * repetitions are expanded into copies.
 		 */
-		std::string_view   return_type;
+		static constexpr unsigned MaxBound = 64;
 
 		/**
-		 * The adaptor type to use for this schema.
+		 * The largest number of states that a DFA may have.
 		 */
-		std::string_view   adaptor;
+		static constexpr size_t MaxStates = 1024;
 
 		/**
-		 * The namespace in which the adaptor is defined. 
+		 * A state in the NFA.
 		 */
-		std::string_view   adaptorNamespace = configNamespace;
+		struct State
+		{
+			/**
+			 * The kinds of state.
+			 */
+			enum Kind
+			{
+				/**
+				 * Consumes a character from `set` and moves to `next[0]`.
+				 */
+				Chars,
+
+				/**
+				 * Moves to every state in `next` without consuming anything.
+				 */
+				Split,
+
+				/**
+				 * Moves to `next[0]` at the start of the string.
+				 */
+				Begin,
+
+				/**
+				 * Moves to `next[0]` at the end of the string.
+				 */
+				End,
+
+				/**
+				 * The match is complete.
+				 */
+				Accept
+			} kind;
+
+			/**
+			 * The characters, for `Chars` states.
+			 */
+			CharSet set;
+
+			/**
+			 * The successor states.
+			 */
+			std::vector<int> next;
+		};
 
 		/**
-		 * The lifetime attribute for this property, if one is required.  For
-		 * strings, the returned `string_view` has a lifetime bound by the
-		 * underlying schema.  Other types are typically either owning
-		 * references or value types.
+		 * The pattern.
 		 */
-		std::string_view   lifetimeAttribute;
+		std::string_view pattern;
 
 		/**
-		 * The name of this property.
+		 * The position of the parser in `pattern`.
 		 */
-		std::string_view   name;
+		size_t position = 0;
 
 		/**
-		 * Any new types that were declared to handle this property.
+		 * The NFA.
 		 */
-		std::stringstream &types;
+		std::vector<State> states;
 
 		/**
-		 * Construct a schema visitor with a specified name, writing to an
-		 * output string stream.
+		 * Returns true if the parser has read the whole pattern.
 		 */
-		SchemaVisitor(std::string_view n, std::stringstream &t)
-		  : name(n), types(t)
+		bool done()
 		{
+			return position == pattern.size();
 		}
 
 		/**
-		 * Handle a number.  This is common code for all of the number
-		 * subclasses.  It provides an adaptor that is the smallest type that
-		 * satisfies all of the constraints.
+		 * Returns the next character of the pattern, which must exist.
 		 */
-		void handleNumber(Number &num, bool isInteger)
+		char peek()
 		{
-			if (!isInteger)
+			return pattern[position];
+		}
+
+		/**
+		 * Returns true if `c` starts a repetition.
+		 */
+		static bool is_repetition(char c)
+		{
+			return (c == '*') || (c == '+') || (c == '?') || (c == '{');
+		}
+
+		/**
+		 * Parses alternatives, up to the end of the pattern or of a group.
+		 */
+		std::optional<Node> parse_alternatives()
+		{
+			Node alternatives{Node::Alternatives};
+			for (;;)
 			{
-				auto multipleOf = num.multipleOf();
-				if (multipleOf)
+				auto sequence = parse_sequence();
+				if (!sequence)
 				{
-					isInteger =
-					  (((double)(uint64_t)*multipleOf) == *multipleOf);
+					return std::nullopt;
+				}
+				alternatives.children.push_back(std::move(*sequence));
+				if (done() || (peek() != '|'))
+				{
+					break;
 				}
+				position++;
 			}
-			if (!isInteger)
+			if (alternatives.children.size() == 1)
 			{
-				return_type = "double";
-				adaptor     = "DoubleAdaptor";
-				return;
+				return std::move(alternatives.children.front());
 			}
-			int64_t min = std::numeric_limits<int64_t>::min();
-			int64_t max = std::numeric_limits<int64_t>::max();
-			min =
-			  std::max(min, static_cast<int64_t>(num.minimum().value_or(min)));
-			min = std::max(
-			  min, static_cast<int64_t>(num.exclusiveMinimum().value_or(min)));
-			max =
-			  std::min(max, static_cast<int64_t>(num.maximum().value_or(max)));
-			max = std::min(
-			  max, static_cast<int64_t>(num.exclusiveMaximum().value_or(max)));
-			auto try_type =
-			  [&](auto intty, std::string_view ty, std::string_view a) {
-				  if ((min >= std::numeric_limits<decltype(intty)>::min()) &&
-				      (max <= std::numeric_limits<decltype(intty)>::max()))
-				  {
-					  return_type = ty;
-					  adaptor     = a;
-				  }
-			  };
-			try_type(int64_t(), "int64_t", "Int64Adaptor");
-			try_type(uint64_t(), "uint64_t", "UInt64Adaptor");
-			try_type(int32_t(), "int32_t", "Int32Adaptor");
-			try_type(uint32_t(), "uint32_t", "UInt32Adaptor");
-			try_type(int16_t(), "int16_t", "Int16Adaptor");
-			try_type(uint16_t(), "uint16_t", "UInt16Adaptor");
-			try_type(int8_t(), "int8_t", "Int8Adaptor");
-			try_type(uint8_t(), "uint8_t", "UInt8Adaptor");
+			return alternatives;
 		}
 
 		/**
-		 * Handle a string schema.
+		 * Parses a sequence of quantified atoms, up to the end of the
+		 * pattern, a `|` or the end of a group.  Empty sequences are
+		 * rejected, because implementations disagree about them.
 		 */
-		void operator()(String)
+		std::optional<Node> parse_sequence()
 		{
-			return_type       = "std::string_view";
-			adaptor           = "StringViewAdaptor";
-			lifetimeAttribute = "CONFIG_LIFETIME_BOUND";
+			Node sequence{Node::Sequence};
+			while (!done() && (peek() != '|') && (peek() != ')'))
+			{
+				auto atom = parse_atom();
+				if (!atom)
+				{
+					return std::nullopt;
+				}
+				while (!done() && is_repetition(peek()))
+				{
+					if (atom->kind == Node::Begin || atom->kind == Node::End)
+					{
+						return std::nullopt;
+					}
+					unsigned min = 0, max = Unbounded;
+					switch (pattern[position++])
+					{
+						case '+':
+							min = 1;
+							break;
+						case '?':
+							max = 1;
+							break;
+						case '{':
+							if (!parse_bounds(min, max))
+							{
+								return std::nullopt;
+							}
+							break;
+					}
+					Node repeat{Node::Repeat};
+					repeat.min = min;
+					repeat.max = max;
+					repeat.children.push_back(std::move(*atom));
+					atom = std::move(repeat);
+				}
+				sequence.children.push_back(std::move(*atom));
+			}
+			if (sequence.children.empty())
+			{
+				return std::nullopt;
+			}
+			return sequence;
 		}
 
 		/**
-		 * Handle a boolean schema.
+		 * Parses a number in a bound.
 		 */
-		void operator()(Boolean)
+		std::optional<unsigned> parse_number()
 		{
-			return_type = "bool";
-			adaptor     = "BoolAdaptor";
+			unsigned value  = 0;
+			size_t   digits = 0;
+			while (!done() && std::isdigit(static_cast<unsigned char>(peek())))
+			{
+				value = value * 10 + (pattern[position++] - '0');
+				if (value > MaxBound)
+				{
+					return std::nullopt;
+				}
+				digits++;
+			}
+			return digits == 0 ? std::nullopt : std::optional(value);
 		}
 
 		/**
-		 * Handle an integer schema.
+		 * Parses the bounds of a `{m}`, `{m,}` or `{m,n}` quantifier, after
+		 * the opening brace.
 		 */
-		void operator()(Integer i)
+		bool parse_bounds(unsigned &min, unsigned &max)
 		{
-			handleNumber(i, true);
-		}
-
-		/**
-		 * Handle an integer schema.
+			auto lower = parse_number();
+			if (!lower || done())
+			{
+				return false;
+			}
+			min = max = *lower;
+			if (peek() == ',')
+			{
+				position++;
+				max = Unbounded;
+				if (!done() && (peek() != '}'))
+				{
+					auto upper = parse_number();
+					if (!upper || (*upper < min))
+					{
+						return false;
+					}
+					max = *upper;
+				}
+			}
+			if (done() || (peek() != '}'))
+			{
+				return false;
+			}
+			position++;
+			return true;
+		}
+
+		/**
+		 * Parses an atom: a character, a bracket expression, a group or an
+		 * anchor.
 		 */
-		void operator()(Number n)
+		std::optional<Node> parse_atom()
 		{
-			handleNumber(n, false);
+			char c = pattern[position++];
+			Node chars{Node::Chars};
+			switch (c)
+			{
+				case '(':
+				{
+					auto group = parse_alternatives();
+					if (!group || done() || (peek() != ')'))
+					{
+						return std::nullopt;
+					}
+					position++;
+					return group;
+				}
+				case '[':
+					return parse_bracket();
+				case '^':
+					return Node{Node::Begin};
+				case '$':
+					return Node{Node::End};
+				case '.':
+					chars.set.set();
+					chars.set.reset(0);
+					return chars;
+				case '\\':
+					// Only escaped special characters mean the same thing to
+					// every implementation.
+					if (done() ||
+					    (std::string_view(".[]()*+?{}|^$\\/-").find(peek()) ==
+					     std::string_view::npos))
+					{
+						return std::nullopt;
+					}
+					c = pattern[position++];
+					break;
+				case '*':
+				case '+':
+				case '?':
+				case '{':
+				case '}':
+				case ')':
+				case ']':
+					return std::nullopt;
+			}
+			if (static_cast<unsigned char>(c) > 127)
+			{
+				return std::nullopt;
+			}
+			chars.set.set(static_cast<unsigned char>(c));
+			return chars;
 		}
 
 		/**
-		 * Handle an object schema.  This does a recursive visit to generate a
-		 * new class that represents the object.
+		 * Parses a bracket expression, after the opening bracket.  As in
+		 * POSIX, backslashes are not special inside brackets.
 		 */
-		void operator()(Object o)
+		std::optional<Node> parse_bracket()
 		{
-			className = name;
-			className += "Class";
-			emit_class(o, className, types);
-			return_type      = className;
-			adaptor          = className;
-			adaptorNamespace = "";
+			Node chars{Node::Chars};
+			bool negated = !done() && (peek() == '^');
+			if (negated)
+			{
+				position++;
+			}
+			bool first = true;
+			for (;;)
+			{
+				if (done())
+				{
+					return std::nullopt;
+				}
+				unsigned char c = pattern[position++];
+				if ((c == ']') && !first)
+				{
+					break;
+				}
+				first = false;
+				if ((c == '[') && !done() &&
+				    ((peek() == ':') || (peek() == '=') || (peek() == '.')))
+				{
+					return std::nullopt;
+				}
+				unsigned char last = c;
+				if ((position + 1 < pattern.size()) && (peek() == '-') &&
+				    (pattern[position + 1] != ']'))
+				{
+					last = pattern[position + 1];
+					position += 2;
+					if ((last == '[') || (last < c))
+					{
+						return std::nullopt;
+					}
+				}
+				if (last > 127)
+				{
+					return std::nullopt;
+				}
+				for (unsigned i = c; i <= last; i++)
+				{
+					chars.set.set(i);
+				}
+			}
+			if (negated)
+			{
+				chars.set.flip();
+			}
+			chars.set.reset(0);
+			return chars;
 		}
 
 		/**
-		 * Handle an array.  This performs a recursive visit to generate a new
-		 * class representing the array element type.
-		 *
-		 * Note that this currently handles only arrays of a single object
-		 * type, not heterogeneous arrays.
+		 * Adds a state to the NFA and returns its index.
 		 */
-		void operator()(Array a)
+		int add_state(State::Kind kind, std::vector<int> next = {})
 		{
-			std::string itemName{name};
-			itemName += "Item";
-			SchemaVisitor item(itemName, types);
-			auto          items = a.items();
-			items.get().visit(item);
-			className = configNamespace;
-			className += "::Range<";
-			className += item.return_type;
-			className += ", ";
-			className += item.adaptor;
-			className += ", true>";
-			return_type      = className;
-			adaptor          = className;
-			adaptorNamespace = "";
+			states.push_back({kind, {}, std::move(next)});
+			return static_cast<int>(states.size() - 1);
+		}
+
+		/**
+		 * Adds the states for `node`, leading to `next`, to the NFA and
+		 * returns the first of them.  States are built from the end of the
+		 * pattern backwards, so that each knows its successors.
+		 */
+		int build(const Node &node, int next)
+		{
+			switch (node.kind)
+			{
+				case Node::Chars:
+				{
+					int state             = add_state(State::Chars, {next});
+					states[state].set     = node.set;
+					return state;
+				}
+				case Node::Sequence:
+					for (auto &child : std::views::reverse(node.children))
+					{
+						next = build(child, next);
+					}
+					return next;
+				case Node::Alternatives:
+				{
+					std::vector<int> starts;
+					for (auto &child : node.children)
+					{
+						starts.push_back(build(child, next));
+					}
+					return add_state(State::Split, std::move(starts));
+				}
+				case Node::Repeat:
+				{
+					auto &child = node.children.front();
+					int   tail  = next;
+					if (node.max == Unbounded)
+					{
+						tail = add_state(State::Split);
+						int body = build(child, tail);
+						states[tail].next = {body, next};
+					}
+					else
+					{
+						// Each optional copy either matches and moves on to the
+						// next, or skips the rest.
+						for (unsigned i = node.min; i < node.max; i++)
+						{
+							int body = build(child, tail);
+							tail     = add_state(State::Split, {body, next});
+						}
+					}
+					for (unsigned i = 0; i < node.min; i++)
+					{
+						tail = build(child, tail);
+					}
+					return tail;
+				}
+				case Node::Begin:
+					return add_state(State::Begin, {next});
+				case Node::End:
+					return add_state(State::End, {next});
+			}
+			return next;
+		}
+
+		/**
+		 * Adds the states reachable from `state` without consuming a
+		 * character to `set`.  Anchors are followed only at the start or
+		 * end of the string.
+		 */
+		void
+		closure(int state, bool atStart, bool atEnd, std::vector<bool> &set)
+		{
+			if (set[state])
+			{
+				return;
+			}
+			set[state] = true;
+			auto &s    = states[state];
+			if ((s.kind == State::Split) ||
+			    ((s.kind == State::Begin) && atStart) ||
+			    ((s.kind == State::End) && atEnd))
+			{
+				for (int next : s.next)
+				{
+					closure(next, atStart, atEnd, set);
+				}
+			}
+		}
+
+		public:
+		/**
+		 * Constructor, compiles `p`.
+		 */
+		PatternCompiler(std::string_view p) : pattern(p) {}
+
+		/**
+		 * Returns the automaton for the pattern, or `std::nullopt` if the
+		 * pattern uses syntax that this does not handle or the automaton is
+		 * too large.
+		 */
+		std::optional<DfaTables> compile()
+		{
+			auto tree = parse_alternatives();
+			if (!tree || !done())
+			{
+				return std::nullopt;
+			}
+			int accept = add_state(State::Accept);
+			int start  = build(*tree, accept);
+
+			// Characters that every `Chars` state treats the same way share a
+			// class.
+			DfaTables                         dfa;
+			std::map<std::vector<bool>, int> classIds;
+			for (unsigned c = 0; c < 128; c++)
+			{
+				std::vector<bool> signature;
+				for (auto &s : states)
+				{
+					if (s.kind == State::Chars)
+					{
+						signature.push_back(s.set[c]);
+					}
+				}
+				auto [it, inserted] =
+				  classIds.try_emplace(std::move(signature), classIds.size());
+				dfa.classes[c] = it->second;
+			}
+			dfa.classCount = classIds.size();
+			std::vector<unsigned> representative(dfa.classCount);
+			for (unsigned c = 128; c-- > 0;)
+			{
+				representative[dfa.classes[c]] = c;
+			}
+
+			// Subset construction.  The start state is the only one where
+			// `^` can match, so it is kept apart from states with the same
+			// NFA states.
+			std::map<std::pair<bool, std::vector<bool>>, uint16_t> ids;
+			std::vector<std::vector<bool>>                         sets;
+			auto intern = [&](bool initial, std::vector<bool> set) {
+				auto [it, inserted] =
+				  ids.try_emplace({initial, set}, uint16_t(sets.size()));
+				if (inserted)
+				{
+					sets.push_back(std::move(set));
+				}
+				return it->second;
+			};
+			std::vector<bool> initial(states.size());
+			closure(start, true, false, initial);
+			intern(true, initial);
+			std::vector<bool> restart(states.size());
+			closure(start, false, false, restart);
+			for (size_t d = 0; d < sets.size(); d++)
+			{
+				if (sets.size() > MaxStates)
+				{
+					return std::nullopt;
+				}
+				auto set = sets[d];
+				// Matches are found as soon as they end.  Matches that end
+				// with `$` are found when the string ends.
+				uint8_t           flags = 0;
+				std::vector<bool> atEnd(states.size());
+				for (size_t s = 0; s < states.size(); s++)
+				{
+					if (set[s])
+					{
+						closure(s, d == 0, true, atEnd);
+					}
+				}
+				if (set[accept])
+				{
+					flags = PatternDfa::Matched | PatternDfa::AcceptsAtEnd;
+				}
+				else if (atEnd[accept])
+				{
+					flags = PatternDfa::AcceptsAtEnd;
+				}
+				dfa.flags.push_back(flags);
+				for (uint16_t c = 0; c < dfa.classCount; c++)
+				{
+					if (flags & PatternDfa::Matched)
+					{
+						dfa.transitions.push_back(d);
+						continue;
+					}
+					std::vector<bool> next = restart;
+					for (size_t s = 0; s < states.size(); s++)
+					{
+						if (set[s] && (states[s].kind == State::Chars) &&
+						    states[s].set[representative[c]])
+						{
+							closure(states[s].next[0], false, false, next);
+						}
+					}
+					dfa.transitions.push_back(intern(false, std::move(next)));
+				}
+			}
+			return dfa;
+		}
+	};
+
+	template<typename T>
+	void emit_class(Object           o,
+	                std::string_view name,
+	                T               &out,
+	                std::string_view prefix = "");
+
+	template<typename T>
+	void emit_external_sections(Object o, T &out);
+
+	/**
+	 * Returns true if any property of the object schema `o` is an external
+	 * section, kept in a separate file.
+	 */
+	bool has_external_sections(Object o)
+	{
+		for (auto prop : o.properties())
+		{
+			if (prop.external())
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	/**
+	 * Returns the schema of each element of the array `a` if it has a fixed
+	 * length: a tuple, or an array of scalars whose `minItems` and
+	 * `maxItems` are equal.  These are stored inline, as a `std::tuple` or a
+	 * `std::array`, rather than exposed as ranges.  Sets `isTuple` if `a` is
+	 * a tuple.  Returns `std::nullopt` for other arrays.
+	 */
+	std::optional<std::vector<SchemaBase>> fixed_elements(Array a,
+	                                                      bool &isTuple)
+	{
+		auto isScalar = [](SchemaBase schema) {
+			bool scalar = false;
+			schema.get().visit(
+			  [](Object) {}, [](Array) {}, [&](auto) { scalar = true; });
+			return scalar;
+		};
+		std::vector<SchemaBase> elements;
+		isTuple = false;
+		if (auto tuple = a.tupleItems())
+		{
+			isTuple = true;
+			for (auto element : *tuple)
+			{
+				if (!isScalar(element))
+				{
+					fprintf(stderr, "Tuple items must be scalars\n");
+					exit(EXIT_FAILURE);
+				}
+				elements.push_back(element);
+			}
+			return elements.empty() ? std::nullopt
+			                        : std::optional(std::move(elements));
+		}
+		auto min = a.minItems();
+		auto max = a.maxItems();
+		if (!min || !max || (*min != *max) || (*min <= 0) ||
+		    !isScalar(a.items()))
+		{
+			return std::nullopt;
+		}
+		elements.resize(*min, a.items());
+		return elements;
+	}
+
+	/**
+	 * Returns the type of a fixed-length array whose elements have the
+	 * types `elements`: a `std::tuple` if `isTuple` is set, otherwise a
+	 * `std::array`, whose elements all have the same type.
+	 */
+	std::string fixed_type(bool isTuple, const std::vector<std::string> &elements)
+	{
+		if (!isTuple)
+		{
+			return "std::array<" + elements.front() + ", " +
+			       std::to_string(elements.size()) + ">";
 		}
+		std::string type = "std::tuple<";
+		for (auto &element : elements)
+		{
+			type += element;
+			type += (&element == &elements.back()) ? ">" : ", ";
+		}
+		return type;
+	}
+
+	/**
+	 * A string `format` that `config-format.h` can parse.
+	 */
+	struct StringFormat
+	{
+		/**
+		 * The name of the format in the schema.
+		 */
+		std::string_view name;
+
+		/**
+		 * The class in `config-format.h` that parses the format.
+		 */
+		std::string_view parser;
+
+		/**
+		 * The type returned by accessors, or empty if they return strings.
+		 */
+		std::string_view value;
+
+		/**
+		 * The type that materialized structs store, if `value` refers to the
+		 * string and so cannot be stored.
+		 */
+		std::string_view storage;
 	};
 
 	/**
-	 * Emit a class.  The class is defined by the object schema `o` and should
-	 * have the name given by the `name` argument.  It will be written to the
-	 * `out` stream.
+	 * Returns the parser for the format of the string schema `s`, or null
+	 * if `--parse-formats` is not enabled or there is none.
+	 */
+	const StringFormat *string_format(String s)
+	{
+		static constexpr StringFormat formats[] = {
+		  {"ipv4", "Ipv4Address", "Ipv4Address", ""},
+		  {"ipv6", "Ipv6Address", "Ipv6Address", ""},
+		  {"hostname", "Hostname", "", ""},
+		  {"uri", "UriView", "UriView", "Uri"},
+		  {"date-time", "DateTime", "DateTime", ""},
+		  {"duration", "Duration", "Duration", ""},
+		};
+		auto format = s.format();
+		if (!parseFormats || !format)
+		{
+			return nullptr;
+		}
+		for (auto &f : formats)
+		{
+			if (f.name == *format)
+			{
+				return &f;
+			}
+		}
+		return nullptr;
+	}
+
+	/**
+	 * Returns the parser for the format of the string schema `s` if
+	 * accessors return the parsed value, or null if they return the string.
+	 * Generic backends expose every string as a string.
+	 */
+	const StringFormat *typed_format(String s)
+	{
+		auto *format = string_format(s);
+		if ((format == nullptr) || format->value.empty() || genericBackend)
+		{
+			return nullptr;
+		}
+		return format;
+	}
+
+	/**
+	 * Schema visitor.  This visits a schema and collects the information
+	 * required to provide the accessor for the described type.
+	 */
+	class SchemaVisitor
+	{
+		/**
+		 * The name of a class emitted by this schema.  This exists because all
+		 * of the other properties are non-owning string views and sometimes
+		 * they need an owned string to reference.
+		 */
+		std::string        className;
+
+		/**
+		 * The type of a fixed-length array, which is owned here for the same
+		 * reason as `className`.
+		 */
+		std::string        fixedType;
+
+		/**
+		 * The type of a parsed string, which is owned here for the same
+		 * reason as `className`.
+		 */
+		std::string        formatType;
+
+		public:
+		/**
+		 * The return type for the accessor for this schema.
+		 */
+		std::string_view   return_type;
+
+		/**
+		 * The adaptor type to use for this schema.
+		 */
+		std::string_view   adaptor;
+
+		/**
+		 * The namespace in which the adaptor is defined. 
+		 */
+		std::string_view   adaptorNamespace = configNamespace;
+
+		/**
+		 * The lifetime attribute for this property, if one is required.  For
+		 * strings, the returned `string_view` has a lifetime bound by the
+		 * underlying schema.  Other types are typically either owning
+		 * references or value types.
+		 */
+		std::string_view   lifetimeAttribute;
+
+		/**
+		 * The class that parses the format of this string, if it has a
+		 * format that `--parse-formats` handles.
+		 */
+		std::string_view   format;
+
+		/**
+		 * The smallest value allowed by the schema, for integer schemas.
+		 */
+		int64_t            minimum = std::numeric_limits<int64_t>::min();
+
+		/**
+		 * The largest value allowed by the schema, for integer schemas.
+		 */
+		int64_t            maximum = std::numeric_limits<int64_t>::max();
+
+		/**
+		 * The name of this property.
+		 */
+		std::string_view   name;
+
+		/**
+		 * The full path of this property from the root of the config.
+		 */
+		std::string_view   path;
+
+		/**
+		 * Any new types that were declared to handle this property.
+		 */
+		std::stringstream &types;
+
+		/**
+		 * Construct a schema visitor with a specified name and path, writing
+		 * to an output string stream.
+		 */
+		SchemaVisitor(std::string_view   n,
+		              std::stringstream &t,
+		              std::string_view   p = "")
+		  : name(n), path(p), types(t)
+		{
+		}
+
+		/**
+		 * If the root class is generic over the backend, replaces the UCL
+		 * adaptor for a scalar with the adaptor for the backend `B`.
+		 */
+		void useBackendAdaptor()
+		{
+			if (genericBackend)
+			{
+				className = "ValueAdaptor<";
+				className += return_type;
+				className += ", B>";
+				adaptor = className;
+			}
+		}
+
+		/**
+		 * Handle a number.  This is common code for all of the number
+		 * subclasses.  It provides an adaptor that is the smallest type that
+		 * satisfies all of the constraints.
+		 */
+		void handleNumber(Number &num, bool isInteger)
+		{
+			if (!isInteger)
+			{
+				auto multipleOf = num.multipleOf();
+				if (multipleOf)
+				{
+					isInteger =
+					  (((double)(uint64_t)*multipleOf) == *multipleOf);
+				}
+			}
+			if (!isInteger)
+			{
+				return_type = "double";
+				adaptor     = "DoubleAdaptor";
+				useBackendAdaptor();
+				return;
+			}
+			int64_t min = std::numeric_limits<int64_t>::min();
+			int64_t max = std::numeric_limits<int64_t>::max();
+			// Converting a double outside of the range of `int64_t` is
+			// undefined, so clamp bounds before converting them.
+			auto toInt = [](double bound) {
+				if (bound <= static_cast<double>(
+				               std::numeric_limits<int64_t>::min()))
+				{
+					return std::numeric_limits<int64_t>::min();
+				}
+				if (bound >= static_cast<double>(
+				               std::numeric_limits<int64_t>::max()))
+				{
+					return std::numeric_limits<int64_t>::max();
+				}
+				return static_cast<int64_t>(bound);
+			};
+			for (auto bound : {num.minimum(), num.exclusiveMinimum()})
+			{
+				if (bound)
+				{
+					min = std::max(min, toInt(*bound));
+				}
+			}
+			for (auto bound : {num.maximum(), num.exclusiveMaximum()})
+			{
+				if (bound)
+				{
+					max = std::min(max, toInt(*bound));
+				}
+			}
+			minimum = min;
+			maximum = max;
+			auto try_type =
+			  [&](auto intty, std::string_view ty, std::string_view a) {
+				  if (std::cmp_greater_equal(
+				        min, std::numeric_limits<decltype(intty)>::min()) &&
+				      std::cmp_less_equal(
+				        max, std::numeric_limits<decltype(intty)>::max()))
+				  {
+					  return_type = ty;
+					  adaptor     = a;
+				  }
+			  };
+			try_type(int64_t(), "int64_t", "Int64Adaptor");
+			try_type(uint64_t(), "uint64_t", "UInt64Adaptor");
+			try_type(int32_t(), "int32_t", "Int32Adaptor");
+			try_type(uint32_t(), "uint32_t", "UInt32Adaptor");
+			try_type(int16_t(), "int16_t", "Int16Adaptor");
+			try_type(uint16_t(), "uint16_t", "UInt16Adaptor");
+			try_type(int8_t(), "int8_t", "Int8Adaptor");
+			try_type(uint8_t(), "uint8_t", "UInt8Adaptor");
+			useBackendAdaptor();
+		}
+
+		/**
+		 * Handle a string schema.  Strings with a format that can be parsed
+		 * are returned as the parsed value, which refers to the string only
+		 * if materialized structs store a different type.
+		 */
+		void operator()(String s)
+		{
+			return_type       = "std::string_view";
+			adaptor           = "StringViewAdaptor";
+			lifetimeAttribute = "CONFIG_LIFETIME_BOUND";
+			if (auto *f = string_format(s))
+			{
+				format = f->parser;
+			}
+			if (auto *f = typed_format(s))
+			{
+				formatType = configNamespace;
+				formatType += f->value;
+				className = "FormatAdaptor<";
+				className += configNamespace;
+				className += f->parser;
+				className += ">";
+				return_type = formatType;
+				adaptor     = className;
+				if (f->storage.empty())
+				{
+					lifetimeAttribute = {};
+				}
+				return;
+			}
+			useBackendAdaptor();
+		}
+
+		/**
+		 * Handle a boolean schema.
+		 */
+		void operator()(Boolean)
+		{
+			return_type = "bool";
+			adaptor     = "BoolAdaptor";
+			useBackendAdaptor();
+		}
+
+		/**
+		 * Handle an integer schema.
+		 */
+		void operator()(Integer i)
+		{
+			handleNumber(i, true);
+		}
+
+		/**
+		 * Handle an integer schema.
+		 */
+		void operator()(Number n)
+		{
+			handleNumber(n, false);
+		}
+
+		/**
+		 * Handle an object schema.  This does a recursive visit to generate a
+		 * new class that represents the object.
+		 */
+		void operator()(Object o)
+		{
+			className = name;
+			className += "Class";
+			std::string prefix{path};
+			prefix += '.';
+			emit_class(o, className, types, prefix);
+			return_type      = className;
+			adaptor          = className;
+			adaptorNamespace = "";
+		}
+
+		/**
+		 * Handle an array.  This performs a recursive visit to generate a new
+		 * class representing the array element type.  Fixed-length arrays
+		 * and tuples of scalars are instead copied out into a `std::array`
+		 * or `std::tuple`.
+		 *
+		 * Note that this currently handles only arrays of a single object
+		 * type, not heterogeneous arrays, apart from tuples.
+		 */
+		void operator()(Array a)
+		{
+			bool isTuple;
+			if (auto elements = fixed_elements(a, isTuple))
+			{
+				std::vector<std::string> elementTypes;
+				for (auto element : *elements)
+				{
+					SchemaVisitor v(name, types);
+					element.get().visit(v);
+					elementTypes.emplace_back(v.return_type);
+					if (!v.lifetimeAttribute.empty())
+					{
+						lifetimeAttribute = v.lifetimeAttribute;
+					}
+				}
+				fixedType = fixed_type(isTuple, elementTypes);
+				className = configNamespace;
+				className += "FixedArrayAdaptor<";
+				className += fixedType;
+				className += genericBackend ? ", B>" : ">";
+				return_type      = fixedType;
+				adaptor          = className;
+				adaptorNamespace = "";
+				return;
+			}
+			std::string itemName{name};
+			itemName += "Item";
+			std::string itemPath{path};
+			itemPath += "[]";
+			SchemaVisitor item(itemName, types, itemPath);
+			auto          items = a.items();
+			items.get().visit(item);
+			if (genericBackend)
+			{
+				className = "typename B::template Range<";
+			}
+			else
+			{
+				className = configNamespace;
+				className += "Range<";
+			}
+			className += item.return_type;
+			className += ", ";
+			className += item.adaptorNamespace;
+			className += item.adaptor;
+			className += genericBackend ? ">" : ", true>";
+			return_type      = className;
+			adaptor          = className;
+			adaptorNamespace = "";
+		}
+	};
+
+	/**
+	 * Returns the name of the accessor method for the property `prop_name`.
+	 * If the property name is not a valid C++ identifier, the accessor name is
+	 * written into `buffer`.
+	 */
+	std::string_view accessor_name(std::string_view prop_name,
+	                               std::string     &buffer)
+	{
+		// FIXME: Do a proper regex match
+		if (prop_name.find('-') == std::string::npos)
+		{
+			return prop_name;
+		}
+		buffer = prop_name;
+		std::replace(buffer.begin(), buffer.end(), '-', '_');
+		return buffer;
+	}
+
+	/**
+	 * Emit a class.  The class is defined by the object schema `o` and should
+	 * have the name given by the `name` argument.  It will be written to the
+	 * `out` stream.  The `prefix` is prepended to property names to give the
+	 * full path used in access counters.
+	 */
+	template<typename T>
+	void emit_class(Object           o,
+	                std::string_view name,
+	                T               &out,
+	                std::string_view prefix)
+	{
+		// Place to write new types.
+		std::stringstream                    types;
+		// Place to write methods.
+		std::stringstream                    methods;
+		// Place to write the body of `write_json`.
+		std::stringstream                    json;
+		// Places to write the property names, the property hashes and the
+		// comparisons for structural hashing.
+		std::stringstream                    names;
+		std::stringstream                    hashes;
+		std::stringstream                    equal;
+		// Places to write the property table, the property IDs, the types of
+		// their values and the code that reads them, for reflection.
+		std::stringstream                    fieldTable;
+		std::stringstream                    fieldIds;
+		std::stringstream                    fieldTypes;
+		std::stringstream                    fieldGets;
+		std::stringstream                    fieldVisits;
+		std::stringstream                    fieldCases;
+		uint32_t                             fieldId = 0;
+		// Place to write the code that starts loading external sections.
+		std::stringstream                    prefetch;
+		// Set of the required properties.
+		std::unordered_set<std::string_view> required_properties;
+
+		// Collect the required properties in a set.
+		if (auto required = o.required())
+		{
+			for (auto prop : *required)
+			{
+				required_properties.insert(prop);
+			}
+		}
+
+		// Count the properties, which is needed for the hash cache.
+		size_t propertyCount = 0;
+		for (auto prop : o.properties())
+		{
+			(void)prop;
+			propertyCount++;
+		}
+		std::string hashArray = "std::array<uint64_t, " +
+		                        std::to_string(propertyCount) + ">";
+
+		// Generate the class definition.  With a generic backend, the root
+		// class is a template over the backend and nested classes are
+		// members of it.
+		if (genericBackend && prefix.empty())
+		{
+			out << "template<" << configNamespace << "Backend B = "
+			    << configNamespace << "UCLBackend>\n";
+		}
+		out << "class " << name << "{";
+		if (genericBackend)
+		{
+			out << "typename B::Ptr obj;";
+		}
+		else
+		{
+			out << configNamespace << "UCLPtr obj;";
+		}
+		// Root classes with memory accounting hold a registration token for
+		// the live config registry.
+		bool registerLive = memoryAccounting && prefix.empty();
+		if (registerLive)
+		{
+			out << "std::shared_ptr<const ucl_object_t> live;";
+		}
+		// Root classes of zero-copy configs keep the memory that their
+		// strings point into alive.
+		bool holdStorage = zeroCopy && prefix.empty();
+		if (holdStorage)
+		{
+			out << "std::shared_ptr<const void> storage;";
+		}
+		// Root classes with external sections share their loaders between
+		// copies.
+		bool hasSections = prefix.empty() && has_external_sections(o);
+		if (hasSections)
+		{
+			out << "struct ExternalSections;"
+			    << "std::shared_ptr<ExternalSections> sections;";
+		}
+		// Root classes with structural hashing cache their property hashes.
+		bool cacheHashes = structuralHash && prefix.empty();
+		if (cacheHashes)
+		{
+			out << "std::shared_ptr<const " << configNamespace
+			    << "CachedHashes<" << propertyCount << ">> hashes;";
+		}
+		out << " public:\n";
+
+		// Generate the constructor.  Root classes with memory accounting
+		// register every config that they are constructed from.  Only UCL
+		// configs can be registered.
+		if (genericBackend)
+		{
+			out << name << "(typename B::Node o) : obj(o) {";
+			if (registerLive)
+			{
+				out << "if constexpr (std::is_same_v<B, " << configNamespace
+				    << "UCLBackend>) { live = " << configNamespace
+				    << "LiveConfigs::global().add(o); }";
+			}
+		}
+		else
+		{
+			out << name << "(const ucl_object_t *o) : obj(o)";
+			if (registerLive)
+			{
+				out << ", live(" << configNamespace
+				    << "LiveConfigs::global().add(o))";
+			}
+			out << " {";
+		}
+		if (cacheHashes)
+		{
+			out << "hashes = std::make_shared<const " << configNamespace
+			    << "CachedHashes<" << propertyCount
+			    << ">>(compute_property_hashes());";
+		}
+		if (hasSections)
+		{
+			out << "sections = std::make_shared<ExternalSections>();";
+		}
+		out << "}\n";
+		if (holdStorage)
+		{
+			out << name << "("
+			    << (genericBackend ? "typename B::Node" : "const ucl_object_t *")
+			    << " o, std::shared_ptr<const void> s) : " << name
+			    << "(o) { storage = std::move(s); }\n";
+		}
+		if (memoryAccounting)
+		{
+			out << configNamespace << "MemoryReport memory_usage() const {"
+			    << "return " << configNamespace << "memory_usage(obj);}\n";
+		}
+
+		// Generate a method for each property.
+		for (auto prop : o.properties())
+		{
+			std::string_view prop_name = prop.key();
+			std::string      method_name_buffer;
+			std::string_view method_name =
+			  accessor_name(prop_name, method_name_buffer);
+
+			bool isRequired = required_properties.contains(prop_name);
+
+			// If there is a description, put it in a doc comment
+			if (auto description = prop.description())
+			{
+				methods << "\n/** " << *description << " */\n";
+			}
+
+			// Allocate an access counter for this property, if requested.
+			std::string path{prefix};
+			path += prop_name;
+			std::string count;
+			if (!accessCountersClass.empty())
+			{
+				count = accessCountersClass;
+				count += "::counters.increment(";
+				count += std::to_string(accessCounterPaths.size());
+				count += ");";
+				accessCounterPaths.push_back(path);
+			}
+
+			// Visit the schema describing this property to collect any types.
+			SchemaVisitor v(method_name, types, path);
+			prop.get().visit(v);
+			// External sections are read from the file that the config
+			// names, the first time that they are needed.
+			if (prop.external())
+			{
+				if (!hasSections || (prop.type() != SchemaBase::TypeObject))
+				{
+					fprintf(stderr,
+					        "Only object properties of the root object can "
+					        "be external: %s\n",
+					        path.c_str());
+					exit(EXIT_FAILURE);
+				}
+				std::string result = "std::variant<" +
+				                     std::string(v.return_type) + ", " +
+				                     configNamespace + "LoadError>";
+				std::string read = "if (const ucl_object_t *path = obj[\"" +
+				                   std::string(prop_name) + "\"]) {";
+				if (isRequired)
+				{
+					methods << result << ' ' << method_name << "() const {"
+					        << count << "return sections->" << method_name
+					        << ".get(obj[\"" << prop_name << "\"]);}\n\n";
+				}
+				else
+				{
+					methods << "std::optional<" << result << "> "
+					        << method_name << "() const {" << count << read
+					        << "return sections->" << method_name
+					        << ".get(path);} return std::nullopt;}\n\n";
+				}
+				prefetch << read << "executor.execute([self = *this, path]() "
+				         << "{ self.sections->" << method_name
+				         << ".get(path); });}";
+				continue;
+			}
+			// Returns the expression for the value of this property in the
+			// object `source`.  If it is not a required property, this is a
+			// `std::optional<T>`.
+			auto value = [&](std::string_view source) {
+				std::stringstream expr;
+				if (isRequired)
+				{
+					expr << v.adaptorNamespace << v.adaptor << "(" << source
+					     << "[\"" << prop_name << "\"])";
+				}
+				else
+				{
+					expr << configNamespace << "make_optional<"
+					     << v.adaptorNamespace << v.adaptor << ", "
+					     << v.return_type << (genericBackend ? ", B" : "")
+					     << ">(" << source << "[\"" << prop_name << "\"])";
+				}
+				return expr.str();
+			};
+			// Generate the method.
+			if (isRequired)
+			{
+				methods << v.return_type;
+			}
+			else
+			{
+				methods << "std::optional<" << v.return_type << ">";
+			}
+			methods << ' ' << method_name << "() const "
+			        << v.lifetimeAttribute << " {" << count << "return "
+			        << value("obj") << ";}";
+			if (structuralHash)
+			{
+				names << '"' << prop_name << "\", ";
+				// Required properties are read through an adaptor, which must
+				// be converted to the value type.
+				auto typed = [&](std::string_view source) {
+					if (!isRequired)
+					{
+						return value(source);
+					}
+					return "static_cast<" + std::string(v.return_type) +
+					       ">(" + value(source) + ")";
+				};
+				hashes << configNamespace << "hash_of(" << typed("obj")
+				       << "),\n";
+				equal << "&& " << configNamespace << "values_equal("
+				      << typed("obj") << ", " << typed("other.obj") << ")\n";
+			}
+			methods << "\n\n";
+			if (reflection)
+			{
+				std::string id = std::to_string(fieldId);
+				fieldTable << "{\"" << prop_name << "\", " << id << ", \""
+				           << v.return_type << "\", "
+				           << (isRequired ? "true" : "false") << ", \""
+				           << v.adaptorNamespace << v.adaptor << "\"},\n";
+				fieldIds << "static constexpr uint32_t " << method_name
+				         << " = " << id << ";";
+				fieldTypes << ", "
+				           << (isRequired ? std::string(v.return_type)
+				                          : "std::optional<" +
+				                              std::string(v.return_type) +
+				                              ">");
+				fieldGets << (fieldId == 0 ? "" : " else ")
+				          << "if constexpr (Id == " << id << ") { return "
+				          << method_name << "(); }";
+				fieldVisits << "visitor(fields[" << id << "], " << method_name
+				            << "());";
+				// The first alternative of `field_value` is for unknown IDs.
+				fieldCases << "case " << id
+				           << ": return field_value(std::in_place_index<"
+				           << fieldId + 1 << ">, " << method_name << "());";
+				fieldId++;
+			}
+			if (writeJson)
+			{
+				json << json_property_writer(
+				  method_name, prop_name, !isRequired);
+			}
+		}
+
+		out << types.str();
+		if (hasSections)
+		{
+			out << "private:\n";
+			emit_external_sections(o, out);
+			out << "public:\n"
+			    << "/** Starts loading each section that is kept in a "
+			       "separate file on `executor`, so that reading it later "
+			       "does not wait for the file. */\n"
+			    << "template<" << configNamespace
+			    << "Executor E> void prefetch_sections(E &executor) const {"
+			    << prefetch.str() << "}\n"
+			    << "/** Starts loading each section that is kept in a "
+			       "separate file on the shared thread pool. */\n"
+			    << "void prefetch_sections() const {"
+			    << "prefetch_sections(" << configNamespace
+			    << "ThreadPool::global());}\n";
+		}
+		out << methods.str();
+		if (writeJson)
+		{
+			out << json_writer(json.str());
+		}
+		if (reflection)
+		{
+			out << "/** The properties of this object, in schema order. The "
+			       "index of each is its ID. */\n"
+			    << "static constexpr std::array<" << configNamespace
+			    << "FieldInfo, " << propertyCount << "> fields = {{"
+			    << fieldTable.str() << "}};\n";
+			out << "/** The ID of each property. */\n"
+			    << "struct field_ids {" << fieldIds.str() << "};\n";
+			out << "/** Returns the ID of the property called `name`, if "
+			       "there is one. */\n"
+			    << "static constexpr std::optional<uint32_t> "
+			       "field_id(std::string_view name) { return "
+			    << configNamespace << "find_field(fields, name); }\n";
+			out << "/** The value of a property, at the index after its "
+			       "ID. */\n"
+			    << "using field_value = std::variant<std::monostate"
+			    << fieldTypes.str() << ">;\n";
+			out << "/** Returns the value of the property with ID `Id`. */\n"
+			    << "template<uint32_t Id> auto get_field() const {"
+			    << "static_assert(Id < " << propertyCount
+			    << ", \"No such property\");" << fieldGets.str() << "}\n";
+			out << "/** Calls `visitor` with the description and value of "
+			       "each property, in schema order. */\n"
+			    << "template<typename V> void for_each_field(V &&visitor) "
+			       "const {"
+			    << fieldVisits.str() << "}\n";
+			out << "/** Returns the value of the property with ID `id`, or "
+			       "`std::monostate` if there is no such property. */\n"
+			    << "field_value get_by_id(uint32_t id) const {"
+			    << "switch (id) {" << fieldCases.str()
+			    << "default: return {};}}\n";
+		}
+		if (structuralHash)
+		{
+			// Property hashes and comparisons read through the adaptors, not
+			// the accessors, so that they are not counted as reads.
+			out << "static constexpr std::array<std::string_view, "
+			    << propertyCount << "> property_names = {" << names.str()
+			    << "};\n";
+			out << "/** Returns the hash of each property, in schema order. "
+			       "*/\n";
+			out << hashArray
+			    << (cacheHashes ? " compute_property_hashes() const {"
+			                    : " property_hashes() const {")
+			    << "return {" << hashes.str() << "};}\n";
+			if (cacheHashes)
+			{
+				out << hashArray << " property_hashes() const {"
+				    << "return hashes->properties;}\n";
+				out << "/** Returns the hash of this config, cached when it "
+				       "was constructed. */\n"
+				    << "uint64_t hash() const { return hashes->hash; }\n";
+			}
+			else
+			{
+				out << "/** Returns the hash of this object, computed from its "
+				       "whole subtree on every call. */\n"
+				    << "uint64_t hash() const { return " << configNamespace
+				    << "hash_properties(property_hashes()); }\n";
+			}
+			out << "/** Returns true if this and `other` have the same "
+			       "value for every property. */\n"
+			    << "bool operator==(const " << name << " &other) const {";
+			if (cacheHashes)
+			{
+				out << "if (hashes->hash != other.hashes->hash) { return "
+				       "false; }";
+			}
+			// Shared UCL trees, for example from interning, are equal
+			// without comparing their properties.
+			std::string identical =
+			  "if (static_cast<const ucl_object_t *>(obj) == "
+			  "static_cast<const ucl_object_t *>(other.obj)) { return true; }";
+			if (genericBackend)
+			{
+				out << "if constexpr (std::is_same_v<B, " << configNamespace
+				    << "UCLBackend>) {" << identical << "}";
+			}
+			else
+			{
+				out << identical;
+			}
+			out << "return true " << equal.str() << ";}\n";
+			out << "/** Returns the names of the properties whose hashes "
+			       "differ from those in `other`. */\n"
+			    << "std::vector<std::string_view> changed_properties(const "
+			    << name << " &other) const {"
+			    << "return " << configNamespace << "changed_properties<"
+			    << propertyCount
+			    << ">(property_names, property_hashes(), "
+			       "other.property_hashes());}\n";
+		}
+
+		out << "};\n";
+	}
+
+	/**
+	 * Emit the columns for the scalar properties of the object schema `o`.
+	 * Column declarations are written to `members`, with a nested struct for
+	 * each object-typed property.  Statements that append one config to the
+	 * columns are written to `append`, reading the values from the
+	 * expression `source`, which refers to an instance of the class generated
+	 * for `o`.  `prefix` is the path from the columnar class to the columns
+	 * for `o`.  Every column under an optional property is itself optional,
+	 * as indicated by `optional`.  Arrays are not stored in columns.
+	 *
+	 * Returns the path of every column that was emitted.
+	 */
+	std::vector<std::string> emit_column_members(Object             o,
+	                                             std::string_view   prefix,
+	                                             std::string_view   source,
+	                                             bool               optional,
+	                                             std::stringstream &members,
+	                                             std::stringstream &append,
+	                                             int               &temporaries)
+	{
+		std::vector<std::string>             columns;
+		std::unordered_set<std::string_view> required_properties;
+		if (auto required = o.required())
+		{
+			for (auto prop : *required)
+			{
+				required_properties.insert(prop);
+			}
+		}
+		for (auto prop : o.properties())
+		{
+			std::string_view prop_name = prop.key();
+			std::string      method_name_buffer;
+			std::string_view method_name =
+			  accessor_name(prop_name, method_name_buffer);
+			bool isOptional =
+			  optional || !required_properties.contains(prop_name);
+			std::string path{prefix};
+			path += method_name;
+			// Qualify columns so that they cannot be shadowed by parameters.
+			std::string column{"this->"};
+			column += path;
+			std::string value{source};
+			value += '.';
+			value += method_name;
+			value += "()";
+			prop.get().visit(
+			  [&](Object child) {
+				  std::string temporary = "o";
+				  temporary += std::to_string(temporaries++);
+				  std::string childSource = temporary;
+				  members << "struct " << method_name << "Columns {\n";
+				  if (required_properties.contains(prop_name))
+				  {
+					  append << "{auto " << temporary << " = " << value
+					         << ";\n";
+				  }
+				  else
+				  {
+					  append << "if (auto " << temporary << " = " << value
+					         << ") {\n";
+					  childSource = "(*" + temporary + ")";
+				  }
+				  auto childColumns = emit_column_members(child,
+				                                          path + '.',
+				                                          childSource,
+				                                          isOptional,
+				                                          members,
+				                                          append,
+				                                          temporaries);
+				  append << "}\n";
+				  if (!required_properties.contains(prop_name))
+				  {
+					  append << "else {\n";
+					  for (auto &column : childColumns)
+					  {
+						  append << column << ".push_missing();\n";
+					  }
+					  append << "}\n";
+				  }
+				  members << "} " << method_name << ";\n";
+				  columns.insert(
+				    columns.end(), childColumns.begin(), childColumns.end());
+			  },
+			  [&](Array) {},
+			  [&](auto scalar) {
+				  std::stringstream unused;
+				  SchemaVisitor     v(method_name, unused);
+				  v(scalar);
+				  // Parsed values that refer to their string, such as URIs,
+				  // are stored as the string, because columns do not refer
+				  // to the configs that they were built from.
+				  if (!v.format.empty() && !v.lifetimeAttribute.empty() &&
+				      (v.return_type != "std::string_view"))
+				  {
+					  value = !required_properties.contains(prop_name)
+					            ? "[](auto v) -> std::optional<std::string_view> "
+					              "{ if (v) { return v->text(); } return "
+					              "std::nullopt; }(" +
+					                value + ")"
+					            : value + ".text()";
+					  members << configNamespace << "StringColumn";
+				  }
+				  else if (v.return_type == "std::string_view")
+				  {
+					  members << configNamespace << "StringColumn";
+				  }
+				  else
+				  {
+					  members << configNamespace << "Column<" << v.return_type
+					          << ">";
+				  }
+				  members << ' ' << method_name << "{"
+				          << (isOptional ? "true" : "false") << "};\n";
+				  append << column << ".push_back(" << value << ");\n";
+				  columns.push_back(std::move(column));
+			  });
+		}
+		return columns;
+	}
+
+	/**
+	 * Emit a columnar store for configs described by the object schema `o`.
+	 * The class is named `name` and holds one contiguous column for each
+	 * scalar property path, built by appending instances of `configClass`.
+	 */
+	template<typename T>
+	void emit_columns(Object           o,
+	                  std::string_view name,
+	                  std::string_view configClass,
+	                  T               &out)
+	{
+		std::stringstream members;
+		std::stringstream append;
+		int               temporaries = 0;
+		auto              columns =
+		  emit_column_members(o, "", "c", false, members, append, temporaries);
+
+		out << "class " << name << "{\nsize_t rows = 0;\npublic:\n";
+		out << members.str();
+		out << name << "() = default;\n";
+		out << "explicit " << name << "(std::span<const " << configClass
+		    << "> configs) {"
+		    << "reserve(configs.size());\n"
+		    << "for (auto &c : configs) { append(c); }\n"
+		    << "}\n";
+		out << "void reserve(size_t n) {";
+		for (auto &column : columns)
+		{
+			out << column << ".reserve(n);\n";
+		}
+		out << "}\n";
+		out << "void append(const " << configClass << " &c) {"
+		    << append.str() << "rows++;\n}\n";
+		out << "size_t size() const { return rows; }\n";
+		out << "};\n";
+	}
+
+	/**
+	 * How a property is stored in a materialised struct.
+	 */
+	struct MaterializedType
+	{
+		/**
+		 * The type of the member that stores the property.
+		 */
+		std::string storage;
+
+		/**
+		 * The type returned by the accessor for a required property.
+		 */
+		std::string accessor;
+
+		/**
+		 * Returns an expression that converts the C++ expression passed as
+		 * the argument, the value returned by the config class's accessor,
+		 * to the storage type.
+		 */
+		std::function<std::string(const std::string &)> convert;
+
+		/**
+		 * The number of bits needed to store the value, if it is small
+		 * enough to pack into a bitfield, or zero otherwise.
+		 */
+		unsigned bits = 0;
+
+		/**
+		 * True for members that are large or own heap memory.  Cold large
+		 * members are moved out of line.
+		 */
+		bool large = false;
+	};
+
+	template<typename T>
+	void emit_materialized(Object           o,
+	                       std::string_view name,
+	                       std::string_view source,
+	                       std::string_view prefix,
+	                       T               &out);
+
+	/**
+	 * Returns the storage for the property `name` at `path`, described by
+	 * `schema`.  `source` is the config class that contains the property's
+	 * accessor.  Structs for object-typed properties are written to `types`.
+	 */
+	MaterializedType materialized_type(SchemaBase         schema,
+	                                   std::string_view   name,
+	                                   std::string_view   path,
+	                                   std::string_view   source,
+	                                   std::stringstream &types)
+	{
+		MaterializedType result;
+		schema.get().visit(
+		  [&](Object o) {
+			  std::string structName{name};
+			  structName += "Data";
+			  std::string sourceClass{source};
+			  sourceClass += "::";
+			  sourceClass += name;
+			  sourceClass += "Class";
+			  std::string prefix{path};
+			  prefix += '.';
+			  emit_materialized(o, structName, sourceClass, prefix, types);
+			  result.storage  = structName;
+			  result.accessor = "const " + structName + " &";
+			  result.convert  = [structName](const std::string &value) {
+				  return structName + "(" + value + ")";
+			  };
+			  result.large = true;
+		  },
+		  [&](Array a) {
+			  bool isTuple;
+			  if (auto elements = fixed_elements(a, isTuple))
+			  {
+				  // Fixed-length arrays are stored inline.  Only arrays of
+				  // strings need converting, to own their elements.
+				  std::vector<MaterializedType> items;
+				  std::vector<std::string>      storage;
+				  bool                          owning = false;
+				  for (auto element : *elements)
+				  {
+					  items.push_back(
+					    materialized_type(element, name, path, source, types));
+					  storage.push_back(items.back().storage);
+					  owning |= (items.back().storage != items.back().accessor);
+				  }
+				  result.storage  = fixed_type(isTuple, storage);
+				  result.accessor = "const " + result.storage + " &";
+				  result.convert  = [items, owning, storage = result.storage](
+				                     const std::string &value) {
+					  if (!owning)
+					  {
+						  return value;
+					  }
+					  std::string init;
+					  for (size_t i = 0; i < items.size(); i++)
+					  {
+						  init += (i == 0) ? "" : ", ";
+						  init += items[i].convert("std::get<" +
+						                           std::to_string(i) +
+						                           ">(items)");
+					  }
+					  return "[](const auto &items) { return " + storage + "{" +
+					         init + "};}(" + value + ")";
+				  };
+				  result.large = owning;
+				  return;
+			  }
+			  std::string itemName{name};
+			  itemName += "Item";
+			  std::string itemPath{path};
+			  itemPath += "[]";
+			  auto item =
+			    materialized_type(a.items(), itemName, itemPath, source, types);
+			  result.storage  = "std::vector<" + item.storage + ">";
+			  result.accessor = "const " + result.storage + " &";
+			  result.convert  = [item, storage = result.storage](
+			                     const std::string &value) {
+				  return "[](auto range) {" + storage +
+				         " items;\n"
+				         "for (auto item : range) { items.push_back(" +
+				         item.convert("item") + "); }\nreturn items;}(" +
+				         value + ")";
+			  };
+			  result.large = true;
+		  },
+		  [&](String s) {
+			  if (auto *f = typed_format(s))
+			  {
+				  // Parsed values are stored as they are, unless they refer
+				  // to the string.
+				  std::string value = configNamespace + std::string(f->value);
+				  result.accessor   = value;
+				  if (f->storage.empty())
+				  {
+					  result.storage = value;
+					  result.convert = [](const std::string &v) { return v; };
+					  return;
+				  }
+				  result.storage = configNamespace + std::string(f->storage);
+				  result.convert = [storage = result.storage](
+				                     const std::string &v) {
+					  return storage + "(" + v + ")";
+				  };
+				  result.large = true;
+				  return;
+			  }
+			  result.storage  = "std::string";
+			  result.accessor = "std::string_view";
+			  result.convert  = [](const std::string &value) {
+				  return "std::string(" + value + ")";
+			  };
+			  result.large = true;
+		  },
+		  [&](auto scalar) {
+			  std::stringstream unused;
+			  SchemaVisitor     v(name, unused);
+			  v(scalar);
+			  result.storage  = v.return_type;
+			  result.accessor = v.return_type;
+			  result.convert  = [](const std::string &value) { return value; };
+			  if (v.return_type == "bool")
+			  {
+				  result.bits = 1;
+			  }
+			  else if ((v.minimum >= 0) &&
+			           (v.maximum <= std::numeric_limits<uint16_t>::max()))
+			  {
+				  result.bits =
+				    std::max<unsigned>(1, std::bit_width(uint64_t(v.maximum)));
+			  }
+		  });
+		return result;
+	}
+
+	/**
+	 * Emit a materialised struct, which copies every property of the object
+	 * schema `o` out of the UCL tree into plain members and exposes them
+	 * through the same accessors as the config class.  The struct is named
+	 * `name` and is constructed from an instance of the config class
+	 * `source`.  `prefix` is the path of the object, used to look up access
+	 * counts in the layout profile.
+	 *
+	 * Without a layout profile, members are declared in schema order.  With
+	 * one, members are ordered from most to least frequently read, so that
+	 * hot members share the first cache lines.  Booleans and small unsigned
+	 * integers are packed into bitfields at the position of the hottest of
+	 * them, and strings, arrays and objects that are read less than 1% as
+	 * often as the hottest property in the profile are moved out of line.
+	 * Ties keep schema order, so the layout is deterministic.
+	 */
+	template<typename T>
+	void emit_materialized(Object           o,
+	                       std::string_view name,
+	                       std::string_view source,
+	                       std::string_view prefix,
+	                       T               &out)
+	{
+		/**
+		 * A member of the struct.
+		 */
+		struct Field
+		{
+			/**
+			 * The name of the accessor.
+			 */
+			std::string method;
+
+			/**
+			 * The name of the property.
+			 */
+			std::string_view key;
+
+			/**
+			 * How the property is stored.
+			 */
+			MaterializedType type;
+
+			/**
+			 * True if the property is optional.
+			 */
+			bool optional;
+
+			/**
+			 * The number of reads recorded by the profile.
+			 */
+			uint64_t count;
+
+			/**
+			 * True if the member is packed into a bitfield.
+			 */
+			bool packed = false;
+
+			/**
+			 * True if the member is stored out of line.
+			 */
+			bool cold = false;
+		};
+		std::stringstream                    types;
+		std::vector<Field>                   fields;
+		std::unordered_set<std::string_view> required_properties;
+		if (auto required = o.required())
+		{
+			for (auto prop : *required)
+			{
+				required_properties.insert(prop);
+			}
+		}
+		bool profiled = !layoutProfile.empty();
+		for (auto prop : o.properties())
+		{
+			std::string_view prop_name = prop.key();
+			std::string      method_name_buffer;
+			std::string_view method_name =
+			  accessor_name(prop_name, method_name_buffer);
+			std::string path{prefix};
+			path += prop_name;
+			Field f{std::string(method_name),
+			        prop_name,
+			        materialized_type(prop, method_name, path, source, types),
+			        !required_properties.contains(prop_name),
+			        0};
+			if (auto count = layoutProfile.find(path);
+			    count != layoutProfile.end())
+			{
+				f.count = count->second;
+			}
+			if (profiled)
+			{
+				f.packed = f.type.bits != 0;
+				f.cold   = f.type.large && (f.count * 100 < layoutHottest);
+			}
+			fields.push_back(std::move(f));
+		}
+		// Accessors and the constructor are emitted in schema order, members
+		// in layout order.
+		std::vector<Field *> layout;
+		for (auto &f : fields)
+		{
+			layout.push_back(&f);
+		}
+		if (profiled)
+		{
+			std::stable_sort(
+			  layout.begin(), layout.end(), [](Field *a, Field *b) {
+				  return a->count > b->count;
+			  });
+		}
+		bool hasCold = std::any_of(
+		  fields.begin(), fields.end(), [](auto &f) { return f.cold; });
+
+		auto member = [](const Field &f) {
+			std::string storage = f.type.storage;
+			if (f.optional && !f.packed)
+			{
+				storage = "std::optional<" + storage + ">";
+			}
+			return storage + " " + f.method + "_{};\n";
+		};
+
+		out << "struct " << name << "{\n";
+		out << types.str();
+		out << "private:\n";
+		if (hasCold)
+		{
+			out << "struct Cold {\n";
+			for (auto *f : layout)
+			{
+				if (f->cold)
+				{
+					out << member(*f);
+				}
+			}
+			out << "};\n";
+		}
+		bool emittedPacked = false;
+		for (auto *f : layout)
+		{
+			if (f->cold)
+			{
+				continue;
+			}
+			if (!f->packed)
+			{
+				out << member(*f);
+				continue;
+			}
+			if (emittedPacked)
+			{
+				continue;
+			}
+			// All packed members go together, so that they share words.
+			for (auto *p : layout)
+			{
+				if (!p->packed)
+				{
+					continue;
+				}
+				out << "uint32_t " << p->method << "_ : " << p->type.bits
+				    << " = 0;\n";
+				if (p->optional)
+				{
+					out << "uint32_t has_" << p->method << "_ : 1 = 0;\n";
+				}
+			}
+			emittedPacked = true;
+		}
+		if (hasCold)
+		{
+			out << "std::shared_ptr<const Cold> coldMembers;\n";
+		}
+		out << "public:\n";
+
+		// Default constructor, leaves every property zero or absent.
+		out << name << "() = default;\n";
+		// Constructor, copies every property out of the config.
+		out << "explicit " << name << "(const " << source << " &c) {";
+		if (hasCold)
+		{
+			out << "auto cold = std::make_shared<Cold>();\n";
+		}
+		for (auto &f : fields)
+		{
+			std::string target = f.cold ? "cold->" : "this->";
+			target += f.method;
+			target += '_';
+			std::string value = "c." + f.method + "()";
+			if (!f.optional)
+			{
+				out << target << " = " << f.type.convert(value) << ";\n";
+			}
+			else if (f.packed)
+			{
+				out << "if (auto v = " << value << ") { " << target
+				    << " = *v; this->has_" << f.method << "_ = 1; } else { "
+				    << target << " = 0; this->has_" << f.method
+				    << "_ = 0; }\n";
+			}
+			else
+			{
+				out << "if (auto v = " << value << ") { " << target << " = "
+				    << f.type.convert("*v") << "; }\n";
+			}
+		}
+		if (hasCold)
+		{
+			out << "coldMembers = std::move(cold);\n";
+		}
+		out << "}\n";
+
+		// Accessors, matching those of the config class.
+		for (auto &f : fields)
+		{
+			std::string ref = f.cold ? "coldMembers->" : "";
+			ref += f.method;
+			ref += '_';
+			if (!f.optional)
+			{
+				if (f.packed)
+				{
+					ref = "static_cast<" + f.type.accessor + ">(" + ref + ")";
+				}
+				out << f.type.accessor << ' ' << f.method << "() const {"
+				    << "return " << ref << ";}\n";
+			}
+			else if (f.packed)
+			{
+				out << "std::optional<" << f.type.accessor << "> " << f.method
+				    << "() const {"
+				    << "if (!has_" << f.method << "_) { return std::nullopt; }"
+				    << "return static_cast<" << f.type.accessor << ">(" << ref
+				    << ");}\n";
+			}
+			else if (f.type.storage == "std::string")
+			{
+				out << "std::optional<std::string_view> " << f.method
+				    << "() const {"
+				    << "if (!" << ref << ") { return std::nullopt; }"
+				    << "return *" << ref << ";}\n";
+			}
+			else if (f.type.large)
+			{
+				// Objects and arrays are returned by pointer, which is null
+				// if the property is absent.
+				out << "const " << f.type.storage << " *" << f.method
+				    << "() const {"
+				    << "return " << ref << " ? &*" << ref << " : nullptr;}\n";
+			}
+			else
+			{
+				out << "std::optional<" << f.type.accessor << "> " << f.method
+				    << "() const {"
+				    << "return " << ref << ";}\n";
+			}
+		}
+		if (writeJson)
+		{
+			std::string writers;
+			for (auto &f : fields)
+			{
+				writers += json_property_writer(f.method, f.key, f.optional);
+			}
+			out << json_writer(writers);
+		}
+		out << "};\n";
+	}
+
+	/**
+	 * Emit a builder for objects described by the object schema `o`.  The
+	 * builder is named `name` and has a setter for each property, with
+	 * nested builders for object-typed properties and for the elements of
+	 * arrays of objects.  If `configClass` is not empty, this is the root
+	 * builder and has a `build` method that returns an instance of it.
+	 *
+	 * Setters check types and the bounds of integers, and `build` checks
+	 * that required properties are present.  Other constraints (string
+	 * patterns and lengths, array lengths, non-integer bounds) are not
+	 * checked.
+	 */
+	template<typename T>
+	void emit_builder(Object           o,
+	                  std::string_view name,
+	                  std::string_view configClass,
+	                  T               &out)
+	{
+		std::stringstream                    types;
+		std::stringstream                    setters;
+		std::unordered_set<std::string_view> required_properties;
+		if (auto required = o.required())
+		{
+			for (auto prop : *required)
+			{
+				required_properties.insert(prop);
+			}
+		}
+		for (auto prop : o.properties())
+		{
+			std::string_view prop_name = prop.key();
+			std::string      method_name_buffer;
+			std::string_view method_name =
+			  accessor_name(prop_name, method_name_buffer);
+			std::string key = "\"";
+			key += prop_name;
+			key += '"';
+			// Emits a setter with the parameter `param` and the body `body`.
+			auto setter = [&](std::string_view method,
+			                  std::string_view param,
+			                  std::string_view body) {
+				setters << name << " &" << method << '(' << param << ") {"
+				        << body << "return *this;}\n";
+			};
+			// Returns statements that check `value` against the bounds of
+			// the integer schema `v`, or the format of the string schema
+			// `v`, if it has any.
+			auto check = [&](SchemaVisitor &v, std::string_view value) {
+				if (!v.format.empty())
+				{
+					return "check_format<" + std::string(configNamespace) +
+					       std::string(v.format) + ">(" + std::string(value) +
+					       ", " + key + ");";
+				}
+				if ((v.minimum == std::numeric_limits<int64_t>::min()) &&
+				    (v.maximum == std::numeric_limits<int64_t>::max()))
+				{
+					return std::string();
+				}
+				return "check_range(" + std::string(value) + ", " +
+				       std::to_string(v.minimum) + "LL, " +
+				       std::to_string(v.maximum) + "LL, " + key + ");";
+			};
+			// Returns the parameter type for the scalar schema `v`.
+			// Integers are taken as `int64_t` so that out-of-range values
+			// are reported rather than truncated, and strings with a format
+			// are taken as strings.
+			auto parameter = [](SchemaVisitor &v) -> std::string {
+				if (!v.format.empty())
+				{
+					return "std::string_view";
+				}
+				if ((v.return_type == "std::string_view") ||
+				    (v.return_type == "bool") || (v.return_type == "double"))
+				{
+					return std::string(v.return_type);
+				}
+				return "int64_t";
+			};
+			prop.get().visit(
+			  [&](Object child) {
+				  std::string builder{method_name};
+				  builder += "Builder";
+				  emit_builder(child, builder, "", types);
+				  setter(method_name,
+				         builder + " &b",
+				         "if (auto *v = adopt(b, " + key + ")) { set_property(" + key +
+				           ", v); }");
+				  setter(method_name,
+				         builder + " &&b",
+				         std::string(method_name) + "(b);");
+			  },
+			  [&](Array a) {
+				  bool isTuple;
+				  if (auto elements = fixed_elements(a, isTuple))
+				  {
+					  // Returns the statement that checks `item`, an element
+					  // with the schema `element`, and appends it to `array`.
+					  // Sets `type` to the parameter type for the element.
+					  auto append = [&](SchemaBase         element,
+					                    const std::string &item,
+					                    std::string       &type) {
+						  std::stringstream unused;
+						  SchemaVisitor     v(method_name, unused);
+						  element.get().visit(v);
+						  type = parameter(v);
+						  return check(v, item) + "ucl_array_append(array, " +
+						         configNamespace + "make_node(arena, " + item +
+						         "));";
+					  };
+					  std::string start =
+					    "auto *array = ucl_object_typed_new(UCL_ARRAY);";
+					  std::string finish = "set_property(" + key + ", array);";
+					  std::string type;
+					  if (isTuple)
+					  {
+						  // Tuples are set from one argument per element.
+						  std::string params;
+						  std::string body;
+						  for (size_t i = 0; i < elements->size(); i++)
+						  {
+							  std::string item = "item" + std::to_string(i);
+							  body += append((*elements)[i], item, type);
+							  params += (i == 0) ? "" : ", ";
+							  params += type + ' ' + item;
+						  }
+						  setter(method_name, params, start + body + finish);
+						  return;
+					  }
+					  // Fixed-length arrays are set from a range, which must
+					  // have the right number of elements.
+					  std::string body = append(elements->front(), "item", type);
+					  std::string fill = start + "size_t count = 0;for (" + type +
+					                     " item : items) {" + body +
+					                     "count++;}"
+					    "if (count != " +
+					    std::to_string(elements->size()) +
+					    ") {"
+					    "fail(UCL_SCHEMA_CONSTRAINT, \"wrong number of items "
+					    "for\", " +
+					    key + ");}" + finish;
+					  setters << "template<std::ranges::input_range R>\n";
+					  setter(method_name, "R &&items", fill);
+					  setter(method_name,
+					         "std::initializer_list<" + type + "> items",
+					         fill);
+					  return;
+				  }
+				  a.items().get().visit(
+				    [&](Object child) {
+					    std::string builder{method_name};
+					    builder += "ItemBuilder";
+					    emit_builder(child, builder, "", types);
+					    setter("add_" + std::string(method_name),
+					           builder + " &b",
+					           "if (auto *v = adopt(b, " + key +
+					             ")) { ucl_array_append(array_property(" + key +
+					             "), v); }");
+					    setter("add_" + std::string(method_name),
+					           builder + " &&b",
+					           "add_" + std::string(method_name) + "(b);");
+					    setters << "template<std::ranges::input_range R>\n";
+					    setter(method_name,
+					           "R &&items",
+					           "auto *array = ucl_object_typed_new(UCL_ARRAY);"
+					           "for (auto &b : items) {"
+					           "if (auto *v = adopt(b, " +
+					             key +
+					             ")) { ucl_array_append(array, v); }}"
+					             "set_property(" +
+					             key + ", array);");
+				    },
+				    [&](Array) {
+					    // Arrays of arrays have no setter.
+				    },
+				    [&](auto scalar) {
+					    std::stringstream unused;
+					    SchemaVisitor     v(method_name, unused);
+					    v(scalar);
+					    std::string type = parameter(v);
+					    setter("add_" + std::string(method_name),
+					           type + " item",
+					           check(v, "item") +
+					             "ucl_array_append(array_property(" + key +
+					             "), " + configNamespace +
+					             "make_node(arena, item));");
+					    std::string fill =
+					      "auto *array = ucl_object_typed_new(UCL_ARRAY);"
+					      "for (" +
+					      type + " item : items) {" + check(v, "item") +
+					      "ucl_array_append(array, " + configNamespace +
+					      "make_node(arena, item));}"
+					      "set_property(" +
+					      key + ", array);";
+					    setters << "template<std::ranges::input_range R>\n";
+					    setter(method_name, "R &&items", fill);
+					    setter(method_name,
+					           "std::initializer_list<" + type + "> items",
+					           fill);
+				    });
+			  },
+			  [&](auto scalar) {
+				  std::stringstream unused;
+				  SchemaVisitor     v(method_name, unused);
+				  v(scalar);
+				  setter(method_name,
+				         parameter(v) + " value",
+				         check(v, "value") + "set_property(" + key + ", " +
+				           configNamespace + "make_node(arena, value));");
+			  });
+		}
+
+		out << "class " << name << " : public " << configNamespace
+		    << "BuilderBase {"
+		    << "static constexpr std::array<std::string_view, "
+		    << required_properties.size() << "> requiredProperties = {";
+		// Iterate over the schema rather than the set so that the order is
+		// deterministic.
+		if (auto required = o.required())
+		{
+			for (auto prop : *required)
+			{
+				out << '"' << prop << "\", ";
+			}
+		}
+		out << "};\npublic:\n";
+		out << types.str();
+		out << "explicit " << name << "(" << configNamespace
+		    << "Arena *a = nullptr) : BuilderBase(a) {}\n";
+		out << "explicit " << name << "(" << configNamespace
+		    << "Arena &a) : BuilderBase(&a) {}\n";
+		out << setters.str();
+		out << "ucl_object_t *release() {"
+		    << "return finish(requiredProperties);}\n";
+		if (!configClass.empty())
+		{
+			out << "std::variant<" << configClass
+			    << ", ucl_schema_error> build() {"
+			    << "return build_config<" << configClass
+			    << ">(requiredProperties);}\n";
+		}
+		out << "};\n";
+	}
+
+	/**
+	 * Returns a C++ string literal for `str`.  Characters other than
+	 * printable ASCII are written as three-digit octal escapes, so that a
+	 * following digit cannot extend them.
+	 */
+	std::string cpp_string_literal(std::string_view str)
+	{
+		std::string literal = "\"";
+		for (char c : str)
+		{
+			auto byte = static_cast<unsigned char>(c);
+			if ((c == '"') || (c == '\\'))
+			{
+				literal += '\\';
+				literal += c;
+			}
+			else if ((byte < 0x20) || (byte >= 0x7f))
+			{
+				char escape[8];
+				snprintf(escape, sizeof(escape), "\\%03o", byte);
+				literal += escape;
+			}
+			else
+			{
+				literal += c;
+			}
+		}
+		literal += '"';
+		return literal;
+	}
+
+	template<typename T>
+	void emit_baked(Object           o,
+	                std::string_view name,
+	                std::string_view qualifiedName,
+	                T               &out);
+
+	/**
+	 * Returns the type used to store the property `name`, described by
+	 * `schema`, in a baked struct whose qualified name is `scope`.  If
+	 * `types` is not null, structs for object-typed properties are written
+	 * to it.
+	 */
+	std::string baked_type(SchemaBase         schema,
+	                       std::string_view   name,
+	                       std::string_view   scope,
+	                       std::stringstream *types)
+	{
+		std::string result;
+		schema.get().visit(
+		  [&](Object o) {
+			  std::string structName{name};
+			  structName += "Baked";
+			  result = std::string(scope) + "::" + structName;
+			  if (types != nullptr)
+			  {
+				  emit_baked(o, structName, result, *types);
+			  }
+		  },
+		  [&](Array a) {
+			  bool isTuple;
+			  if (auto elements = fixed_elements(a, isTuple))
+			  {
+				  std::vector<std::string> types;
+				  for (auto element : *elements)
+				  {
+					  types.push_back(baked_type(element, name, scope, nullptr));
+				  }
+				  result = fixed_type(isTuple, types);
+				  return;
+			  }
+			  std::string itemName{name};
+			  itemName += "Item";
+			  result = "std::span<const " +
+			           baked_type(a.items(), itemName, scope, types) + ">";
+		  },
+		  [&](auto scalar) {
+			  std::stringstream unused;
+			  SchemaVisitor     v(name, unused);
+			  v(scalar);
+			  result = v.return_type;
+		  });
+		return result;
+	}
+
+	std::string bake_object(Object              o,
+	                        const ucl_object_t *value,
+	                        std::string_view    type,
+	                        std::stringstream  &arrays,
+	                        int                &arrayCount);
+
+	/**
+	 * Returns a constant expression for `value`, which has been validated
+	 * against `schema`, as the property `name` of the baked struct whose
+	 * qualified name is `scope`.  The elements of arrays are written to
+	 * `arrays` as named constants, numbered from `arrayCount`.
+	 */
+	std::string bake_value(SchemaBase          schema,
+	                       const ucl_object_t *value,
+	                       std::string_view    name,
+	                       std::string_view    scope,
+	                       std::stringstream  &arrays,
+	                       int                &arrayCount)
+	{
+		std::string result;
+		schema.get().visit(
+		  [&](Object o) {
+			  std::string type{scope};
+			  type += "::";
+			  type += name;
+			  type += "Baked";
+			  result = bake_object(o, value, type, arrays, arrayCount);
+		  },
+		  [&](Array a) {
+			  bool isTuple;
+			  if (auto elements = fixed_elements(a, isTuple))
+			  {
+				  // Fixed-length arrays are stored inline.  Missing elements,
+				  // which only tuples can have, are value initialised.
+				  result = baked_type(schema, name, scope, nullptr) + "{";
+				  for (size_t i = 0; i < elements->size(); i++)
+				  {
+					  auto *item = ucl_array_find_index(value, i);
+					  result += (i == 0) ? "" : ", ";
+					  result +=
+					    (item == nullptr)
+					      ? baked_type((*elements)[i], name, scope, nullptr) + "{}"
+					      : bake_value((*elements)[i],
+					                   item,
+					                   name,
+					                   scope,
+					                   arrays,
+					                   arrayCount);
+				  }
+				  result += "}";
+				  return;
+			  }
+			  std::string itemName{name};
+			  itemName += "Item";
+			  std::string itemType =
+			    baked_type(a.items(), itemName, scope, nullptr);
+			  std::vector<std::string> items;
+			  ucl_object_iter_t        it = nullptr;
+			  while (auto *item = ucl_object_iterate(value, &it, true))
+			  {
+				  items.push_back(bake_value(
+				    a.items(), item, itemName, scope, arrays, arrayCount));
+			  }
+			  result = "std::span<const " + itemType + ">(";
+			  if (!items.empty())
+			  {
+				  // Elements are written after any arrays that they refer to.
+				  std::string array = "baked_array_";
+				  array += std::to_string(arrayCount++);
+				  arrays << "inline constexpr " << itemType << ' ' << array
+				         << "[] = {";
+				  for (auto &item : items)
+				  {
+					  arrays << item << ",\n";
+				  }
+				  arrays << "};\n";
+				  result += array;
+			  }
+			  result += ")";
+		  },
+		  [&](String s) {
+			  size_t      length;
+			  const char *str = ucl_object_tolstring(value, &length);
+			  result          = "std::string_view(" +
+			           cpp_string_literal({str, length}) + ", " +
+			           std::to_string(length) + ")";
+			  // Formatted strings are parsed when the header is compiled.
+			  if (auto *f = typed_format(s))
+			  {
+				  result = "*" + std::string(configNamespace) +
+				           std::string(f->value) + "::parse(" + result + ")";
+			  }
+		  },
+		  [&](auto scalar) {
+			  std::stringstream unused;
+			  SchemaVisitor     v(name, unused);
+			  v(scalar);
+			  if (v.return_type == "bool")
+			  {
+				  result = ucl_object_toboolean(value) ? "true" : "false";
+			  }
+			  else if (v.return_type == "double")
+			  {
+				  double d = ucl_object_todouble(value);
+				  if (std::isnan(d))
+				  {
+					  result = "std::numeric_limits<double>::quiet_NaN()";
+				  }
+				  else if (std::isinf(d))
+				  {
+					  result = d < 0
+					             ? "-std::numeric_limits<double>::infinity()"
+					             : "std::numeric_limits<double>::infinity()";
+				  }
+				  else
+				  {
+					  char buffer[32];
+					  snprintf(buffer, sizeof(buffer), "%.17g", d);
+					  result = buffer;
+				  }
+			  }
+			  else
+			  {
+				  int64_t i = ucl_object_toint(value);
+				  // The most negative value has no literal, because the
+				  // minus sign is a separate operator.
+				  result = (i == std::numeric_limits<int64_t>::min())
+				             ? "std::numeric_limits<int64_t>::min()"
+				             : std::string(v.return_type) + "(" +
+				                 std::to_string(i) + "LL)";
+			  }
+		  });
+		return result;
+	}
+
+	/**
+	 * Returns a constant expression for `value`, which has been validated
+	 * against the object schema `o`, as an instance of the baked struct
+	 * `type`.  Absent optional properties are `std::nullopt`.
+	 */
+	std::string bake_object(Object              o,
+	                        const ucl_object_t *value,
+	                        std::string_view    type,
+	                        std::stringstream  &arrays,
+	                        int                &arrayCount)
+	{
+		std::string result{type};
+		result += "(";
+		bool first = true;
+		for (auto prop : o.properties())
+		{
+			std::string_view prop_name = prop.key();
+			std::string      method_name_buffer;
+			std::string_view method_name =
+			  accessor_name(prop_name, method_name_buffer);
+			auto *child = ucl_object_lookup_len(
+			  value, prop_name.data(), prop_name.size());
+			if (!first)
+			{
+				result += ", ";
+			}
+			first = false;
+			if (child == nullptr)
+			{
+				result += "std::nullopt";
+				continue;
+			}
+			result +=
+			  bake_value(prop, child, method_name, type, arrays, arrayCount);
+		}
+		result += ")";
+		return result;
+	}
+
+	/**
+	 * Emit a baked struct for the object schema `o`, named `name` and with
+	 * the fully qualified name `qualifiedName`.  Baked structs are literal
+	 * types with a `constexpr` constructor that takes every property in
+	 * schema order, and expose the same accessors as the config class.
+	 * Arrays are stored as spans of constant arrays and optional properties
+	 * as `std::optional`.
+	 */
+	template<typename T>
+	void emit_baked(Object           o,
+	                std::string_view name,
+	                std::string_view qualifiedName,
+	                T               &out)
+	{
+		std::stringstream                    types;
+		std::stringstream                    members;
+		std::stringstream                    parameters;
+		std::stringstream                    initializers;
+		std::stringstream                    accessors;
+		std::string                          json;
+		std::unordered_set<std::string_view> required_properties;
+		if (auto required = o.required())
+		{
+			for (auto prop : *required)
+			{
+				required_properties.insert(prop);
+			}
+		}
+		bool first = true;
+		for (auto prop : o.properties())
+		{
+			std::string_view prop_name = prop.key();
+			std::string      method_name_buffer;
+			std::string_view method_name =
+			  accessor_name(prop_name, method_name_buffer);
+			bool        isRequired = required_properties.contains(prop_name);
+			std::string type =
+			  baked_type(prop, method_name, qualifiedName, &types);
+			// Nested structs and fixed-length arrays are returned by
+			// reference, everything else by value.
+			bool isStruct = false;
+			prop.get().visit_some([&](Object) { isStruct = true; },
+			                      [&](Array a) {
+				                      bool isTuple;
+				                      isStruct =
+				                        fixed_elements(a, isTuple).has_value();
+			                      });
+			if (!isRequired)
+			{
+				type = "std::optional<" + type + ">";
+			}
+			members << type << ' ' << method_name << "_;\n";
+			if (!first)
+			{
+				parameters << ", ";
+				initializers << ", ";
+			}
+			first = false;
+			parameters << type << ' ' << method_name;
+			initializers << method_name << "_(" << method_name << ")";
+			if (auto description = prop.description())
+			{
+				accessors << "\n/** " << *description << " */\n";
+			}
+			accessors << "constexpr "
+			          << ((isStruct || !isRequired) ? "const " + type + " &"
+			                                        : type)
+			          << ' ' << method_name << "() const { return "
+			          << method_name << "_; }\n";
+			if (writeJson)
+			{
+				json += json_property_writer(method_name, prop_name, !isRequired);
+			}
+		}
+		out << "class " << name << " {\npublic:\n" << types.str();
+		out << "private:\n" << members.str() << "public:\n";
+		out << "constexpr " << name << "(" << parameters.str() << ")";
+		if (!first)
+		{
+			out << " : " << initializers.str();
+		}
+		out << " {}\n";
+		out << accessors.str();
+		if (writeJson)
+		{
+			out << json_writer(json);
+		}
+		out << "};\n";
+	}
+	/**
+	 * A string property whose pattern is checked by a compiled matcher.
+	 */
+	struct PatternSite
+	{
+		/**
+		 * The steps from the root of the config to the property, as the
+		 * elements of an initializer list of `PathStep`s.
+		 */
+		std::string path;
+
+		/**
+		 * The index of the pattern.
+		 */
+		size_t pattern;
+	};
+
+	/**
+	 * Calls `visit` with each string schema in `schema`, which is at `path`,
+	 * reached through object properties, array items and tuple elements,
+	 * and the path to it as the elements of an initializer list of
+	 * `PathStep`s.  Strings anywhere else, such as in `additionalItems` or
+	 * in external sections, are not visited.
+	 */
+	template<typename F>
+	void visit_strings(SchemaBase schema, const std::string &path, F &&visit)
+	{
+		std::string step = "{";
+		step += configNamespace;
+		step += "PathStep::";
+		schema.get().visit(
+		  [&](Object o) {
+			  for (auto prop : o.properties())
+			  {
+				  // External sections are checked when they are loaded.
+				  if (prop.external())
+				  {
+					  continue;
+				  }
+				  visit_strings(prop,
+				                path + step + "Property, " +
+				                  cpp_string_literal(prop.key()) + "},",
+				                visit);
+			  }
+		  },
+		  [&](Array a) {
+			  if (auto tuple = a.tupleItems())
+			  {
+				  uint32_t index = 0;
+				  for (auto element : *tuple)
+				  {
+					  visit_strings(element,
+					                path + step + "Element, {}, " +
+					                  std::to_string(index++) + "},",
+					                visit);
+				  }
+				  return;
+			  }
+			  visit_strings(a.items(), path + step + "Elements},", visit);
+		  },
+		  [&](String s) { visit(s, path); },
+		  [](auto) {});
+	}
+
+	/**
+	 * Finds the patterns of the string properties in `schema`.  Each
+	 * distinct pattern is added to `patterns` once.  The patterns are
+	 * removed from the schema, so that libucl does not compile them again
+	 * for every string that it validates.  Patterns that `visit_strings`
+	 * does not reach are left for libucl.
+	 */
+	void collect_patterns(SchemaBase                schema,
+	                      std::vector<std::string> &patterns,
+	                      std::vector<PatternSite> &sites)
+	{
+		visit_strings(schema, "", [&](String s, const std::string &path) {
+			auto pattern = s.pattern();
+			if (!pattern)
+			{
+				return;
+			}
+			std::string source{*pattern};
+			auto found = std::find(patterns.begin(), patterns.end(), source);
+			sites.push_back({path, size_t(found - patterns.begin())});
+			if (found == patterns.end())
+			{
+				patterns.push_back(std::move(source));
+			}
+			ucl_object_unref(ucl_object_pop_key(
+			  const_cast<ucl_object_t *>(s.object()), "pattern"));
+		});
+	}
+
+	/**
+	 * Emits a struct called `name` with a matcher for each of `patterns`,
+	 * with automata for those that `PatternCompiler` handles, and a `check`
+	 * function that checks the strings at each of `sites` against them.
+	 */
+	template<typename T>
+	void emit_patterns(std::string_view                name,
+	                   const std::vector<std::string> &patterns,
+	                   const std::vector<PatternSite> &sites,
+	                   T                              &out)
+	{
+		out << "/** Matchers for the patterns in the schema, which are not "
+		       "in the schema used for validation. */\n"
+		    << "struct " << name << " {";
+		for (size_t i = 0; i < patterns.size(); i++)
+		{
+			std::string id  = std::to_string(i);
+			auto        dfa = PatternCompiler(patterns[i]).compile();
+			if (dfa)
+			{
+				out << "static constexpr uint16_t transitions" << id
+				    << "[] = {";
+				for (auto next : dfa->transitions)
+				{
+					out << next << ',';
+				}
+				out << "};\nstatic constexpr uint8_t flags" << id << "[] = {";
+				for (auto flags : dfa->flags)
+				{
+					out << unsigned(flags) << ',';
+				}
+				out << "};\nstatic constexpr " << configNamespace
+				    << "PatternDfa dfa" << id << "{{";
+				for (auto c : dfa->classes)
+				{
+					out << unsigned(c) << ',';
+				}
+				out << "}, " << dfa->classCount << ", transitions" << id
+				    << ", flags" << id << "};\n";
+			}
+			out << "/** Matcher for " << cpp_string_literal(patterns[i])
+			    << (dfa ? "" : ", which has no automaton") << ". */\n"
+			    << "static const " << configNamespace
+			    << "PatternMatcher &matcher" << id << "() { static const "
+			    << configNamespace
+			    << "PatternMatcher matcher(" << cpp_string_literal(patterns[i])
+			    << (dfa ? ", &dfa" + id : "") << "); return matcher; }\n";
+		}
+		out << "/** Checks the strings in `obj`, which has been validated "
+		       "against the schema, against the patterns. */\n"
+		    << "static bool check(const ucl_object_t *obj, ucl_schema_error "
+		       "*err) {";
+		for (size_t i = 0; i < sites.size(); i++)
+		{
+			out << "static constexpr " << configNamespace << "PathStep site"
+			    << i << "[] = {" << sites[i].path << "};\n";
+		}
+		out << "return true";
+		for (size_t i = 0; i < sites.size(); i++)
+		{
+			out << " && " << configNamespace << "check_pattern(obj, site" << i
+			    << ", matcher" << sites[i].pattern << "(), err)";
+		}
+		out << ";}\n};\n\n";
+	}
+
+	/**
+	 * A string property whose format is checked after the schema.
+	 */
+	struct FormatSite
+	{
+		/**
+		 * The steps from the root of the config to the property, as the
+		 * elements of an initializer list of `PathStep`s.
+		 */
+		std::string path;
+
+		/**
+		 * The class that parses the format.
+		 */
+		std::string_view parser;
+	};
+
+	/**
+	 * Finds the string properties in `schema` whose format has a parser.
+	 */
+	void collect_formats(SchemaBase schema, std::vector<FormatSite> &sites)
+	{
+		visit_strings(schema, "", [&](String s, const std::string &path) {
+			if (auto *format = string_format(s))
+			{
+				sites.push_back({path, format->parser});
+			}
+		});
+	}
+
+	/**
+	 * Emits a struct called `name` with a `check` function that checks the
+	 * strings at each of `sites` against their format, which libucl does not
+	 * check.
 	 */
 	template<typename T>
-	void emit_class(Object o, std::string_view name, T &out)
+	void emit_formats(std::string_view               name,
+	                  const std::vector<FormatSite> &sites,
+	                  T                             &out)
 	{
-		// Place to write new types.
-		std::stringstream                    types;
-		// Place to write methods.
-		std::stringstream                    methods;
-		// Set of the required properties.
-		std::unordered_set<std::string_view> required_properties;
-
-		// Collect the required properties in a set.
-		if (auto required = o.required())
+		out << "/** Checks the formats of strings, which libucl does not "
+		       "check. */\n"
+		    << "struct " << name << " {"
+		    << "static bool check(const ucl_object_t *obj, ucl_schema_error "
+		       "*err) {";
+		for (size_t i = 0; i < sites.size(); i++)
 		{
-			for (auto prop : *required)
-			{
-				required_properties.insert(prop);
-			}
+			out << "static constexpr " << configNamespace << "PathStep site"
+			    << i << "[] = {" << sites[i].path << "};\n";
 		}
+		out << "return true";
+		for (size_t i = 0; i < sites.size(); i++)
+		{
+			out << " && " << configNamespace << "check_format<"
+			    << configNamespace << sites[i].parser << ">(obj, site" << i
+			    << ", err)";
+		}
+		out << ";}\n};\n\n";
+	}
 
-		// Generate the class definition
-		out << "class " << name << "{" << configNamespace
-		    << "UCLPtr obj; public:\n";
+	/**
+	 * Returns `schema` as JSON, escaped as the contents of a C string
+	 * literal.
+	 */
+	std::string schema_literal(const ucl_object_t *schema)
+	{
+		char *schemaCString = reinterpret_cast<char *>(
+		  ucl_object_emit(schema, UCL_EMIT_JSON_COMPACT));
+		std::string literal(schemaCString);
+		free(schemaCString);
+		// Escape as a C string:
+		auto replace = [&](std::string_view search, std::string_view replace) {
+			size_t pos = 0;
+			while ((pos = literal.find(search, pos)) != std::string::npos)
+			{
+				literal.replace(pos, search.length(), replace);
+				pos += replace.length();
+			}
+		};
+		replace("\\", "\\\\");
+		replace("\"", "\\\"");
+		replace("\n", "\\n");
+		return literal;
+	}
 
-		// Generate the constructor.
-		out << name << "(const ucl_object_t *o) : obj(o) {}\n";
+	/**
+	 * Emits a function, with the signature `declaration`, that returns the
+	 * schema in the string literal contents `literal`, which is parsed the
+	 * first time that it is needed.
+	 */
+	template<typename T>
+	void emit_schema_accessor(std::string_view   declaration,
+	                          const std::string &literal,
+	                          T                 &out)
+	{
+		out << declaration << " {"
+		    << "static const ucl_object_t *schema = []() {"
+		    << "static const char embeddedSchema[] = \"" << literal << "\";\n"
+		    << "struct ucl_parser *p = "
+		       "ucl_parser_new(UCL_PARSER_NO_IMPLICIT_ARRAYS);\n"
+		    << "ucl_parser_add_string(p, embeddedSchema, "
+		       "sizeof(embeddedSchema));\n"
+		    << "if (ucl_parser_get_error(p)) { std::terminate(); }\n"
+		    << "auto obj = ucl_parser_get_object(p);\n"
+		    << "ucl_parser_free(p);\n"
+		    << "return obj;\n"
+		    << "}();"
+		    << "return schema;\n"
+		    << "}\n\n";
+	}
 
-		// Generate a method for each property.
+	/**
+	 * Returns a copy of the root schema `o` in which the schema of each
+	 * external section is replaced by one for the string that names its
+	 * file, which is what configs contain.
+	 */
+	ucl_object_t *without_external_sections(Object o)
+	{
+		auto *copy       = ucl_object_copy(o.object());
+		auto *properties = const_cast<ucl_object_t *>(
+		  ucl_object_lookup(copy, "properties"));
 		for (auto prop : o.properties())
 		{
-			std::string_view prop_name   = prop.key();
-			std::string_view method_name = prop_name;
-
-			std::string method_name_buffer;
-
-			bool isRequired = required_properties.contains(prop_name);
-
-			// FIXME: Do a proper regex match
-			if (method_name.find('-') != std::string::npos)
+			if (!prop.external())
 			{
-				method_name_buffer = method_name;
-				std::replace(method_name_buffer.begin(),
-				             method_name_buffer.end(),
-				             '-',
-				             '_');
-				method_name = method_name_buffer;
+				continue;
 			}
-
-			// If there is a description, put it in a doc comment
+			auto *path = ucl_object_typed_new(UCL_OBJECT);
+			ucl_object_insert_key(
+			  path, ucl_object_fromstring("string"), "type", 0, false);
 			if (auto description = prop.description())
 			{
-				methods << "\n/** " << *description << " */\n";
+				ucl_object_insert_key(
+				  path,
+				  ucl_object_fromlstring(description->data(),
+				                         description->size()),
+				  "description",
+				  0,
+				  false);
 			}
+			std::string_view key = prop.key();
+			ucl_object_replace_key(
+			  properties, path, key.data(), key.size(), true);
+		}
+		return copy;
+	}
 
-			// Visit the schema describing this property to collect any types.
-			SchemaVisitor v(method_name, types);
-			prop.get().visit(v);
-			// Generate the method.  If it is not a required property, it must
-			// return a `std::optional<T>`.
-			if (isRequired)
+	/**
+	 * Emits the `ExternalSections` struct for the root object schema `o`,
+	 * with a loader for each of its external sections.  Each section is
+	 * validated against its own schema, which is embedded here, and then
+	 * has its formats checked.  Patterns in sections are left for libucl.
+	 */
+	template<typename T>
+	void emit_external_sections(Object o, T &out)
+	{
+		std::stringstream loaders;
+		out << "/** The loaders for the sections kept in separate files, "
+		       "which copies of a config share. */\n"
+		    << "struct ExternalSections {";
+		for (auto prop : o.properties())
+		{
+			if (!prop.external())
 			{
-				methods << v.return_type << ' ' << method_name << "() const "
-				        << v.lifetimeAttribute << " {"
-				        << "return " << v.adaptorNamespace << v.adaptor
-				        << "(obj[\"" << prop_name << "\"]);}";
+				continue;
 			}
-			else
+			std::string      buffer;
+			std::string_view method_name = accessor_name(prop.key(), buffer);
+			std::string      section{method_name};
+			emit_schema_accessor("static const ucl_object_t *" + section +
+			                       "_schema()",
+			                     schema_literal(prop.object()),
+			                     out);
+			std::vector<FormatSite> sites;
+			collect_formats(prop, sites);
+			std::string check = "nullptr";
+			if (!sites.empty())
 			{
-				methods << "std::optional<" << v.return_type << "> "
-				        << method_name << "() const " << v.lifetimeAttribute
-				        << " {"
-				        << "return " << configNamespace << "::make_optional<"
-				        << v.adaptorNamespace << v.adaptor << ", "
-				        << v.return_type << ">(obj[\"" << prop_name << "\"]);}";
+				emit_formats(section + "_formats", sites, out);
+				check = section + "_formats::check";
 			}
-			methods << "\n\n";
+			loaders << configNamespace << "ExternalSection<" << method_name
+			        << "Class> " << method_name << "{" << section
+			        << "_schema, " << check << "};\n";
 		}
-
-		out << types.str();
-		out << methods.str();
-
-		out << "};\n";
+		out << loaders.str() << "};\n";
 	}
+
 } // namespace
 
 int main(int argc, char **argv)
@@ -583,7 +3330,24 @@ int main(int argc, char **argv)
 	  {"config-class", required_argument, nullptr, 'c'},
 	  {"detail-namespace", required_argument, nullptr, 'd'},
 	  {"output", required_argument, nullptr, 'o'},
-	  {"embed-schema", required_argument, nullptr, 'e'},
+	  {"embed-schema", no_argument, nullptr, 'e'},
+	  {"columns", no_argument, nullptr, 'C'},
+	  {"access-counters", no_argument, nullptr, 'a'},
+	  {"memory-usage", no_argument, nullptr, 'M'},
+	  {"materialize", no_argument, nullptr, 'm'},
+	  {"layout-profile", required_argument, nullptr, 'p'},
+	  {"write-json", no_argument, nullptr, 'j'},
+	  {"builders", no_argument, nullptr, 'b'},
+	  {"hash", no_argument, nullptr, 'H'},
+	  {"bake", required_argument, nullptr, 'B'},
+	  {"generic-backend", no_argument, nullptr, 'g'},
+	  {"msgpack", required_argument, nullptr, 'P'},
+	  {"zero-copy", no_argument, nullptr, 'z'},
+	  {"shared-memory", no_argument, nullptr, 'S'},
+	  {"reflection", no_argument, nullptr, 'r'},
+	  {"compile-patterns", no_argument, nullptr, 'R'},
+	  {"parse-formats", no_argument, nullptr, 'F'},
+	  {"validation-cache", no_argument, nullptr, 'V'},
 	  {nullptr, 0, nullptr, 0},
 	};
 
@@ -591,12 +3355,33 @@ int main(int argc, char **argv)
 
 	bool embedSchema = false;
 
+	bool emitColumns = false;
+
+	bool countAccesses = false;
+
+	bool materialize = false;
+
+	bool emitBuilders = false;
+
+	const char *bakeFile = nullptr;
+
+	const char *msgpackFile = nullptr;
+
+	bool sharedMemory = false;
+
+	bool compilePatterns = false;
+
+	bool validationCache = false;
+
 	if (argc > 2)
 	{
 		int c = -1;
 		int option_index;
-		while ((c = getopt_long(
-		          argc, argv, "d:ec:o:", long_options, &option_index)) != -1)
+		while ((c = getopt_long(argc,
+		                        argv,
+		                        "d:ec:o:CaMmp:jbHB:gP:zSrRFV",
+		                        long_options,
+		                        &option_index)) != -1)
 		{
 			switch (c)
 			{
@@ -616,9 +3401,114 @@ int main(int argc, char **argv)
 					embedSchema = true;
 					break;
 				}
+				case 'a':
+				{
+					countAccesses = true;
+					break;
+				}
+				case 'j':
+				{
+					writeJson = true;
+					break;
+				}
+				case 'b':
+				{
+					emitBuilders = true;
+					break;
+				}
+				case 'H':
+				{
+					structuralHash = true;
+					break;
+				}
+				case 'B':
+				{
+					bakeFile = optarg;
+					break;
+				}
+				case 'g':
+				{
+					genericBackend = true;
+					break;
+				}
+				case 'P':
+				{
+					msgpackFile = optarg;
+					break;
+				}
+				case 'z':
+				{
+					zeroCopy = true;
+					break;
+				}
+				case 'r':
+				{
+					reflection = true;
+					break;
+				}
+				case 'R':
+				{
+					compilePatterns = true;
+					break;
+				}
+				case 'F':
+				{
+					parseFormats = true;
+					break;
+				}
+				case 'V':
+				{
+					validationCache = true;
+					break;
+				}
+				case 'S':
+				{
+					// Readers are the generated classes instantiated with the
+					// flat backend.
+					sharedMemory   = true;
+					genericBackend = true;
+					break;
+				}
+				case 'm':
+				{
+					materialize = true;
+					break;
+				}
+				case 'p':
+				{
+					// Read an access report, as written by
+					// `write_access_report`: a count and a path per line.
+					std::ifstream profile(optarg);
+					if (!profile)
+					{
+						fprintf(stderr, "Unable to read profile: %s\n", optarg);
+						return EXIT_FAILURE;
+					}
+					uint64_t    count;
+					std::string path;
+					while ((profile >> count) &&
+					       std::getline(profile >> std::ws, path))
+					{
+						layoutProfile[path] = count;
+						layoutHottest       = std::max(layoutHottest, count);
+					}
+					materialize = true;
+					break;
+				}
+				case 'M':
+				{
+					memoryAccounting = true;
+					break;
+				}
+				case 'C':
+				{
+					emitColumns = true;
+					break;
+				}
 				case 'o':
 				{
-					file_out = std::make_unique<std::ofstream>(optarg);
+					file_out =
+					  std::make_unique<std::ofstream>(optarg, std::ios::binary);
 					break;
 				}
 			}
@@ -648,55 +3538,615 @@ int main(int argc, char **argv)
 
 	auto obj = ucl_parser_get_object(p);
 	ucl_parser_free(p);
+	// Rewrite tuples into the form that libucl validates, both for checking
+	// configs here and in the embedded copy of the schema, and require all
+	// of their items, which the generated accessors return.
+	translate_prefix_items(obj, true);
 	Root  conf(obj);
-	char *schemaCString =
-	  reinterpret_cast<char *>(ucl_object_emit(obj, UCL_EMIT_JSON_COMPACT));
-	std::string schema(schemaCString);
-	free(schemaCString);
-	// Escape as a C string:
-	auto replace = [&](std::string_view search, std::string_view replace) {
-		size_t pos = 0;
-		while ((pos = schema.find(search, pos)) != std::string::npos)
-		{
-			schema.replace(pos, search.length(), replace);
-			pos += replace.length();
+	// Sections kept in separate files are loaded through the embedded
+	// loader and are not yet understood by the other generated views of a
+	// config.
+	bool externalSections = has_external_sections(conf);
+	if (externalSections)
+	{
+		if (!embedSchema)
+		{
+			fprintf(stderr, "External sections require --embed-schema\n");
+			return EXIT_FAILURE;
+		}
+		if (genericBackend || materialize || emitColumns || emitBuilders ||
+		    structuralHash || writeJson || reflection || (bakeFile != nullptr))
+		{
+			fprintf(stderr,
+			        "External sections cannot be used with generic backends, "
+			        "materialized structs, columns, builders, hashing, JSON "
+			        "output, reflection or baked configs\n");
+			return EXIT_FAILURE;
+		}
+	}
+	// Configs name the files of their external sections, so they are
+	// validated against a schema with strings in place of the sections.
+	auto documentSchema = [&]() {
+		return externalSections ? without_external_sections(conf)
+		                        : ucl_object_ref(obj);
+	};
+	// Parses a config named on the command line and validates it now, so
+	// that the generated code or the consumers of the output do not have
+	// to.  Returns null on failure.
+	auto loadConfig = [&](const char *file) -> ucl_object_t * {
+		auto *configParser = ucl_parser_new(UCL_PARSER_NO_IMPLICIT_ARRAYS);
+		ucl_parser_add_file(configParser, file);
+		if (ucl_parser_get_error(configParser))
+		{
+			fprintf(stderr,
+			        "Error parsing config: %s\n",
+			        ucl_parser_get_error(configParser));
+			ucl_parser_free(configParser);
+			return nullptr;
 		}
+		auto *config = ucl_parser_get_object(configParser);
+		ucl_parser_free(configParser);
+		ucl_schema_error err;
+		auto            *schema = documentSchema();
+		bool             valid  = ucl_object_validate(schema, config, &err);
+		ucl_object_unref(schema);
+		if (!valid)
+		{
+			fprintf(stderr, "Config does not match schema: %s\n", err.msg);
+			ucl_object_unref(config);
+			return nullptr;
+		}
+		return config;
+	};
+	// Converting a config to MessagePack writes the encoding instead of a
+	// header.
+	if (msgpackFile != nullptr)
+	{
+		auto *config = loadConfig(msgpackFile);
+		if (config == nullptr)
+		{
+			return EXIT_FAILURE;
+		}
+		size_t length  = 0;
+		auto  *encoded = ucl_object_emit_len(config, UCL_EMIT_MSGPACK, &length);
+		out.write(reinterpret_cast<const char *>(encoded), length);
+		free(encoded);
+		ucl_object_unref(config);
+		ucl_object_unref(obj);
+		out.flush();
+		return out ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+	// Parse the config to bake, if any.
+	ucl_object_t *baked = nullptr;
+	if (bakeFile != nullptr)
+	{
+		baked = loadConfig(bakeFile);
+		if (baked == nullptr)
+		{
+			return EXIT_FAILURE;
+		}
+	}
+	// Returns the schema for configs as the contents of a C string literal.
+	auto emitSchema = [&]() {
+		auto       *schema  = documentSchema();
+		std::string literal = schema_literal(schema);
+		ucl_object_unref(schema);
+		return literal;
 	};
-	replace("\\", "\\\\");
-	replace("\"", "\\\"");
-	replace("\n", "\\n");
+	std::string schema = emitSchema();
+	// With compiled patterns, configs are validated against a copy of the
+	// schema without the patterns, and then the patterns are checked.  The
+	// full schema is kept for layered configs.
+	std::vector<std::string> patterns;
+	std::vector<PatternSite> patternSites;
+	std::string              validationSchema;
+	if (compilePatterns && embedSchema)
+	{
+		collect_patterns(conf, patterns, patternSites);
+		validationSchema = emitSchema();
+	}
+	std::string patternsStruct{configClass};
+	patternsStruct += "Patterns";
+	// Formats are checked after the schema, because libucl ignores them.
+	std::vector<FormatSite> formatSites;
+	if (embedSchema)
+	{
+		collect_formats(conf, formatSites);
+	}
+	std::string formatsStruct{configClass};
+	formatsStruct += "Formats";
 	ucl_object_unref(obj);
 
 	// Generic headers
-	out << "#include \"config-generic.h\"\n\n";
-	out << "#include <variant>\n\n";
+	out << "#include \"config-generic.h\"\n";
+	if (embedSchema)
+	{
+		out << "#include \"config-loader.h\"\n";
+	}
+	if (emitColumns)
+	{
+		out << "#include \"config-columns.h\"\n";
+	}
+	if (countAccesses)
+	{
+		out << "#include \"config-counters.h\"\n";
+	}
+	if (memoryAccounting)
+	{
+		out << "#include \"config-memory.h\"\n";
+	}
+	if (writeJson)
+	{
+		out << "#include \"config-json.h\"\n";
+	}
+	if (emitBuilders)
+	{
+		out << "#include \"config-builder.h\"\n";
+	}
+	if (structuralHash)
+	{
+		out << "#include \"config-hash.h\"\n";
+	}
+	if (sharedMemory)
+	{
+		out << "#include \"config-shm.h\"\n";
+	}
+	if (reflection)
+	{
+		out << "#include \"config-reflect.h\"\n";
+	}
+	if (!patterns.empty())
+	{
+		out << "#include \"config-pattern.h\"\n";
+	}
+	if (parseFormats)
+	{
+		out << "#include \"config-format.h\"\n";
+	}
+	if (validationCache && embedSchema)
+	{
+		out << "#include \"config-cache.h\"\n";
+	}
+	if (externalSections)
+	{
+		out << "#include \"config-external.h\"\n";
+	}
+	if (materialize)
+	{
+		out << "\n#include <memory>\n#include <string>\n#include <vector>";
+	}
+	if (zeroCopy)
+	{
+		out << "\n#include <memory>";
+	}
+	if (baked != nullptr)
+	{
+		out << "\n#include <limits>\n#include <optional>\n#include <span>";
+	}
+	out << "\n#include <variant>\n\n";
 	out << "// Machine generated by "
 	       "https://github.com/davidchisnall/config-gen DO NOT EDIT\n";
 	out << "#ifdef CONFIG_NAMESPACE_BEGIN\nCONFIG_NAMESPACE_BEGIN\n#endif\n";
 
-	// Emit the config class
-	emit_class(conf, configClass, out);
+	// With a generic backend, the emitted class is a template and the
+	// config class is its instantiation for libucl.
+	std::string rootClass{configClass};
+	if (genericBackend)
+	{
+		rootClass = "Basic" + rootClass;
+	}
+	// Emit the config class.  If accessors count reads, the counters must be
+	// declared first, but their number is known only after emitting the
+	// class, so buffer it.
+	if (countAccesses)
+	{
+		accessCountersClass = configClass;
+		accessCountersClass += "AccessCounters";
+		std::stringstream classOut;
+		emit_class(conf, rootClass, classOut);
+		out << "struct " << accessCountersClass << " {"
+		    << "static constexpr std::array<std::string_view, "
+		    << accessCounterPaths.size() << "> paths = {";
+		for (auto &path : accessCounterPaths)
+		{
+			out << '"' << path << "\", ";
+		}
+		out << "};\n"
+		    << "static inline " << configNamespace << "AccessCounters<"
+		    << accessCounterPaths.size() << "> counters;\n"
+		    << "};\n";
+		out << classOut.str();
+		out << "inline std::vector<" << configNamespace
+		    << "AccessCount> access_counts() {"
+		    << "return " << accessCountersClass
+		    << "::counters.snapshot(" << accessCountersClass
+		    << "::paths);}\n";
+		out << "inline void reset_access_counts() {" << accessCountersClass
+		    << "::counters.reset();}\n";
+	}
+	else
+	{
+		emit_class(conf, rootClass, out);
+	}
+	if (genericBackend)
+	{
+		out << "using " << configClass << " = " << rootClass << "<>;\n";
+	}
+	// Configs read from shared memory are the same class over flat images.
+	std::string sharedClass{configClass};
+	sharedClass += "Shared";
+	if (sharedMemory)
+	{
+		out << "using " << sharedClass << " = " << rootClass << "<"
+		    << configNamespace << "FlatBackend>;\n";
+		out << "using " << sharedClass << "Reader = " << configNamespace
+		    << "SharedConfigReader<" << sharedClass << ">;\n";
+	}
+	// If we've been asked for a materialised struct, emit it after the class
+	// that it is built from.
+	if (materialize)
+	{
+		std::string dataStruct{configClass};
+		dataStruct += "Data";
+		emit_materialized(conf, dataStruct, configClass, "", out);
+	}
+	// If we've been asked for a builder, emit it after the class that it
+	// builds.
+	if (emitBuilders)
+	{
+		std::string builderClass{configClass};
+		builderClass += "Builder";
+		emit_builder(conf, builderClass, configClass, out);
+	}
+	// If we've been given a config to bake, emit the literal types and then
+	// the config as a constant.
+	if (baked != nullptr)
+	{
+		std::string bakedStruct{configClass};
+		bakedStruct += "Baked";
+		emit_baked(conf, bakedStruct, bakedStruct, out);
+		std::stringstream arrays;
+		int               arrayCount = 0;
+		std::string value =
+		  bake_object(conf, baked, bakedStruct, arrays, arrayCount);
+		out << arrays.str();
+		out << "inline constexpr " << bakedStruct << " baked_config = "
+		    << value << ";\n";
+		ucl_object_unref(baked);
+	}
+	// If we've been asked for a columnar store, emit it after the class that
+	// it is built from.
+	if (emitColumns)
+	{
+		std::string columnsClass{configClass};
+		columnsClass += "Columns";
+		emit_columns(conf, columnsClass, configClass, out);
+	}
 	// If we've been asked to embed the schema and a constructor, do so
 	if (embedSchema)
 	{
+		emit_schema_accessor(
+		  "inline const ucl_object_t *embedded_schema()", schema, out);
+		// Schema without the compiled patterns, and their matchers.
+		std::string validate = "ucl_object_validate(schema, obj, &err)";
+		std::string schemaAccessor = "embedded_schema()";
+		if (!patterns.empty())
+		{
+			emit_schema_accessor(
+			  "inline const ucl_object_t *embedded_validation_schema()",
+			  validationSchema,
+			  out);
+			emit_patterns(patternsStruct, patterns, patternSites, out);
+			validate += " && " + patternsStruct + "::check(obj, &err)";
+			schemaAccessor = "embedded_validation_schema()";
+		}
+		std::string checkFormats;
+		if (!formatSites.empty())
+		{
+			emit_formats(formatsStruct, formatSites, out);
+			checkFormats = formatsStruct + "::check";
+			validate += " && " + checkFormats + "(obj, &err)";
+		}
+		// Construction, with each phase reported to an observer.
+		out << "template<" << configNamespace << "LoadObserver O>\n"
+		    << "inline std::variant<" << configClass
+		    << ", ucl_schema_error> "
+		       "make_config(ucl_object_t *obj, O &observer"
+		    << (zeroCopy ? ", std::shared_ptr<const void> storage = {}" : "")
+		    << ") {"
+		    << "const ucl_object_t *schema;\n"
+		    << "{" << configNamespace << "ObservedPhase phase(observer, "
+		    << configNamespace << "LoadPhase::SchemaLoad);\n"
+		    << "schema = " << schemaAccessor << ";}\n"
+		    << "ucl_schema_error err;\n"
+		    << "{" << configNamespace << "ObservedPhase phase(observer, "
+		    << configNamespace << "LoadPhase::Validate);\n"
+		    << "if (!(" << validate << ")) { return err; }}\n"
+		    << configNamespace << "ObservedPhase phase(observer, "
+		    << configNamespace << "LoadPhase::Materialize);\n"
+		    << "return " << configClass << "(obj"
+		    << (zeroCopy ? ", std::move(storage)" : "") << ");\n"
+		    << "}\n\n";
 		out << "inline std::variant<" << configClass
 		    << ", ucl_schema_error> "
 		       "make_config(ucl_object_t *obj) {"
-		    << "static const ucl_object_t *schema = []() {"
-		    << "static const char embeddedSchema[] = \"" << schema << "\";\n"
-		    << "struct ucl_parser *p = "
-		       "ucl_parser_new(UCL_PARSER_NO_IMPLICIT_ARRAYS);\n"
-		    << "ucl_parser_add_string(p, embeddedSchema, "
-		       "sizeof(embeddedSchema));\n"
-		    << "if (ucl_parser_get_error(p)) { std::terminate(); }\n"
-		    << "auto obj = ucl_parser_get_object(p);\n"
-		    << "ucl_parser_free(p);\n"
-		    << "return obj;\n"
-		    << "}();"
+		    << configNamespace << "NullObserver observer;\n"
+		    << "return make_config(obj, observer);\n"
+		    << "}\n\n";
+		// Layered configs, validated on the merged view.
+		out << "inline std::variant<" << configClass
+		    << ", ucl_schema_error> "
+		       "make_config(const "
+		    << configNamespace << "LayerStack &layers) {"
+		    << "ucl_schema_error err;\n"
+		    << "if (!layers.validate(embedded_schema(), &err)"
+		    << (checkFormats.empty()
+		          ? ""
+		          : " || !" + checkFormats + "(layers.view(), &err)")
+		    << ") { return err; }"
+		    << "return " << configClass << "(layers.view());\n"
+		    << "}\n\n";
+		out << "inline std::variant<" << configClass
+		    << ", ucl_schema_error> "
+		       "make_config("
+		    << configNamespace
+		    << "LayerStack &layers, size_t index, const ucl_object_t "
+		       "*layer) {"
+		    << "ucl_schema_error err;\n"
+		    << "if (!layers.replace(index, layer, embedded_schema(), &err"
+		    << (checkFormats.empty() ? "" : ", " + checkFormats)
+		    << ")) { return err; }"
+		    << "return " << configClass << "(layers.view());\n"
+		    << "}\n\n";
+		// Interning loader, shares identical subtrees between configs.
+		out << "inline std::variant<" << configClass
+		    << ", ucl_schema_error> "
+		       "make_interned_config(ucl_object_t *obj, "
+		    << configNamespace << "InternTable &table = " << configNamespace
+		    << "InternTable::global()) {"
+		    << "const ucl_object_t *schema = " << schemaAccessor << ";\n"
 		    << "ucl_schema_error err;\n"
-		    << "if (!ucl_object_validate(schema, obj, &err)) { return err; }"
-		    << "return " << configClass << "(obj);\n"
+		    << "if (!(" << validate << ")) { return err; }"
+		    << "auto *canonical = table.intern(obj);\n"
+		    << configClass << " conf(canonical);\n"
+		    << "ucl_object_unref(canonical);\n"
+		    << "return conf;\n"
+		    << "}\n\n";
+		// Batch loader, parses and validates a set of files concurrently.
+		out << "template<" << configNamespace << "Executor E>\n"
+		    << "inline std::vector<std::variant<" << configClass << ", "
+		    << configNamespace << "LoadError>> "
+		    << "load_configs(std::span<const std::filesystem::path> paths, "
+		       "E &executor) {"
+		    << "return " << configNamespace << "load_configs<" << configClass
+		    << ">(paths, executor, [](ucl_object_t *obj) { return "
+		       "make_config(obj); });"
+		    << "}\n\n";
+		out << "template<" << configNamespace << "Executor E>\n"
+		    << "inline std::vector<std::variant<" << configClass << ", "
+		    << configNamespace << "LoadError>> "
+		    << "load_configs(std::span<const std::filesystem::path> paths, "
+		       "E &executor, "
+		    << configNamespace << "InternTable &table) {"
+		    << "return " << configNamespace << "load_configs<" << configClass
+		    << ">(paths, executor, [&](ucl_object_t *obj) { return "
+		       "make_interned_config(obj, table); });"
+		    << "}\n\n";
+		// Batch loaders that parse each included fragment once.
+		out << "template<" << configNamespace << "Executor E>\n"
+		    << "inline std::vector<std::variant<" << configClass << ", "
+		    << configNamespace << "LoadError>> "
+		    << "load_configs(std::span<const std::filesystem::path> paths, "
+		       "E &executor, "
+		    << configNamespace << "FragmentCache &fragments) {"
+		    << "return " << configNamespace << "load_configs<" << configClass
+		    << ">(paths, executor, fragments, [](ucl_object_t *obj) { "
+		       "return make_config(obj); });"
+		    << "}\n\n";
+		out << "template<" << configNamespace << "Executor E, "
+		    << configNamespace << "LoadObserver O>\n"
+		    << "inline std::vector<std::variant<" << configClass << ", "
+		    << configNamespace << "LoadError>> "
+		    << "load_configs(std::span<const std::filesystem::path> paths, "
+		       "E &executor, "
+		    << configNamespace << "FragmentCache &fragments, O &observer) {"
+		    << "return " << configNamespace << "load_configs<" << configClass
+		    << ">(paths, executor, fragments, [&](ucl_object_t *obj) { "
+		       "return make_config(obj, observer); }, observer);"
+		    << "}\n\n";
+		// Batch loader, reporting every phase of every file to an observer.
+		out << "template<" << configNamespace << "Executor E, "
+		    << configNamespace << "LoadObserver O>\n"
+		    << "inline std::vector<std::variant<" << configClass << ", "
+		    << configNamespace << "LoadError>> "
+		    << "load_configs(std::span<const std::filesystem::path> paths, "
+		       "E &executor, O &observer) {"
+		    << "return " << configNamespace << "load_configs<" << configClass
+		    << ">(paths, executor, [&](ucl_object_t *obj) { return "
+		       "make_config(obj, observer); }, observer);"
+		    << "}\n\n";
+		// Binary loaders, for configs that are produced by programs rather
+		// than written by people.
+		out << "template<" << configNamespace << "LoadObserver O>\n"
+		    << "inline std::variant<" << configClass << ", "
+		    << configNamespace << "LoadError> "
+		    << "make_config_from_msgpack(std::span<const std::byte> data, O "
+		       "&observer) {"
+		    << "return " << configNamespace << "load_config_msgpack<"
+		    << configClass
+		    << ">(data, [&](ucl_object_t *obj) { return make_config(obj, "
+		       "observer); }, observer);"
+		    << "}\n\n";
+		out << "inline std::variant<" << configClass << ", "
+		    << configNamespace << "LoadError> "
+		    << "make_config_from_msgpack(std::span<const std::byte> data) {"
+		    << configNamespace << "NullObserver observer;\n"
+		    << "return make_config_from_msgpack(data, observer);\n"
 		    << "}\n\n";
+		// Shared-memory publisher, validates a config once and publishes
+		// its flat image for readers in other processes.
+		if (sharedMemory)
+		{
+			out << "inline std::variant<" << configClass << ", "
+			    << configNamespace << "LoadError> "
+			    << "publish_config(" << configNamespace
+			    << "SharedConfigRegion &region, ucl_object_t *obj) {"
+			    << "auto conf = make_config(obj);\n"
+			    << "if (auto *err = std::get_if<ucl_schema_error>(&conf)) { "
+			       "return "
+			    << configNamespace << "LoadError(*err); }\n"
+			    << "auto published = region.publish(" << configNamespace
+			    << "encode_flat(obj));\n"
+			    << "if (auto *err = std::get_if<" << configNamespace
+			    << "LoadError>(&published)) { return std::move(*err); }\n"
+			    << "return std::get<" << configClass << ">(conf);\n"
+			    << "}\n\n";
+		}
+		// Zero-copy loader, parses a mapping of the file in place.
+		if (zeroCopy)
+		{
+			out << "template<" << configNamespace << "LoadObserver O>\n"
+			    << "inline std::variant<" << configClass << ", "
+			    << configNamespace << "LoadError> "
+			    << "load_config(const std::filesystem::path &path, O "
+			       "&observer) {"
+			    << "return " << configNamespace << "load_config_mapped<"
+			    << configClass
+			    << ">(path, [&](ucl_object_t *obj, std::shared_ptr<const "
+			       "void> storage) { return make_config(obj, observer, "
+			       "std::move(storage)); }, observer);"
+			    << "}\n\n";
+			out << "inline std::variant<" << configClass << ", "
+			    << configNamespace << "LoadError> "
+			    << "load_config(const std::filesystem::path &path) {"
+			    << configNamespace << "NullObserver observer;\n"
+			    << "return load_config(path, observer);\n"
+			    << "}\n\n";
+		}
+		// Asynchronous loaders, which read, parse and validate files on an
+		// executor while the caller gets on with something else.  Zero-copy
+		// configs are loaded from a mapping, as `load_config` does.
+		{
+			std::string load =
+			  zeroCopy
+			    ? std::string("[](const std::filesystem::path &path) { "
+			                  "return load_config(path); }")
+			    : std::string("[](const std::filesystem::path &path) { "
+			                  "return ") +
+			        configNamespace + "load_config_file<" + configClass +
+			        ">(path, [](ucl_object_t *obj) { return make_config(obj); "
+			        "}); }";
+			std::string observed =
+			  zeroCopy
+			    ? std::string("[&observer](const std::filesystem::path "
+			                  "&path) { return load_config(path, observer); }")
+			    : std::string("[&observer](const std::filesystem::path "
+			                  "&path) { return ") +
+			        configNamespace + "load_config_file<" + configClass +
+			        ">(path, [&](ucl_object_t *obj) { return make_config(obj, "
+			        "observer); }, observer); }";
+			std::string future = std::string("std::future<std::variant<") +
+			                     configClass + ", " + configNamespace +
+			                     "LoadError>>";
+			out << "template<" << configNamespace << "Executor E, "
+			    << configNamespace << "LoadObserver O>\n"
+			    << "inline " << future
+			    << " make_config_async(const std::filesystem::path &path, E "
+			       "&executor, O &observer) {"
+			    << "return " << configNamespace << "load_config_async<"
+			    << configClass << ">(path, executor, " << observed << ");"
+			    << "}\n\n";
+			out << "template<" << configNamespace << "Executor E>\n"
+			    << "inline " << future
+			    << " make_config_async(const std::filesystem::path &path, E "
+			       "&executor) {"
+			    << "return " << configNamespace << "load_config_async<"
+			    << configClass << ">(path, executor, " << load << ");"
+			    << "}\n\n";
+			out << "inline " << future
+			    << " make_config_async(const std::filesystem::path &path) {"
+			    << "return make_config_async(path, " << configNamespace
+			    << "ThreadPool::global());"
+			    << "}\n\n";
+			out << "template<" << configNamespace << "Executor E>\n"
+			    << "inline std::vector<" << future << "> "
+			    << "make_configs_async(std::span<const std::filesystem::path> "
+			       "paths, E &executor) {"
+			    << "return " << configNamespace << "load_configs_async<"
+			    << configClass << ">(paths, executor, " << load << ");"
+			    << "}\n\n";
+			out << "inline std::vector<" << future << "> "
+			    << "make_configs_async(std::span<const std::filesystem::path> "
+			       "paths) {"
+			    << "return make_configs_async(paths, " << configNamespace
+			    << "ThreadPool::global());"
+			    << "}\n\n";
+		}
+		// Cached loaders, which skip validation of configs that passed on
+		// an earlier run.  The key covers the schema, every check that
+		// `make_config` runs and the version of the generator's pattern
+		// compiler, so changing any of them invalidates the cache.
+		if (validationCache)
+		{
+			char schemaHash[19];
+			snprintf(schemaHash,
+			         sizeof(schemaHash),
+			         "0x%016llx",
+			         static_cast<unsigned long long>(hash_bytes(
+			           schema.data(),
+			           schema.size(),
+			           hash_bytes(validate.data(),
+			                      validate.size(),
+			                      CheckerVersion))));
+			out << "/** Hash of the schema and checks used by make_config. */\n"
+			    << "inline constexpr uint64_t embedded_schema_hash = "
+			    << schemaHash << "ULL;\n\n";
+			std::string trust = std::string("[&](ucl_object_t *obj) {") +
+			                    configNamespace + "ObservedPhase phase(observer, " +
+			                    configNamespace + "LoadPhase::Materialize);\n" +
+			                    "return " + configClass + "(obj); }";
+			out << "template<" << configNamespace << "LoadObserver O>\n"
+			    << "inline std::variant<" << configClass << ", "
+			    << configNamespace << "LoadError> "
+			    << "load_config(const std::filesystem::path &path, "
+			    << configNamespace << "ValidationCache &cache, O &observer) {"
+			    << "return " << configNamespace << "load_config_cached<"
+			    << configClass
+			    << ">(path, cache, embedded_schema_hash, [&](ucl_object_t "
+			       "*obj) { return make_config(obj, observer); }, "
+			    << trust << ", observer);"
+			    << "}\n\n";
+			out << "inline std::variant<" << configClass << ", "
+			    << configNamespace << "LoadError> "
+			    << "load_config(const std::filesystem::path &path, "
+			    << configNamespace << "ValidationCache &cache) {"
+			    << configNamespace << "NullObserver observer;\n"
+			    << "return load_config(path, cache, observer);\n"
+			    << "}\n\n";
+			out << "template<" << configNamespace << "Executor E, "
+			    << configNamespace << "LoadObserver O>\n"
+			    << "inline std::vector<std::variant<" << configClass << ", "
+			    << configNamespace << "LoadError>> "
+			    << "load_configs(std::span<const std::filesystem::path> paths, "
+			       "E &executor, "
+			    << configNamespace << "ValidationCache &cache, O &observer) {"
+			    << "return " << configNamespace << "load_configs_cached<"
+			    << configClass
+			    << ">(paths, executor, cache, embedded_schema_hash, "
+			       "[&](ucl_object_t *obj) { return make_config(obj, "
+			       "observer); }, "
+			    << trust << ", observer);"
+			    << "}\n\n";
+			out << "template<" << configNamespace << "Executor E>\n"
+			    << "inline std::vector<std::variant<" << configClass << ", "
+			    << configNamespace << "LoadError>> "
+			    << "load_configs(std::span<const std::filesystem::path> paths, "
+			       "E &executor, "
+			    << configNamespace << "ValidationCache &cache) {"
+			    << configNamespace << "NullObserver observer;\n"
+			    << "return load_configs(paths, executor, cache, observer);\n"
+			    << "}\n\n";
+		}
 	}
 	out << "#ifdef CONFIG_NAMESPACE_END\nCONFIG_NAMESPACE_END\n#endif\n\n";
 }
@@ -3,10 +3,17 @@
 #pragma once
 
 #include <algorithm>
+#include <array>
 #include <assert.h>
 #include <chrono>
+#include <concepts>
+#include <cstring>
 #include <initializer_list>
+#include <optional>
+#include <span>
 #include <string_view>
+#include <tuple>
+#include <type_traits>
 #include <ucl.h>
 #include <unordered_map>
 #include <utility>
@@ -313,11 +320,20 @@ namespace CONFIG_DETAIL_NAMESPACE
 
 		/**
 		 * Implicit cast operator.  Returns a string view representing the
-		 * object.
+		 * object.  Strings are returned in place, using their recorded
+		 * length, so that strings parsed without copying (which are not
+		 * null terminated) are not copied on access.  Other types are
+		 * converted by libucl.
 		 */
 		operator std::string_view()
 		{
-			const char *cstr = ucl_object_tostring(obj);
+			size_t      length;
+			const char *cstr = ucl_object_tolstring(obj, &length);
+			if (cstr != nullptr)
+			{
+				return {cstr, length};
+			}
+			cstr = ucl_object_tostring(obj);
 			if (cstr != nullptr)
 			{
 				return cstr;
@@ -507,7 +523,7 @@ namespace CONFIG_DETAIL_NAMESPACE
 		 * The type of a value.  All of the key-value pairs must refer to the
 		 * same `enum` type.
 		 */
-		using Value = std::remove_reference_t<decltype(get<0>(kvps).val)>;
+		using Value = std::remove_reference_t<decltype(std::get<0>(kvps).val)>;
 
 		/**
 		 * Look up a key.  This is `constexpr` and can be compile-time
@@ -527,12 +543,12 @@ namespace CONFIG_DETAIL_NAMESPACE
 			static_assert(
 			  std::is_same_v<
 			    Value,
-			    std::remove_reference_t<decltype(get<Element>(kvps).val)>>,
+			    std::remove_reference_t<decltype(std::get<Element>(kvps).val)>>,
 			  "All entries must use the same enum value");
 			// Re
-			if (key == get<Element>(kvps).key())
+			if (key == std::get<Element>(kvps).key())
 			{
-				return get<Element>(kvps).val;
+				return std::get<Element>(kvps).val;
 			}
 			if constexpr (Element + 1 < std::tuple_size_v<KVPs>)
 			{
@@ -580,7 +596,7 @@ namespace CONFIG_DETAIL_NAMESPACE
 		 */
 		operator EnumType()
 		{
-			return Map::get(ucl_object_tostring(obj));
+			return Map::get(StringViewAdaptor(obj));
 		}
 	};
 
@@ -730,11 +746,19 @@ namespace CONFIG_DETAIL_NAMESPACE
 		PropertyAdaptor(const ucl_object_t *o) : Adaptor(o) {}
 
 		/**
-		 * Provide the key as a string view.
+		 * Provide the key as a string view.  The key is returned in place,
+		 * using its recorded length: `ucl_object_key` would copy a key that
+		 * was parsed without copying into the node, which readers share.
 		 */
 		std::string_view key()
 		{
-			return ucl_object_key(Adaptor::obj);
+			size_t      length;
+			const char *key = ucl_object_keyl(Adaptor::obj, &length);
+			if (key == nullptr)
+			{
+				return std::string_view("", 0);
+			}
+			return {key, length};
 		}
 	};
 
@@ -753,4 +777,485 @@ namespace CONFIG_DETAIL_NAMESPACE
 		return Adaptor(o);
 	}
 
+	/**
+	 * Concept for the storage backends that generated classes can read
+	 * configs from.  A backend provides:
+	 *
+	 *  - `Node`, a cheap handle to a value, which may be null.  Adaptors and
+	 *    generated classes are constructed from nodes.
+	 *  - `Ptr`, the handle stored in generated classes.  It is constructible
+	 *    from a node, keeps the value alive, and is indexed by key to look up
+	 *    a property, giving something convertible to a null node if the
+	 *    property is absent.
+	 *  - `Range<T, Adaptor>`, a range over the elements of an array node that
+	 *    uses `Adaptor` to expose each element as a `T`.
+	 *  - Static functions that test a node for null and convert it to a
+	 *    string, integer, floating-point or boolean value.
+	 *
+	 * `UCLBackend` is the default.
+	 */
+	template<typename B>
+	concept Backend = requires(typename B::Node node, const typename B::Ptr &ptr)
+	{
+		requires std::constructible_from<typename B::Ptr, typename B::Node>;
+		{
+			ptr["key"]
+			} -> std::convertible_to<typename B::Node>;
+		{
+			B::is_null(node)
+			} -> std::convertible_to<bool>;
+		{
+			B::to_string(node)
+			} -> std::convertible_to<std::string_view>;
+		{
+			B::to_int(node)
+			} -> std::convertible_to<int64_t>;
+		{
+			B::to_double(node)
+			} -> std::convertible_to<double>;
+		{
+			B::to_bool(node)
+			} -> std::convertible_to<bool>;
+	};
+
+	/**
+	 * Backend that reads configs from libucl objects.
+	 */
+	struct UCLBackend
+	{
+		/**
+		 * Nodes are non-owning pointers to UCL objects.
+		 */
+		using Node = const ucl_object_t *;
+
+		/**
+		 * Generated classes hold a reference to their object.
+		 */
+		using Ptr = UCLPtr;
+
+		/**
+		 * Arrays are exposed as UCL ranges.
+		 */
+		template<typename T, typename Adaptor>
+		using Range = CONFIG_DETAIL_NAMESPACE::Range<T, Adaptor, true>;
+
+		/**
+		 * Returns true if `node` is absent.
+		 */
+		static bool is_null(Node node)
+		{
+			return node == nullptr;
+		}
+
+		/**
+		 * Returns the value of `node` as a string.
+		 */
+		static std::string_view to_string(Node node)
+		{
+			return StringViewAdaptor(node);
+		}
+
+		/**
+		 * Returns the value of `node` as an integer.
+		 */
+		static int64_t to_int(Node node)
+		{
+			return ucl_object_toint(node);
+		}
+
+		/**
+		 * Returns the value of `node` as a floating-point number.
+		 */
+		static double to_double(Node node)
+		{
+			return ucl_object_todouble(node);
+		}
+
+		/**
+		 * Returns the value of `node` as a boolean.
+		 */
+		static bool to_bool(Node node)
+		{
+			return ucl_object_toboolean(node);
+		}
+	};
+
+	/**
+	 * Adaptor that exposes a node from backend `B` as a scalar of type `T`,
+	 * which may be a boolean, an integer, a floating-point type or a string
+	 * view.
+	 *
+	 * Adaptors are intended to be short-lived, created only as temporaries,
+	 * and must not outlive the object that they are adapting.
+	 */
+	template<typename T, Backend B>
+	class ValueAdaptor
+	{
+		/**
+		 * The node that this adaptor is wrapping.
+		 */
+		typename B::Node obj;
+
+		public:
+		/**
+		 * Constructor, captures a non-owning reference to a node.
+		 */
+		ValueAdaptor(typename B::Node o) : obj(o) {}
+
+		/**
+		 * Implicit conversion operator, returns the node's value as a `T`.
+		 */
+		operator T()
+		{
+			if constexpr (std::is_same_v<T, bool>)
+			{
+				return B::to_bool(obj);
+			}
+			else if constexpr (std::is_integral_v<T>)
+			{
+				return static_cast<T>(B::to_int(obj));
+			}
+			else if constexpr (std::is_floating_point_v<T>)
+			{
+				return static_cast<T>(B::to_double(obj));
+			}
+			else
+			{
+				return B::to_string(obj);
+			}
+		}
+	};
+
+	/**
+	 * Adaptor that exposes a node from backend `B` as the node itself, used
+	 * to collect the nodes of an array's elements.
+	 */
+	template<Backend B>
+	class NodeAdaptor
+	{
+		/**
+		 * The node that this adaptor is wrapping.
+		 */
+		typename B::Node obj;
+
+		public:
+		/**
+		 * Constructor, captures a non-owning reference to a node.
+		 */
+		NodeAdaptor(typename B::Node o) : obj(o) {}
+
+		/**
+		 * Implicit conversion operator, returns the node.
+		 */
+		operator typename B::Node()
+		{
+			return obj;
+		}
+	};
+
+	/**
+	 * Adaptor that exposes an array node from backend `B` as a fixed-size
+	 * value of type `T`, which is either a `std::array` or a `std::tuple` of
+	 * scalars.  Element `i` is converted to the type of element `i` of `T`
+	 * with `ValueAdaptor`.  Elements beyond the size of `T` are ignored and
+	 * elements missing from the array are value initialised, though neither
+	 * can happen in arrays that have been validated against a schema with
+	 * the matching `minItems` and `maxItems`.
+	 *
+	 * Adaptors are intended to be short-lived, created only as temporaries,
+	 * and must not outlive the object that they are adapting.
+	 */
+	template<typename T, Backend B = UCLBackend>
+	class FixedArrayAdaptor
+	{
+		/**
+		 * The number of elements in `T`.
+		 */
+		static constexpr size_t Size = std::tuple_size_v<T>;
+
+		/**
+		 * The node that this adaptor is wrapping.
+		 */
+		typename B::Node obj;
+
+		/**
+		 * Converts the first `count` elements of `nodes` into the elements
+		 * of `result` with the same index.
+		 */
+		template<size_t... I>
+		static void convert(T                                         &result,
+		                    const std::array<typename B::Node, Size> &nodes,
+		                    size_t                                     count,
+		                    std::index_sequence<I...>)
+		{
+			((I < count ? void(std::get<I>(result) =
+			                     ValueAdaptor<std::tuple_element_t<I, T>, B>(
+			                       nodes[I]))
+			            : void()),
+			 ...);
+		}
+
+		public:
+		/**
+		 * Constructor, captures a non-owning reference to a node.
+		 */
+		FixedArrayAdaptor(typename B::Node o) : obj(o) {}
+
+		/**
+		 * Implicit conversion operator, copies the elements of the array
+		 * into a `T`.
+		 */
+		operator T()
+		{
+			std::array<typename B::Node, Size> nodes{};
+			size_t                             count = 0;
+			if constexpr (std::is_same_v<B, UCLBackend>)
+			{
+				// Iterate without the allocation that `Range` needs.
+				ucl_object_iter_t it = nullptr;
+				while (auto *node = ucl_object_iterate(obj, &it, true))
+				{
+					if (count == Size)
+					{
+						break;
+					}
+					nodes[count++] = node;
+				}
+			}
+			else if (!B::is_null(obj))
+			{
+				typename B::template Range<typename B::Node, NodeAdaptor<B>>
+				  elements(obj);
+				for (auto node : elements)
+				{
+					if (count == Size)
+					{
+						break;
+					}
+					nodes[count++] = node;
+				}
+			}
+			T result{};
+			convert(result, nodes, count, std::make_index_sequence<Size>());
+			return result;
+		}
+	};
+
+	/**
+	 * Helper to construct a value from a node of backend `B` if it exists.
+	 * Equivalent to the UCL version of `make_optional`.
+	 */
+	template<typename Adaptor, typename T, Backend B>
+	std::optional<T> make_optional(typename B::Node o)
+	{
+		if (B::is_null(o))
+		{
+			return {};
+		}
+		return Adaptor(o);
+	}
+
+	/**
+	 * Version of the checks that run after libucl's schema validation: the
+	 * format parsers in `config-format.h` and the pattern matchers that the
+	 * generator compiles with `config-pattern.h`.  Validation caches mix
+	 * this into their keys, so it must be incremented whenever a change to
+	 * these checks could reject a config that they accepted before.
+	 */
+	inline constexpr uint64_t CheckerVersion = 1;
+
+	/**
+	 * Finalisation step for 64-bit hashes, mixes all of the bits of `h` so
+	 * that similar inputs give very different outputs.
+	 */
+	constexpr uint64_t hash_mix(uint64_t h)
+	{
+		h ^= h >> 33;
+		h *= 0xff51afd7ed558ccdULL;
+		h ^= h >> 33;
+		h *= 0xc4ceb9fe1a85ec53ULL;
+		h ^= h >> 33;
+		return h;
+	}
+
+	/**
+	 * Hashes `len` bytes starting at `data`.  This is a fast non-cryptographic
+	 * hash, suitable for hash tables but not for untrusted input.
+	 */
+	inline uint64_t hash_bytes(const void *data, size_t len, uint64_t seed = 0)
+	{
+		auto    *p = static_cast<const unsigned char *>(data);
+		uint64_t h = seed ^ (len * 0x9e3779b97f4a7c15ULL);
+		for (; len >= 8; len -= 8, p += 8)
+		{
+			uint64_t word;
+			memcpy(&word, p, 8);
+			h = hash_mix(h ^ word) * 0x9e3779b97f4a7c15ULL;
+		}
+		uint64_t tail = 0;
+		memcpy(&tail, p, len);
+		return hash_mix(h ^ tail);
+	}
+
+	/**
+	 * Hashes the value of a single UCL node.  Scalars are hashed directly;
+	 * for collections, `child` is called for each element and must return a
+	 * hash of that element including its key (see `hash_keyed`).  Arrays are
+	 * hashed in order, objects independently of the order of their keys.
+	 */
+	template<typename ChildHash>
+	uint64_t hash_value(const ucl_object_t *obj, ChildHash &&child)
+	{
+		auto     type = ucl_object_type(obj);
+		uint64_t h    = hash_mix(static_cast<uint64_t>(type) + 1);
+		switch (type)
+		{
+			case UCL_STRING:
+			{
+				size_t      len;
+				const char *str = ucl_object_tolstring(obj, &len);
+				return hash_bytes(str, len, h);
+			}
+			case UCL_INT:
+			case UCL_BOOLEAN:
+				return hash_mix(h ^ static_cast<uint64_t>(obj->value.iv));
+			case UCL_FLOAT:
+			case UCL_TIME:
+			{
+				uint64_t bits;
+				memcpy(&bits, &obj->value.dv, sizeof(bits));
+				return hash_mix(h ^ bits);
+			}
+			case UCL_ARRAY:
+			case UCL_OBJECT:
+			{
+				uint64_t          sum = 0;
+				ucl_object_iter_t it  = nullptr;
+				while (auto *c = ucl_object_iterate(obj, &it, true))
+				{
+					if (type == UCL_ARRAY)
+					{
+						h = hash_mix(h ^ child(c));
+					}
+					else
+					{
+						sum += child(c);
+					}
+				}
+				return hash_mix(h ^ sum);
+			}
+			default:
+				return h;
+		}
+	}
+
+	/**
+	 * Combines the hash of a node's value with its key, if it has one.
+	 */
+	inline uint64_t hash_keyed(const ucl_object_t *obj, uint64_t valueHash)
+	{
+		size_t      len;
+		const char *key = ucl_object_keyl(obj, &len);
+		if (key == nullptr)
+		{
+			return valueHash;
+		}
+		return hash_mix(hash_bytes(key, len, valueHash));
+	}
+
+	/**
+	 * A step on the path from the root of a config to a string property,
+	 * used by generated code that checks the strings that a schema
+	 * constrains beyond what libucl checks.
+	 */
+	struct PathStep
+	{
+		/**
+		 * The kinds of step.
+		 */
+		enum Kind : uint8_t
+		{
+			/**
+			 * The property `key` of an object.
+			 */
+			Property,
+
+			/**
+			 * Every element of an array.
+			 */
+			Elements,
+
+			/**
+			 * Element `index` of a tuple.
+			 */
+			Element
+		};
+
+		/**
+		 * The kind of step.
+		 */
+		Kind kind;
+
+		/**
+		 * The key, for `Property` steps.
+		 */
+		std::string_view key = {};
+
+		/**
+		 * The index, for `Element` steps.
+		 */
+		uint32_t index = 0;
+	};
+
+	/**
+	 * Calls `check` with each string at the end of `path`, starting from
+	 * `node`, and its value, stopping at the first for which it returns
+	 * false.  Absent properties and values that are not strings are skipped,
+	 * because the schema has already been checked.  Returns false if
+	 * `check` did.
+	 */
+	template<typename F>
+	bool check_strings(const ucl_object_t          *node,
+	                   std::span<const PathStep>    path,
+	                   F                          &&check)
+	{
+		if (node == nullptr)
+		{
+			return true;
+		}
+		if (path.empty())
+		{
+			size_t      length;
+			const char *str = ucl_object_tolstring(node, &length);
+			return (ucl_object_type(node) != UCL_STRING) ||
+			       check(node, std::string_view{str, length});
+		}
+		auto &step = path.front();
+		auto  rest = path.subspan(1);
+		switch (step.kind)
+		{
+			case PathStep::Property:
+				return check_strings(
+				  ucl_object_lookup_len(node, step.key.data(), step.key.size()),
+				  rest,
+				  check);
+			case PathStep::Element:
+				return check_strings(
+				  ucl_array_find_index(node, step.index), rest, check);
+			case PathStep::Elements:
+			{
+				ucl_object_iter_t it = nullptr;
+				while (auto *element = ucl_object_iterate(node, &it, true))
+				{
+					if (!check_strings(element, rest, check))
+					{
+						return false;
+					}
+				}
+				return true;
+			}
+		}
+		return true;
+	}
+
 } // namespace CONFIG_DETAIL_NAMESPACE
@@ -0,0 +1,227 @@
+// Copyright David Chisnall
+// SPDX-License-Identifier: MIT
+#pragma once
+
+#include "config-generic.h"
+#include <array>
+#include <concepts>
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+namespace CONFIG_DETAIL_NAMESPACE
+{
+	/**
+	 * The hash of an absent optional property.
+	 */
+	constexpr uint64_t AbsentHash = 0x2545f4914f6cdd1dULL;
+
+	/**
+	 * Hashes a string.
+	 */
+	inline uint64_t hash_of(std::string_view str)
+	{
+		return hash_bytes(str.data(), str.size(), 0x73);
+	}
+
+	/**
+	 * Hashes a boolean or integer.  Integers of different types with the same
+	 * value hash the same.
+	 */
+	template<std::integral T>
+	uint64_t hash_of(T value)
+	{
+		return hash_mix(static_cast<uint64_t>(value) ^ 0x69);
+	}
+
+	/**
+	 * Hashes a floating-point number.  Positive and negative zero compare
+	 * equal, so they hash the same.
+	 */
+	template<std::floating_point T>
+	uint64_t hash_of(T value)
+	{
+		double   d = (value == 0) ? 0.0 : double(value);
+		uint64_t bits;
+		memcpy(&bits, &d, sizeof(bits));
+		return hash_mix(bits ^ 0x66);
+	}
+
+	/**
+	 * Hashes a generated config class.
+	 */
+	template<typename T>
+	requires requires(const T &value)
+	{
+		{
+			value.hash()
+			} -> std::convertible_to<uint64_t>;
+	}
+	uint64_t hash_of(const T &value)
+	{
+		return value.hash();
+	}
+
+	/**
+	 * Concept for the ranges that generated classes use for arrays.
+	 */
+	template<typename T>
+	concept ConfigRange =
+	  !std::is_convertible_v<T, std::string_view> && requires(T &range)
+	{
+		range.begin();
+		range.end();
+	};
+
+	/**
+	 * Hashes an array.  Order is significant.
+	 */
+	template<ConfigRange T>
+	uint64_t hash_of(const T &value)
+	{
+		T        range = value;
+		uint64_t h     = 0x61;
+		for (auto item : range)
+		{
+			h = hash_mix(h ^ hash_of(item)) * 0x9e3779b97f4a7c15ULL;
+		}
+		return hash_mix(h);
+	}
+
+	/**
+	 * Hashes a tuple.  A tuple hashes the same as an array of the same
+	 * values.
+	 */
+	template<typename... T>
+	uint64_t hash_of(const std::tuple<T...> &value)
+	{
+		uint64_t h = 0x61;
+		std::apply(
+		  [&](const auto &...item) {
+			  ((h = hash_mix(h ^ hash_of(item)) * 0x9e3779b97f4a7c15ULL), ...);
+		  },
+		  value);
+		return hash_mix(h);
+	}
+
+	/**
+	 * Hashes an optional property.
+	 */
+	template<typename T>
+	uint64_t hash_of(const std::optional<T> &value)
+	{
+		return value ? hash_of(*value) : AbsentHash;
+	}
+
+	/**
+	 * Combines the hashes of the properties of an object, given in schema
+	 * order.  Because the order comes from the schema, the result does not
+	 * depend on the order of keys in the config.
+	 */
+	inline uint64_t hash_properties(std::span<const uint64_t> hashes)
+	{
+		uint64_t h = hashes.size();
+		for (auto property : hashes)
+		{
+			h = hash_mix(h ^ property) * 0x9e3779b97f4a7c15ULL;
+		}
+		return hash_mix(h);
+	}
+
+	/**
+	 * Compares two scalars or generated config classes.
+	 */
+	template<typename T>
+	bool values_equal(const T &a, const T &b)
+	{
+		return a == b;
+	}
+
+	/**
+	 * Compares two arrays, element by element.
+	 */
+	template<ConfigRange T>
+	bool values_equal(const T &left, const T &right)
+	{
+		T    a  = left;
+		T    b  = right;
+		auto ai = a.begin();
+		auto ae = a.end();
+		auto bi = b.begin();
+		auto be = b.end();
+		for (; (ai != ae) && (bi != be); ++ai, ++bi)
+		{
+			if (!values_equal(*ai, *bi))
+			{
+				return false;
+			}
+		}
+		return !(ai != ae) && !(bi != be);
+	}
+
+	/**
+	 * Compares two optional properties.
+	 */
+	template<typename T>
+	bool values_equal(const std::optional<T> &a, const std::optional<T> &b)
+	{
+		if (a.has_value() != b.has_value())
+		{
+			return false;
+		}
+		return !a || values_equal(*a, *b);
+	}
+
+	/**
+	 * Property hashes cached by a root config class when it is constructed.
+	 */
+	template<size_t N>
+	struct CachedHashes
+	{
+		/**
+		 * The hash of each property, in schema order.
+		 */
+		std::array<uint64_t, N> properties;
+
+		/**
+		 * The hash of the whole config.
+		 */
+		uint64_t hash;
+
+		/**
+		 * Constructor, caches `p` and combines it into the hash of the
+		 * config.
+		 */
+		explicit CachedHashes(const std::array<uint64_t, N> &p)
+		  : properties(p), hash(hash_properties(p))
+		{
+		}
+	};
+
+	/**
+	 * Returns the names of the properties whose hashes differ between `a` and
+	 * `b`, given the property names in schema order.
+	 */
+	template<size_t N>
+	std::vector<std::string_view>
+	changed_properties(std::span<const std::string_view, N> names,
+	                   const std::array<uint64_t, N>       &a,
+	                   const std::array<uint64_t, N>       &b)
+	{
+		std::vector<std::string_view> changed;
+		for (size_t i = 0; i < N; i++)
+		{
+			if (a[i] != b[i])
+			{
+				changed.push_back(names[i]);
+			}
+		}
+		return changed;
+	}
+
+} // namespace CONFIG_DETAIL_NAMESPACE
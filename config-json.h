@@ -0,0 +1,383 @@
+// Copyright David Chisnall
+// SPDX-License-Identifier: MIT
+#pragma once
+
+#include "config-generic.h"
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <span>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <unistd.h>
+
+namespace CONFIG_DETAIL_NAMESPACE
+{
+	/**
+	 * Concept for sinks that JSON can be written to.  A sink must provide a
+	 * `write` method that takes a pointer and a length.
+	 */
+	template<typename T>
+	concept Sink = requires(T &s, const char *data, size_t length)
+	{
+		s.write(data, length);
+	};
+
+	/**
+	 * Sink that writes into a caller-supplied buffer.  Output that does not
+	 * fit is dropped, but still counted, so that the caller can retry with a
+	 * buffer of `size()` bytes.
+	 */
+	class BufferSink
+	{
+		/**
+		 * The buffer.
+		 */
+		std::span<char> buffer;
+
+		/**
+		 * The number of bytes written, including any that did not fit.
+		 */
+		size_t written = 0;
+
+		public:
+		/**
+		 * Constructor, writes into `b`.
+		 */
+		explicit BufferSink(std::span<char> b) : buffer(b) {}
+
+		/**
+		 * Appends `length` bytes from `data`.
+		 */
+		void write(const char *data, size_t length)
+		{
+			if (written < buffer.size())
+			{
+				std::memcpy(buffer.data() + written,
+				            data,
+				            std::min(length, buffer.size() - written));
+			}
+			written += length;
+		}
+
+		/**
+		 * Returns the number of bytes of output, including any that did not
+		 * fit in the buffer.
+		 */
+		size_t size() const
+		{
+			return written;
+		}
+
+		/**
+		 * Returns true if the output did not fit in the buffer.
+		 */
+		bool truncated() const
+		{
+			return written > buffer.size();
+		}
+
+		/**
+		 * Returns the output that fit in the buffer.
+		 */
+		std::string_view view() const
+		{
+			return {buffer.data(), std::min(written, buffer.size())};
+		}
+	};
+
+	/**
+	 * Sink that appends to a string.
+	 */
+	class StringSink
+	{
+		/**
+		 * The string to append to.
+		 */
+		std::string &out;
+
+		public:
+		/**
+		 * Constructor, appends to `s`.
+		 */
+		explicit StringSink(std::string &s) : out(s) {}
+
+		/**
+		 * Appends `length` bytes from `data`.
+		 */
+		void write(const char *data, size_t length)
+		{
+			out.append(data, length);
+		}
+	};
+
+	/**
+	 * Sink that streams to a file descriptor through a fixed-size buffer.
+	 * The buffer is flushed when it fills and when the sink is destroyed.
+	 */
+	class FdSink
+	{
+		/**
+		 * The file descriptor.  Not owned by the sink.
+		 */
+		int fd;
+
+		/**
+		 * The number of bytes in `buffer`.
+		 */
+		size_t used = 0;
+
+		/**
+		 * Set if a write to the file descriptor failed.  Later output is
+		 * discarded.
+		 */
+		bool failed = false;
+
+		/**
+		 * Output that has not yet been written to the file descriptor.
+		 */
+		std::array<char, 16384> buffer;
+
+		/**
+		 * Writes `length` bytes from `data` to the file descriptor.
+		 */
+		void write_fd(const char *data, size_t length)
+		{
+			while (!failed && (length > 0))
+			{
+				ssize_t ret = ::write(fd, data, length);
+				if (ret < 0)
+				{
+					failed = (errno != EINTR);
+					continue;
+				}
+				data += ret;
+				length -= ret;
+			}
+		}
+
+		public:
+		/**
+		 * Constructor, writes to `f`.
+		 */
+		explicit FdSink(int f) : fd(f) {}
+
+		/**
+		 * File descriptor sinks cannot be copied.
+		 */
+		FdSink(const FdSink &) = delete;
+
+		/**
+		 * Destructor, flushes any buffered output.
+		 */
+		~FdSink()
+		{
+			flush();
+		}
+
+		/**
+		 * Appends `length` bytes from `data`.  Writes larger than the buffer
+		 * go straight to the file descriptor.
+		 */
+		void write(const char *data, size_t length)
+		{
+			if (used + length > buffer.size())
+			{
+				flush();
+				if (length > buffer.size())
+				{
+					write_fd(data, length);
+					return;
+				}
+			}
+			std::memcpy(buffer.data() + used, data, length);
+			used += length;
+		}
+
+		/**
+		 * Writes any buffered output to the file descriptor.
+		 */
+		void flush()
+		{
+			write_fd(buffer.data(), used);
+			used = 0;
+		}
+
+		/**
+		 * Returns true if a write to the file descriptor failed.
+		 */
+		bool error() const
+		{
+			return failed;
+		}
+	};
+
+	/**
+	 * Writes a string literal, without its terminating null.
+	 */
+	template<Sink S, size_t N>
+	void write_literal(S &sink, const char (&literal)[N])
+	{
+		sink.write(literal, N - 1);
+	}
+
+	/**
+	 * Writes an object key.  `key` is a literal of the form `,"name":`,
+	 * with the name already escaped.  The leading comma is skipped for the
+	 * first key in an object, tracked by `first`.
+	 */
+	template<Sink S, size_t N>
+	void write_key(S &sink, bool &first, const char (&key)[N])
+	{
+		sink.write(key + first, N - 1 - first);
+		first = false;
+	}
+
+	/**
+	 * Writes `str` as a quoted JSON string.  Runs of characters that do not
+	 * need escaping are written in one call.
+	 */
+	template<Sink S>
+	void write_json_value(S &sink, std::string_view str)
+	{
+		static constexpr char hex[] = "0123456789abcdef";
+		write_literal(sink, "\"");
+		size_t start = 0;
+		for (size_t i = 0; i < str.size(); i++)
+		{
+			unsigned char c = str[i];
+			if ((c >= 0x20) && (c != '"') && (c != '\\'))
+			{
+				continue;
+			}
+			sink.write(str.data() + start, i - start);
+			start = i + 1;
+			switch (c)
+			{
+				case '"':
+					write_literal(sink, "\\\"");
+					break;
+				case '\\':
+					write_literal(sink, "\\\\");
+					break;
+				case '\n':
+					write_literal(sink, "\\n");
+					break;
+				case '\r':
+					write_literal(sink, "\\r");
+					break;
+				case '\t':
+					write_literal(sink, "\\t");
+					break;
+				default:
+				{
+					char escape[] = {
+					  '\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xf]};
+					sink.write(escape, sizeof(escape));
+				}
+			}
+		}
+		sink.write(str.data() + start, str.size() - start);
+		write_literal(sink, "\"");
+	}
+
+	/**
+	 * Writes a boolean.
+	 */
+	template<Sink S>
+	void write_json_value(S &sink, bool value)
+	{
+		if (value)
+		{
+			write_literal(sink, "true");
+		}
+		else
+		{
+			write_literal(sink, "false");
+		}
+	}
+
+	/**
+	 * Writes a number.  Floating-point values are written in the shortest
+	 * form that round trips.  JSON cannot represent infinities or NaNs, so
+	 * they are written as `null`.
+	 */
+	template<Sink S, typename T>
+	requires(std::is_arithmetic_v<T> && !std::is_same_v<T, bool>)
+	void write_json_value(S &sink, T value)
+	{
+		if constexpr (std::is_floating_point_v<T>)
+		{
+			if (!std::isfinite(value))
+			{
+				write_literal(sink, "null");
+				return;
+			}
+		}
+		char buffer[32];
+		auto [end, ec] = std::to_chars(buffer, buffer + sizeof(buffer), value);
+		sink.write(buffer, end - buffer);
+	}
+
+	/**
+	 * Writes a generated config class or materialised struct.
+	 */
+	template<Sink S, typename T>
+	requires requires(const T &value, S &sink)
+	{
+		value.write_json(sink);
+	}
+	void write_json_value(S &sink, const T &value)
+	{
+		value.write_json(sink);
+	}
+
+	/**
+	 * Writes an array, given as any range of values that can be written.
+	 */
+	template<Sink S, typename T>
+	requires(!std::is_convertible_v<T, std::string_view> && requires(T &range) {
+		range.begin();
+		range.end();
+	})
+	void write_json_value(S &sink, T &&range)
+	{
+		bool first = true;
+		write_literal(sink, "[");
+		for (auto &&item : range)
+		{
+			if (!first)
+			{
+				write_literal(sink, ",");
+			}
+			first = false;
+			write_json_value(sink, item);
+		}
+		write_literal(sink, "]");
+	}
+
+	/**
+	 * Writes a tuple as an array.
+	 */
+	template<Sink S, typename... T>
+	void write_json_value(S &sink, const std::tuple<T...> &value)
+	{
+		write_literal(sink, "[");
+		std::apply(
+		  [&](const auto &...item) {
+			  bool first = true;
+			  (((first ? void() : write_literal(sink, ",")),
+			    write_json_value(sink, item),
+			    first = false),
+			   ...);
+		  },
+		  value);
+		write_literal(sink, "]");
+	}
+
+} // namespace CONFIG_DETAIL_NAMESPACE
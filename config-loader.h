@@ -0,0 +1,2103 @@
+// Copyright David Chisnall
+// SPDX-License-Identifier: MIT
+#pragma once
+
+#include "config-generic.h"
+#include "config-observer.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <future>
+#include <latch>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <queue>
+#include <span>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <variant>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace CONFIG_DETAIL_NAMESPACE
+{
+	/**
+	 * Concept for executors that the loaders can use to run work
+	 * concurrently.  An executor must provide an `execute` method that
+	 * accepts a nullary function and runs it at some point, on some thread.
+	 * Executors may optionally provide a `concurrency()` method returning the
+	 * number of tasks that they can usefully run in parallel.
+	 */
+	template<typename T>
+	concept Executor = requires(T &e, std::function<void()> f)
+	{
+		e.execute(std::move(f));
+	};
+
+	/**
+	 * Executor that runs every task immediately on the calling thread.
+	 */
+	class InlineExecutor
+	{
+		public:
+		/**
+		 * Runs `f` synchronously.
+		 */
+		void execute(std::function<void()> f)
+		{
+			f();
+		}
+
+		/**
+		 * An inline executor runs one task at a time.
+		 */
+		size_t concurrency() const
+		{
+			return 1;
+		}
+	};
+
+	/**
+	 * A simple fixed-size thread pool.  Tasks are run in FIFO order by the
+	 * first idle worker.  The destructor waits for all queued tasks to finish.
+	 */
+	class ThreadPool
+	{
+		/**
+		 * The worker threads.
+		 */
+		std::vector<std::thread> workers;
+
+		/**
+		 * Tasks that have been submitted but not yet started.
+		 */
+		std::queue<std::function<void()>> tasks;
+
+		/**
+		 * Lock protecting `tasks` and `stopping`.
+		 */
+		std::mutex lock;
+
+		/**
+		 * Condition variable used to wake idle workers.
+		 */
+		std::condition_variable wake;
+
+		/**
+		 * Set when the pool is being destroyed.
+		 */
+		bool stopping = false;
+
+		/**
+		 * The pool that owns the current thread, or null if it is not a
+		 * worker.
+		 */
+		static inline thread_local ThreadPool *current = nullptr;
+
+		/**
+		 * The body of each worker thread.
+		 */
+		void run()
+		{
+			current = this;
+			while (true)
+			{
+				std::function<void()> task;
+				{
+					std::unique_lock g(lock);
+					wake.wait(g, [&]() { return stopping || !tasks.empty(); });
+					if (tasks.empty())
+					{
+						return;
+					}
+					task = std::move(tasks.front());
+					tasks.pop();
+				}
+				task();
+			}
+		}
+
+		public:
+		/**
+		 * Constructor.  Creates a pool with `threads` workers, defaulting to
+		 * one per hardware thread.
+		 */
+		ThreadPool(size_t threads = std::thread::hardware_concurrency())
+		{
+			threads = std::max<size_t>(threads, 1);
+			workers.reserve(threads);
+			for (size_t i = 0; i < threads; i++)
+			{
+				workers.emplace_back([this]() { run(); });
+			}
+		}
+
+		/**
+		 * Thread pools cannot be copied.
+		 */
+		ThreadPool(const ThreadPool &) = delete;
+
+		/**
+		 * Returns a process-wide pool with one worker per hardware thread,
+		 * which is created the first time that it is used.
+		 */
+		static ThreadPool &global()
+		{
+			static ThreadPool pool;
+			return pool;
+		}
+
+		/**
+		 * Destructor.  Finishes all queued work and then joins the workers.
+		 */
+		~ThreadPool()
+		{
+			{
+				std::lock_guard g(lock);
+				stopping = true;
+			}
+			wake.notify_all();
+			for (auto &w : workers)
+			{
+				w.join();
+			}
+		}
+
+		/**
+		 * Queues `f` to run on one of the worker threads.
+		 */
+		void execute(std::function<void()> f)
+		{
+			{
+				std::lock_guard g(lock);
+				tasks.push(std::move(f));
+			}
+			wake.notify_one();
+		}
+
+		/**
+		 * Returns the number of worker threads.
+		 */
+		size_t concurrency() const
+		{
+			return workers.size();
+		}
+
+		/**
+		 * Returns true if the calling thread is one of this pool's workers.
+		 * A task that waited for other tasks on the same pool could wait for
+		 * ever if every worker did the same.
+		 */
+		bool is_worker() const
+		{
+			return current == this;
+		}
+	};
+
+	/**
+	 * Returns the number of tasks that `executor` can usefully run in
+	 * parallel.  Uses the executor's `concurrency()` method if it has one,
+	 * otherwise assumes one task per hardware thread.
+	 */
+	template<Executor E>
+	size_t executor_concurrency(E &executor)
+	{
+		if constexpr (requires { executor.concurrency(); })
+		{
+			return std::max<size_t>(executor.concurrency(), 1);
+		}
+		else
+		{
+			return std::max<unsigned>(std::thread::hardware_concurrency(), 1);
+		}
+	}
+
+	/**
+	 * Error from loading a config.  Either the input could not be read or
+	 * parsed, in which case `code` is `UCL_SCHEMA_UNKNOWN` and `object` is
+	 * null, or it was parsed but failed schema validation.
+	 */
+	struct LoadError
+	{
+		/**
+		 * The error code.  `UCL_SCHEMA_UNKNOWN` for parse errors, otherwise
+		 * the code reported by the schema validator.
+		 */
+		ucl_schema_error_code code = UCL_SCHEMA_UNKNOWN;
+
+		/**
+		 * Human-readable description of the error.
+		 */
+		std::string message;
+
+		/**
+		 * The object that failed validation, if any.  This holds a reference
+		 * so that it remains valid after the rest of the tree is discarded.
+		 */
+		UCLPtr object;
+
+		/**
+		 * The memory that `object` refers to, if it was parsed without
+		 * copying strings.
+		 */
+		std::shared_ptr<const void> storage;
+
+		/**
+		 * Constructs an error for input that could not be parsed.
+		 */
+		LoadError(std::string m) : message(std::move(m)) {}
+
+		/**
+		 * Constructs an error from a schema validation failure.
+		 */
+		LoadError(const ucl_schema_error &err)
+		  : code(err.code), message(err.msg), object(err.obj)
+		{
+		}
+	};
+
+	/**
+	 * Returns an owning reference to a new object whose only property is
+	 * `node`, under the key that `node` already has.  Merging the result
+	 * into another object with `ucl_object_merge` adds a reference to `node`
+	 * without writing to it, unlike `ucl_object_insert_key`, which sets the
+	 * key of the node that it inserts.  This is how nodes that other threads
+	 * may be reading are added to an object, but the wrapper itself must be
+	 * built before `node` is shared.
+	 */
+	inline ucl_object_t *wrap_property(ucl_object_t *node)
+	{
+		size_t        len;
+		const char   *key     = ucl_object_keyl(node, &len);
+		ucl_object_t *wrapper = ucl_object_typed_new(UCL_OBJECT);
+		ucl_object_insert_key(wrapper, ucl_object_ref(node), key, len, false);
+		return wrapper;
+	}
+
+	/**
+	 * Adds the property of `wrapper`, which was returned by
+	 * `wrap_property`, to `target`, which must not already have its key.
+	 */
+	inline void insert_wrapped(ucl_object_t *target, const ucl_object_t *wrapper)
+	{
+		ucl_object_merge(target, const_cast<ucl_object_t *>(wrapper), false);
+	}
+
+	/**
+	 * Cache of the files that configs include with the `include` and
+	 * `try_include` macros, for fleets of configs that include the same large
+	 * fragments.  Parsers created by the cache handle these macros
+	 * themselves: each fragment is parsed once and its top-level values are
+	 * inserted by reference into the object that includes it, so every
+	 * config that includes a fragment shares its nodes rather than holding a
+	 * copy.  Fragments are keyed by canonical path and parsed again if the
+	 * file's size, modification time or inode changes.
+	 *
+	 * Shared nodes must not be modified, so they are added through wrappers
+	 * that the cache builds when it parses the fragment (see
+	 * `wrap_property`) rather than with `ucl_object_insert_key`, which would
+	 * write their keys.  Keys that the including file sets again after the
+	 * include are handled by libucl, which makes an explicit array holding
+	 * the shared node without writing to it.
+	 *
+	 * Anything else that libucl's include would resolve by combining nodes
+	 * falls back to libucl: a fragment key that the including object already
+	 * has, a fragment that repeats a top-level key, or a macro argument other
+	 * than `try`, such as `priority`, `duplicate` or `prefix`.  The whole
+	 * config is then parsed again by a parser with libucl's own include
+	 * handler, so it gets exactly libucl's semantics and shares nothing.
+	 * Parsers that allow implicit arrays would link duplicates to shared
+	 * nodes, so they always use libucl's include.
+	 */
+	class FragmentCache
+	{
+		/**
+		 * The identity of a file that a fragment was parsed from.
+		 */
+		struct FileIdentity
+		{
+			/**
+			 * The canonical path of the file.
+			 */
+			std::string path;
+
+			/**
+			 * The device holding the file.
+			 */
+			dev_t device = 0;
+
+			/**
+			 * The file's inode, which changes if the file is replaced.
+			 */
+			ino_t inode = 0;
+
+			/**
+			 * The file's size.
+			 */
+			off_t size = 0;
+
+			/**
+			 * The file's modification time.
+			 */
+			struct timespec modified = {};
+
+			/**
+			 * Constructor, records the identity of the file at `p`, which
+			 * `sb` describes.
+			 */
+			FileIdentity(std::string p, const struct stat &sb)
+			  : path(std::move(p)),
+			    device(sb.st_dev),
+			    inode(sb.st_ino),
+			    size(sb.st_size),
+			    modified(sb.st_mtim)
+			{
+			}
+
+			/**
+			 * Returns true if `sb` describes this file, unchanged.
+			 */
+			bool is_current(const struct stat &sb) const
+			{
+				return (device == sb.st_dev) && (inode == sb.st_ino) &&
+				       (size == sb.st_size) &&
+				       (modified.tv_sec == sb.st_mtim.tv_sec) &&
+				       (modified.tv_nsec == sb.st_mtim.tv_nsec);
+			}
+
+			/**
+			 * Returns true if the file has not changed.
+			 */
+			bool is_current() const
+			{
+				struct stat sb;
+				return (stat(path.c_str(), &sb) == 0) && is_current(sb);
+			}
+		};
+
+		/**
+		 * A parsed fragment and the files that it was parsed from: the
+		 * fragment itself, followed by every file that it includes, directly
+		 * or indirectly.
+		 */
+		struct Fragment
+		{
+			/**
+			 * Owning reference to an array that holds, for each top-level
+			 * property of the parsed tree, a `wrap_property` wrapper.  The
+			 * wrappers are built before the fragment is shared, so that
+			 * includes can add its properties without writing to them.
+			 */
+			ucl_object_t *properties = nullptr;
+
+			/**
+			 * The files that the tree was parsed from.
+			 */
+			std::vector<FileIdentity> files;
+
+			/**
+			 * Returns true if none of the files has changed since the
+			 * fragment was parsed.  The fragment's own file has already been
+			 * checked against `sb`.
+			 */
+			bool is_current(const struct stat &sb) const
+			{
+				return files.front().is_current(sb) &&
+				       std::all_of(files.begin() + 1,
+				                   files.end(),
+				                   [](auto &file) { return file.is_current(); });
+			}
+		};
+
+		/**
+		 * The state of one include macro handler for one parse.
+		 */
+		struct Includer
+		{
+			/**
+			 * The cache that fragments are found in.
+			 */
+			FragmentCache *cache;
+
+			/**
+			 * The flags for parsing fragments.
+			 */
+			int flags;
+
+			/**
+			 * The number of includes that enclose the file being parsed.
+			 */
+			size_t depth;
+
+			/**
+			 * True for `try_include`, which ignores missing files.
+			 */
+			bool optional;
+
+			/**
+			 * The files that the included fragments were parsed from.
+			 */
+			std::vector<FileIdentity> &files;
+
+			/**
+			 * The wrappers through which the handler added fragments'
+			 * properties.  These are already shared, so a fragment that
+			 * includes another reuses them rather than wrapping the
+			 * properties again.
+			 */
+			std::vector<UCLPtr> &wrappers;
+
+			/**
+			 * Set if the config must be parsed with libucl's include
+			 * handler instead.  The handler then fails the parse.
+			 */
+			bool &fallback;
+
+			/**
+			 * The first error reported by the handler.  libucl reports
+			 * only that a macro failed, so this is reported instead.
+			 */
+			std::string error = {};
+
+			/**
+			 * Records `message`, unless an error has already been recorded,
+			 * and returns false.
+			 */
+			bool fail(std::string message)
+			{
+				if (error.empty())
+				{
+					error = std::move(message);
+				}
+				return false;
+			}
+		};
+
+		/**
+		 * The maximum depth of nested includes, which stops include cycles.
+		 */
+		static constexpr size_t MaxDepth = 16;
+
+		/**
+		 * Lock protecting `fragments`.
+		 */
+		std::mutex lock;
+
+		/**
+		 * Parsed fragments, keyed by canonical path.
+		 */
+		std::unordered_map<std::string, Fragment> fragments;
+
+		/**
+		 * The number of includes that found a current fragment.
+		 */
+		std::atomic<size_t> hitCount{0};
+
+		/**
+		 * The number of includes that parsed a fragment.
+		 */
+		std::atomic<size_t> missCount{0};
+
+		/**
+		 * The number of configs that were parsed with libucl's include.
+		 */
+		std::atomic<size_t> fallbackCount{0};
+
+		/**
+		 * Macro handler for `include` and `try_include`.  Inserts the
+		 * top-level values of the fragment named by `data` into `context`,
+		 * or requests a fallback to libucl's include if that would combine
+		 * them with existing values or the macro has arguments that libucl
+		 * would apply.
+		 */
+		static bool include(const unsigned char *data,
+		                    size_t               len,
+		                    const ucl_object_t  *arguments,
+		                    const ucl_object_t  *context,
+		                    void                *ud)
+		{
+			auto       &includer = *static_cast<Includer *>(ud);
+			std::string path{reinterpret_cast<const char *>(data), len};
+			bool        optional = includer.optional;
+			ucl_object_iter_t it = nullptr;
+			while (auto *argument = ucl_object_iterate(arguments, &it, true))
+			{
+				const char *key = ucl_object_key(argument);
+				if ((key != nullptr) && (std::string_view(key) == "try"))
+				{
+					optional = ucl_object_toboolean(argument);
+					continue;
+				}
+				includer.fallback = true;
+				return false;
+			}
+			if ((context == nullptr) || (ucl_object_type(context) != UCL_OBJECT))
+			{
+				return includer.fail(path + ": include outside an object");
+			}
+			if (includer.depth >= MaxDepth)
+			{
+				return includer.fail(path + ": includes nested too deeply");
+			}
+			if (optional && (access(path.c_str(), R_OK) != 0))
+			{
+				return true;
+			}
+			auto fragment = includer.cache->fragment(
+			  path, includer.flags, includer.depth + 1, includer.fallback);
+			if (includer.fallback)
+			{
+				return false;
+			}
+			if (auto *err = std::get_if<LoadError>(&fragment))
+			{
+				return includer.fail(std::move(err->message));
+			}
+			auto &[properties, files] = std::get<Fragment>(fragment);
+			auto *target = const_cast<ucl_object_t *>(context);
+			// Check for duplicates before adding anything, so that a fallback
+			// leaves the object as it was.
+			ucl_object_iter_t fit = nullptr;
+			while (auto *wrapper = ucl_object_iterate(properties, &fit, true))
+			{
+				ucl_object_iter_t wit   = nullptr;
+				auto             *child = ucl_object_iterate(wrapper, &wit, true);
+				size_t            keyLength;
+				const char       *key = ucl_object_keyl(child, &keyLength);
+				if (ucl_object_lookup_len(target, key, keyLength) != nullptr)
+				{
+					ucl_object_unref(properties);
+					includer.fallback = true;
+					return false;
+				}
+			}
+			includer.files.insert(
+			  includer.files.end(), files.begin(), files.end());
+			fit = nullptr;
+			while (auto *wrapper = ucl_object_iterate(properties, &fit, true))
+			{
+				insert_wrapped(target, wrapper);
+				includer.wrappers.emplace_back(wrapper);
+			}
+			ucl_object_unref(properties);
+			return true;
+		}
+
+		/**
+		 * Parses the file at `path`, which is nested inside `depth`
+		 * includes, with a parser that resolves includes through this
+		 * cache, and adds the files that it includes to `files` and the
+		 * wrappers of the properties that it added from them to `wrappers`.
+		 * Returns an owning reference to the parsed object, or a
+		 * `LoadError`.  Sets `fallback` and fails if the config that is
+		 * being loaded must be parsed with libucl's include instead.
+		 */
+		std::variant<ucl_object_t *, LoadError>
+		parse_nested(const std::filesystem::path &path,
+		             int                          flags,
+		             size_t                       depth,
+		             std::vector<FileIdentity>   &files,
+		             std::vector<UCLPtr>         &wrappers,
+		             bool                        &fallback)
+		{
+			Includer required{
+			  this, flags, depth, false, files, wrappers, fallback};
+			Includer optional{
+			  this, flags, depth, true, files, wrappers, fallback};
+			struct ucl_parser *p = ucl_parser_new(flags);
+			ucl_parser_register_context_macro(p, "include", include, &required);
+			ucl_parser_register_context_macro(
+			  p, "try_include", include, &optional);
+			ucl_parser_add_file(p, path.c_str());
+			if (fallback)
+			{
+				ucl_parser_free(p);
+				return LoadError{path.string() + ": needs libucl's include"};
+			}
+			std::string error =
+			  required.error.empty() ? optional.error : required.error;
+			if (error.empty())
+			{
+				if (const char *err = ucl_parser_get_error(p))
+				{
+					error = err;
+				}
+			}
+			if (!error.empty())
+			{
+				ucl_parser_free(p);
+				return LoadError{error};
+			}
+			auto obj = ucl_parser_get_object(p);
+			ucl_parser_free(p);
+			if (obj == nullptr)
+			{
+				return LoadError{path.string() + ": empty config"};
+			}
+			return obj;
+		}
+
+		/**
+		 * Returns the parsed fragment at `path`, which is nested inside
+		 * `depth` includes, parsing it with `flags` if it is not cached or
+		 * it or a file that it includes has changed.  The returned fragment
+		 * holds its own reference to the tree.  Sets `fallback` if the
+		 * fragment cannot be shared, and then caches nothing.
+		 */
+		std::variant<Fragment, LoadError>
+		fragment(const std::filesystem::path &path,
+		         int                          flags,
+		         size_t                       depth,
+		         bool                        &fallback)
+		{
+			std::error_code ec;
+			auto            canonical = std::filesystem::canonical(path, ec);
+			if (ec)
+			{
+				return LoadError{path.string() + ": " + ec.message()};
+			}
+			struct stat sb;
+			if (stat(canonical.c_str(), &sb) != 0)
+			{
+				return LoadError{path.string() + ": " + strerror(errno)};
+			}
+			{
+				std::lock_guard g(lock);
+				auto            i = fragments.find(canonical.string());
+				if ((i != fragments.end()) && i->second.is_current(sb))
+				{
+					hitCount++;
+					return Fragment{ucl_object_ref(i->second.properties),
+					                i->second.files};
+				}
+			}
+			// Parse without holding the lock, so that loaders including
+			// different fragments do not wait for each other.  If a file
+			// changes after it is examined, the next include parses the
+			// fragment again.
+			missCount++;
+			std::vector<FileIdentity> files{{canonical.string(), sb}};
+			std::vector<UCLPtr>       wrappers;
+			auto parsed =
+			  parse_nested(canonical, flags, depth, files, wrappers, fallback);
+			if (auto *err = std::get_if<LoadError>(&parsed))
+			{
+				return std::move(*err);
+			}
+			auto *root = std::get<ucl_object_t *>(parsed);
+			if (ucl_object_type(root) != UCL_OBJECT)
+			{
+				ucl_object_unref(root);
+				return LoadError{path.string() + ": fragment is not an object"};
+			}
+			// libucl appends later duplicates of a repeated key to its
+			// array, which must not be shared.
+			ucl_object_iter_t it = nullptr;
+			while (auto *child = ucl_object_iterate(root, &it, false))
+			{
+				if ((child->flags & UCL_OBJECT_MULTIVALUE) != 0)
+				{
+					ucl_object_unref(root);
+					fallback = true;
+					return LoadError{path.string() + ": repeats a key"};
+				}
+			}
+			// Properties that came from included fragments are already
+			// shared and must not be wrapped again, which would write their
+			// keys, so they keep the wrappers that they were added with.
+			std::unordered_map<const ucl_object_t *, const ucl_object_t *>
+			  included;
+			for (auto &wrapper : wrappers)
+			{
+				ucl_object_iter_t wit = nullptr;
+				included.emplace(ucl_object_iterate(wrapper, &wit, false),
+				                 wrapper);
+			}
+			auto *properties = ucl_object_typed_new(UCL_ARRAY);
+			it               = nullptr;
+			while (auto *child = ucl_object_iterate(root, &it, false))
+			{
+				auto wrapped = included.find(child);
+				ucl_array_append(
+				  properties,
+				  wrapped != included.end()
+				    ? ucl_object_ref(wrapped->second)
+				    : wrap_property(const_cast<ucl_object_t *>(child)));
+			}
+			ucl_object_unref(root);
+			std::lock_guard g(lock);
+			auto           &slot = fragments[canonical.string()];
+			if (slot.properties != nullptr)
+			{
+				ucl_object_unref(slot.properties);
+			}
+			slot = {ucl_object_ref(properties), files};
+			return Fragment{properties, std::move(files)};
+		}
+
+		public:
+		/**
+		 * Returns the process-wide fragment cache.
+		 */
+		static FragmentCache &global()
+		{
+			static FragmentCache cache;
+			return cache;
+		}
+
+		/**
+		 * Default constructor.
+		 */
+		FragmentCache() = default;
+
+		/**
+		 * Fragment caches cannot be copied.
+		 */
+		FragmentCache(const FragmentCache &) = delete;
+
+		/**
+		 * Destructor, drops the cache's references to all fragments.
+		 * Configs that include them keep their own references.
+		 */
+		~FragmentCache()
+		{
+			clear();
+		}
+
+		/**
+		 * Parses the config file at `path`, resolving its includes through
+		 * the cache, or with libucl's include if they cannot be shared.
+		 * Returns an owning reference to the parsed object, or a
+		 * `LoadError` if it, or a file that it includes, could not be read
+		 * or parsed.
+		 */
+		std::variant<ucl_object_t *, LoadError>
+		parse_file(const std::filesystem::path &path,
+		           int flags = UCL_PARSER_NO_IMPLICIT_ARRAYS)
+		{
+			if ((flags & UCL_PARSER_NO_IMPLICIT_ARRAYS) != 0)
+			{
+				std::vector<FileIdentity> files;
+				std::vector<UCLPtr>       wrappers;
+				bool                      fallback = false;
+				auto                      parsed =
+				  parse_nested(path, flags, 0, files, wrappers, fallback);
+				if (!fallback)
+				{
+					return parsed;
+				}
+			}
+			fallbackCount++;
+			struct ucl_parser *p = ucl_parser_new(flags);
+			ucl_parser_add_file(p, path.c_str());
+			if (const char *err = ucl_parser_get_error(p))
+			{
+				LoadError e{err};
+				ucl_parser_free(p);
+				return e;
+			}
+			auto obj = ucl_parser_get_object(p);
+			ucl_parser_free(p);
+			if (obj == nullptr)
+			{
+				return LoadError{path.string() + ": empty config"};
+			}
+			return obj;
+		}
+
+		/**
+		 * Drops every cached fragment.  Configs that include them keep
+		 * their nodes.
+		 */
+		void clear()
+		{
+			std::lock_guard g(lock);
+			for (auto &[path, fragment] : fragments)
+			{
+				ucl_object_unref(fragment.properties);
+			}
+			fragments.clear();
+		}
+
+		/**
+		 * Returns the number of cached fragments.
+		 */
+		size_t size()
+		{
+			std::lock_guard g(lock);
+			return fragments.size();
+		}
+
+		/**
+		 * Returns the number of includes that found a current fragment.
+		 */
+		size_t hits() const
+		{
+			return hitCount;
+		}
+
+		/**
+		 * Returns the number of includes that parsed a fragment.
+		 */
+		size_t misses() const
+		{
+			return missCount;
+		}
+
+		/**
+		 * Returns the number of configs that were parsed with libucl's
+		 * include because their includes could not share fragments.
+		 */
+		size_t fallbacks() const
+		{
+			return fallbackCount;
+		}
+	};
+
+	/**
+	 * Parses the file at `path`, reporting the parse phase to `observer`.
+	 * Returns an owning reference to the parsed object, or a `LoadError` if
+	 * the file could not be read or parsed.
+	 *
+	 * libucl parsers accumulate everything added to them into a single
+	 * top-level object, so a parser cannot be reused between documents and a
+	 * new one is created for each file.
+	 */
+	template<LoadObserver O>
+	std::variant<ucl_object_t *, LoadError>
+	parse_file(const std::filesystem::path &path,
+	           O                           &observer,
+	           int flags = UCL_PARSER_NO_IMPLICIT_ARRAYS)
+	{
+		ObservedPhase      phase(observer, LoadPhase::Parse);
+		struct ucl_parser *p = ucl_parser_new(flags);
+		ucl_parser_add_file(p, path.c_str());
+		if (const char *err = ucl_parser_get_error(p))
+		{
+			LoadError e{err};
+			ucl_parser_free(p);
+			return e;
+		}
+		auto obj = ucl_parser_get_object(p);
+		ucl_parser_free(p);
+		std::error_code ec;
+		phase.bytes = std::filesystem::file_size(path, ec);
+		if (ec)
+		{
+			phase.bytes = 0;
+		}
+		return obj;
+	}
+
+	/**
+	 * Parses the file at `path` without observing it.
+	 */
+	inline std::variant<ucl_object_t *, LoadError>
+	parse_file(const std::filesystem::path &path,
+	           int                          flags = UCL_PARSER_NO_IMPLICIT_ARRAYS)
+	{
+		NullObserver observer;
+		return parse_file(path, observer, flags);
+	}
+
+	/**
+	 * Parses the file at `path`, resolving its includes through
+	 * `fragments`, and reports the parse phase, including the parsing of any
+	 * fragments that are not cached, to `observer`.
+	 */
+	template<LoadObserver O>
+	std::variant<ucl_object_t *, LoadError>
+	parse_file(const std::filesystem::path &path,
+	           FragmentCache               &fragments,
+	           O                           &observer,
+	           int flags = UCL_PARSER_NO_IMPLICIT_ARRAYS)
+	{
+		ObservedPhase phase(observer, LoadPhase::Parse);
+		auto          parsed = fragments.parse_file(path, flags);
+		if (std::holds_alternative<ucl_object_t *>(parsed))
+		{
+			std::error_code ec;
+			phase.bytes = std::filesystem::file_size(path, ec);
+			if (ec)
+			{
+				phase.bytes = 0;
+			}
+		}
+		return parsed;
+	}
+
+	/**
+	 * Validates and constructs a config with `make` from the result of
+	 * parsing it.  The parsed tree is released once the config object holds
+	 * its own reference.
+	 */
+	template<typename Config, typename Make>
+	std::variant<Config, LoadError>
+	make_parsed(std::variant<ucl_object_t *, LoadError> &&parsed, Make &&make)
+	{
+		if (auto *err = std::get_if<LoadError>(&parsed))
+		{
+			return std::move(*err);
+		}
+		auto *obj         = std::get<ucl_object_t *>(parsed);
+		auto  confOrError = make(obj);
+		std::variant<Config, LoadError> result =
+		  std::holds_alternative<Config>(confOrError)
+		    ? std::variant<Config, LoadError>{std::get<Config>(confOrError)}
+		    : std::variant<Config, LoadError>{
+		        LoadError{std::get<ucl_schema_error>(confOrError)}};
+		ucl_object_unref(obj);
+		return result;
+	}
+
+	/**
+	 * Parses and validates a single file with `make`, which should be the
+	 * `make_config` function for the generated class.  The parse phase is
+	 * reported to `observer`, `make` is responsible for reporting the later
+	 * phases.
+	 */
+	template<typename Config, typename Make, LoadObserver O = NullObserver>
+	std::variant<Config, LoadError>
+	load_config_file(const std::filesystem::path &path,
+	                 Make                       &&make,
+	                 O                          &&observer = O{})
+	{
+		return make_parsed<Config>(parse_file(path, observer), make);
+	}
+
+	/**
+	 * Parses and validates a single file as `load_config_file` does,
+	 * resolving its includes through `fragments`.
+	 */
+	template<typename Config, typename Make, LoadObserver O = NullObserver>
+	std::variant<Config, LoadError>
+	load_config_file(const std::filesystem::path &path,
+	                 FragmentCache               &fragments,
+	                 Make                       &&make,
+	                 O                          &&observer = O{})
+	{
+		return make_parsed<Config>(parse_file(path, fragments, observer),
+		                           make);
+	}
+
+	/**
+	 * Parses MessagePack-encoded `data`, reporting the parse phase to
+	 * `observer`.  Returns an owning reference to the parsed object, or a
+	 * `LoadError` if the input is not valid MessagePack.  Binary input skips
+	 * tokenising text, so this is faster than parsing the equivalent UCL or
+	 * JSON.
+	 */
+	template<LoadObserver O>
+	std::variant<ucl_object_t *, LoadError>
+	parse_msgpack(std::span<const std::byte> data,
+	              O                         &observer,
+	              int flags = UCL_PARSER_NO_IMPLICIT_ARRAYS)
+	{
+		ObservedPhase      phase(observer, LoadPhase::Parse);
+		struct ucl_parser *p = ucl_parser_new(flags);
+		ucl_parser_add_chunk_full(
+		  p,
+		  reinterpret_cast<const unsigned char *>(data.data()),
+		  data.size(),
+		  0,
+		  UCL_DUPLICATE_APPEND,
+		  UCL_PARSE_MSGPACK);
+		if (const char *err = ucl_parser_get_error(p))
+		{
+			LoadError e{err};
+			ucl_parser_free(p);
+			return e;
+		}
+		auto obj = ucl_parser_get_object(p);
+		ucl_parser_free(p);
+		if (obj == nullptr)
+		{
+			return LoadError{"empty MessagePack input"};
+		}
+		phase.bytes = data.size();
+		return obj;
+	}
+
+	/**
+	 * Parses MessagePack-encoded `data` without observing it.
+	 */
+	inline std::variant<ucl_object_t *, LoadError>
+	parse_msgpack(std::span<const std::byte> data,
+	              int flags = UCL_PARSER_NO_IMPLICIT_ARRAYS)
+	{
+		NullObserver observer;
+		return parse_msgpack(data, observer, flags);
+	}
+
+	/**
+	 * Returns the MessagePack encoding of `obj`, which can be loaded with
+	 * `parse_msgpack` or a generated `make_config_from_msgpack`.
+	 */
+	inline std::vector<std::byte> encode_msgpack(const ucl_object_t *obj)
+	{
+		size_t length  = 0;
+		auto  *encoded = ucl_object_emit_len(obj, UCL_EMIT_MSGPACK, &length);
+		if (encoded == nullptr)
+		{
+			return {};
+		}
+		auto *bytes = reinterpret_cast<const std::byte *>(encoded);
+		std::vector<std::byte> result(bytes, bytes + length);
+		free(encoded);
+		return result;
+	}
+
+	/**
+	 * Parses MessagePack-encoded `data` and validates it with `make`, which
+	 * should be the `make_config` function for the generated class.  As with
+	 * `load_config_file`, the parse phase is reported to `observer` and
+	 * `make` is responsible for reporting the later phases.
+	 */
+	template<typename Config, typename Make, LoadObserver O = NullObserver>
+	std::variant<Config, LoadError>
+	load_config_msgpack(std::span<const std::byte> data,
+	                    Make                     &&make,
+	                    O                        &&observer = O{})
+	{
+		return make_parsed<Config>(parse_msgpack(data, observer), make);
+	}
+
+	/**
+	 * Read-only memory mapping of a file.  Trees parsed from the mapping with
+	 * `UCL_PARSER_ZEROCOPY` point into it for their strings and keys, so it
+	 * must outlive them.  libucl's own file loader unmaps the file after
+	 * parsing, so it cannot be used with zero-copy parsing.
+	 */
+	class MappedFile
+	{
+		/**
+		 * The start of the mapping, or null for an empty file.
+		 */
+		const std::byte *data = nullptr;
+
+		/**
+		 * The length of the mapping.
+		 */
+		size_t length = 0;
+
+		/**
+		 * Constructor, takes ownership of a mapping.
+		 */
+		MappedFile(const std::byte *d, size_t l) : data(d), length(l) {}
+
+		public:
+		/**
+		 * Mappings cannot be copied.
+		 */
+		MappedFile(const MappedFile &) = delete;
+
+		/**
+		 * Destructor, unmaps the file.
+		 */
+		~MappedFile()
+		{
+			if (data != nullptr)
+			{
+				munmap(const_cast<std::byte *>(data), length);
+			}
+		}
+
+		/**
+		 * Maps the file at `path`.  Returns a shared reference to the
+		 * mapping, or a `LoadError` if the file could not be mapped.
+		 */
+		static std::variant<std::shared_ptr<const MappedFile>, LoadError>
+		open(const std::filesystem::path &path)
+		{
+			int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+			if (fd < 0)
+			{
+				return LoadError{path.string() + ": " + strerror(errno)};
+			}
+			struct stat sb;
+			if (fstat(fd, &sb) != 0)
+			{
+				LoadError e{path.string() + ": " + strerror(errno)};
+				close(fd);
+				return e;
+			}
+			size_t length = static_cast<size_t>(sb.st_size);
+			void  *data   = nullptr;
+			if (length != 0)
+			{
+				data = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+				if (data == MAP_FAILED)
+				{
+					LoadError e{path.string() + ": " + strerror(errno)};
+					close(fd);
+					return e;
+				}
+			}
+			close(fd);
+			return std::shared_ptr<const MappedFile>(
+			  new MappedFile(static_cast<const std::byte *>(data), length));
+		}
+
+		/**
+		 * Returns the contents of the file.
+		 */
+		std::span<const std::byte> bytes() const
+		{
+			return {data, length};
+		}
+	};
+
+	/**
+	 * Maps the file at `path` and parses it in place, so that the strings and
+	 * keys in the tree point into the mapping rather than into copies, then
+	 * validates and constructs the config with `make`.  `make` is passed the
+	 * parsed object and a reference to the mapping, which the config must
+	 * hold for as long as it is used.  Reports phases in the same way as
+	 * `load_config_file`.
+	 */
+	template<typename Config, typename Make, LoadObserver O = NullObserver>
+	std::variant<Config, LoadError>
+	load_config_mapped(const std::filesystem::path &path,
+	                   Make                       &&make,
+	                   O                          &&observer = O{})
+	{
+		std::shared_ptr<const MappedFile> file;
+		ucl_object_t                     *obj;
+		{
+			ObservedPhase phase(observer, LoadPhase::Parse);
+			auto          mapped = MappedFile::open(path);
+			if (auto *err = std::get_if<LoadError>(&mapped))
+			{
+				return std::move(*err);
+			}
+			file       = std::get<std::shared_ptr<const MappedFile>>(mapped);
+			auto bytes = file->bytes();
+			struct ucl_parser *p = ucl_parser_new(
+			  UCL_PARSER_NO_IMPLICIT_ARRAYS | UCL_PARSER_ZEROCOPY);
+			ucl_parser_add_chunk(
+			  p,
+			  reinterpret_cast<const unsigned char *>(bytes.data()),
+			  bytes.size());
+			if (const char *err = ucl_parser_get_error(p))
+			{
+				LoadError e{path.string() + ": " + err};
+				ucl_parser_free(p);
+				return e;
+			}
+			obj = ucl_parser_get_object(p);
+			ucl_parser_free(p);
+			if (obj == nullptr)
+			{
+				return LoadError{path.string() + ": empty config"};
+			}
+			phase.bytes = bytes.size();
+		}
+		auto confOrError = make(obj, file);
+		std::variant<Config, LoadError> result =
+		  std::holds_alternative<Config>(confOrError)
+		    ? std::variant<Config, LoadError>{std::get<Config>(confOrError)}
+		    : std::variant<Config, LoadError>{
+		        LoadError{std::get<ucl_schema_error>(confOrError)}};
+		if (auto *err = std::get_if<LoadError>(&result))
+		{
+			err->storage = file;
+		}
+		ucl_object_unref(obj);
+		return result;
+	}
+
+	/**
+	 * Loads every file in `paths` with `load`, which is called with a path
+	 * and returns the result of loading it, running on `executor`.  One task
+	 * is submitted per unit of executor concurrency and each task pulls the
+	 * next unloaded file from a shared counter, so uneven file sizes do not
+	 * leave workers idle.  Returns once every file has been loaded, with the
+	 * results in the same order as `paths`.
+	 *
+	 * If the caller is itself running on one of the executor's workers (for
+	 * executors that report this with `is_worker()`), the files are loaded
+	 * on the calling thread instead, because waiting for tasks queued behind
+	 * the caller could deadlock.
+	 */
+	template<typename Config, Executor E, typename Load>
+	std::vector<std::variant<Config, LoadError>>
+	load_each(std::span<const std::filesystem::path> paths,
+	          E                                     &executor,
+	          Load                                 &&load)
+	{
+		using Result = std::variant<Config, LoadError>;
+		std::vector<std::optional<Result>> slots(paths.size());
+		bool                               loadInline = false;
+		if constexpr (requires { executor.is_worker(); })
+		{
+			loadInline = executor.is_worker();
+		}
+		if (loadInline)
+		{
+			for (size_t idx = 0; idx < paths.size(); idx++)
+			{
+				slots[idx].emplace(load(paths[idx]));
+			}
+		}
+		else if (!paths.empty())
+		{
+			size_t tasks =
+			  std::min(paths.size(), executor_concurrency(executor));
+			std::atomic<size_t> next{0};
+			std::latch          done(static_cast<ptrdiff_t>(tasks));
+			for (size_t i = 0; i < tasks; i++)
+			{
+				executor.execute([&]() {
+					for (size_t idx = next++; idx < paths.size(); idx = next++)
+					{
+						slots[idx].emplace(load(paths[idx]));
+					}
+					done.count_down();
+				});
+			}
+			done.wait();
+		}
+		std::vector<Result> results;
+		results.reserve(slots.size());
+		for (auto &slot : slots)
+		{
+			results.push_back(std::move(*slot));
+		}
+		return results;
+	}
+
+	/**
+	 * Loads every file in `paths` using `make` to validate and construct
+	 * each config, running on `executor` as described for `load_each`.
+	 * Parsing is reported to `observer` from the worker threads.
+	 */
+	template<typename Config,
+	         Executor E,
+	         typename Make,
+	         LoadObserver O = NullObserver>
+	std::vector<std::variant<Config, LoadError>>
+	load_configs(std::span<const std::filesystem::path> paths,
+	             E                                     &executor,
+	             Make                                 &&make,
+	             O                                    &&observer = O{})
+	{
+		return load_each<Config>(
+		  paths, executor, [&](const std::filesystem::path &path) {
+			  return load_config_file<Config>(path, make, observer);
+		  });
+	}
+
+	/**
+	 * Loads every file in `paths` as `load_configs` does, resolving includes
+	 * through `fragments`, so that each fragment is parsed once however many
+	 * of the files include it.
+	 */
+	template<typename Config,
+	         Executor E,
+	         typename Make,
+	         LoadObserver O = NullObserver>
+	std::vector<std::variant<Config, LoadError>>
+	load_configs(std::span<const std::filesystem::path> paths,
+	             E                                     &executor,
+	             FragmentCache                         &fragments,
+	             Make                                 &&make,
+	             O                                    &&observer = O{})
+	{
+		return load_each<Config>(
+		  paths, executor, [&](const std::filesystem::path &path) {
+			  return load_config_file<Config>(path, fragments, make, observer);
+		  });
+	}
+
+	/**
+	 * Starts loading the file at `path` with `load`, which is called with the
+	 * path and returns the result of loading it, on `executor`, and returns
+	 * a future for the result.  The caller can do other work, or start
+	 * loading other files, while the file is read, parsed and validated.
+	 * `load` is copied into the task, and anything that it refers to, as
+	 * well as `executor`, must outlive the load.
+	 */
+	template<typename Config, Executor E, typename Load>
+	std::future<std::variant<Config, LoadError>>
+	load_config_async(const std::filesystem::path &path, E &executor, Load load)
+	{
+		using Result = std::variant<Config, LoadError>;
+		// Executors take copyable functions, so the promise is shared.
+		auto promise = std::make_shared<std::promise<Result>>();
+		auto future  = promise->get_future();
+		executor.execute([promise, path, load]() {
+			try
+			{
+				promise->set_value(load(path));
+			}
+			catch (...)
+			{
+				promise->set_exception(std::current_exception());
+			}
+		});
+		return future;
+	}
+
+	/**
+	 * Starts loading every file in `paths` with `load` on `executor`, as
+	 * `load_config_async` does, and returns a future for each, in the same
+	 * order as `paths`.  Each file is a separate task, so the files are
+	 * loaded concurrently on executors with more than one thread and each
+	 * result can be used as soon as it is ready.
+	 */
+	template<typename Config, Executor E, typename Load>
+	std::vector<std::future<std::variant<Config, LoadError>>>
+	load_configs_async(std::span<const std::filesystem::path> paths,
+	                   E                                     &executor,
+	                   Load                                   load)
+	{
+		std::vector<std::future<std::variant<Config, LoadError>>> futures;
+		futures.reserve(paths.size());
+		for (auto &path : paths)
+		{
+			futures.push_back(load_config_async<Config>(path, executor, load));
+		}
+		return futures;
+	}
+
+	/**
+	 * Merges a stack of UCL layers, ordered from lowest to highest priority,
+	 * into a single view.  The highest layer that defines a key wins, except
+	 * that objects defined by several consecutive layers are merged
+	 * recursively.
+	 *
+	 * The result is shallow: a new container is created only for objects that
+	 * are defined in more than one layer.  Every other node, including whole
+	 * subtrees that only one layer defines, is shared with the layer by
+	 * reference rather than copied.  Returns an owning reference, or null if
+	 * no layer is non-null.
+	 */
+	inline ucl_object_t *merge_layers(std::span<const ucl_object_t *const> layers)
+	{
+		// Collect the highest non-null layer and, if it is an object, the
+		// run of objects beneath it.  Any other value hides everything below
+		// it.
+		std::vector<const ucl_object_t *> objects;
+		for (size_t i = layers.size(); i-- > 0;)
+		{
+			const ucl_object_t *layer = layers[i];
+			if (layer == nullptr)
+			{
+				continue;
+			}
+			if (ucl_object_type(layer) != UCL_OBJECT)
+			{
+				if (objects.empty())
+				{
+					return ucl_object_ref(layer);
+				}
+				break;
+			}
+			objects.push_back(layer);
+		}
+		if (objects.empty())
+		{
+			return nullptr;
+		}
+		if (objects.size() == 1)
+		{
+			return ucl_object_ref(objects.front());
+		}
+		std::reverse(objects.begin(), objects.end());
+		ucl_object_t *merged = ucl_object_typed_new(UCL_OBJECT);
+		// Add the properties of each layer in turn, so that the highest
+		// layer that defines a key wins.  Layers' nodes are shared with
+		// other views and their readers, and `ucl_object_insert_key` would
+		// set their keys, so they are added with `ucl_object_merge`, which
+		// inserts references under the nodes' own keys without writing to
+		// them.  Keys that a lower layer has already added are removed
+		// first, because merging into an existing value would modify it, so
+		// overridden keys move after the others.
+		for (auto *object : objects)
+		{
+			ucl_object_iter_t it = nullptr;
+			while (auto *child = ucl_object_iterate(object, &it, false))
+			{
+				size_t      keylen;
+				const char *key = ucl_object_keyl(child, &keylen);
+				ucl_object_delete_keyl(merged, key, keylen);
+			}
+			ucl_object_merge(merged, const_cast<ucl_object_t *>(object), false);
+		}
+		// Objects that several consecutive layers define are merged
+		// recursively into new containers, which are not shared and so can
+		// be given a copy of the key.
+		std::vector<const ucl_object_t *> winners;
+		ucl_object_iter_t                 it = nullptr;
+		while (auto *child = ucl_object_iterate(merged, &it, false))
+		{
+			if (ucl_object_type(child) == UCL_OBJECT)
+			{
+				winners.push_back(child);
+			}
+		}
+		for (auto *winner : winners)
+		{
+			size_t      keylen;
+			const char *key = ucl_object_keyl(winner, &keylen);
+			std::vector<const ucl_object_t *> children;
+			for (auto *layer : objects)
+			{
+				children.push_back(ucl_object_lookup_len(layer, key, keylen));
+			}
+			ucl_object_t *value = merge_layers(children);
+			if (value != winner)
+			{
+				ucl_object_replace_key(merged, value, key, keylen, true);
+			}
+			else
+			{
+				ucl_object_unref(value);
+			}
+		}
+		return merged;
+	}
+
+	/**
+	 * An ordered stack of UCL layers (for example a base config, a regional
+	 * layer and a per-host override) and the merged view of them.  Accessors
+	 * of a config constructed from the view resolve each property once, when
+	 * the view is built, rather than searching the layers on every read.
+	 */
+	class LayerStack
+	{
+		/**
+		 * The layers, from lowest to highest priority.
+		 */
+		std::vector<UCLPtr> layers;
+
+		/**
+		 * The merged view of `layers`.
+		 */
+		UCLPtr merged;
+
+		/**
+		 * True once `merged` is known to be valid against the schema, which
+		 * is what allows `replace` to revalidate only the changed
+		 * properties.  Set by a successful `validate` or `replace`.
+		 */
+		mutable bool validated = false;
+
+		/**
+		 * Returns the layers as raw pointers, with `replacement` substituted
+		 * for the layer at `index`.
+		 */
+		std::vector<const ucl_object_t *>
+		raw_layers(size_t index, const ucl_object_t *replacement) const
+		{
+			std::vector<const ucl_object_t *> raw;
+			for (size_t i = 0; i < layers.size(); i++)
+			{
+				raw.push_back(i == index ? replacement
+				                         : static_cast<const ucl_object_t *>(
+				                             layers[i]));
+			}
+			return raw;
+		}
+
+		/**
+		 * Returns true if `schema` constrains the top-level object only
+		 * through `properties` and `required`, so that a change to one
+		 * property can be checked by validating just that property.
+		 */
+		static bool root_is_separable(const ucl_object_t *schema)
+		{
+			ucl_object_iter_t it = nullptr;
+			while (auto *rule = ucl_object_iterate(schema, &it, true))
+			{
+				size_t           keylen;
+				const char      *name = ucl_object_keyl(rule, &keylen);
+				std::string_view key{name, keylen};
+				if ((key != "properties") && (key != "required") &&
+				    (key != "type") && (key != "title") &&
+				    (key != "description") && (key != "$schema") &&
+				    (key != "$id"))
+				{
+					return false;
+				}
+			}
+			return true;
+		}
+
+		/**
+		 * Validates `view` against `schema`, assuming that it differs from
+		 * an already-validated view only in the top-level properties
+		 * defined by `before` or `after`.  Falls back to validating
+		 * everything if the schema does not allow the check to be split.
+		 */
+		static bool validate_changes(const ucl_object_t      *schema,
+		                             const ucl_object_t      *view,
+		                             const ucl_object_t      *before,
+		                             const ucl_object_t      *after,
+		                             struct ucl_schema_error *err)
+		{
+			if ((ucl_object_type(view) != UCL_OBJECT) ||
+			    (ucl_object_type(before) != UCL_OBJECT) ||
+			    (ucl_object_type(after) != UCL_OBJECT) ||
+			    !root_is_separable(schema))
+			{
+				return ucl_object_validate(schema, view, err);
+			}
+			auto *properties = ucl_object_lookup(schema, "properties");
+			auto *required   = ucl_object_lookup(schema, "required");
+			for (auto *layer : {before, after})
+			{
+				ucl_object_iter_t it = nullptr;
+				while (auto *changed = ucl_object_iterate(layer, &it, true))
+				{
+					size_t      keylen;
+					const char *key   = ucl_object_keyl(changed, &keylen);
+					auto       *value = ucl_object_lookup_len(view, key, keylen);
+					auto *property =
+					  ucl_object_lookup_len(properties, key, keylen);
+					if (value == nullptr)
+					{
+						// Removing an override can only remove a key
+						// if no other layer defines it.
+						for (auto name :
+						     Range<std::string_view, StringViewAdaptor>(
+						       required))
+						{
+							if (name == std::string_view(key, keylen))
+							{
+								err->code = UCL_SCHEMA_MISSING_PROPERTY;
+								err->obj  = view;
+								snprintf(err->msg,
+								         sizeof(err->msg),
+								         "object has missing property %.*s",
+								         static_cast<int>(keylen),
+								         key);
+								return false;
+							}
+						}
+						continue;
+					}
+					if (property == nullptr)
+					{
+						return ucl_object_validate(schema, view, err);
+					}
+					if (!ucl_object_validate(property, value, err))
+					{
+						return false;
+					}
+				}
+			}
+			return true;
+		}
+
+		public:
+		/**
+		 * Constructor.  Takes references to `stack`, ordered from lowest to
+		 * highest priority, and builds the merged view.
+		 */
+		LayerStack(std::span<const ucl_object_t *const> stack)
+		{
+			for (auto *layer : stack)
+			{
+				layers.emplace_back(layer);
+			}
+			ucl_object_t *view = merge_layers(stack);
+			merged             = view;
+			ucl_object_unref(view);
+		}
+
+		/**
+		 * Returns the merged view.
+		 */
+		const ucl_object_t *view() const
+		{
+			return merged;
+		}
+
+		/**
+		 * Returns the number of layers.
+		 */
+		size_t size() const
+		{
+			return layers.size();
+		}
+
+		/**
+		 * Validates the whole merged view against `schema`.
+		 */
+		bool validate(const ucl_object_t      *schema,
+		              struct ucl_schema_error *err) const
+		{
+			if (!ucl_object_validate(schema, merged, err))
+			{
+				return false;
+			}
+			validated = true;
+			return true;
+		}
+
+		/**
+		 * Replaces the layer at `index` with `layer` and rebuilds the merged
+		 * view.  The other layers are not copied.  If the current view has
+		 * been validated, only the top-level properties that the old or new
+		 * layer define are revalidated; otherwise the whole new view is
+		 * validated.  If `check` is not
+		 * null, it is then called with the whole new view, to check
+		 * constraints that libucl does not.  If the new view is invalid then
+		 * the stack is left unchanged and `err` describes the problem.
+		 */
+		bool replace(size_t                   index,
+		             const ucl_object_t      *layer,
+		             const ucl_object_t      *schema,
+		             struct ucl_schema_error *err,
+		             bool (*check)(const ucl_object_t *,
+		                           ucl_schema_error *) = nullptr)
+		{
+			assert(index < layers.size());
+			auto          stack = raw_layers(index, layer);
+			ucl_object_t *view  = merge_layers(stack);
+			bool          valid =
+			  validated
+			    ? validate_changes(schema, view, layers[index], layer, err)
+			    : ucl_object_validate(schema, view, err);
+			if (!valid || ((check != nullptr) && !check(view, err)))
+			{
+				ucl_object_unref(view);
+				return false;
+			}
+			layers[index] = layer;
+			merged        = view;
+			validated     = true;
+			ucl_object_unref(view);
+			return true;
+		}
+	};
+
+	/**
+	 * Table of canonical, immutable UCL subtrees, used to share identical
+	 * parts of many configs (hash-consing).  Interning a tree builds a copy
+	 * of it from canonical subtrees: each subtree is replaced by an existing
+	 * equal subtree from the table, if there is one, or by a new copy that is
+	 * added to the table otherwise.  The interned tree is a new root and the
+	 * input is not modified.  Configs that are mostly identical then share
+	 * most of their nodes, so memory grows with the differences between them
+	 * rather than with their number.
+	 *
+	 * The table holds a reference to each canonical node.  libucl cannot
+	 * notify the table when the last other reference goes away, so each shard
+	 * drops the nodes that nothing else refers to whenever it has doubled in
+	 * size since it was last swept.  The table therefore stays within a
+	 * constant factor of the nodes that are still in use.  `collect()` drops
+	 * all unused nodes at once.
+	 *
+	 * Interned trees are shared between configs and must not be modified.
+	 * Canonical nodes copy their keys and strings, so trees parsed with
+	 * `UCL_PARSER_ZEROCOPY` can be interned and their buffers released
+	 * afterwards.
+	 */
+	class InternTable
+	{
+		/**
+		 * A canonical node and, if it has a key, the `wrap_property` wrapper
+		 * through which it is added to objects.  Both are owning references.
+		 */
+		struct Canonical
+		{
+			/**
+			 * The canonical node.
+			 */
+			ucl_object_t *node;
+
+			/**
+			 * The wrapper, or null if `node` has no key.
+			 */
+			ucl_object_t *wrapper;
+
+			/**
+			 * Returns the number of references that the table holds to
+			 * `node`, directly or through the wrapper.
+			 */
+			unsigned own_references() const
+			{
+				return wrapper == nullptr ? 1 : 2;
+			}
+
+			/**
+			 * Returns true if nothing other than the table refers to `node`.
+			 */
+			bool unused() const
+			{
+				return __atomic_load_n(&node->ref, __ATOMIC_ACQUIRE) ==
+				       own_references();
+			}
+
+			/**
+			 * Drops the table's references.
+			 */
+			void release()
+			{
+				ucl_object_unref(wrapper);
+				ucl_object_unref(node);
+			}
+		};
+
+		/**
+		 * The smallest size at which a shard is swept.
+		 */
+		static constexpr size_t MinSweepSize = 64;
+
+		/**
+		 * One independently locked part of the table.  Nodes are assigned to
+		 * a shard by hash so that concurrent loaders rarely contend.
+		 */
+		struct Shard
+		{
+			/**
+			 * Lock protecting `nodes` and `sweepSize`.
+			 */
+			std::mutex lock;
+
+			/**
+			 * Canonical nodes, keyed by hash.  The table owns a reference
+			 * to each.
+			 */
+			std::unordered_multimap<uint64_t, Canonical> nodes;
+
+			/**
+			 * The number of nodes at which the shard is next swept.
+			 */
+			size_t sweepSize = MinSweepSize;
+
+			/**
+			 * Drops the nodes that only the table refers to and returns the
+			 * number dropped.  The lock must be held.
+			 */
+			size_t sweep()
+			{
+				size_t dropped = 0;
+				for (auto i = nodes.begin(); i != nodes.end();)
+				{
+					if (i->second.unused())
+					{
+						i->second.release();
+						i = nodes.erase(i);
+						dropped++;
+					}
+					else
+					{
+						++i;
+					}
+				}
+				sweepSize = std::max(MinSweepSize, 2 * nodes.size());
+				return dropped;
+			}
+		};
+
+		/**
+		 * The number of shards.
+		 */
+		static constexpr size_t ShardCount = 64;
+
+		/**
+		 * The shards.
+		 */
+		std::array<Shard, ShardCount> shards;
+
+		/**
+		 * Returns true if the canonical node `canon` has the same key and
+		 * value as `node`, whose children have the canonical versions
+		 * `children`, in collection order.  This is shallow: collections are
+		 * compared by the identity of their canonical elements.
+		 */
+		static bool same_node(const ucl_object_t        *canon,
+		                      const ucl_object_t        *node,
+		                      std::span<const Canonical> children)
+		{
+			size_t      alen, blen;
+			const char *akey = ucl_object_keyl(canon, &alen);
+			const char *bkey = ucl_object_keyl(node, &blen);
+			if ((ucl_object_type(canon) != ucl_object_type(node)) ||
+			    ((akey == nullptr) != (bkey == nullptr)) ||
+			    ((akey != nullptr) &&
+			     (std::string_view(akey, alen) != std::string_view(bkey, blen))))
+			{
+				return false;
+			}
+			switch (ucl_object_type(canon))
+			{
+				case UCL_STRING:
+				{
+					const char *astr = ucl_object_tolstring(canon, &alen);
+					const char *bstr = ucl_object_tolstring(node, &blen);
+					return std::string_view(astr, alen) ==
+					       std::string_view(bstr, blen);
+				}
+				case UCL_INT:
+				case UCL_BOOLEAN:
+					return canon->value.iv == node->value.iv;
+				case UCL_FLOAT:
+				case UCL_TIME:
+					return memcmp(&canon->value.dv,
+					              &node->value.dv,
+					              sizeof(double)) == 0;
+				case UCL_ARRAY:
+				{
+					if (canon->len != children.size())
+					{
+						return false;
+					}
+					for (unsigned i = 0; i < canon->len; i++)
+					{
+						if (ucl_array_find_index(canon, i) != children[i].node)
+						{
+							return false;
+						}
+					}
+					return true;
+				}
+				case UCL_OBJECT:
+				{
+					if (canon->len != children.size())
+					{
+						return false;
+					}
+					for (auto &child : children)
+					{
+						size_t      len;
+						const char *key = ucl_object_keyl(child.node, &len);
+						if (ucl_object_lookup_len(canon, key, len) !=
+						    child.node)
+						{
+							return false;
+						}
+					}
+					return true;
+				}
+				default:
+					return true;
+			}
+		}
+
+		/**
+		 * Returns a new node with the same key and value as `node`, built
+		 * from the canonical versions of its children, `children`, and its
+		 * wrapper.  `node` is only read.
+		 */
+		static Canonical copy_node(const ucl_object_t        *node,
+		                           std::span<const Canonical> children)
+		{
+			ucl_object_t *copy;
+			auto          type = ucl_object_type(node);
+			switch (type)
+			{
+				case UCL_STRING:
+				{
+					size_t      len;
+					const char *str = ucl_object_tolstring(node, &len);
+					copy            = ucl_object_fromlstring(str, len);
+					break;
+				}
+				case UCL_INT:
+					copy = ucl_object_fromint(ucl_object_toint(node));
+					break;
+				case UCL_BOOLEAN:
+					copy = ucl_object_frombool(ucl_object_toboolean(node));
+					break;
+				case UCL_FLOAT:
+				case UCL_TIME:
+					copy           = ucl_object_typed_new(type);
+					copy->value.dv = node->value.dv;
+					break;
+				case UCL_ARRAY:
+					copy = ucl_object_typed_new(UCL_ARRAY);
+					for (auto &child : children)
+					{
+						ucl_array_append(copy, ucl_object_ref(child.node));
+					}
+					break;
+				case UCL_OBJECT:
+					copy = ucl_object_typed_new(UCL_OBJECT);
+					for (auto &child : children)
+					{
+						insert_wrapped(copy, child.wrapper);
+					}
+					break;
+				default:
+					copy = ucl_object_typed_new(type);
+			}
+			size_t      len;
+			const char *key = ucl_object_keyl(node, &len);
+			if (key == nullptr)
+			{
+				return {copy, nullptr};
+			}
+			// The copy is not shared yet, so this can set its key.
+			ucl_object_t *wrapper = ucl_object_typed_new(UCL_OBJECT);
+			ucl_object_insert_key(wrapper, copy, key, len, true);
+			return {copy, wrapper};
+		}
+
+		/**
+		 * Returns the canonical node equal to `node`, whose hash (including
+		 * its key) is `hash` and whose children have the canonical versions
+		 * `children`, adding a copy of `node` to the table if there is none.
+		 * The caller receives an owning reference to the node, but not to
+		 * the wrapper, which remains valid for as long as the node is
+		 * referenced.
+		 */
+		Canonical canonical(const ucl_object_t        *node,
+		                    uint64_t                   hash,
+		                    std::span<const Canonical> children)
+		{
+			Shard          &shard = shards[hash % ShardCount];
+			std::lock_guard g(shard.lock);
+			auto [begin, end] = shard.nodes.equal_range(hash);
+			for (auto i = begin; i != end; ++i)
+			{
+				if (same_node(i->second.node, node, children))
+				{
+					ucl_object_ref(i->second.node);
+					return i->second;
+				}
+			}
+			Canonical added = copy_node(node, children);
+			shard.nodes.emplace(hash, added);
+			ucl_object_ref(added.node);
+			// The caller's reference keeps the new node from being swept.
+			if (shard.nodes.size() >= shard.sweepSize)
+			{
+				shard.sweep();
+			}
+			return added;
+		}
+
+		/**
+		 * Interns `node` and its subtree, bottom-up, and returns its
+		 * canonical version, with an owning reference to the node.  Sets
+		 * `hash` to the hash of `node`, including its key.
+		 */
+		Canonical intern_node(const ucl_object_t *node, uint64_t &hash)
+		{
+			std::vector<Canonical> children;
+			std::vector<uint64_t>  hashes;
+			auto                   type = ucl_object_type(node);
+			if ((type == UCL_OBJECT) || (type == UCL_ARRAY))
+			{
+				ucl_object_iter_t it = nullptr;
+				while (auto *child = ucl_object_iterate(node, &it, true))
+				{
+					uint64_t childHash;
+					children.push_back(intern_node(child, childHash));
+					hashes.push_back(childHash);
+				}
+			}
+			// Arrays keep their order and object hashes do not depend on
+			// order, so the hashes can be consumed in collection order.
+			size_t next  = 0;
+			auto   child = [&](auto *) { return hashes[next++]; };
+			hash         = hash_keyed(node, hash_value(node, child));
+			Canonical canon = canonical(node, hash, children);
+			for (auto &child : children)
+			{
+				ucl_object_unref(child.node);
+			}
+			return canon;
+		}
+
+		public:
+		/**
+		 * Returns the process-wide intern table.
+		 */
+		static InternTable &global()
+		{
+			static InternTable table;
+			return table;
+		}
+
+		/**
+		 * Default constructor.
+		 */
+		InternTable() = default;
+
+		/**
+		 * Intern tables cannot be copied.
+		 */
+		InternTable(const InternTable &) = delete;
+
+		/**
+		 * Destructor, drops the table's references to all canonical nodes.
+		 */
+		~InternTable()
+		{
+			for (auto &shard : shards)
+			{
+				for (auto &[hash, canon] : shard.nodes)
+				{
+					canon.release();
+				}
+			}
+		}
+
+		/**
+		 * Interns the tree rooted at `root`, which is not modified.  Returns
+		 * an owning reference to the canonical equal tree, whose subtrees are
+		 * shared with every other equal subtree interned in this table.
+		 */
+		ucl_object_t *intern(const ucl_object_t *root)
+		{
+			uint64_t hash;
+			return intern_node(root, hash).node;
+		}
+
+		/**
+		 * Drops canonical nodes that are referenced only by the table and
+		 * returns the number dropped.  Dropping a collection can release the
+		 * last reference to its elements, so this repeats until nothing more
+		 * can be dropped.
+		 */
+		size_t collect()
+		{
+			size_t total = 0;
+			size_t dropped;
+			do
+			{
+				dropped = 0;
+				for (auto &shard : shards)
+				{
+					std::lock_guard g(shard.lock);
+					dropped += shard.sweep();
+				}
+				total += dropped;
+			} while (dropped > 0);
+			return total;
+		}
+
+		/**
+		 * Returns the number of canonical nodes in the table.
+		 */
+		size_t size()
+		{
+			size_t total = 0;
+			for (auto &shard : shards)
+			{
+				std::lock_guard g(shard.lock);
+				total += shard.nodes.size();
+			}
+			return total;
+		}
+	};
+
+} // namespace CONFIG_DETAIL_NAMESPACE
@@ -0,0 +1,326 @@
+// Copyright David Chisnall
+// SPDX-License-Identifier: MIT
+#pragma once
+
+#include "config-generic.h"
+#include <array>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+namespace CONFIG_DETAIL_NAMESPACE
+{
+	/**
+	 * Memory used by part of a UCL tree.
+	 *
+	 * libucl does not expose the sizes of its allocations, so some of these
+	 * are estimates: object hash tables are counted as three pointers per
+	 * member and arrays as one pointer per element.  Strings that were not
+	 * copied by the parser (for example with `UCL_PARSER_ZEROCOPY`) point
+	 * into memory owned by someone else and are not counted.
+	 */
+	struct MemoryUsage
+	{
+		/**
+		 * The number of UCL nodes.
+		 */
+		size_t nodes = 0;
+
+		/**
+		 * Bytes used by the nodes themselves and by the hash tables of
+		 * objects.
+		 */
+		size_t nodeBytes = 0;
+
+		/**
+		 * Bytes used by copies of keys and string values.
+		 */
+		size_t stringBytes = 0;
+
+		/**
+		 * Bytes used by the element storage of arrays.
+		 */
+		size_t arrayBytes = 0;
+
+		/**
+		 * Returns the total number of bytes.
+		 */
+		size_t total() const
+		{
+			return nodeBytes + stringBytes + arrayBytes;
+		}
+
+		/**
+		 * Adds the usage in `other` to this.
+		 */
+		MemoryUsage &operator+=(const MemoryUsage &other)
+		{
+			nodes += other.nodes;
+			nodeBytes += other.nodeBytes;
+			stringBytes += other.stringBytes;
+			arrayBytes += other.arrayBytes;
+			return *this;
+		}
+	};
+
+	/**
+	 * Memory used by a config, broken down by property path.
+	 */
+	struct MemoryReport
+	{
+		/**
+		 * The memory used by the whole tree.
+		 */
+		MemoryUsage total;
+
+		/**
+		 * The memory used by the nodes at each path, relative to the object
+		 * that the report was made for.  The object itself has the empty
+		 * path and elements of arrays are written as `anArray[]`, with all
+		 * elements of an array accumulated together.  Each entry counts only
+		 * the nodes at that path, not their children, so the entries sum to
+		 * `total`.
+		 */
+		std::map<std::string, MemoryUsage> paths;
+	};
+
+	/**
+	 * Returns the memory used by `obj` itself, excluding its children.
+	 */
+	inline MemoryUsage node_memory_usage(const ucl_object_t *obj)
+	{
+		MemoryUsage usage;
+		usage.nodes     = 1;
+		usage.nodeBytes = sizeof(ucl_object_t);
+		// libucl records copied keys and values in the trash stack, in the
+		// key and value slots respectively.
+		if (obj->trash_stack[0] != nullptr)
+		{
+			usage.stringBytes += obj->keylen + 1;
+		}
+		if ((obj->trash_stack[1] != nullptr) &&
+		    (ucl_object_type(obj) == UCL_STRING))
+		{
+			usage.stringBytes += obj->len + 1;
+		}
+		if (ucl_object_type(obj) == UCL_ARRAY)
+		{
+			usage.arrayBytes += obj->len * sizeof(ucl_object_t *);
+		}
+		else if (ucl_object_type(obj) == UCL_OBJECT)
+		{
+			usage.nodeBytes += obj->len * 3 * sizeof(void *);
+		}
+		return usage;
+	}
+
+	/**
+	 * Adds the memory used by the tree rooted at `obj`, which is at `path`,
+	 * to `report`.  If `seen` is not null, nodes already in it are skipped
+	 * and new nodes are added, so that shared subtrees are counted once.
+	 */
+	inline void add_memory_usage(MemoryReport                            &report,
+	                             const ucl_object_t                      *obj,
+	                             std::string                             &path,
+	                             std::unordered_set<const ucl_object_t *> *seen)
+	{
+		if ((seen != nullptr) && !seen->insert(obj).second)
+		{
+			return;
+		}
+		auto usage = node_memory_usage(obj);
+		report.total += usage;
+		report.paths[path] += usage;
+		auto type = ucl_object_type(obj);
+		if ((type != UCL_OBJECT) && (type != UCL_ARRAY))
+		{
+			return;
+		}
+		size_t            length = path.size();
+		ucl_object_iter_t it     = nullptr;
+		while (auto *child = ucl_object_iterate(obj, &it, true))
+		{
+			if (type == UCL_ARRAY)
+			{
+				path += "[]";
+			}
+			else
+			{
+				if (length != 0)
+				{
+					path += '.';
+				}
+				size_t      keyLength;
+				const char *key = ucl_object_keyl(child, &keyLength);
+				path.append(key, keyLength);
+			}
+			add_memory_usage(report, child, path, seen);
+			path.resize(length);
+		}
+	}
+
+	/**
+	 * Returns the memory used by the tree rooted at `obj`.  Subtrees that
+	 * appear more than once in the tree are counted each time.
+	 */
+	inline MemoryReport memory_usage(const ucl_object_t *obj)
+	{
+		MemoryReport report;
+		std::string  path;
+		add_memory_usage(report, obj, path, nullptr);
+		return report;
+	}
+
+	/**
+	 * Registry of live configs, used to report the memory used by all
+	 * configs in the process.  Each registered config holds a shared token
+	 * that owns a reference to its tree, and the registry holds only weak
+	 * references to the tokens, so a config drops out of the registry as soon
+	 * as it and all of its copies are destroyed.
+	 *
+	 * Every config registers when it is constructed, so the registry is
+	 * split into independently locked shards, chosen by the registering
+	 * thread, and threads that construct configs concurrently rarely contend.
+	 */
+	class LiveConfigs
+	{
+		/**
+		 * One independently locked part of the registry.
+		 */
+		struct Shard
+		{
+			/**
+			 * Lock protecting `configs`.
+			 */
+			std::mutex lock;
+
+			/**
+			 * The tokens of registered configs.
+			 */
+			std::vector<std::weak_ptr<const ucl_object_t>> configs;
+
+			/**
+			 * Drops configs that have been destroyed.  Must be called with
+			 * the lock held.
+			 */
+			void prune()
+			{
+				std::erase_if(configs, [](auto &c) { return c.expired(); });
+			}
+		};
+
+		/**
+		 * The number of shards.
+		 */
+		static constexpr size_t ShardCount = 16;
+
+		/**
+		 * The shards.
+		 */
+		std::array<Shard, ShardCount> shards;
+
+		/**
+		 * Returns the shard that the calling thread registers with.
+		 */
+		Shard &local_shard()
+		{
+			static std::atomic<size_t> nextShard;
+			static thread_local size_t index =
+			  nextShard.fetch_add(1, std::memory_order_relaxed) % ShardCount;
+			return shards[index];
+		}
+
+		public:
+		/**
+		 * Returns the process-wide registry.  Generated config classes
+		 * register with this when built with `--memory-usage`.
+		 */
+		static LiveConfigs &global()
+		{
+			static LiveConfigs registry;
+			return registry;
+		}
+
+		/**
+		 * Default constructor.
+		 */
+		LiveConfigs() = default;
+
+		/**
+		 * Registries cannot be copied.
+		 */
+		LiveConfigs(const LiveConfigs &) = delete;
+
+		/**
+		 * Registers a config rooted at `root`.  Returns the token that the
+		 * config must hold for as long as it is live.
+		 */
+		std::shared_ptr<const ucl_object_t> add(const ucl_object_t *root)
+		{
+			std::shared_ptr<const ucl_object_t> token(
+			  ucl_object_ref(root), [](const ucl_object_t *o) {
+				  ucl_object_unref(const_cast<ucl_object_t *>(o));
+			  });
+			Shard          &shard = local_shard();
+			std::lock_guard g(shard.lock);
+			// Amortise pruning over registrations, so that the registry
+			// does not grow without bound if nobody asks for usage.
+			if (shard.configs.size() == shard.configs.capacity())
+			{
+				shard.prune();
+			}
+			shard.configs.push_back(token);
+			return token;
+		}
+
+		/**
+		 * Returns the number of live configs.
+		 */
+		size_t size()
+		{
+			size_t total = 0;
+			for (auto &shard : shards)
+			{
+				std::lock_guard g(shard.lock);
+				shard.prune();
+				total += shard.configs.size();
+			}
+			return total;
+		}
+
+		/**
+		 * Returns the memory used by all live configs.  Subtrees shared
+		 * between configs, for example by interning or layering, are
+		 * counted once.
+		 */
+		MemoryReport usage()
+		{
+			std::vector<std::shared_ptr<const ucl_object_t>> roots;
+			for (auto &shard : shards)
+			{
+				std::lock_guard g(shard.lock);
+				shard.prune();
+				for (auto &c : shard.configs)
+				{
+					if (auto root = c.lock())
+					{
+						roots.push_back(std::move(root));
+					}
+				}
+			}
+			MemoryReport                             report;
+			std::unordered_set<const ucl_object_t *> seen;
+			std::string                              path;
+			for (auto &root : roots)
+			{
+				add_memory_usage(report, root.get(), path, &seen);
+			}
+			return report;
+		}
+	};
+
+} // namespace CONFIG_DETAIL_NAMESPACE
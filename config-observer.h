@@ -0,0 +1,306 @@
+// Copyright David Chisnall
+// SPDX-License-Identifier: MIT
+#pragma once
+
+#include "config-generic.h"
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <string_view>
+
+namespace CONFIG_DETAIL_NAMESPACE
+{
+	/**
+	 * The phases of loading a config, reported to load observers.
+	 */
+	enum class LoadPhase
+	{
+		/**
+		 * Reading and parsing the config file.
+		 */
+		Parse,
+		/**
+		 * Loading the embedded schema.  This does real work only the first
+		 * time that a schema is used.
+		 */
+		SchemaLoad,
+		/**
+		 * Validating the parsed config against the schema.
+		 */
+		Validate,
+		/**
+		 * Building the config object, including any index or interning.
+		 */
+		Materialize,
+	};
+
+	/**
+	 * The number of values in `LoadPhase`.
+	 */
+	constexpr size_t LoadPhaseCount = 4;
+
+	/**
+	 * Returns a human-readable name for `phase`.
+	 */
+	constexpr std::string_view phase_name(LoadPhase phase)
+	{
+		switch (phase)
+		{
+			case LoadPhase::Parse:
+				return "parse";
+			case LoadPhase::SchemaLoad:
+				return "schema load";
+			case LoadPhase::Validate:
+				return "validate";
+			case LoadPhase::Materialize:
+				return "materialize";
+		}
+		return "unknown";
+	}
+
+	/**
+	 * Concept for load observers.  The loaders call `begin` at the start of
+	 * each phase and `end` when it finishes, with the number of input bytes
+	 * processed if that is known, or zero otherwise.  Phases do not nest and
+	 * `end` is called on the same thread as the matching `begin`, but the
+	 * batch loaders call observers from several threads at once.
+	 */
+	template<typename T>
+	concept LoadObserver = requires(T &o, LoadPhase phase, size_t bytes)
+	{
+		o.begin(phase);
+		o.end(phase, bytes);
+	};
+
+	/**
+	 * Observer that does nothing.  This is the default for all loaders and
+	 * compiles away entirely.
+	 */
+	struct NullObserver
+	{
+		/**
+		 * Ignores the start of a phase.
+		 */
+		void begin(LoadPhase) {}
+
+		/**
+		 * Ignores the end of a phase.
+		 */
+		void end(LoadPhase, size_t) {}
+	};
+
+	/**
+	 * RAII helper that reports a phase to an observer for the lifetime of
+	 * this object.  Set `bytes` before it goes out of scope to report the
+	 * amount of input processed.
+	 */
+	template<LoadObserver O>
+	class ObservedPhase
+	{
+		/**
+		 * The observer to notify.
+		 */
+		O &observer;
+
+		/**
+		 * The phase being observed.
+		 */
+		LoadPhase phase;
+
+		public:
+		/**
+		 * The number of bytes to report at the end of the phase.
+		 */
+		size_t bytes = 0;
+
+		/**
+		 * Constructor.  Begins the phase.
+		 */
+		ObservedPhase(O &o, LoadPhase p) : observer(o), phase(p)
+		{
+			observer.begin(phase);
+		}
+
+		/**
+		 * Phases cannot be copied.
+		 */
+		ObservedPhase(const ObservedPhase &) = delete;
+
+		/**
+		 * Destructor.  Ends the phase.
+		 */
+		~ObservedPhase()
+		{
+			observer.end(phase, bytes);
+		}
+	};
+
+	/**
+	 * Observer that records a latency histogram and the number of bytes
+	 * processed for each phase.  Recording uses relaxed atomics, so one
+	 * observer can be shared by concurrent loads.
+	 *
+	 * Start times are kept per thread, not per observer, so a thread must
+	 * not interleave loads reported to different histogram observers.
+	 */
+	class HistogramObserver
+	{
+		/**
+		 * The number of histogram buckets.  Bucket `i` counts phases that
+		 * took less than 2^i nanoseconds but at least 2^(i-1).
+		 */
+		static constexpr size_t Buckets = 64;
+
+		/**
+		 * Counters for one phase.
+		 */
+		struct Counters
+		{
+			/**
+			 * The number of times that the phase ended.
+			 */
+			std::atomic<uint64_t> count;
+
+			/**
+			 * The total time spent in the phase.
+			 */
+			std::atomic<uint64_t> nanoseconds;
+
+			/**
+			 * The total number of bytes reported.
+			 */
+			std::atomic<uint64_t> bytes;
+
+			/**
+			 * The latency histogram.
+			 */
+			std::array<std::atomic<uint64_t>, Buckets> buckets;
+		};
+
+		/**
+		 * The counters for each phase.
+		 */
+		std::array<Counters, LoadPhaseCount> phases = {};
+
+		/**
+		 * Returns the start times of the phases in progress on the calling
+		 * thread.
+		 */
+		static auto &starts()
+		{
+			thread_local std::array<std::chrono::steady_clock::time_point,
+			                        LoadPhaseCount>
+			  times;
+			return times;
+		}
+
+		public:
+		/**
+		 * A snapshot of the measurements for one phase.
+		 */
+		struct Stats
+		{
+			/**
+			 * The number of times that the phase ran.
+			 */
+			uint64_t count = 0;
+
+			/**
+			 * The total time spent in the phase.
+			 */
+			std::chrono::nanoseconds total{0};
+
+			/**
+			 * The total number of bytes processed.
+			 */
+			uint64_t bytes = 0;
+
+			/**
+			 * The latency histogram, with bucket `i` counting durations in
+			 * `[2^(i-1), 2^i)` nanoseconds.
+			 */
+			std::array<uint64_t, Buckets> buckets = {};
+
+			/**
+			 * Returns an upper bound on the `q` quantile (between 0 and 1)
+			 * of the latency, to within a factor of two.
+			 */
+			std::chrono::nanoseconds quantile(double q) const
+			{
+				uint64_t target = static_cast<uint64_t>(q * count);
+				uint64_t seen   = 0;
+				for (size_t i = 0; i < Buckets; i++)
+				{
+					seen += buckets[i];
+					if ((seen > target) || (seen == count))
+					{
+						return std::chrono::nanoseconds(
+						  (i < 63) ? (uint64_t(1) << i) : ~uint64_t(0) >> 1);
+					}
+				}
+				return std::chrono::nanoseconds(0);
+			}
+		};
+
+		/**
+		 * Records the start of a phase.
+		 */
+		void begin(LoadPhase phase)
+		{
+			starts()[size_t(phase)] = std::chrono::steady_clock::now();
+		}
+
+		/**
+		 * Records the end of a phase.
+		 */
+		void end(LoadPhase phase, size_t bytes)
+		{
+			auto elapsed = std::chrono::steady_clock::now() -
+			               starts()[size_t(phase)];
+			uint64_t ns  = std::chrono::nanoseconds(elapsed).count();
+			auto    &c   = phases[size_t(phase)];
+			c.count.fetch_add(1, std::memory_order_relaxed);
+			c.nanoseconds.fetch_add(ns, std::memory_order_relaxed);
+			c.bytes.fetch_add(bytes, std::memory_order_relaxed);
+			c.buckets[std::min<size_t>(std::bit_width(ns), Buckets - 1)]
+			  .fetch_add(1, std::memory_order_relaxed);
+		}
+
+		/**
+		 * Returns the measurements for `phase`.
+		 */
+		Stats stats(LoadPhase phase) const
+		{
+			auto &c = phases[size_t(phase)];
+			Stats s;
+			s.count = c.count.load(std::memory_order_relaxed);
+			s.total = std::chrono::nanoseconds(
+			  c.nanoseconds.load(std::memory_order_relaxed));
+			s.bytes = c.bytes.load(std::memory_order_relaxed);
+			for (size_t i = 0; i < Buckets; i++)
+			{
+				s.buckets[i] = c.buckets[i].load(std::memory_order_relaxed);
+			}
+			return s;
+		}
+
+		/**
+		 * Discards all measurements.
+		 */
+		void reset()
+		{
+			for (auto &c : phases)
+			{
+				c.count.store(0, std::memory_order_relaxed);
+				c.nanoseconds.store(0, std::memory_order_relaxed);
+				c.bytes.store(0, std::memory_order_relaxed);
+				for (auto &b : c.buckets)
+				{
+					b.store(0, std::memory_order_relaxed);
+				}
+			}
+		}
+	};
+
+} // namespace CONFIG_DETAIL_NAMESPACE
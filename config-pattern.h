@@ -0,0 +1,208 @@
+// Copyright David Chisnall
+// SPDX-License-Identifier: MIT
+#pragma once
+
+#include "config-generic.h"
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <regex.h>
+#include <span>
+#include <string>
+#include <string_view>
+
+namespace CONFIG_DETAIL_NAMESPACE
+{
+	/**
+	 * A deterministic automaton, built by the generator from a `pattern`,
+	 * that finds whether an ASCII string contains a match for the pattern.
+	 * Bytes are mapped to classes of bytes that the pattern does not
+	 * distinguish, so the transition table has a column per class rather
+	 * than per byte.  State 0 is the start state.
+	 */
+	struct PatternDfa
+	{
+		/**
+		 * Set for states that have seen a match.  These states loop to
+		 * themselves, so the rest of the string does not need to be read.
+		 */
+		static constexpr uint8_t Matched = 1;
+
+		/**
+		 * Set for states that match if the string ends in them, which
+		 * includes matches that end with `$`.
+		 */
+		static constexpr uint8_t AcceptsAtEnd = 2;
+
+		/**
+		 * The class of each ASCII byte.
+		 */
+		std::array<uint8_t, 128> classes;
+
+		/**
+		 * The number of classes.
+		 */
+		uint16_t classCount;
+
+		/**
+		 * The next state for each state and class, indexed by
+		 * `state * classCount + class`.
+		 */
+		std::span<const uint16_t> transitions;
+
+		/**
+		 * The flags for each state.
+		 */
+		std::span<const uint8_t> flags;
+
+		/**
+		 * Returns true if `str`, which must contain only bytes from 1 to 127,
+		 * contains a match.
+		 */
+		constexpr bool matches(std::string_view str) const
+		{
+			uint16_t state = 0;
+			for (unsigned char c : str)
+			{
+				if (flags[state] & Matched)
+				{
+					return true;
+				}
+				state = transitions[state * classCount + classes[c]];
+			}
+			return flags[state] & (Matched | AcceptsAtEnd);
+		}
+	};
+
+	/**
+	 * Matcher for one `pattern` from a schema, shared by every property that
+	 * uses it.  Strings are matched with the pattern's automaton if the
+	 * generator could build one and the string is plain ASCII.  Otherwise,
+	 * they are matched with a POSIX extended regular expression, as libucl
+	 * does, which is compiled once, when it is first needed.
+	 */
+	class PatternMatcher
+	{
+		/**
+		 * The pattern, which must be null terminated.
+		 */
+		const char *pattern;
+
+		/**
+		 * The automaton for the pattern, or null if there is none.
+		 */
+		const PatternDfa *dfa;
+
+		/**
+		 * Guards compiling `regex`.
+		 */
+		mutable std::once_flag compiled;
+
+		/**
+		 * The compiled regular expression, valid if `valid` is set.
+		 */
+		mutable regex_t regex;
+
+		/**
+		 * True if `regex` compiled.  Like libucl, a pattern that does not
+		 * compile matches nothing.
+		 */
+		mutable bool valid = false;
+
+		/**
+		 * Returns true if `str` can be matched by the automaton.
+		 */
+		static bool plain_ascii(std::string_view str)
+		{
+			for (unsigned char c : str)
+			{
+				if ((c == 0) || (c > 127))
+				{
+					return false;
+				}
+			}
+			return true;
+		}
+
+		public:
+		/**
+		 * Constructor, matches the null-terminated pattern `p`, using the
+		 * automaton `d` if it is not null.
+		 */
+		PatternMatcher(const char *p, const PatternDfa *d = nullptr)
+		  : pattern(p), dfa(d)
+		{
+		}
+
+		/**
+		 * Matchers cannot be copied.
+		 */
+		PatternMatcher(const PatternMatcher &) = delete;
+
+		/**
+		 * Destructor, frees the compiled regular expression.
+		 */
+		~PatternMatcher()
+		{
+			if (valid)
+			{
+				regfree(&regex);
+			}
+		}
+
+		/**
+		 * Returns the pattern.
+		 */
+		const char *source() const
+		{
+			return pattern;
+		}
+
+		/**
+		 * Returns true if `str` contains a match.  As with libucl, the
+		 * string ends at its first null byte.
+		 */
+		bool matches(std::string_view str) const
+		{
+			if ((dfa != nullptr) && plain_ascii(str))
+			{
+				return dfa->matches(str);
+			}
+			std::call_once(compiled, [&]() {
+				valid = regcomp(&regex, pattern, REG_EXTENDED | REG_NOSUB) == 0;
+			});
+			// Strings that reach here are rare, so copying them to add a
+			// null terminator is cheap overall.
+			std::string copy{str};
+			return valid && (regexec(&regex, copy.c_str(), 0, nullptr, 0) == 0);
+		}
+	};
+
+	/**
+	 * Checks the strings at the end of `path`, starting from `node`, against
+	 * `matcher`.  Returns false and describes the first mismatch in `err`,
+	 * as libucl would, if there is one.
+	 */
+	inline bool check_pattern(const ucl_object_t        *node,
+	                          std::span<const PathStep> path,
+	                          const PatternMatcher      &matcher,
+	                          ucl_schema_error          *err)
+	{
+		return check_strings(
+		  node, path, [&](const ucl_object_t *str, std::string_view value) {
+			  if (matcher.matches(value))
+			  {
+				  return true;
+			  }
+			  err->code = UCL_SCHEMA_CONSTRAINT;
+			  err->obj  = str;
+			  snprintf(err->msg,
+			           sizeof(err->msg),
+			           "string doesn't match regexp %s",
+			           matcher.source());
+			  return false;
+		  });
+	}
+
+} // namespace CONFIG_DETAIL_NAMESPACE
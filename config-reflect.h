@@ -0,0 +1,65 @@
+// Copyright David Chisnall
+// SPDX-License-Identifier: MIT
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <variant>
+
+namespace CONFIG_DETAIL_NAMESPACE
+{
+	/**
+	 * Description of a property of a generated class, from the table that
+	 * classes generated with `--reflection` expose as `fields`.
+	 */
+	struct FieldInfo
+	{
+		/**
+		 * The name of the property in the schema.
+		 */
+		std::string_view name;
+
+		/**
+		 * The dense ID of the property, which is its index in schema order.
+		 */
+		uint32_t id;
+
+		/**
+		 * The C++ type that the accessor returns, without the
+		 * `std::optional` that wraps optional properties.
+		 */
+		std::string_view type;
+
+		/**
+		 * True if the schema requires the property.
+		 */
+		bool required;
+
+		/**
+		 * The adaptor that the accessor reads the property with.
+		 */
+		std::string_view adaptor;
+	};
+
+	/**
+	 * Returns the ID of the property called `name` in `fields`, or nothing if
+	 * there is no such property.  This is a linear scan, intended for use in
+	 * constant expressions or when resolving names once.
+	 */
+	template<size_t N>
+	constexpr std::optional<uint32_t>
+	find_field(const std::array<FieldInfo, N> &fields, std::string_view name)
+	{
+		for (auto &field : fields)
+		{
+			if (field.name == name)
+			{
+				return field.id;
+			}
+		}
+		return std::nullopt;
+	}
+
+} // namespace CONFIG_DETAIL_NAMESPACE
@@ -0,0 +1,1315 @@
+// Copyright David Chisnall
+// SPDX-License-Identifier: MIT
+#pragma once
+
+#include "config-generic.h"
+#include "config-loader.h"
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace CONFIG_DETAIL_NAMESPACE
+{
+	/**
+	 * Model of a JSON Schema, used by `config-gen` to generate classes and by
+	 * `RuntimeSchema` to interpret schemas that are known only at run time.
+	 */
+	namespace Schema
+	{
+		struct Object;
+		struct Array;
+		struct String;
+		struct Integer;
+		struct Boolean;
+		struct Number;
+
+		/**
+		 * Base class for parts of a JSON Schema.
+		 */
+		class SchemaBase
+		{
+			protected:
+			/**
+			 * The UCL object that this represents.
+			 */
+			UCLPtr obj;
+
+			public:
+			/**
+			 * Constructor, captures an owning reference to a UCL object.
+			 */
+			SchemaBase(const ucl_object_t *o) : obj(o) {}
+
+			/**
+			 * Type adaptor, allows dispatching to a visitor with overloads to all
+			 * of the basic types of schema depending on the value of the `type`
+			 * property.
+			 */
+			using TypeAdaptor = NamedTypeAdaptor<"type",
+			                                     NamedType<"object", Object>,
+			                                     NamedType<"array", Array>,
+			                                     NamedType<"string", String>,
+			                                     NamedType<"integer", Integer>,
+			                                     NamedType<"boolean", Boolean>,
+			                                     NamedType<"number", Number>>;
+
+			/**
+			 * Returns the UCL object that this represents.
+			 */
+			const ucl_object_t *object() const
+			{
+				return obj;
+			}
+
+			/**
+			 * Returns a type adaptor for this object that can be used to dispatch
+			 * based on the value of the `type` field.
+			 */
+			TypeAdaptor get()
+			{
+				return TypeAdaptor(obj);
+			}
+
+			/**
+			 * Types of JSON sub-schema.
+			 */
+			enum Type
+			{
+				/**
+				 * A JSON object.
+				 */
+				TypeObject,
+				/**
+				 * A JSON string.
+				 */
+				TypeString,
+				/**
+				 * A JSON array.
+				 */
+				TypeArray,
+				/**
+				 * A JSON number.
+				 */
+				TypeNumber,
+				/**
+				 * An integer.  This is shorthand for a number with the constraint
+				 * that it must increment in units of 1.
+				 */
+				TypeInteger,
+				/**
+				 * A JSON boolean.
+				 */
+				TypeBool,
+			};
+
+			/**
+			 * Enum adaptor type, maps from a string value from a JSON schema to a
+			 * value in the `Type` `enum`.
+			 */
+			using TypeEnumAdaptor =
+			  EnumAdaptor<Type,
+			              EnumValueMap<Enum{"object", TypeObject},
+			                           Enum{"array", TypeArray},
+			                           Enum{"string", TypeString},
+			                           Enum{"integer", TypeInteger},
+			                           Enum{"boolean", TypeBool},
+			                           Enum{"number", TypeNumber}>>;
+
+			/**
+			 * Returns the type of this schema.
+			 */
+			Type type()
+			{
+				return TypeEnumAdaptor(obj["type"]);
+			}
+
+			/**
+			 * Returns the title of this schema.
+			 */
+			std::string_view title()
+			{
+				return StringViewAdaptor(obj["title"]);
+			}
+
+			/**
+			 * Returns the description of this schame.
+			 */
+			std::optional<std::string_view> description()
+			{
+				return make_optional<StringViewAdaptor>(obj["description"]);
+			}
+
+			/**
+			 * Returns true if this schema is marked with `x-external`, so that
+			 * configs give the path of a separate file that holds the value.
+			 */
+			bool external()
+			{
+				return make_optional<BoolAdaptor, bool>(obj["x-external"])
+				  .value_or(false);
+			}
+		};
+
+		/**
+		 * Array.  Represents a JSON schema array.  This defines a field `items`
+		 * that describes elements of the array.
+		 *
+		 * Tuples, whose leading items each have their own schema, are written
+		 * with `prefixItems`.  libucl validates only the older form, where
+		 * `items` is an array of schemas and `additionalItems` describes the
+		 * rest, so schemas are rewritten into that form with
+		 * `translate_prefix_items` before they are used.
+		 */
+		struct Array : public SchemaBase
+		{
+			using SchemaBase::SchemaBase;
+
+			/**
+			 * The schema for the items of this array.  For tuples, this is
+			 * not an object schema.
+			 */
+			SchemaBase items()
+			{
+				return SchemaBase(obj["items"]);
+			}
+
+			/**
+			 * The schemas of the leading items, if this array is a tuple.
+			 */
+			std::optional<Range<SchemaBase>> tupleItems()
+			{
+				const ucl_object_t *items = obj["items"];
+				if (ucl_object_type(items) != UCL_ARRAY)
+				{
+					return std::nullopt;
+				}
+				return Range<SchemaBase>(items);
+			}
+
+			/**
+			 * The minimum number of items.
+			 */
+			std::optional<int64_t> minItems()
+			{
+				return make_optional<Int64Adaptor>(obj["minItems"]);
+			}
+
+			/**
+			 * The maximum number of items.
+			 */
+			std::optional<int64_t> maxItems()
+			{
+				return make_optional<Int64Adaptor>(obj["maxItems"]);
+			}
+		};
+
+		/**
+		 * A JSON schema string, which may be constrained by a pattern or a
+		 * format.
+		 */
+		struct String : public SchemaBase
+		{
+			using SchemaBase::SchemaBase;
+
+			/**
+			 * The regular expression that valid strings match, if any.
+			 */
+			std::optional<std::string_view> pattern()
+			{
+				return make_optional<StringViewAdaptor, std::string_view>(
+				  obj["pattern"]);
+			}
+
+			/**
+			 * The name of the format of valid strings, such as `ipv4`, if
+			 * any.
+			 */
+			std::optional<std::string_view> format()
+			{
+				return make_optional<StringViewAdaptor, std::string_view>(
+				  obj["format"]);
+			}
+		};
+
+		/**
+		 * A JSON schema number.  This can define an allowed range, and a step size.
+		 */
+		struct Number : public SchemaBase
+		{
+			using SchemaBase::SchemaBase;
+
+			/**
+			 * The minimum value.  Valid numbers are >= this value.
+			 */
+			std::optional<double> minimum()
+			{
+				return make_optional<DoubleAdaptor>(obj["minimum"]);
+			}
+
+			/**
+			 * The exclusive minimum value.  Valid numbers are > this value.
+			 */
+			std::optional<double> exclusiveMinimum()
+			{
+				return make_optional<DoubleAdaptor>(obj["exclusiveMinimum"]);
+			}
+
+			/**
+			 * The maximum value.  Valid numbers are <= this value.
+			 */
+			std::optional<double> maximum()
+			{
+				return make_optional<DoubleAdaptor>(obj["maximum"]);
+			}
+
+			/**
+			 * The exclusive maximum value.  Valid numbers are < this value.
+			 */
+			std::optional<double> exclusiveMaximum()
+			{
+				return make_optional<DoubleAdaptor>(obj["exclusiveMaximum"]);
+			}
+
+			/**
+			 * The step size.  A valid value % this value == 0.
+			 */
+			std::optional<double> multipleOf()
+			{
+				return make_optional<DoubleAdaptor>(obj["multipleOf"]);
+			}
+		};
+
+		/**
+		 * Integer, a kind of number.
+		 */
+		struct Integer : public Number
+		{
+			using Number::Number;
+		};
+
+		/**
+		 * Boolean, a trivial type in JSON schema.
+		 */
+		struct Boolean : public SchemaBase
+		{
+			using SchemaBase::SchemaBase;
+		};
+
+		/**
+		 * A JSON Schema object, contains a set of properties some of which may be
+		 * required, some optional.
+		 */
+		struct Object : public SchemaBase
+		{
+			public:
+			using SchemaBase::SchemaBase;
+
+			/**
+			 * The type for the properties.  This provides an iterable range of
+			 * key-value pairs mapping from name to property.
+			 */
+			using Properties =
+			  Range<PropertyAdaptor<SchemaBase>, PropertyAdaptor<SchemaBase>, true>;
+
+			/**
+			 * The properties of this object.
+			 */
+			Properties properties()
+			{
+				return Properties(obj["properties"]);
+			}
+
+			/**
+			 * The names of any properties that are required.  Properties not
+			 * specified by this collection are optional.
+			 */
+			std::optional<Range<std::string_view, StringViewAdaptor>> required()
+			{
+				return make_optional<Range<std::string_view, StringViewAdaptor>>(
+				  obj["required"]);
+			}
+		};
+
+		/**
+		 * The root of a schema.  This is an object that also defines a schema and a
+		 * unique id.
+		 */
+		class Root : public Object
+		{
+			public:
+			/**
+			 * Constructor, takes an owning reference to a UCL object.
+			 */
+			Root(ucl_object_t *o) : Object(o) {}
+
+			/**
+			 * The schema property.  Should match the JSON Schema schema
+			 */
+			std::string_view schema()
+			{
+				return StringViewAdaptor(obj["$schema"]);
+			}
+
+			/**
+			 * The id property.
+			 */
+			std::string_view id()
+			{
+				return StringViewAdaptor(obj["$id"]);
+			}
+		};
+
+		/**
+		 * Calls `visit` on each subschema directly below `schema`: the values
+		 * of keywords that hold a schema, the elements of keywords that hold
+		 * an array of schemas, and the values of keywords that map names to
+		 * schemas.  Keywords that hold data, such as `default`, `const`,
+		 * `enum` and `examples`, and unknown keywords are not visited.
+		 */
+		template<typename F>
+		void for_each_subschema(const ucl_object_t *schema, F &&visit)
+		{
+			if (ucl_object_type(schema) != UCL_OBJECT)
+			{
+				return;
+			}
+			static constexpr std::string_view SchemaKeywords[] = {
+			  "items",
+			  "additionalItems",
+			  "additionalProperties",
+			  "contains",
+			  "not",
+			  "if",
+			  "then",
+			  "else",
+			  "propertyNames",
+			  "unevaluatedItems",
+			  "unevaluatedProperties",
+			  "allOf",
+			  "anyOf",
+			  "oneOf",
+			  "prefixItems"};
+			static constexpr std::string_view MapKeywords[] = {
+			  "properties",
+			  "patternProperties",
+			  "dependentSchemas",
+			  "dependencies",
+			  "definitions",
+			  "$defs"};
+			auto visitSchemas = [&](const ucl_object_t *value) {
+				if (ucl_object_type(value) == UCL_OBJECT)
+				{
+					visit(const_cast<ucl_object_t *>(value));
+				}
+				else if (ucl_object_type(value) == UCL_ARRAY)
+				{
+					ucl_object_iter_t it = nullptr;
+					while (auto *child = ucl_object_iterate(value, &it, true))
+					{
+						// Elements that are not objects, such as the
+						// property names in `dependencies`, are not schemas.
+						if (ucl_object_type(child) == UCL_OBJECT)
+						{
+							visit(const_cast<ucl_object_t *>(child));
+						}
+					}
+				}
+			};
+			for (auto keyword : SchemaKeywords)
+			{
+				visitSchemas(
+				  ucl_object_lookup_len(schema, keyword.data(), keyword.size()));
+			}
+			for (auto keyword : MapKeywords)
+			{
+				auto *map =
+				  ucl_object_lookup_len(schema, keyword.data(), keyword.size());
+				if (ucl_object_type(map) != UCL_OBJECT)
+				{
+					continue;
+				}
+				ucl_object_iter_t it = nullptr;
+				while (auto *child = ucl_object_iterate(map, &it, true))
+				{
+					visitSchemas(child);
+				}
+			}
+		}
+
+		/**
+		 * Rewrites every tuple in `schema`, in place, from the `prefixItems`
+		 * form into the form that libucl validates: `prefixItems` becomes an
+		 * array-valued `items` and any `items` beside it, which describes the
+		 * rest of the array, becomes `additionalItems`.  Only subschemas are
+		 * rewritten, not data such as `default` values.
+		 *
+		 * If `requireItems` is set, each rewritten tuple also requires all of
+		 * its leading items.  libucl checks only the items that are present,
+		 * so without this a shorter array is valid.
+		 */
+		inline void translate_prefix_items(ucl_object_t *schema,
+		                                   bool          requireItems = false)
+		{
+			if (ucl_object_type(schema) != UCL_OBJECT)
+			{
+				return;
+			}
+			if (auto *prefix = ucl_object_pop_key(schema, "prefixItems"))
+			{
+				if (auto *rest = ucl_object_pop_key(schema, "items"))
+				{
+					ucl_object_insert_key(
+					  schema, rest, "additionalItems", 0, false);
+				}
+				ucl_object_insert_key(schema, prefix, "items", 0, false);
+				int64_t count = prefix->len;
+				if (requireItems && (ucl_object_type(prefix) == UCL_ARRAY) &&
+				    (count > 0))
+				{
+					auto *min = ucl_object_lookup(schema, "minItems");
+					if ((min == nullptr) || (ucl_object_toint(min) < count))
+					{
+						ucl_object_unref(
+						  ucl_object_pop_key(schema, "minItems"));
+						ucl_object_insert_key(schema,
+						                      ucl_object_fromint(count),
+						                      "minItems",
+						                      0,
+						                      false);
+					}
+				}
+			}
+			for_each_subschema(schema, [&](ucl_object_t *child) {
+				translate_prefix_items(child, requireItems);
+			});
+		}
+	} // namespace Schema
+
+
+	class RuntimeSchema;
+	class RuntimeObject;
+
+	template<typename T>
+	class RuntimeArray;
+
+	/**
+	 * Handle to a property in a `RuntimeSchema`, resolved once from a path.
+	 * Reads through a handle index a table of the nodes that was filled in
+	 * when the object was loaded, rather than looking up keys, so they cost
+	 * about the same as a generated accessor.  `T` is the type that reads
+	 * return.  Handles are valid only for objects loaded with the schema
+	 * that resolved them.
+	 */
+	template<typename T>
+	class PathHandle
+	{
+		friend class RuntimeSchema;
+		friend class RuntimeObject;
+
+		/**
+		 * The layout that the property belongs to: the root object, or the
+		 * items of an array of objects.
+		 */
+		uint32_t layout;
+
+		/**
+		 * The index of the property in its layout.
+		 */
+		uint32_t slot;
+
+		/**
+		 * Constructor, used by `RuntimeSchema`.
+		 */
+		PathHandle(uint32_t l, uint32_t s) : layout(l), slot(s) {}
+	};
+
+	/**
+	 * Error from resolving a path against a runtime schema.
+	 */
+	struct PathError
+	{
+		/**
+		 * Human-readable description of the error.
+		 */
+		std::string message;
+	};
+
+	/**
+	 * A schema loaded at run time.  The schema is flattened into layouts, one
+	 * for the root object and one for the items of each array of objects.
+	 * Every property reachable from a layout's object without passing
+	 * through an array has a slot in that layout, with its parent's slot
+	 * before it.
+	 *
+	 * Paths are written either with dots (`tls.certificate`) or as JSON
+	 * Pointers (`/tls/certificate`).  Properties of the items of arrays are
+	 * addressed in dotted paths with `[]` (`backends[].host`), and are read
+	 * from the objects produced by iterating the array.
+	 */
+	class RuntimeSchema
+	{
+		friend class RuntimeObject;
+
+		template<typename T>
+		friend class RuntimeArray;
+
+		public:
+		/**
+		 * The types that a runtime schema can describe.
+		 */
+		using Type = Schema::SchemaBase::Type;
+
+		private:
+		/**
+		 * Marker for a missing parent, layout or item type.
+		 */
+		static constexpr uint32_t None = std::numeric_limits<uint32_t>::max();
+
+		/**
+		 * Description of a value in the schema.
+		 */
+		struct TypeInfo
+		{
+			/**
+			 * The type of the value.
+			 */
+			Type type;
+
+			/**
+			 * The smallest value allowed, for integers.
+			 */
+			int64_t minimum = std::numeric_limits<int64_t>::min();
+
+			/**
+			 * The largest value allowed, for integers.
+			 */
+			int64_t maximum = std::numeric_limits<int64_t>::max();
+
+			/**
+			 * For objects, the layout that holds their properties.
+			 */
+			uint32_t layout = None;
+
+			/**
+			 * For arrays, the index of the type of their items.
+			 */
+			uint32_t items = None;
+		};
+
+		/**
+		 * A property in a layout.
+		 */
+		struct Field
+		{
+			/**
+			 * The key of the property in its parent.
+			 */
+			std::string key;
+
+			/**
+			 * The slot of the parent object, or `None` if the parent is the
+			 * object that the layout describes.
+			 */
+			uint32_t parent;
+
+			/**
+			 * The index of the type of the property.
+			 */
+			uint32_t type;
+		};
+
+		/**
+		 * The properties of the root object or of the items of an array of
+		 * objects.
+		 */
+		using Layout = std::vector<Field>;
+
+		/**
+		 * The schema, used for validation.
+		 */
+		UCLPtr schema;
+
+		/**
+		 * Every type in the schema.
+		 */
+		std::vector<TypeInfo> types;
+
+		/**
+		 * Every layout in the schema.  The root object's layout is first.
+		 */
+		std::vector<Layout> layouts;
+
+		/**
+		 * Records the description of the schema `s` and returns its index,
+		 * or `None` if it has a type that is not supported.  The properties
+		 * of objects are added to `layout`, under `parent`, unless `layout`
+		 * is `None`, in which case they get a new layout.
+		 */
+		uint32_t
+		add_type(Schema::SchemaBase s, uint32_t layout, uint32_t parent)
+		{
+			std::optional<TypeInfo> info;
+			s.get().visit(
+			  [&](Schema::Object o) {
+				  info = TypeInfo{Type::TypeObject};
+				  if (layout == None)
+				  {
+					  layout = static_cast<uint32_t>(layouts.size());
+					  layouts.emplace_back();
+					  parent = None;
+				  }
+				  info->layout = layout;
+				  add_properties(o, layout, parent);
+			  },
+			  [&](Schema::Array a) {
+				  info        = TypeInfo{Type::TypeArray};
+				  info->items = add_type(a.items(), None, None);
+			  },
+			  [&](Schema::String) { info = TypeInfo{Type::TypeString}; },
+			  [&](Schema::Boolean) { info = TypeInfo{Type::TypeBool}; },
+			  [&](Schema::Integer i) {
+				  info = TypeInfo{Type::TypeInteger};
+				  if (auto min = i.minimum())
+				  {
+					  info->minimum = clamp(std::ceil(*min));
+				  }
+				  if (auto min = i.exclusiveMinimum())
+				  {
+					  info->minimum = clamp(std::floor(*min) + 1);
+				  }
+				  if (auto max = i.maximum())
+				  {
+					  info->maximum = clamp(std::floor(*max));
+				  }
+				  if (auto max = i.exclusiveMaximum())
+				  {
+					  info->maximum = clamp(std::ceil(*max) - 1);
+				  }
+			  },
+			  [&](Schema::Number) { info = TypeInfo{Type::TypeNumber}; });
+			if (!info)
+			{
+				return None;
+			}
+			types.push_back(*info);
+			return static_cast<uint32_t>(types.size() - 1);
+		}
+
+		/**
+		 * Adds the properties of `o` to `layout`, as children of `parent`.
+		 */
+		void add_properties(Schema::Object o, uint32_t layout, uint32_t parent)
+		{
+			for (auto prop : o.properties())
+			{
+				uint32_t slot = static_cast<uint32_t>(layouts[layout].size());
+				layouts[layout].push_back(
+				  Field{std::string(prop.key()), parent, None});
+				// Nested objects share their parent's layout, arrays and
+				// scalars do not add to it.
+				uint32_t type = add_type(prop, layout, slot);
+				if (type == None)
+				{
+					// Unsupported types cannot have handles, but keep their
+					// slots so that the indexes of their children are stable.
+					continue;
+				}
+				layouts[layout][slot].type = type;
+			}
+		}
+
+		/**
+		 * Converts a bound from a schema to an integer.
+		 */
+		static int64_t clamp(double value)
+		{
+			if (value <= double(std::numeric_limits<int64_t>::min()))
+			{
+				return std::numeric_limits<int64_t>::min();
+			}
+			if (value >= double(std::numeric_limits<int64_t>::max()))
+			{
+				return std::numeric_limits<int64_t>::max();
+			}
+			return static_cast<int64_t>(value);
+		}
+
+		/**
+		 * Splits `path` into property names, with `[]` for the items of an
+		 * array.
+		 */
+		static std::vector<std::string> split_path(std::string_view path)
+		{
+			std::vector<std::string> segments;
+			if (path.starts_with('/'))
+			{
+				// JSON Pointer: `/`-separated, with `~1` for `/` and `~0`
+				// for `~`.
+				size_t start = 1;
+				while (start <= path.size())
+				{
+					size_t end = path.find('/', start);
+					if (end == std::string_view::npos)
+					{
+						end = path.size();
+					}
+					std::string segment;
+					for (size_t i = start; i < end; i++)
+					{
+						if ((path[i] == '~') && (i + 1 < end))
+						{
+							segment += (path[++i] == '1') ? '/' : '~';
+							continue;
+						}
+						segment += path[i];
+					}
+					segments.push_back(std::move(segment));
+					start = end + 1;
+				}
+				return segments;
+			}
+			size_t start = 0;
+			while (start <= path.size())
+			{
+				size_t end = path.find_first_of(".[", start);
+				if (end == std::string_view::npos)
+				{
+					end = path.size();
+				}
+				if (end > start)
+				{
+					segments.emplace_back(path.substr(start, end - start));
+				}
+				if ((end < path.size()) && (path[end] == '['))
+				{
+					if (path.substr(end, 2) != "[]")
+					{
+						segments.emplace_back(path.substr(end));
+						break;
+					}
+					segments.emplace_back("[]");
+					end++;
+				}
+				start = end + 1;
+			}
+			return segments;
+		}
+
+		/**
+		 * Returns an error if values of type `info` cannot be read as `T`.
+		 */
+		template<typename T>
+		std::optional<PathError> check_type(const TypeInfo   &info,
+		                                    std::string_view path) const
+		{
+			auto mismatch = [&](std::string_view expected) {
+				return PathError{std::string(path) + " is not " +
+				                 std::string(expected)};
+			};
+			if constexpr (std::is_same_v<T, std::string_view>)
+			{
+				if (info.type != Type::TypeString)
+				{
+					return mismatch("a string");
+				}
+			}
+			else if constexpr (std::is_same_v<T, bool>)
+			{
+				if (info.type != Type::TypeBool)
+				{
+					return mismatch("a boolean");
+				}
+			}
+			else if constexpr (std::is_integral_v<T>)
+			{
+				if (info.type != Type::TypeInteger)
+				{
+					return mismatch("an integer");
+				}
+				if (!std::in_range<T>(info.minimum) ||
+				    !std::in_range<T>(info.maximum))
+				{
+					return PathError{std::string(path) +
+					                 " has values that do not fit in the "
+					                 "requested type"};
+				}
+			}
+			else if constexpr (std::is_floating_point_v<T>)
+			{
+				if ((info.type != Type::TypeNumber) &&
+				    (info.type != Type::TypeInteger))
+				{
+					return mismatch("a number");
+				}
+			}
+			else if constexpr (std::is_same_v<T, RuntimeObject>)
+			{
+				if (info.type != Type::TypeObject)
+				{
+					return mismatch("an object");
+				}
+			}
+			else
+			{
+				// `T` is a `RuntimeArray`, check its items too.
+				if (info.type != Type::TypeArray)
+				{
+					return mismatch("an array");
+				}
+				if (info.items == None)
+				{
+					return PathError{std::string(path) +
+					                 " has items of an unsupported type"};
+				}
+				return check_type<typename T::value_type>(
+				  types[info.items], std::string(path) + "[]");
+			}
+			return std::nullopt;
+		}
+
+		/**
+		 * Constructor, flattens `s`.  Use `create` to construct schemas.
+		 */
+		explicit RuntimeSchema(const ucl_object_t *s) : schema(s)
+		{
+			layouts.emplace_back();
+			add_properties(Schema::Object(s), 0, None);
+		}
+
+		public:
+		/**
+		 * Returns a runtime schema for the JSON Schema `s`, which must
+		 * describe an object.
+		 */
+		static std::shared_ptr<const RuntimeSchema>
+		create(const ucl_object_t *s)
+		{
+			return std::shared_ptr<const RuntimeSchema>(new RuntimeSchema(s));
+		}
+
+		/**
+		 * Resolves `path` to a handle for reading it as a `T`, which may be
+		 * `std::string_view`, `bool`, an integer or floating-point type,
+		 * `RuntimeObject` or `RuntimeArray` of any of these.  Integer types
+		 * must be able to hold every value that the schema allows.  Returns
+		 * an error if the path is not in the schema or its values cannot be
+		 * read as a `T`.
+		 */
+		template<typename T>
+		std::variant<PathHandle<T>, PathError>
+		resolve(std::string_view path) const
+		{
+			auto     segments = split_path(path);
+			uint32_t layout   = 0;
+			uint32_t parent   = None;
+			uint32_t slot     = None;
+			if (segments.empty())
+			{
+				return PathError{"empty path"};
+			}
+			for (auto &segment : segments)
+			{
+				if (segment == "[]")
+				{
+					// Move into the items of the array, which must be
+					// objects for any further segments to be resolved.
+					if ((slot == None) ||
+					    (types[layouts[layout][slot].type].type !=
+					     Type::TypeArray))
+					{
+						return PathError{std::string(path) +
+						                 ": [] follows something that is "
+						                 "not an array"};
+					}
+					auto items = types[layouts[layout][slot].type].items;
+					if ((items == None) ||
+					    (types[items].type != Type::TypeObject))
+					{
+						return PathError{
+						  std::string(path) +
+						  ": only properties of items that are objects "
+						  "can be resolved"};
+					}
+					layout = types[items].layout;
+					parent = None;
+					slot   = None;
+					continue;
+				}
+				if (slot != None)
+				{
+					parent = slot;
+				}
+				slot = None;
+				for (uint32_t i = 0; i < layouts[layout].size(); i++)
+				{
+					auto &field = layouts[layout][i];
+					if ((field.parent == parent) && (field.key == segment) &&
+					    (field.type != None))
+					{
+						slot = i;
+						break;
+					}
+				}
+				if (slot == None)
+				{
+					return PathError{std::string(path) + ": no property " +
+					                 segment};
+				}
+			}
+			if (slot == None)
+			{
+				return PathError{std::string(path) +
+				                 ": array items are read by iterating the "
+				                 "array"};
+			}
+			if (auto error =
+			      check_type<T>(types[layouts[layout][slot].type], path))
+			{
+				return *error;
+			}
+			return PathHandle<T>(layout, slot);
+		}
+
+		/**
+		 * Returns the schema that configs are validated against.
+		 */
+		const ucl_object_t *object() const
+		{
+			return schema;
+		}
+	};
+
+	/**
+	 * An object read through a `RuntimeSchema`: either a config, or a nested
+	 * object or array item within one.  When an object is created, every
+	 * property in its layout is looked up once, so reads through handles do
+	 * not look up keys.
+	 */
+	class RuntimeObject
+	{
+		template<typename T>
+		friend class RuntimeArray;
+
+		/**
+		 * The nodes of the properties in a layout, indexed by slot.
+		 */
+		using Slots = std::vector<const ucl_object_t *>;
+
+		/**
+		 * The schema.
+		 */
+		std::shared_ptr<const RuntimeSchema> schema;
+
+		/**
+		 * The object.  Holds a reference to keep the nodes in `slots` alive.
+		 */
+		UCLPtr obj;
+
+		/**
+		 * The layout that `slots` was filled in for.
+		 */
+		uint32_t layout;
+
+		/**
+		 * The nodes of the properties in the layout.  Nested objects share
+		 * the table of the object that contains them.
+		 */
+		std::shared_ptr<const Slots> slots;
+
+		/**
+		 * Constructor, used for nested objects.
+		 */
+		RuntimeObject(std::shared_ptr<const RuntimeSchema> s,
+		              const ucl_object_t                  *o,
+		              uint32_t                             l,
+		              std::shared_ptr<const Slots>         table)
+		  : schema(std::move(s)), obj(o), layout(l), slots(std::move(table))
+		{
+		}
+
+		/**
+		 * Returns the value of `node`, which has the type at index `type` in
+		 * the schema, as a `T`.
+		 */
+		template<typename T>
+		T read(const ucl_object_t *node, uint32_t type) const
+		{
+			if constexpr (std::is_same_v<T, RuntimeObject>)
+			{
+				// Objects in the same layout share its slots.  Objects
+				// reached through arrays are the roots of their own layouts
+				// and are handled by `RuntimeArray`.
+				return RuntimeObject(
+				  schema, node, schema->types[type].layout, slots);
+			}
+			else if constexpr (std::is_constructible_v<
+			                     T,
+			                     std::shared_ptr<const RuntimeSchema>,
+			                     const ucl_object_t *,
+			                     uint32_t>)
+			{
+				return T(schema, node, schema->types[type].items);
+			}
+			else
+			{
+				return ValueAdaptor<T, UCLBackend>(node);
+			}
+		}
+
+		public:
+		/**
+		 * Constructor, reads `o` with the layout `l` of `s`.
+		 */
+		RuntimeObject(std::shared_ptr<const RuntimeSchema> s,
+		              const ucl_object_t                  *o,
+		              uint32_t                             l = 0)
+		  : schema(std::move(s)), obj(o), layout(l)
+		{
+			auto &fields = schema->layouts[layout];
+			auto  table  = std::make_shared<Slots>(fields.size());
+			for (size_t i = 0; i < fields.size(); i++)
+			{
+				auto               &field = fields[i];
+				const ucl_object_t *parent =
+				  (field.parent == RuntimeSchema::None) ? o
+				                                        : (*table)[field.parent];
+				(*table)[i] = (parent == nullptr)
+				                ? nullptr
+				                : ucl_object_lookup_len(
+				                    parent, field.key.data(), field.key.size());
+			}
+			slots = std::move(table);
+		}
+
+		/**
+		 * Returns the value of the property for `handle`, or nothing if it is
+		 * absent.  `handle` must come from the schema that this was loaded
+		 * with, and from the same layout: handles for the root object are
+		 * used with configs and the objects nested in them, handles for the
+		 * items of an array with the objects produced by iterating it.
+		 */
+		template<typename T>
+		std::optional<T> get(PathHandle<T> handle) const
+		{
+			assert(handle.layout == layout);
+			auto *node = (*slots)[handle.slot];
+			if (node == nullptr)
+			{
+				return std::nullopt;
+			}
+			return read<T>(node, schema->layouts[layout][handle.slot].type);
+		}
+
+		/**
+		 * Returns the value of the property for `handle`, or `fallback` if it
+		 * is absent.
+		 */
+		template<typename T>
+		T get_or(PathHandle<T> handle, std::type_identity_t<T> fallback) const
+		{
+			return get(handle).value_or(std::move(fallback));
+		}
+
+		/**
+		 * Returns the underlying UCL object.
+		 */
+		const ucl_object_t *object() const
+		{
+			return obj;
+		}
+	};
+
+	/**
+	 * An array read through a `RuntimeSchema`, iterable as a range of `T`.
+	 * Items that are objects are the roots of their own layouts, and their
+	 * properties are read with handles resolved from `array[].property`
+	 * paths.
+	 */
+	template<typename T>
+	class RuntimeArray
+	{
+		friend class RuntimeObject;
+
+		/**
+		 * The schema.
+		 */
+		std::shared_ptr<const RuntimeSchema> schema;
+
+		/**
+		 * The array.
+		 */
+		UCLPtr array;
+
+		/**
+		 * The index of the type of the items.
+		 */
+		uint32_t items;
+
+		public:
+		/**
+		 * The type of the items.
+		 */
+		using value_type = T;
+
+		/**
+		 * Constructor, reads `a` as an array whose items have the type at
+		 * index `i` in `s`.
+		 */
+		RuntimeArray(std::shared_ptr<const RuntimeSchema> s,
+		             const ucl_object_t                  *a,
+		             uint32_t                             i)
+		  : schema(std::move(s)), array(a), items(i)
+		{
+		}
+
+		/**
+		 * Returns the number of items.
+		 */
+		size_t size() const
+		{
+			const ucl_object_t *a = array;
+			return (ucl_object_type(a) == UCL_ARRAY) ? a->len : 0;
+		}
+
+		/**
+		 * Returns true if there are no items.
+		 */
+		bool empty() const
+		{
+			return size() == 0;
+		}
+
+		/**
+		 * Returns the item at `index`, which must be less than `size()`.
+		 */
+		T operator[](size_t index) const
+		{
+			auto *node = ucl_array_find_index(array, index);
+			auto &info = schema->types[items];
+			if constexpr (std::is_same_v<T, RuntimeObject>)
+			{
+				return RuntimeObject(schema, node, info.layout);
+			}
+			else if constexpr (std::is_constructible_v<
+			                     T,
+			                     std::shared_ptr<const RuntimeSchema>,
+			                     const ucl_object_t *,
+			                     uint32_t>)
+			{
+				return T(schema, node, info.items);
+			}
+			else
+			{
+				return ValueAdaptor<T, UCLBackend>(node);
+			}
+		}
+
+		/**
+		 * Iterator over the items.
+		 */
+		class Iter
+		{
+			/**
+			 * The array.
+			 */
+			const RuntimeArray *array;
+
+			/**
+			 * The index of the current item.
+			 */
+			size_t index;
+
+			public:
+			/**
+			 * Constructor, refers to item `i` of `a`.
+			 */
+			Iter(const RuntimeArray *a, size_t i) : array(a), index(i) {}
+
+			/**
+			 * Returns the current item.
+			 */
+			T operator*() const
+			{
+				return (*array)[index];
+			}
+
+			/**
+			 * Advances to the next item.
+			 */
+			Iter &operator++()
+			{
+				index++;
+				return *this;
+			}
+
+			/**
+			 * Non-equality comparison, used to terminate range-based for
+			 * loops.
+			 */
+			bool operator!=(const Iter &other) const
+			{
+				return index != other.index;
+			}
+		};
+
+		/**
+		 * Returns an iterator to the first item.
+		 */
+		Iter begin() const
+		{
+			return {this, 0};
+		}
+
+		/**
+		 * Returns an iterator past the last item.
+		 */
+		Iter end() const
+		{
+			return {this, size()};
+		}
+	};
+
+	/**
+	 * Validates `obj` against `schema` and returns it as a runtime config,
+	 * or returns the validation error.
+	 */
+	inline std::variant<RuntimeObject, ucl_schema_error>
+	make_runtime_config(std::shared_ptr<const RuntimeSchema> schema,
+	                    const ucl_object_t                  *obj)
+	{
+		ucl_schema_error err;
+		if (!ucl_object_validate(schema->object(), obj, &err))
+		{
+			return err;
+		}
+		return RuntimeObject(std::move(schema), obj);
+	}
+
+	/**
+	 * Loads the JSON Schema at `path` as a runtime schema.
+	 */
+	inline std::variant<std::shared_ptr<const RuntimeSchema>, LoadError>
+	load_runtime_schema(const std::filesystem::path &path)
+	{
+		auto parsed = parse_file(path);
+		if (auto *err = std::get_if<LoadError>(&parsed))
+		{
+			return std::move(*err);
+		}
+		auto *obj = std::get<ucl_object_t *>(parsed);
+		Schema::translate_prefix_items(obj);
+		auto schema = RuntimeSchema::create(obj);
+		ucl_object_unref(obj);
+		return schema;
+	}
+
+} // namespace CONFIG_DETAIL_NAMESPACE
@@ -0,0 +1,420 @@
+// Copyright David Chisnall
+// SPDX-License-Identifier: MIT
+#pragma once
+
+#include "config-flat.h"
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <memory>
+#include <new>
+#include <optional>
+#include <span>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <variant>
+
+namespace CONFIG_DETAIL_NAMESPACE
+{
+	/**
+	 * A POSIX shared-memory region that holds the flat image of the most
+	 * recently published config.  The region has two buffers.  Publishing
+	 * writes the buffer that readers are not directed to and then flips
+	 * between them, so a publish never disturbs readers of the current
+	 * config.  Each buffer has a sequence number that is odd while it is
+	 * being written, which readers check before and after copying it out
+	 * (a seqlock), so a reader that is overtaken by two publishes retries
+	 * rather than seeing a torn image.
+	 */
+	class SharedConfigRegion
+	{
+		/**
+		 * The control block at the start of the region.
+		 */
+		struct Header
+		{
+			/**
+			 * Identifies config regions.
+			 */
+			static constexpr uint64_t Magic = 0x314d48534746432eULL;
+
+			/**
+			 * `Magic`, written last when the region is created.
+			 */
+			std::atomic<uint64_t> magic;
+
+			/**
+			 * The capacity of each buffer in bytes.
+			 */
+			uint64_t capacity;
+
+			/**
+			 * The number of configs published so far.
+			 */
+			std::atomic<uint64_t> generation;
+
+			/**
+			 * The buffer that holds the current config.
+			 */
+			std::atomic<uint32_t> active;
+
+			/**
+			 * Set while a process is publishing.
+			 */
+			std::atomic<uint32_t> publishing;
+
+			/**
+			 * The sequence number of each buffer.
+			 */
+			std::atomic<uint64_t> sequence[2];
+
+			/**
+			 * The size of the image in each buffer.
+			 */
+			std::atomic<uint64_t> size[2];
+		};
+
+		static_assert(std::atomic<uint64_t>::is_always_lock_free,
+		              "Shared-memory configs need lock-free 64-bit atomics");
+
+		/**
+		 * The offset of the first buffer from the start of the region.
+		 */
+		static constexpr size_t BufferOffset = 64;
+
+		static_assert(sizeof(Header) <= BufferOffset);
+
+		/**
+		 * The mapping.
+		 */
+		void *mapping;
+
+		/**
+		 * The size of the mapping.
+		 */
+		size_t mappingSize;
+
+		/**
+		 * Constructor, takes ownership of a mapping.
+		 */
+		SharedConfigRegion(void *m, size_t s) : mapping(m), mappingSize(s) {}
+
+		/**
+		 * Returns the control block.
+		 */
+		Header *header() const
+		{
+			return static_cast<Header *>(mapping);
+		}
+
+		/**
+		 * Returns buffer `index`.
+		 */
+		std::byte *buffer(uint32_t index) const
+		{
+			return static_cast<std::byte *>(mapping) + BufferOffset +
+			       index * header()->capacity;
+		}
+
+		/**
+		 * Returns an error describing the last failed system call.
+		 */
+		static LoadError system_error(const std::string &name,
+		                              const char        *what)
+		{
+			return LoadError{name + ": " + what + ": " + strerror(errno)};
+		}
+
+		public:
+		/**
+		 * Creates the region `name` with buffers of `capacity` bytes, and
+		 * maps it for publishing.  `name` is a POSIX shared-memory name, such
+		 * as `/myserver-config`.  An existing region with the same name is
+		 * removed first: processes attached to it keep the old region, and
+		 * must attach again to see configs published to the new one.
+		 */
+		static std::variant<std::shared_ptr<SharedConfigRegion>, LoadError>
+		create(const std::string &name, size_t capacity)
+		{
+			capacity = (capacity + 63) & ~size_t(63);
+			shm_unlink(name.c_str());
+			int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+			if (fd < 0)
+			{
+				return system_error(name, "shm_open");
+			}
+			size_t size = BufferOffset + 2 * capacity;
+			if (ftruncate(fd, size) != 0)
+			{
+				auto error = system_error(name, "ftruncate");
+				close(fd);
+				return error;
+			}
+			void *m =
+			  mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+			close(fd);
+			if (m == MAP_FAILED)
+			{
+				return system_error(name, "mmap");
+			}
+			// The region is zero filled, so only the fields that are not zero
+			// need to be set.
+			auto *h     = new (m) Header{};
+			h->capacity = capacity;
+			h->magic.store(Header::Magic, std::memory_order_release);
+			return std::shared_ptr<SharedConfigRegion>(
+			  new SharedConfigRegion(m, size));
+		}
+
+		/**
+		 * Maps the existing region `name` read-only, for reading.
+		 */
+		static std::variant<std::shared_ptr<const SharedConfigRegion>, LoadError>
+		attach(const std::string &name)
+		{
+			int fd = shm_open(name.c_str(), O_RDONLY, 0);
+			if (fd < 0)
+			{
+				return system_error(name, "shm_open");
+			}
+			struct stat sb;
+			if (fstat(fd, &sb) != 0)
+			{
+				auto error = system_error(name, "fstat");
+				close(fd);
+				return error;
+			}
+			size_t size = sb.st_size;
+			if (size < BufferOffset)
+			{
+				close(fd);
+				return LoadError{name + ": not a config region"};
+			}
+			void *m = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+			close(fd);
+			if (m == MAP_FAILED)
+			{
+				return system_error(name, "mmap");
+			}
+			std::shared_ptr<const SharedConfigRegion> region(
+			  new SharedConfigRegion(m, size));
+			auto *h = region->header();
+			if ((h->magic.load(std::memory_order_acquire) != Header::Magic) ||
+			    (BufferOffset + 2 * h->capacity > size))
+			{
+				return LoadError{name + ": not a config region"};
+			}
+			return region;
+		}
+
+		/**
+		 * Removes the region `name`.  Processes that have it mapped can
+		 * continue to use it.
+		 */
+		static bool remove(const std::string &name)
+		{
+			return shm_unlink(name.c_str()) == 0;
+		}
+
+		/**
+		 * Regions cannot be copied.
+		 */
+		SharedConfigRegion(const SharedConfigRegion &) = delete;
+
+		/**
+		 * Destructor, unmaps the region.
+		 */
+		~SharedConfigRegion()
+		{
+			munmap(mapping, mappingSize);
+		}
+
+		/**
+		 * Returns the capacity of each buffer in bytes.
+		 */
+		size_t capacity() const
+		{
+			return header()->capacity;
+		}
+
+		/**
+		 * Returns the number of configs published so far.
+		 */
+		uint64_t generation() const
+		{
+			return header()->generation.load(std::memory_order_acquire);
+		}
+
+		/**
+		 * Publishes the flat image `image` and returns its generation.
+		 * Fails if the image does not fit or another process is publishing.
+		 */
+		std::variant<uint64_t, LoadError>
+		publish(std::span<const std::byte> image)
+		{
+			auto *h = header();
+			if (image.size() > h->capacity)
+			{
+				return LoadError{"config does not fit in the shared region"};
+			}
+			if (h->publishing.exchange(1, std::memory_order_acquire) != 0)
+			{
+				return LoadError{"another process is publishing a config"};
+			}
+			uint32_t index = 1 - h->active.load(std::memory_order_relaxed);
+			uint64_t seq   = h->sequence[index].load(std::memory_order_relaxed);
+			h->sequence[index].store(seq + 1, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_release);
+			memcpy(buffer(index), image.data(), image.size());
+			h->size[index].store(image.size(), std::memory_order_relaxed);
+			h->sequence[index].store(seq + 2, std::memory_order_release);
+			h->active.store(index, std::memory_order_release);
+			auto generation =
+			  h->generation.fetch_add(1, std::memory_order_acq_rel) + 1;
+			h->publishing.store(0, std::memory_order_release);
+			return generation;
+		}
+
+		/**
+		 * Copies the current image out of the region and returns it, along
+		 * with its generation.  Retries if a publish overwrites the image
+		 * while it is being copied.  Returns a `LoadError` if nothing has
+		 * been published.
+		 */
+		std::variant<std::pair<std::shared_ptr<const FlatImage>, uint64_t>,
+		             LoadError>
+		read() const
+		{
+			auto *h = header();
+			for (;;)
+			{
+				uint64_t generation =
+				  h->generation.load(std::memory_order_acquire);
+				if (generation == 0)
+				{
+					return LoadError{"no config has been published"};
+				}
+				uint32_t index = h->active.load(std::memory_order_acquire);
+				uint64_t seq = h->sequence[index].load(std::memory_order_acquire);
+				uint64_t size = h->size[index].load(std::memory_order_relaxed);
+				if ((seq & 1) || (size > h->capacity))
+				{
+					std::this_thread::yield();
+					continue;
+				}
+				auto image = std::make_shared<FlatImage>(size);
+				memcpy(image->data(), buffer(index), size);
+				std::atomic_thread_fence(std::memory_order_acquire);
+				if (h->sequence[index].load(std::memory_order_relaxed) == seq)
+				{
+					return std::pair{std::shared_ptr<const FlatImage>(image),
+					                 generation};
+				}
+			}
+		}
+	};
+
+	/**
+	 * Reads configs of type `Config` (a generated class instantiated with
+	 * `FlatBackend`) that another process publishes to a shared region.
+	 * Each reader keeps a private copy of the most recent config that it
+	 * read, so configs that callers hold remain valid whatever the
+	 * publisher does.
+	 */
+	template<typename Config>
+	class SharedConfigReader
+	{
+		/**
+		 * The region.
+		 */
+		std::shared_ptr<const SharedConfigRegion> region;
+
+		/**
+		 * The generation of `config`, or zero if nothing has been read.
+		 */
+		uint64_t seen = 0;
+
+		/**
+		 * The most recent config read from the region.
+		 */
+		std::optional<Config> config;
+
+		public:
+		/**
+		 * Constructor, reads from `r`.
+		 */
+		explicit SharedConfigReader(std::shared_ptr<const SharedConfigRegion> r)
+		  : region(std::move(r))
+		{
+		}
+
+		/**
+		 * Attaches to the region `name`.
+		 */
+		static std::variant<SharedConfigReader, LoadError>
+		attach(const std::string &name)
+		{
+			auto result = SharedConfigRegion::attach(name);
+			if (auto *error = std::get_if<LoadError>(&result))
+			{
+				return std::move(*error);
+			}
+			return SharedConfigReader(
+			  std::get<std::shared_ptr<const SharedConfigRegion>>(result));
+		}
+
+		/**
+		 * Returns true if a config has been published since the last call
+		 * to `current`.  This is a single load from shared memory, so it can
+		 * be polled cheaply.
+		 */
+		bool changed() const
+		{
+			return region->generation() != seen;
+		}
+
+		/**
+		 * Returns the generation of the config that `current` last
+		 * returned, or zero if it has not returned one.
+		 */
+		uint64_t generation() const
+		{
+			return seen;
+		}
+
+		/**
+		 * Returns the most recently published config.  If nothing has been
+		 * published since the last call, returns the same config again
+		 * without touching the region.  Otherwise copies the new image out
+		 * of the region, which does not parse or validate it again.
+		 */
+		std::variant<Config, LoadError> current()
+		{
+			if (!changed() && config)
+			{
+				return *config;
+			}
+			auto result = region->read();
+			if (auto *error = std::get_if<LoadError>(&result))
+			{
+				return std::move(*error);
+			}
+			auto &[image, generation] =
+			  std::get<std::pair<std::shared_ptr<const FlatImage>, uint64_t>>(
+			    result);
+			auto root = open_flat(image);
+			if (auto *error = std::get_if<LoadError>(&root))
+			{
+				return std::move(*error);
+			}
+			config.emplace(std::get<FlatNode>(root));
+			seen = generation;
+			return *config;
+		}
+	};
+
+} // namespace CONFIG_DETAIL_NAMESPACE
@@ -0,0 +1,354 @@
+// Copyright David Chisnall
+// SPDX-License-Identifier: MIT
+#pragma once
+
+#include "config-loader.h"
+#include <filesystem>
+#include <memory>
+#include <simdjson.h>
+#include <string_view>
+#include <variant>
+
+namespace CONFIG_DETAIL_NAMESPACE
+{
+	/**
+	 * Handle to a value in a JSON document parsed by simdjson.  Every handle
+	 * shares ownership of its document, so values remain valid for as long
+	 * as any config refers to them.  A default-constructed handle represents
+	 * an absent value.
+	 */
+	class JsonNode
+	{
+		/**
+		 * The document that contains the value.
+		 */
+		std::shared_ptr<const simdjson::dom::document> document;
+
+		/**
+		 * The value, if `document` is not null.
+		 */
+		simdjson::dom::element element;
+
+		public:
+		/**
+		 * Default constructor, represents an absent value.
+		 */
+		JsonNode() = default;
+
+		/**
+		 * Constructor, refers to the value `e` in `d`.
+		 */
+		JsonNode(std::shared_ptr<const simdjson::dom::document> d,
+		         simdjson::dom::element                         e)
+		  : document(std::move(d)), element(e)
+		{
+		}
+
+		/**
+		 * Returns true if this refers to a value.
+		 */
+		explicit operator bool() const
+		{
+			return document != nullptr;
+		}
+
+		/**
+		 * Returns the value.  Must not be called on an absent value.
+		 */
+		simdjson::dom::element value() const
+		{
+			return element;
+		}
+
+		/**
+		 * Returns the document that contains the value.
+		 */
+		const std::shared_ptr<const simdjson::dom::document> &owner() const
+		{
+			return document;
+		}
+
+		/**
+		 * Looks up the property `key` of this object.  Returns an absent
+		 * value if this is absent, is not an object, or has no such
+		 * property.
+		 */
+		JsonNode operator[](const char *key) const
+		{
+			simdjson::dom::element child;
+			if (!document || element.at_key(key).get(child))
+			{
+				return {};
+			}
+			return {document, child};
+		}
+	};
+
+	/**
+	 * Range over the elements of a JSON array.  Each element is exposed as a
+	 * `T`, constructed with `Adaptor`.  Absent values and values that are not
+	 * arrays are empty ranges.
+	 */
+	template<typename T, typename Adaptor>
+	class JsonRange
+	{
+		/**
+		 * The array.
+		 */
+		JsonNode array;
+
+		/**
+		 * Iterator type for this range.
+		 */
+		class Iter
+		{
+			/**
+			 * The document that contains the array.
+			 */
+			const std::shared_ptr<const simdjson::dom::document> *document;
+
+			/**
+			 * The current position in the array.
+			 */
+			simdjson::dom::array::iterator current;
+
+			public:
+			/**
+			 * Constructor, iterates from `i` in an array in `d`.
+			 */
+			Iter(const std::shared_ptr<const simdjson::dom::document> *d,
+			     simdjson::dom::array::iterator                        i)
+			  : document(d), current(i)
+			{
+			}
+
+			/**
+			 * Dereference operator, uses `Adaptor` to expose the current
+			 * element as a `T`.
+			 */
+			T operator*()
+			{
+				return Adaptor(JsonNode(*document, *current));
+			}
+
+			/**
+			 * Pre-increment operator, advances to the next element.
+			 */
+			Iter &operator++()
+			{
+				++current;
+				return *this;
+			}
+
+			/**
+			 * Non-equality comparison, used to terminate range-based for
+			 * loops.
+			 */
+			bool operator!=(const Iter &other) const
+			{
+				return current != other.current;
+			}
+		};
+
+		/**
+		 * Returns the array, or an empty array if this does not refer to
+		 * one.
+		 */
+		simdjson::dom::array elements()
+		{
+			simdjson::dom::array result;
+			if (!array || array.value().get(result))
+			{
+				return {};
+			}
+			return result;
+		}
+
+		public:
+		/**
+		 * Constructor.  Constructs a range from a node.
+		 */
+		JsonRange(JsonNode a) : array(std::move(a)) {}
+
+		/**
+		 * Returns an iterator to the start of the range.
+		 */
+		Iter begin()
+		{
+			return {&array.owner(), elements().begin()};
+		}
+
+		/**
+		 * Returns an iterator to the end of the range.
+		 */
+		Iter end()
+		{
+			return {&array.owner(), elements().end()};
+		}
+
+		/**
+		 * Returns true if this is an empty range.
+		 */
+		bool empty()
+		{
+			return !(begin() != end());
+		}
+	};
+
+	/**
+	 * Backend that reads configs from JSON documents parsed by simdjson.
+	 * Documents are not validated against the schema: accessors for
+	 * properties with the wrong type return zero or empty values.
+	 */
+	struct SimdjsonBackend
+	{
+		/**
+		 * Nodes share ownership of their document.
+		 */
+		using Node = JsonNode;
+
+		/**
+		 * Generated classes hold nodes directly.
+		 */
+		using Ptr = JsonNode;
+
+		/**
+		 * Arrays are exposed as JSON ranges.
+		 */
+		template<typename T, typename Adaptor>
+		using Range = JsonRange<T, Adaptor>;
+
+		/**
+		 * Returns true if `node` is absent.
+		 */
+		static bool is_null(const Node &node)
+		{
+			return !node;
+		}
+
+		/**
+		 * Returns the value of `node` as a string, or an empty string if it
+		 * is not a string.
+		 */
+		static std::string_view to_string(const Node &node)
+		{
+			std::string_view result;
+			if (!node || node.value().get(result))
+			{
+				return {};
+			}
+			return result;
+		}
+
+		/**
+		 * Returns the value of `node` as an integer.  Floating-point values
+		 * are truncated.
+		 */
+		static int64_t to_int(const Node &node)
+		{
+			if (!node)
+			{
+				return 0;
+			}
+			auto value = node.value();
+			switch (value.type())
+			{
+				case simdjson::dom::element_type::INT64:
+					return value.get_int64().value_unsafe();
+				case simdjson::dom::element_type::UINT64:
+					return static_cast<int64_t>(value.get_uint64().value_unsafe());
+				case simdjson::dom::element_type::DOUBLE:
+					return static_cast<int64_t>(value.get_double().value_unsafe());
+				case simdjson::dom::element_type::BOOL:
+					return value.get_bool().value_unsafe();
+				default:
+					return 0;
+			}
+		}
+
+		/**
+		 * Returns the value of `node` as a floating-point number.
+		 */
+		static double to_double(const Node &node)
+		{
+			if (!node)
+			{
+				return 0;
+			}
+			auto value = node.value();
+			switch (value.type())
+			{
+				case simdjson::dom::element_type::DOUBLE:
+					return value.get_double().value_unsafe();
+				case simdjson::dom::element_type::INT64:
+				case simdjson::dom::element_type::UINT64:
+				case simdjson::dom::element_type::BOOL:
+					return static_cast<double>(to_int(node));
+				default:
+					return 0;
+			}
+		}
+
+		/**
+		 * Returns the value of `node` as a boolean.
+		 */
+		static bool to_bool(const Node &node)
+		{
+			bool result;
+			if (!node || node.value().get(result))
+			{
+				return to_int(node) != 0;
+			}
+			return result;
+		}
+	};
+
+	/**
+	 * Returns the parser used by the calling thread.  Parsers keep their
+	 * buffers between documents, so reusing them avoids reallocating for
+	 * every file.
+	 */
+	inline simdjson::dom::parser &thread_json_parser()
+	{
+		thread_local simdjson::dom::parser parser;
+		return parser;
+	}
+
+	/**
+	 * Parses the JSON document `json`.  Returns its root or a `LoadError` if
+	 * it is not valid JSON.
+	 */
+	inline std::variant<JsonNode, LoadError> parse_json(std::string_view json)
+	{
+		auto document = std::make_shared<simdjson::dom::document>();
+		simdjson::dom::element root;
+		auto error = thread_json_parser()
+		               .parse_into_document(*document, json.data(), json.size())
+		               .get(root);
+		if (error)
+		{
+			return LoadError{simdjson::error_message(error)};
+		}
+		return JsonNode{std::move(document), root};
+	}
+
+	/**
+	 * Parses the JSON file at `path`, reporting the parse phase to
+	 * `observer`.  Returns its root or a `LoadError` if it could not be read
+	 * or is not valid JSON.
+	 */
+	template<LoadObserver O = NullObserver>
+	std::variant<JsonNode, LoadError>
+	parse_json_file(const std::filesystem::path &path, O &&observer = O{})
+	{
+		ObservedPhase          phase(observer, LoadPhase::Parse);
+		simdjson::padded_string json;
+		if (auto error = simdjson::padded_string::load(path.string()).get(json))
+		{
+			return LoadError{simdjson::error_message(error)};
+		}
+		phase.bytes = json.size();
+		return parse_json(json);
+	}
+
+} // namespace CONFIG_DETAIL_NAMESPACE
@@ -0,0 +1,94 @@
+#include "test_async.h"
+#include "test_helpers.h"
+#include <fstream>
+#include <functional>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+using config::detail::LoadError;
+
+/**
+ * Returns true if `future` has a value.
+ */
+template<typename T>
+bool is_ready(std::future<T> &future)
+{
+	return future.wait_for(std::chrono::seconds(0)) ==
+	       std::future_status::ready;
+}
+
+int main()
+{
+	auto dir = std::filesystem::temp_directory_path() /
+	           ("config-gen-test-async-" + std::to_string(getpid()));
+	std::filesystem::create_directories(dir);
+	std::vector<std::filesystem::path> paths;
+	for (int i = 0; i < 8; i++)
+	{
+		paths.push_back(dir / ("tenant" + std::to_string(i) + ".conf"));
+		std::ofstream(paths.back()) << "name = \"tenant" << i
+		                            << "\";\nrateLimit = " << i * 10 << ";\n";
+	}
+	auto invalid = dir / "invalid.conf";
+	std::ofstream(invalid) << "name = \"x\";\nrateLimit = -1;\n";
+
+	// Nothing is loaded until the executor runs the task.
+	{
+		DeferredExecutor executor;
+		auto             future = make_config_async(paths[1], executor);
+		assert(executor.tasks.size() == 1);
+		assert(!is_ready(future));
+		executor.run();
+		assert(is_ready(future));
+		assert(std::get<Config>(future.get()).rateLimit() == 10);
+	}
+
+	// The default executor is a process-wide thread pool.
+	{
+		auto future = make_config_async(paths[2]);
+		assert(std::get<Config>(future.get()).name() == "tenant2");
+	}
+
+	// Several files can be prefetched at once and collected in any order.
+	{
+		config::detail::ThreadPool pool(4);
+		auto futures = make_configs_async(paths, pool);
+		assert(futures.size() == paths.size());
+		for (size_t i = futures.size(); i-- > 0;)
+		{
+			auto conf = std::get<Config>(futures[i].get());
+			assert(conf.rateLimit() == i * 10);
+		}
+	}
+
+	// Errors are returned through the future, as they are from the
+	// synchronous loaders.
+	{
+		config::detail::InlineExecutor executor;
+		auto bad = make_config_async(invalid, executor).get();
+		assert(std::get<LoadError>(bad).code != UCL_SCHEMA_UNKNOWN);
+		auto missing = make_config_async(dir / "missing.conf", executor).get();
+		assert(std::get<LoadError>(missing).code == UCL_SCHEMA_UNKNOWN);
+	}
+
+	// Observers see every phase, from the thread that ran the load.
+	{
+		config::detail::ThreadPool        pool(2);
+		config::detail::HistogramObserver observer;
+		std::vector<std::future<std::variant<Config, LoadError>>> futures;
+		for (auto &path : paths)
+		{
+			futures.push_back(make_config_async(path, pool, observer));
+		}
+		for (auto &future : futures)
+		{
+			assert(std::holds_alternative<Config>(future.get()));
+		}
+		using config::detail::LoadPhase;
+		assert(observer.stats(LoadPhase::Parse).count == paths.size());
+		assert(observer.stats(LoadPhase::Validate).count == paths.size());
+	}
+	std::filesystem::remove_all(dir);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,110 @@
+#include "test_backend.h"
+#include "test_helpers.h"
+
+#ifdef CONFIG_HAVE_SIMDJSON
+#	include "config-simdjson.h"
+#endif
+
+#include <string>
+#include <vector>
+
+static const char json[] =
+  "{\"name\": \"server\", \"port\": 8080, \"ratio\": 0.5, \"enabled\": true,"
+  " \"tls\": {\"certificate\": \"cert.pem\", \"ciphers\": [\"a\", \"b\"]},"
+  " \"backends\": [{\"host\": \"x\", \"weight\": 2}, {\"host\": \"y\"}]}";
+
+static const char minimal[] = "{\"name\": \"bare\", \"port\": 1}";
+
+/**
+ * Checks the values in `json` through a config that may use any backend.
+ */
+template<typename T>
+void check_full(const T &conf)
+{
+	assert(conf.name() == "server");
+	assert(conf.port() == 8080);
+	assert(conf.ratio() == 0.5);
+	assert(conf.enabled() == true);
+	auto tls = conf.tls();
+	assert(tls);
+	assert(tls->certificate() == "cert.pem");
+	std::vector<std::string_view> ciphers;
+	auto                          cipherRange = *tls->ciphers();
+	for (auto cipher : cipherRange)
+	{
+		ciphers.push_back(cipher);
+	}
+	assert((ciphers == std::vector<std::string_view>{"a", "b"}));
+	std::vector<std::string> hosts;
+	int64_t                  weights  = 0;
+	auto                     backends = *conf.backends();
+	assert(!backends.empty());
+	for (auto backend : backends)
+	{
+		hosts.emplace_back(backend.host());
+		weights += backend.weight().value_or(0);
+	}
+	assert((hosts == std::vector<std::string>{"x", "y"}));
+	assert(weights == 2);
+}
+
+/**
+ * Checks the values in `minimal` through a config that may use any backend.
+ */
+template<typename T>
+void check_minimal(const T &conf)
+{
+	assert(conf.name() == "bare");
+	assert(conf.port() == 1);
+	assert(!conf.ratio());
+	assert(!conf.enabled());
+	assert(!conf.tls());
+	assert(!conf.backends());
+}
+
+int main()
+{
+	// The default backend is libucl, and `Config` names the same class as
+	// `BasicConfig<>`.
+	static_assert(std::is_same_v<Config, BasicConfig<>>);
+	static_assert(config::detail::Backend<config::detail::UCLBackend>);
+	{
+		auto *obj  = parse(json, sizeof(json) - 1);
+		auto  conf = getConfig(obj);
+		ucl_object_unref(obj);
+		check_full(conf);
+	}
+	{
+		auto *obj  = parse(minimal, sizeof(minimal) - 1);
+		auto  conf = getConfig(obj);
+		ucl_object_unref(obj);
+		check_minimal(conf);
+	}
+
+#ifdef CONFIG_HAVE_SIMDJSON
+	using JsonConfig = BasicConfig<config::detail::SimdjsonBackend>;
+	static_assert(config::detail::Backend<config::detail::SimdjsonBackend>);
+	{
+		// The config keeps the document alive after the parse result is
+		// gone.
+		std::optional<JsonConfig> conf;
+		{
+			auto parsed = config::detail::parse_json(json);
+			conf.emplace(std::get<config::detail::JsonNode>(parsed));
+		}
+		check_full(*conf);
+	}
+	{
+		auto parsed = config::detail::parse_json(minimal);
+		check_minimal(JsonConfig(std::get<config::detail::JsonNode>(parsed)));
+	}
+	{
+		auto parsed = config::detail::parse_json("{\"name\": ");
+		assert(std::holds_alternative<config::detail::LoadError>(parsed));
+		auto missing =
+		  config::detail::parse_json_file("/nonexistent/config.json");
+		assert(std::holds_alternative<config::detail::LoadError>(missing));
+	}
+#endif
+	return EXIT_SUCCESS;
+}
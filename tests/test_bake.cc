@@ -0,0 +1,62 @@
+#include "test_bake.h"
+#include "test_helpers.h"
+
+#include <limits>
+
+static const char source[] =
+  "name = \"baked \\\"service\\\"\";\n"
+  "port = 443;\n"
+  "enabled = true;\n"
+  "max-size = -9223372036854775808;\n"
+  "tls {\n"
+  "  certificate = \"cert.pem\";\n"
+  "}\n"
+  "matrix = [[1, 2], [], [3]];\n"
+  "backends = [{ host = \"x\", weight = 2 }, { host = \"y\" }];\n";
+
+// The same code works on runtime and baked configs.
+template<typename C>
+constexpr int64_t total_weight(const C &conf)
+{
+	int64_t total    = 0;
+	auto    backends = *conf.backends();
+	for (auto backend : backends)
+	{
+		total += backend.weight().value_or(1);
+	}
+	return total;
+}
+
+// The baked config is a constant, so it can be used in constant expressions.
+static_assert(baked_config.port() == 443);
+static_assert(baked_config.name() == "baked \"service\"");
+static_assert(*baked_config.enabled());
+static_assert(!baked_config.ratio());
+static_assert(*baked_config.max_size() == std::numeric_limits<int64_t>::min());
+static_assert(baked_config.tls()->certificate() == "cert.pem");
+static_assert(!baked_config.tls()->ciphers());
+static_assert(baked_config.matrix()->size() == 3);
+static_assert((*baked_config.matrix())[1].empty());
+static_assert((*baked_config.matrix())[2][0] == 3);
+static_assert(total_weight(baked_config) == 3);
+
+int main()
+{
+	auto *obj     = parse(source, sizeof(source));
+	auto  runtime = getConfig(obj);
+	ucl_object_unref(obj);
+
+	assert(runtime.name() == baked_config.name());
+	assert(runtime.port() == baked_config.port());
+	assert(runtime.max_size() == baked_config.max_size());
+	assert(total_weight(runtime) == total_weight(baked_config));
+	auto runtimeBackends = *runtime.backends();
+	auto baked           = baked_config.backends()->begin();
+	for (auto backend : runtimeBackends)
+	{
+		assert(backend.host() == baked->host());
+		assert(backend.weight() == baked->weight());
+		++baked;
+	}
+	assert(baked == baked_config.backends()->end());
+}
@@ -0,0 +1,90 @@
+#include "test_builder.h"
+#include "test_helpers.h"
+
+#include <string>
+#include <vector>
+
+static const char equivalent[] =
+  "name = \"server\";\n"
+  "port = 8080;\n"
+  "ratio = 0.25;\n"
+  "enabled = true;\n"
+  "max-size = -3;\n"
+  "tls { certificate = \"cert.pem\"; ciphers = [\"a\", \"b\"]; }\n"
+  "backends = [{ host = \"x\", weight = 2 }, { host = \"y\" }];\n";
+
+int main()
+{
+	config::detail::Arena arena;
+	ConfigBuilder         builder(arena);
+	auto                  fill = [&]() -> ConfigBuilder & {
+		return builder.name("server")
+		  .port(8080)
+		  .ratio(0.25)
+		  .enabled(true)
+		  .max_size(-3)
+		  .tls(ConfigBuilder::tlsBuilder(arena)
+		         .certificate("cert.pem")
+		         .ciphers({"a", "b"}))
+		  .add_backends(
+		    ConfigBuilder::backendsItemBuilder(arena).host("x").weight(2))
+		  .add_backends(ConfigBuilder::backendsItemBuilder(arena).host("y"));
+	};
+
+	// The built tree is the one that parsing the equivalent config gives,
+	// and passes schema validation.
+	auto *released = fill().release();
+	assert(released != nullptr);
+	auto *parsed = parse(equivalent, sizeof(equivalent));
+	assert(ucl_object_compare(parsed, released) == 0);
+	ucl_object_unref(parsed);
+	getConfig(released);
+	ucl_object_unref(released);
+
+	auto built = fill().build();
+	assert(std::holds_alternative<Config>(built));
+	auto &conf = std::get<Config>(built);
+	assert(conf.name() == "server");
+	assert(conf.port() == 8080);
+	assert(*conf.enabled());
+	assert(*conf.max_size() == -3);
+	assert(conf.tls()->certificate() == "cert.pem");
+	assert(arena.size() > 0);
+
+	// The builder is empty after building and can be reused.  Setting a
+	// property again replaces it, and ranges of any string type work.
+	std::vector<std::string> ciphers{"c"};
+	auto                     again =
+	  builder.name("a")
+	    .name("b")
+	    .port(1)
+	    .tls(ConfigBuilder::tlsBuilder().certificate("c").ciphers(ciphers))
+	    .build();
+	assert(std::holds_alternative<Config>(again));
+	assert(std::get<Config>(again).name() == "b");
+	assert(!std::get<Config>(again).ratio());
+	auto tls = *std::get<Config>(again).tls();
+	assert(*tls.ciphers()->begin() == "c");
+
+	// Missing required properties are reported by build, including those of
+	// nested builders.
+	auto missing = ConfigBuilder().name("x").build();
+	assert(std::holds_alternative<ucl_schema_error>(missing));
+	assert(std::get<ucl_schema_error>(missing).code ==
+	       UCL_SCHEMA_MISSING_PROPERTY);
+	assert(std::string_view(std::get<ucl_schema_error>(missing).msg)
+	         .ends_with("port"));
+	auto nested = ConfigBuilder()
+	                .name("x")
+	                .port(1)
+	                .add_backends(ConfigBuilder::backendsItemBuilder())
+	                .build();
+	assert(std::holds_alternative<ucl_schema_error>(nested));
+	assert(std::string_view(std::get<ucl_schema_error>(nested).msg)
+	         .ends_with("backends.host"));
+
+	// Out-of-range integers are rejected rather than truncated.
+	auto range = ConfigBuilder().name("x").port(65536).build();
+	assert(std::holds_alternative<ucl_schema_error>(range));
+	assert(std::get<ucl_schema_error>(range).code == UCL_SCHEMA_CONSTRAINT);
+}
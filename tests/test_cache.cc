@@ -0,0 +1,198 @@
+#include "test_cache.h"
+#include "test_helpers.h"
+#include <fstream>
+#include <string>
+#include <unistd.h>
+
+using config::detail::LoadError;
+using config::detail::LoadPhase;
+using config::detail::ValidationCache;
+
+/**
+ * Writes a tenant config to `path`.
+ */
+void write_tenant(const std::filesystem::path &path,
+                  std::string_view             name,
+                  int                          rateLimit)
+{
+	std::ofstream(path) << "name = \"" << name
+	                    << "\";\nrateLimit = " << rateLimit << ";\n";
+}
+
+int main()
+{
+	auto dir = std::filesystem::temp_directory_path() /
+	           ("config-gen-test-cache-" + std::to_string(getpid()));
+	std::filesystem::create_directories(dir);
+	auto cachePath = dir / "validation.cache";
+
+	std::vector<std::filesystem::path> paths;
+	for (int i = 0; i < 32; i++)
+	{
+		paths.push_back(dir / ("tenant" + std::to_string(i) + ".conf"));
+		if (i == 7)
+		{
+			// Fails validation: rateLimit out of range.
+			write_tenant(paths.back(), "tenant7", 200000);
+		}
+		else if (i == 9)
+		{
+			// Looks as if it uses a macro, which may read another file.
+			write_tenant(paths.back(), ".include", 90);
+		}
+		else
+		{
+			write_tenant(paths.back(), "tenant" + std::to_string(i), i * 10);
+		}
+	}
+
+	config::detail::ThreadPool pool(4);
+	auto check = [&](auto &results) {
+		assert(results.size() == paths.size());
+		for (size_t i = 0; i < results.size(); i++)
+		{
+			if (i == 7)
+			{
+				auto &err = std::get<LoadError>(results[i]);
+				assert(err.code != UCL_SCHEMA_UNKNOWN);
+				continue;
+			}
+			auto &conf = std::get<Config>(results[i]);
+			assert(conf.rateLimit() == i * 10);
+		}
+	};
+
+	// The first run validates everything and records the configs that
+	// passed, except the one that may use a macro.
+	{
+		ValidationCache                   cache(cachePath);
+		config::detail::HistogramObserver observer;
+		auto results = load_configs(paths, pool, cache, observer);
+		check(results);
+		assert(observer.stats(LoadPhase::Validate).count == paths.size());
+		assert(cache.hits() == 0);
+		assert(cache.size() == paths.size() - 2);
+		assert(std::filesystem::exists(cachePath));
+	}
+
+	// A restart only parses the configs that passed.
+	{
+		ValidationCache cache(cachePath);
+		assert(cache.size() == paths.size() - 2);
+		config::detail::HistogramObserver observer;
+		auto results = load_configs(paths, pool, cache, observer);
+		check(results);
+		assert(observer.stats(LoadPhase::Parse).count == paths.size());
+		assert(observer.stats(LoadPhase::Validate).count == 2);
+		assert(observer.stats(LoadPhase::Materialize).count ==
+		       paths.size() - 1);
+		assert(cache.hits() == paths.size() - 2);
+
+		// A config that changes is validated again, and then cached.
+		write_tenant(paths[0], "tenant0", 5);
+		config::detail::HistogramObserver single;
+		auto changed = load_config(paths[0], cache, single);
+		assert(std::get<Config>(changed).rateLimit() == 5);
+		assert(single.stats(LoadPhase::Validate).count == 1);
+		changed = load_config(paths[0], cache, single);
+		assert(single.stats(LoadPhase::Validate).count == 1);
+
+		// Changes that make it invalid are caught.
+		write_tenant(paths[0], "tenant0", -1);
+		assert(std::holds_alternative<LoadError>(load_config(paths[0], cache)));
+		write_tenant(paths[0], "tenant0", 0);
+		assert(std::holds_alternative<Config>(load_config(paths[0], cache)));
+	}
+
+	// Keys depend on the schema as well as the contents.
+	std::string_view text  = "name = \"x\";\nrateLimit = 1;\n";
+	auto             bytes = std::as_bytes(std::span{text});
+	assert(ValidationCache::key(bytes, embedded_schema_hash) ==
+	       ValidationCache::key(bytes, embedded_schema_hash));
+	assert(!(ValidationCache::key(bytes, embedded_schema_hash) ==
+	         ValidationCache::key(bytes, embedded_schema_hash + 1)));
+	// The libucl in use is found, so that upgrading it changes the keys.
+	assert(config::detail::libucl_identity() != 0);
+	// Keys for configs that use file variables depend on the path.
+	assert(!(ValidationCache::key(bytes, embedded_schema_hash) ==
+	         ValidationCache::key(bytes, embedded_schema_hash, "/a.conf")));
+	assert(!(ValidationCache::key(bytes, embedded_schema_hash, "/a.conf") ==
+	         ValidationCache::key(bytes, embedded_schema_hash, "/b.conf")));
+
+	// Macros and variables are found conservatively.
+	auto inputs = [](std::string_view text) {
+		return config::detail::config_inputs(std::as_bytes(std::span{text}));
+	};
+	using config::detail::ConfigInputs;
+	assert(inputs("name = \"a.example\";\nratio = 0.5;\n") ==
+	       ConfigInputs::Contents);
+	assert(inputs("name = \"^a$\";\n") == ConfigInputs::Contents);
+	assert(inputs(".include \"other.conf\"\n") == ConfigInputs::Unknown);
+	assert(inputs("a = 1;\n.priority(2)\n") == ConfigInputs::Unknown);
+	assert(inputs("name = \"$FILENAME\";\n") == ConfigInputs::Path);
+	assert(inputs("name = \"${CURDIR}/x\";\n") == ConfigInputs::Path);
+	assert(inputs("name = \"$HOME\";\n") == ConfigInputs::Unknown);
+
+	// Copies of a config that uses file variables are cached separately,
+	// because the variables expand differently.
+	{
+		ValidationCache cache(dir / "filevars.cache");
+		auto            a = dir / "a.conf";
+		auto            b = dir / "b.conf";
+		std::ofstream(a) << "name = \"$FILENAME\";\nrateLimit = 1;\n";
+		std::ofstream(b) << "name = \"$FILENAME\";\nrateLimit = 1;\n";
+		auto confA = load_config(a, cache);
+		assert(std::get<Config>(confA).name() ==
+		       std::filesystem::canonical(a).string());
+		auto confB = load_config(b, cache);
+		assert(std::get<Config>(confB).name() ==
+		       std::filesystem::canonical(b).string());
+		assert(cache.size() == 2);
+		assert(cache.hits() == 0);
+		confA = load_config(a, cache);
+		assert(cache.hits() == 1);
+	}
+
+	// Caches that share a file keep each other's keys.
+	{
+		auto shared = dir / "shared.cache";
+		auto key    = [&](uint64_t schema) {
+			   return ValidationCache::key(bytes, schema);
+		};
+		ValidationCache first(shared);
+		ValidationCache second(shared);
+		first.insert(key(1));
+		second.insert(key(2));
+		assert(first.flush());
+		assert(second.flush());
+		ValidationCache third(shared);
+		assert(third.size() == 2);
+		assert(third.contains(key(1)));
+		assert(third.contains(key(2)));
+		assert(!third.contains(key(3)));
+	}
+
+	// A corrupt cache is treated as empty and replaced.
+	{
+		std::ofstream(cachePath) << "not a cache";
+		{
+			ValidationCache cache(cachePath);
+			assert(cache.size() == 0);
+			auto results = load_configs(paths, pool, cache);
+			check(results);
+		}
+		ValidationCache cache(cachePath);
+		assert(cache.size() == paths.size() - 2);
+	}
+
+	// Missing files are reported, not cached.
+	{
+		ValidationCache cache(cachePath);
+		auto            result = load_config(dir / "missing.conf", cache);
+		auto           *err    = std::get_if<LoadError>(&result);
+		assert(err != nullptr);
+		assert(err->code == UCL_SCHEMA_UNKNOWN);
+	}
+	std::filesystem::remove_all(dir);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,75 @@
+#include "test_columns.h"
+#include "test_helpers.h"
+
+#include <string>
+#include <vector>
+
+int main()
+{
+	std::vector<Config> configs;
+	for (int i = 0; i < 100; i++)
+	{
+		std::string str = "name = \"server" + std::to_string(i) + "\";\n" +
+		                  "port = " + std::to_string(8000 + i) + ";\n";
+		if (i % 2 == 0)
+		{
+			str += "enabled = true;\n";
+		}
+		if (i % 4 == 0)
+		{
+			str += "limits { connections = " + std::to_string(i) + "; }\n";
+		}
+		if (i == 10)
+		{
+			str += "weight = 0.5; aliases = [\"ten\"];\n";
+		}
+		auto obj = parse(str.c_str(), str.size());
+		configs.push_back(getConfig(obj));
+		ucl_object_unref(obj);
+	}
+
+	ConfigColumns columns{std::span<const Config>(configs)};
+	assert(columns.size() == 100);
+	assert(columns.name[42] == "server42");
+	assert(columns.port[42] == 8042);
+	// Required columns have no presence bitmap.
+	assert(columns.port.presence() == nullptr);
+	assert(columns.enabled.presence() != nullptr);
+	assert(columns.port.count() == 100);
+	assert(columns.enabled.count() == 50);
+	assert(columns.weight.count() == 1);
+	assert(columns.weight[10] == 0.5);
+	// Columns under an optional object are optional, even when the property
+	// is required within the object.
+	assert(columns.limits.connections.count() == 25);
+	assert(!columns.limits.connections.has(1));
+	assert(columns.limits.timeout.count() == 0);
+	assert(!columns.limits.timeout.min());
+
+	// Filters and aggregates.
+	auto high = columns.port.filter([](uint16_t p) { return p >= 8090; });
+	assert(high.count() == 10);
+	assert(columns.port.sum(&high) == 8090 * 10 + 45);
+	assert(columns.port.min(&high) == 8090);
+	assert(columns.port.max() == 8099);
+	auto enabled = columns.enabled.filter([](bool e) { return e; });
+	assert(enabled.count() == 50);
+	assert((enabled & high).count() == 5);
+	assert(columns.limits.connections.count(&high) == 2);
+	assert(columns.limits.connections.sum(&high) == 92 + 96);
+	assert(columns.limits.connections.max() == 96);
+	auto named = columns.name.filter(
+	  [](std::string_view n) { return n.ends_with('7'); });
+	assert(named.count() == 10);
+	std::vector<size_t> rows;
+	named.for_each([&](size_t row) { rows.push_back(row); });
+	assert(rows.front() == 7 && rows.back() == 97);
+
+	const uint16_t bounds[] = {8010, 8050};
+	auto histogram = columns.port.histogram(std::span(bounds));
+	assert(histogram.size() == 3);
+	assert(histogram[0] == 10 && histogram[1] == 40 && histogram[2] == 50);
+	histogram = columns.port.histogram(std::span(bounds), &enabled);
+	assert(histogram[0] == 5 && histogram[1] == 20 && histogram[2] == 25);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,75 @@
+#include "test_counters.h"
+#include "test_helpers.h"
+
+#include <sstream>
+#include <thread>
+#include <vector>
+
+static const char counted[] = "aString = \"top\";\n"
+                              "anObject {\n"
+                              "  aString = \"nested\";\n"
+                              "  anInt = 42;\n"
+                              "}\n"
+                              "anArray = [{ aBool = true }, { aBool = false }];\n";
+
+uint64_t count_of(std::string_view path)
+{
+	for (auto &c : access_counts())
+	{
+		if (c.path == path)
+		{
+			return c.count;
+		}
+	}
+	assert(false && "Unknown property path");
+	return 0;
+}
+
+int main()
+{
+	auto obj  = parse(counted, sizeof(counted));
+	auto conf = getConfig(obj);
+	ucl_object_unref(obj);
+
+	// Every property has a counter, including those in array elements.
+	assert(access_counts().size() == 6);
+	assert(count_of("anObject.anInt") == 0);
+
+	std::vector<std::thread> threads;
+	for (int i = 0; i < 4; i++)
+	{
+		threads.emplace_back([&]() {
+			for (int j = 0; j < 1000; j++)
+			{
+				assert(conf.anObject().anInt() == 42);
+			}
+		});
+	}
+	for (auto &t : threads)
+	{
+		t.join();
+	}
+	auto array = conf.anArray();
+	for (auto item : *array)
+	{
+		(void)item.aBool();
+	}
+
+	assert(count_of("anObject") == 4000);
+	assert(count_of("anObject.anInt") == 4000);
+	assert(count_of("anObject.aString") == 0);
+	assert(count_of("anArray") == 1);
+	assert(count_of("anArray[].aBool") == 2);
+
+	// The report is ordered hottest first, with unread properties last.
+	auto counts = access_counts();
+	assert(counts.front().count == 4000);
+	assert(counts.back().count == 0);
+	std::stringstream report;
+	config::detail::write_access_report(report, counts);
+	assert(report.str().find("2\tanArray[].aBool\n") != std::string::npos);
+
+	reset_access_counts();
+	assert(count_of("anObject.anInt") == 0);
+	return EXIT_SUCCESS;
+}
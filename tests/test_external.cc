@@ -0,0 +1,153 @@
+#include "test_external.h"
+#include "test_helpers.h"
+#include <fstream>
+#include <functional>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+using config::detail::Ipv4Address;
+using config::detail::LoadError;
+
+/**
+ * Returns a config called `name` whose sections are in `routes` and, if it
+ * is not empty, `geo`.
+ */
+Config make_service(const std::filesystem::path &routes,
+                    const std::filesystem::path &geo = {})
+{
+	std::string text = "name = \"service\";\nroutes = \"" + routes.string() +
+	                   "\";\n";
+	if (!geo.empty())
+	{
+		text += "geo = \"" + geo.string() + "\";\n";
+	}
+	auto *obj  = parse(text.c_str(), text.size());
+	auto  conf = getConfig(obj);
+	ucl_object_unref(obj);
+	return conf;
+}
+
+int main()
+{
+	auto dir = std::filesystem::temp_directory_path() /
+	           ("config-gen-test-external-" + std::to_string(getpid()));
+	std::filesystem::create_directories(dir);
+	auto routes = dir / "routes.conf";
+	auto geo    = dir / "geo.conf";
+	std::ofstream(routes) << "gateway = \"10.0.0.1\";\nweight = 3;\n";
+	std::ofstream(geo) << "region = \"eu-1\";\n";
+
+	// Sections are read from their files when they are first read, and are
+	// not read again, even by copies of the config.
+	{
+		auto conf = make_service(routes, geo);
+		std::ofstream(routes) << "gateway = \"10.0.0.2\";\nweight = 4;\n";
+		auto section = std::get<Config::routesClass>(conf.routes());
+		assert(section.gateway() == *Ipv4Address::parse("10.0.0.2"));
+		assert(section.weight() == 4);
+		std::ofstream(routes) << "gateway = \"10.0.0.3\";\nweight = 5;\n";
+		auto copy = conf;
+		assert(std::get<Config::routesClass>(copy.routes()).weight() == 4);
+		assert(std::get<Config::routesClass>(make_service(routes).routes())
+		         .weight() == 5);
+		assert(std::get<Config::geoClass>(*conf.geo()).region() == "eu-1");
+	}
+
+	// Optional sections that the config does not name are absent.
+	assert(!make_service(routes).geo());
+
+	// The config holds the path, not the section.
+	{
+		static const char inline_section[] =
+		  "name = \"service\";\nroutes { gateway = \"10.0.0.1\"; weight = 1; "
+		  "}\n";
+		auto *obj = parse(inline_section, sizeof(inline_section) - 1);
+		checkInvalidConfig(obj);
+		ucl_object_unref(obj);
+	}
+
+	// Errors in sections are reported when they are read, and are kept.
+	{
+		auto missing = make_service(dir / "missing.conf");
+		auto result  = missing.routes();
+		assert(std::get<LoadError>(result).code == UCL_SCHEMA_UNKNOWN);
+		std::ofstream(dir / "missing.conf")
+		  << "gateway = \"10.0.0.1\";\nweight = 1;\n";
+		assert(std::holds_alternative<LoadError>(missing.routes()));
+	}
+	{
+		// Sections are validated against their own schema, including the
+		// checks that libucl does not make.
+		static const char *invalid[] = {
+		  "gateway = \"10.0.0.1\";\nweight = 0;\n",
+		  "gateway = \"not an address\";\nweight = 1;\n",
+		  "weight = 1;\n",
+		};
+		auto bad = dir / "bad.conf";
+		for (auto *text : invalid)
+		{
+			std::ofstream(bad) << text;
+			auto error = std::get<LoadError>(make_service(bad).routes());
+			assert(error.code != UCL_SCHEMA_UNKNOWN);
+			assert(error.message.starts_with(bad.string()));
+		}
+		std::ofstream(bad) << "region = \"Europe\";\n";
+		assert(std::holds_alternative<LoadError>(
+		  *make_service(routes, bad).geo()));
+	}
+
+	// Threads that read a section at once share a single load.
+	{
+		auto                     conf = make_service(routes, geo);
+		std::vector<std::thread> threads;
+		std::atomic<int>         loaded = 0;
+		for (int i = 0; i < 8; i++)
+		{
+			threads.emplace_back([&]() {
+				auto section = conf.routes();
+				if (std::get<Config::routesClass>(section).weight() == 5)
+				{
+					loaded++;
+				}
+			});
+		}
+		for (auto &thread : threads)
+		{
+			thread.join();
+		}
+		assert(loaded == 8);
+	}
+
+	// Prefetching loads every section in the background, after which the
+	// files are no longer needed.
+	{
+		auto             conf = make_service(routes, geo);
+		DeferredExecutor executor;
+		conf.prefetch_sections(executor);
+		assert(executor.tasks.size() == 2);
+		executor.run();
+		auto moved = dir / "moved";
+		std::filesystem::create_directories(moved);
+		std::filesystem::rename(routes, moved / "routes.conf");
+		assert(std::get<Config::routesClass>(conf.routes()).weight() == 5);
+		assert(std::get<Config::geoClass>(*conf.geo()).region() == "eu-1");
+		std::filesystem::rename(moved / "routes.conf", routes);
+	}
+	{
+		auto conf = make_service(routes);
+		conf.prefetch_sections();
+		assert(std::get<Config::routesClass>(conf.routes()).weight() == 5);
+	}
+
+	// Reads of sections are counted like any other property.
+	auto counts = access_counts();
+	auto found  = std::find_if(counts.begin(), counts.end(), [](auto &c) {
+		return c.path == "routes";
+	});
+	assert((found != counts.end()) && (found->count > 0));
+
+	std::filesystem::remove_all(dir);
+	return EXIT_SUCCESS;
+}
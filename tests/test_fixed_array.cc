@@ -0,0 +1,116 @@
+#include "test_fixed_array.h"
+#include "test_helpers.h"
+#include "test_json_helpers.h"
+
+#include <array>
+#include <string>
+#include <tuple>
+#include <type_traits>
+
+static const char source[] = "origin = [1.5, -2, 0.25];\n"
+                             "colour = [255, 128, 0];\n"
+                             "endpoint = [\"localhost\", 8080];\n"
+                             "aliases = [\"a\", \"b\"];\n";
+
+// Fixed-length arrays and tuples are returned as values, not ranges.
+static_assert(std::is_same_v<decltype(std::declval<Config>().origin()),
+                             std::array<double, 3>>);
+static_assert(std::is_same_v<decltype(std::declval<Config>().colour()),
+                             std::array<uint8_t, 3>>);
+static_assert(std::is_same_v<decltype(std::declval<Config>().endpoint()),
+                             std::tuple<std::string_view, uint16_t>>);
+static_assert(
+  std::is_same_v<decltype(std::declval<Config>().aliases()),
+                 std::optional<std::array<std::string_view, 2>>>);
+
+// Materialised structs store them inline.
+static_assert(std::is_same_v<decltype(std::declval<ConfigData>().colour()),
+                             const std::array<uint8_t, 3> &>);
+static_assert(
+  std::is_same_v<decltype(std::declval<ConfigData>().endpoint()),
+                 const std::tuple<std::string, uint16_t> &>);
+
+// So do baked configs, which can be read in constant expressions.
+static_assert(baked_config.colour()[1] == 128);
+static_assert(std::get<1>(baked_config.endpoint()) == 8080);
+static_assert(std::get<0>(baked_config.endpoint()) == "localhost");
+static_assert((*baked_config.aliases())[1] == "b");
+
+int main()
+{
+	auto *obj  = parse(source, sizeof(source) - 1);
+	auto  conf = getConfig(obj);
+	ucl_object_unref(obj);
+
+	assert((conf.origin() == std::array<double, 3>{1.5, -2, 0.25}));
+	assert((conf.colour() == std::array<uint8_t, 3>{255, 128, 0}));
+	auto [host, port] = conf.endpoint();
+	assert(host == "localhost");
+	assert(port == 8080);
+	assert((*conf.aliases() == std::array<std::string_view, 2>{"a", "b"}));
+	assert(!conf.tags());
+
+	// Materialised copies own their strings.
+	ConfigData data(conf);
+	assert(data.colour() == conf.colour());
+	assert(std::get<0>(data.endpoint()) == "localhost");
+	assert((*data.aliases())[0] == "a");
+
+	// Tuples are written as arrays.
+	static const char expected[] =
+	  "{\"origin\":[1.5,-2,0.25],\"colour\":[255,128,0],"
+	  "\"endpoint\":[\"localhost\",8080],\"aliases\":[\"a\",\"b\"]}";
+	assert(to_json(conf) == expected);
+	assert(to_json(data) == expected);
+
+	// Element counts and ranges are validated.
+	static const char *invalid[] = {
+	  "origin = [1, 2];\ncolour = [1, 2, 3];\nendpoint = [\"h\", 1];\n",
+	  "origin = [1, 2, 3, 4];\ncolour = [1, 2, 3];\nendpoint = [\"h\", 1];\n",
+	  "origin = [1, 2, 3];\ncolour = [1, 2, 256];\nendpoint = [\"h\", 1];\n",
+	  "origin = [1, 2, 3];\ncolour = [1, 2, 3];\nendpoint = [1, \"h\"];\n",
+	  "origin = [1, 2, 3];\ncolour = [1, 2, 3];\nendpoint = [\"h\", 0];\n",
+	  "origin = [1, 2, 3];\ncolour = [1, 2, 3];\nendpoint = [\"h\", 1, 2];\n",
+	  "origin = [1, 2, 3];\ncolour = [1, 2, 3];\nendpoint = [\"h\"];\n",
+	  "origin = [1, 2, 3];\ncolour = [1, 2, 3];\nendpoint = [];\n",
+	};
+	for (auto *text : invalid)
+	{
+		auto *bad = parse(text, strlen(text));
+		checkInvalidConfig(bad);
+		ucl_object_unref(bad);
+	}
+
+	// Structurally equal configs hash the same, whatever their source.
+	static const char reordered[] = "endpoint = [\"localhost\", 8080];\n"
+	                                "aliases = [\"a\", \"b\"];\n"
+	                                "colour = [255, 128, 0];\n"
+	                                "origin = [1.5, -2, 0.25];\n";
+	auto *other = parse(reordered, sizeof(reordered) - 1);
+	auto  same  = getConfig(other);
+	ucl_object_unref(other);
+	assert(conf.hash() == same.hash());
+	assert(conf == same);
+
+	// Builders set fixed-length arrays from ranges of the right size and
+	// tuples from one argument per element.
+	auto built = ConfigBuilder()
+	               .origin({1.5, -2, 0.25})
+	               .colour(std::array{255, 128, 0})
+	               .endpoint("localhost", 8080)
+	               .aliases({"a", "b"})
+	               .build();
+	assert(std::get<Config>(built) == conf);
+	auto tooShort = ConfigBuilder()
+	                  .origin({1, 2})
+	                  .colour({1, 2, 3})
+	                  .endpoint("h", 1)
+	                  .build();
+	assert(std::holds_alternative<ucl_schema_error>(tooShort));
+	auto outOfRange = ConfigBuilder()
+	                    .origin({1, 2, 3})
+	                    .colour({1, 2, 3})
+	                    .endpoint("h", 65536)
+	                    .build();
+	assert(std::holds_alternative<ucl_schema_error>(outOfRange));
+}
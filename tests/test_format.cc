@@ -0,0 +1,194 @@
+#include "test_format.h"
+#include "test_helpers.h"
+#include "test_json_helpers.h"
+
+#include <arpa/inet.h>
+#include <chrono>
+#include <string>
+#include <type_traits>
+
+using namespace std::chrono_literals;
+using namespace config::detail;
+
+static const char source[] =
+  "listen = \"192.168.1.20\";\n"
+  "listen6 = \"fe80::0:1\";\n"
+  "hostname = \"edge-1.example.com\";\n"
+  "upstream = \"https://user@backend.internal:8443/api/v1?debug=1#top\";\n"
+  "mirrors = [\"http://[2001:db8::2]/\", \"ftp://mirror.example.org\"];\n"
+  "certificate {\n"
+  "  expires = \"2030-06-15T12:30:00.25+02:00\";\n"
+  "  renewBefore = \"P1DT12H\";\n"
+  "}\n"
+  "label = \"anything\";\n";
+
+// Formatted strings are returned as parsed values.
+static_assert(std::is_same_v<decltype(std::declval<Config>().listen()),
+                             Ipv4Address>);
+static_assert(
+  std::is_same_v<decltype(std::declval<Config>().listen6()),
+                 std::optional<Ipv6Address>>);
+static_assert(std::is_same_v<decltype(std::declval<Config>().upstream()),
+                             UriView>);
+static_assert(std::is_same_v<decltype(std::declval<Config>().hostname()),
+                             std::string_view>);
+static_assert(std::is_same_v<decltype(std::declval<Config>().label()),
+                             std::optional<std::string_view>>);
+
+// Materialised structs store them, with URIs owning their text.
+static_assert(std::is_same_v<decltype(std::declval<ConfigData>().listen()),
+                             Ipv4Address>);
+static_assert(std::is_same_v<decltype(std::declval<ConfigData>().upstream()),
+                             UriView>);
+
+// Baked configs parse them when the header is compiled.
+static_assert(baked_config.listen() == *Ipv4Address::parse("10.0.0.1"));
+static_assert(baked_config.upstream().port() == 8443);
+static_assert(baked_config.upstream().path() == "/api");
+static_assert(baked_config.certificate()->renewBefore() ==
+              std::optional<Duration>(std::chrono::days(14)));
+
+static std::string invalid_message(const std::string &text)
+{
+	auto *obj         = parse(text.c_str(), text.size());
+	auto  confOrError = make_config(obj);
+	ucl_object_unref(obj);
+	assert(std::holds_alternative<ucl_schema_error>(confOrError));
+	return std::get<ucl_schema_error>(confOrError).msg;
+}
+
+int main()
+{
+	auto *obj  = parse(source, sizeof(source) - 1);
+	auto  conf = getConfig(obj);
+	ucl_object_unref(obj);
+
+	in_addr listen = conf.listen().address();
+	char    text[INET6_ADDRSTRLEN];
+	assert(inet_ntop(AF_INET, &listen, text, sizeof(text)) != nullptr);
+	assert(std::string_view(text) == "192.168.1.20");
+	in6_addr listen6 = conf.listen6()->address();
+	assert(inet_ntop(AF_INET6, &listen6, text, sizeof(text)) != nullptr);
+	assert(std::string_view(text) == "fe80::1");
+	assert(conf.hostname() == "edge-1.example.com");
+
+	auto upstream = conf.upstream();
+	assert(upstream.scheme() == "https");
+	assert(upstream.userinfo() == "user");
+	assert(upstream.host() == "backend.internal");
+	assert(upstream.port() == 8443);
+	assert(upstream.path() == "/api/v1");
+	assert(upstream.query() == "debug=1");
+	assert(upstream.fragment() == "top");
+	auto mirrors = *conf.mirrors();
+	auto mirror  = mirrors.begin();
+	assert((*mirror).host() == "2001:db8::2");
+	assert(!(*mirror).port());
+	++mirror;
+	assert((*mirror).scheme() == "ftp");
+	assert((*mirror).path().empty());
+
+	auto certificate = *conf.certificate();
+	auto expires     = std::chrono::sys_days(std::chrono::year(2030) /
+	                                         std::chrono::June / 15) +
+	               10h + 30min + 250ms;
+	assert(certificate.expires() == expires);
+	assert(certificate.renewBefore() == 36h);
+
+	// Materialised copies own their values.
+	ConfigData data(conf);
+	assert(data.listen() == conf.listen());
+	assert(data.upstream() == upstream);
+	assert(data.upstream().port() == 8443);
+	assert(data.certificate()->expires() == expires);
+
+	// Values are written back in canonical form.
+	static const char expected[] =
+	  "{\"listen\":\"192.168.1.20\",\"listen6\":\"fe80::1\","
+	  "\"hostname\":\"edge-1.example.com\","
+	  "\"upstream\":\"https://user@backend.internal:8443/api/v1?debug=1#top\","
+	  "\"mirrors\":[\"http://[2001:db8::2]/\",\"ftp://mirror.example.org\"],"
+	  "\"certificate\":{\"expires\":\"2030-06-15T10:30:00.25Z\","
+	  "\"renewBefore\":\"P1DT12H\"},\"label\":\"anything\"}";
+	assert(to_json(conf) == expected);
+	assert(to_json(data) == expected);
+
+	// Equal values hash the same, however they were written.
+	std::string same{source};
+	same.replace(same.find("fe80::0:1"), 9, "FE80::1");
+	auto *other = parse(same.c_str(), same.size());
+	auto  equal = getConfig(other);
+	ucl_object_unref(other);
+	assert(conf.hash() == equal.hash());
+	assert(conf == equal);
+
+	// Strings that are not in their format are rejected when loading.
+	assert(invalid_message("listen = \"10.0.0.256\";\nhostname = \"h\";\n"
+	                       "upstream = \"a:b\";\n") ==
+	       "string doesn't match format ipv4");
+	static const char *invalid[] = {
+	  "listen6 = \"1::2::3\";\n",
+	  "hostname = \"-bad\";\n",
+	  "upstream = \"not a uri\";\n",
+	  "mirrors = [\"http://ok/\", \"http://[::g]/\"];\n",
+	  "certificate { expires = \"2030-02-30T00:00:00Z\"; }\n",
+	  "certificate { expires = \"2030-01-01T00:00:00Z\"; "
+	  "renewBefore = \"P1M\"; }\n",
+	};
+	for (auto *text : invalid)
+	{
+		std::string config = "listen = \"10.0.0.1\";\n";
+		config += text;
+		for (auto *property :
+		     {"hostname = \"h\";\n", "upstream = \"a:b\";\n"})
+		{
+			std::string_view key{property, strchr(property, ' ')};
+			if (config.find(key) == std::string::npos)
+			{
+				config += property;
+			}
+		}
+		auto *bad = parse(config.c_str(), config.size());
+		checkInvalidConfig(bad);
+		ucl_object_unref(bad);
+	}
+
+	// Layered configs check formats after merging.
+	auto *base  = parse(source, sizeof(source) - 1);
+	auto *valid = parse("listen = \"10.0.0.2\";\n", 21);
+	auto *bad   = parse("listen = \"10.0.0\";\n", 19);
+	const ucl_object_t *stack[]     = {base, valid};
+	const ucl_object_t *badStack[]  = {base, bad};
+	LayerStack          layers{stack};
+	LayerStack          badLayers{badStack};
+	assert(std::holds_alternative<Config>(make_config(layers)));
+	assert(std::holds_alternative<ucl_schema_error>(
+	  make_config(layers, 1, bad)));
+	assert(std::get<Config>(make_config(layers)).listen() ==
+	       *Ipv4Address::parse("10.0.0.2"));
+	assert(std::holds_alternative<ucl_schema_error>(make_config(badLayers)));
+	ucl_object_unref(base);
+	ucl_object_unref(valid);
+	ucl_object_unref(bad);
+
+	// Builders take formatted strings as strings and check them.
+	auto built = ConfigBuilder()
+	               .listen("192.168.1.20")
+	               .hostname("edge-1.example.com")
+	               .upstream("https://user@backend.internal:8443/api/v1?"
+	                         "debug=1#top")
+	               .build();
+	assert(std::get<Config>(built).upstream() == upstream);
+	auto wrong = ConfigBuilder()
+	               .listen("192.168.1")
+	               .hostname("h")
+	               .upstream("a:b")
+	               .build();
+	assert(std::holds_alternative<ucl_schema_error>(wrong));
+
+	// Columns hold parsed values, with URIs stored as strings.
+	std::vector<Config> configs{conf, equal};
+	ConfigColumns       columns{std::span<const Config>(configs)};
+	assert(columns.listen[1] == conf.listen());
+	assert(columns.upstream[0] == upstream.text());
+}
@@ -0,0 +1,178 @@
+#include "test_fragment.h"
+#include "test_helpers.h"
+#include <fstream>
+#include <string>
+#include <unistd.h>
+
+using config::detail::FragmentCache;
+using config::detail::LoadError;
+
+/**
+ * Writes `contents` to `path`.
+ */
+void write_file(const std::filesystem::path &path, std::string_view contents)
+{
+	std::ofstream(path) << contents;
+}
+
+/**
+ * Returns the text of a tenant config that includes `fragment`.
+ */
+std::string tenant(size_t i, const std::filesystem::path &fragment)
+{
+	return "name = \"tenant" + std::to_string(i) + "\";\n.include \"" +
+	       fragment.string() + "\"\n";
+}
+
+int main()
+{
+	auto dir = std::filesystem::temp_directory_path() /
+	           ("config-gen-test-fragment-" + std::to_string(getpid()));
+	std::filesystem::create_directories(dir);
+	auto shared = dir / "shared.inc";
+	auto limits = dir / "limits.inc";
+	write_file(limits, "limits { connections = 100; }\n");
+	write_file(shared,
+	           "tls {\n"
+	           "  certificate = \"/etc/ssl/fullchain.pem\";\n"
+	           "  caBundle = \"-----BEGIN CERTIFICATE-----\";\n"
+	           "}\n"
+	           "routes [\n"
+	           "  { prefix = \"/api\", backend = \"api.internal\" },\n"
+	           "  { prefix = \"/static\", backend = \"cdn.internal\" },\n"
+	           "]\n"
+	           ".include \"" +
+	             limits.string() + "\"\n");
+	std::vector<std::filesystem::path> paths;
+	for (size_t i = 0; i < 16; i++)
+	{
+		paths.push_back(dir / ("tenant" + std::to_string(i) + ".conf"));
+		write_file(paths.back(), tenant(i, shared));
+	}
+
+	config::detail::ThreadPool pool(4);
+	FragmentCache              fragments;
+	auto results = load_configs(paths, pool, fragments);
+	assert(results.size() == paths.size());
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		auto &conf = std::get<Config>(results[i]);
+		assert(conf.name() == "tenant" + std::to_string(i));
+		assert(conf.tls().certificate() == "/etc/ssl/fullchain.pem");
+		assert(conf.limits()->connections() == 100);
+	}
+	// Each fragment, including the nested one, was parsed once.
+	assert(fragments.size() == 2);
+	assert(fragments.misses() == 2);
+	assert(fragments.hits() == paths.size() - 1);
+
+	// Every config shares the fragment's nodes.
+	auto &first = std::get<Config>(results[0]);
+	auto &last  = std::get<Config>(results.back());
+	assert(first.tls().certificate().data() ==
+	       last.tls().certificate().data());
+	assert((*first.routes()->begin()).backend().data() ==
+	       (*last.routes()->begin()).backend().data());
+
+	// Without the cache, each config has its own copy.
+	auto copies = load_configs(std::span{paths}.first(2), pool);
+	assert(std::get<Config>(copies[0]).tls().certificate().data() !=
+	       std::get<Config>(copies[1]).tls().certificate().data());
+
+	// A fragment that changes is parsed again, as are the fragments that
+	// include it.  Configs that were loaded before the change keep the old
+	// nodes.
+	write_file(limits, "limits { connections = 2000; }\n");
+	auto reloaded = load_configs(std::span{paths}.first(1), pool, fragments);
+	assert(std::get<Config>(reloaded[0]).limits()->connections() == 2000);
+	assert(first.limits()->connections() == 100);
+	assert(fragments.misses() == 4);
+
+	// Dropping the cache does not affect configs that use its fragments.
+	fragments.clear();
+	assert(fragments.size() == 0);
+	assert(last.tls().certificate() == "/etc/ssl/fullchain.pem");
+
+	// Missing fragments are errors, unless they are optional.
+	{
+		auto path = dir / "missing.conf";
+		write_file(path, tenant(0, dir / "missing.inc"));
+		auto result = load_configs(std::span{&path, 1}, pool, fragments);
+		auto *err   = std::get_if<LoadError>(&result[0]);
+		assert(err != nullptr);
+		assert(err->message.find("missing.inc") != std::string::npos);
+		write_file(path,
+		           tenant(0, shared) + ".try_include \"" +
+		             (dir / "missing.inc").string() + "\"\n");
+		result = load_configs(std::span{&path, 1}, pool, fragments);
+		assert(std::holds_alternative<Config>(result[0]));
+	}
+
+	// Include cycles are errors rather than infinite loops.
+	{
+		auto cycle = dir / "cycle.inc";
+		write_file(cycle, ".include \"" + cycle.string() + "\"\n");
+		auto path = dir / "cycle.conf";
+		write_file(path, tenant(0, cycle));
+		auto result = load_configs(std::span{&path, 1}, pool, fragments);
+		auto *err   = std::get_if<LoadError>(&result[0]);
+		assert(err != nullptr);
+		assert(err->message.find("nested") != std::string::npos);
+	}
+
+	// Included configs are still validated.
+	{
+		auto bad = dir / "bad.inc";
+		write_file(bad, "limits { connections = 0; }\ntls { caBundle = \"x\"; }\n");
+		auto path = dir / "bad.conf";
+		write_file(path, tenant(0, bad));
+		auto result = load_configs(std::span{&path, 1}, pool, fragments);
+		auto *err   = std::get_if<LoadError>(&result[0]);
+		assert(err != nullptr);
+		assert(err->code != UCL_SCHEMA_UNKNOWN);
+	}
+	// Includes that combine a fragment with existing values, or that have
+	// arguments that libucl applies, are parsed by libucl's own include and
+	// give the same tree as they do without the cache.
+	{
+		auto path = dir / "duplicate.conf";
+		auto same = [&](const std::string &text) {
+			write_file(path, text);
+			auto cached = fragments.parse_file(path);
+			auto stock  = config::detail::parse_file(path);
+			if (std::holds_alternative<LoadError>(stock))
+			{
+				return std::holds_alternative<LoadError>(cached);
+			}
+			auto *a     = std::get<ucl_object_t *>(cached);
+			auto *b     = std::get<ucl_object_t *>(stock);
+			bool  equal = ucl_object_compare(a, b) == 0;
+			ucl_object_unref(a);
+			ucl_object_unref(b);
+			return equal;
+		};
+		auto include = [&](const std::string &arguments) {
+			return ".include" + arguments + " \"" + limits.string() + "\"\n";
+		};
+		std::string local  = "limits { connections = 5; }\n";
+		size_t      before = fragments.fallbacks();
+		assert(same(local + include("")));
+		assert(same(local + include("(priority=2)")));
+		assert(same(local + include("(duplicate=\"rewrite\")")));
+		assert(same(local + include("(duplicate=\"merge\")")));
+		assert(same(local + include("(duplicate=\"error\")")));
+		assert(same(include("(prefix=true, key=\"nested\")")));
+		auto repeated = dir / "repeated.inc";
+		write_file(repeated, local + local);
+		assert(same(".include \"" + repeated.string() + "\"\n"));
+		assert(fragments.fallbacks() == before + 7);
+		// Keys set again after an include are added by libucl as an
+		// array holding the shared node, which is left unchanged.
+		assert(same(include("") + local));
+		assert(fragments.fallbacks() == before + 7);
+		auto result = load_configs(std::span{paths}.first(1), pool, fragments);
+		assert(std::get<Config>(result[0]).limits()->connections() == 2000);
+	}
+	std::filesystem::remove_all(dir);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,87 @@
+#include "test_hash.h"
+#include "test_helpers.h"
+
+#include <vector>
+
+static const char base[] =
+  "name = \"server\";\n"
+  "port = 8080;\n"
+  "ratio = 0.0;\n"
+  "tls { certificate = \"cert.pem\"; ciphers = [\"a\", \"b\"]; }\n"
+  "backends = [{ host = \"x\", weight = 2 }, { host = \"y\" }];\n";
+
+// The same config with keys in a different order, different whitespace and
+// negative zero.
+static const char reordered[] =
+  "backends = [{ weight = 2, host = \"x\" }, { host = \"y\" }]\n"
+  "tls {ciphers = [\"a\", \"b\"]\ncertificate = \"cert.pem\"}\n"
+  "ratio = -0.0\nport = 8080\nname = \"server\"\n";
+
+static const char changedCertificate[] =
+  "name = \"server\";\n"
+  "port = 8080;\n"
+  "ratio = 0.0;\n"
+  "tls { certificate = \"other.pem\"; ciphers = [\"a\", \"b\"]; }\n"
+  "backends = [{ host = \"x\", weight = 2 }, { host = \"y\" }];\n";
+
+static const char swappedBackends[] =
+  "name = \"server\";\n"
+  "port = 8080;\n"
+  "ratio = 0.0;\n"
+  "tls { certificate = \"cert.pem\"; ciphers = [\"a\", \"b\"]; }\n"
+  "backends = [{ host = \"y\" }, { host = \"x\", weight = 2 }];\n";
+
+static const char withoutRatio[] =
+  "name = \"server\";\n"
+  "port = 8080;\n"
+  "tls { certificate = \"cert.pem\"; ciphers = [\"a\", \"b\"]; }\n"
+  "backends = [{ host = \"x\", weight = 2 }, { host = \"y\" }];\n";
+
+template<size_t N>
+Config load(const char (&str)[N])
+{
+	auto *obj  = parse(str, N);
+	auto  conf = getConfig(obj);
+	ucl_object_unref(obj);
+	return conf;
+}
+
+int main()
+{
+	auto a = load(base);
+	auto b = load(reordered);
+
+	// Key order and formatting do not affect the hash or equality.
+	assert(a.hash() == b.hash());
+	assert(a == b);
+	assert(a.changed_properties(b).empty());
+	assert(a.tls()->hash() == b.tls()->hash());
+	assert(a == a);
+
+	// A change deep in the tree changes the root hash, and the changed
+	// subtree can be found by comparing child hashes.
+	auto c = load(changedCertificate);
+	assert(a.hash() != c.hash());
+	assert(!(a == c));
+	auto changed = a.changed_properties(c);
+	assert(changed == std::vector<std::string_view>{"tls"});
+	auto nested = a.tls()->changed_properties(*c.tls());
+	assert(nested == std::vector<std::string_view>{"certificate"});
+
+	// Array order is significant.
+	auto d = load(swappedBackends);
+	assert(a.hash() != d.hash());
+	assert(!(a == d));
+	assert(a.changed_properties(d) ==
+	       std::vector<std::string_view>{"backends"});
+
+	// An absent optional property differs from any present value.
+	auto e = load(withoutRatio);
+	assert(!(a == e));
+	assert(a.changed_properties(e) == std::vector<std::string_view>{"ratio"});
+
+	// Copies share the cached hashes.
+	Config copy = a;
+	assert(copy.hash() == a.hash());
+	assert(copy == a);
+}
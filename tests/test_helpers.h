@@ -1,16 +1,22 @@
 #include <cassert>
+#include <functional>
 #include <iostream>
+#include <string>
+#include <vector>
 
-ucl_object_t *parse(const char *str, size_t len)
+ucl_object_t *
+parse(const char *str, size_t len, int flags = UCL_PARSER_NO_IMPLICIT_ARRAYS)
 {
-	struct ucl_parser *p = ucl_parser_new(UCL_PARSER_NO_IMPLICIT_ARRAYS);
+	struct ucl_parser *p = ucl_parser_new(flags);
 	ucl_parser_add_string(p, str, len);
 	if (ucl_parser_get_error(p))
 	{
 		std::cerr << "Parse error: " << ucl_parser_get_error(p) << std::endl;
 		exit(EXIT_FAILURE);
 	}
-	return ucl_parser_get_object(p);
+	auto obj = ucl_parser_get_object(p);
+	ucl_parser_free(p);
+	return obj;
 }
 
 Config getConfig(ucl_object_t *obj)
@@ -32,3 +38,35 @@ void checkInvalidConfig(ucl_object_t *obj)
 	auto confOrError = make_config(obj);
 	assert(std::holds_alternative<ucl_schema_error>(make_config(obj)));
 }
+
+/**
+ * Executor that queues tasks until `run` is called, so that tests can
+ * check what happens before a load finishes.
+ */
+struct DeferredExecutor
+{
+	/**
+	 * The queued tasks.
+	 */
+	std::vector<std::function<void()>> tasks;
+
+	/**
+	 * Queues `f`.
+	 */
+	void execute(std::function<void()> f)
+	{
+		tasks.push_back(std::move(f));
+	}
+
+	/**
+	 * Runs and removes every queued task.
+	 */
+	void run()
+	{
+		for (auto &task : tasks)
+		{
+			task();
+		}
+		tasks.clear();
+	}
+};
@@ -0,0 +1,69 @@
+#include "test_intern.h"
+#include "test_helpers.h"
+
+static const char tenant_a[] = "name = \"a\";\n"
+                               "tls {\n"
+                               "  certificate = \"shared.pem\";\n"
+                               "  ciphers = [\"aes128\", \"aes256\"];\n"
+                               "}\n";
+
+static const char tenant_b[] = "tls {\n"
+                               "  ciphers = [\"aes128\", \"aes256\"];\n"
+                               "  certificate = \"shared.pem\";\n"
+                               "}\n"
+                               "name = \"b\";\n";
+
+static const char tenant_c[] = "name = \"c\";\n"
+                               "tls {\n"
+                               "  certificate = \"other.pem\";\n"
+                               "  ciphers = [\"aes128\", \"aes256\"];\n"
+                               "}\n";
+
+Config intern(config::detail::InternTable &table, const char *str, size_t len)
+{
+	auto        obj         = parse(str, len);
+	const auto *name        = ucl_object_lookup(obj, "name");
+	auto        confOrError = make_interned_config(obj, table);
+	assert(std::holds_alternative<Config>(confOrError));
+	// The interned tree is a copy, the parsed tree is not modified.
+	assert(ucl_object_lookup(obj, "name") == name);
+	assert(std::get<Config>(confOrError).name().data() !=
+	       ucl_object_tostring(name));
+	ucl_object_unref(obj);
+	return std::get<Config>(confOrError);
+}
+
+int main()
+{
+	config::detail::InternTable table;
+	{
+		auto a = intern(table, tenant_a, sizeof(tenant_a));
+		auto b = intern(table, tenant_b, sizeof(tenant_b));
+		auto c = intern(table, tenant_c, sizeof(tenant_c));
+		assert(a.name() == "a");
+		assert(b.name() == "b");
+		assert(b.tls().certificate() == "shared.pem");
+		assert(c.tls().certificate() == "other.pem");
+		// Identical sections share nodes, regardless of key order.
+		assert(a.tls().certificate().data() == b.tls().certificate().data());
+		assert(a.tls().certificate().data() != c.tls().certificate().data());
+		auto first = [](auto ciphers) { return (*ciphers.begin()).data(); };
+		assert(first(*a.tls().ciphers()) == first(*c.tls().ciphers()));
+		size_t entries = table.size();
+		// Nothing can be collected while the configs are alive.
+		assert(table.collect() == 0);
+		assert(table.size() == entries);
+	}
+	// Once the configs are gone, everything can be collected.
+	table.collect();
+	assert(table.size() == 0);
+	// Unused nodes are dropped as the table grows, without `collect()`.
+	for (int i = 0; i < 10000; i++)
+	{
+		std::string tenant = "name = \"tenant-" + std::to_string(i) +
+		                     "\"; tls { certificate = \"shared.pem\"; }";
+		intern(table, tenant.data(), tenant.size());
+	}
+	assert(table.size() < 10000);
+	return EXIT_SUCCESS;
+}
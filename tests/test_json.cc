@@ -0,0 +1,75 @@
+#include "test_json.h"
+#include "test_helpers.h"
+#include "test_json_helpers.h"
+
+#include <cstdio>
+#include <string>
+
+static const char full[] =
+  "name = \"quote \\\" backslash \\\\ tab \\t\";\n"
+  "port = 8080;\n"
+  "ratio = 0.25;\n"
+  "enabled = false;\n"
+  "max-size = -3;\n"
+  "tls { certificate = \"cert.pem\"; ciphers = [\"a\", \"b\"]; }\n"
+  "backends = [{ host = \"x\", weight = 2 }, { host = \"y\" }];\n";
+
+static const char expected[] =
+  "{\"name\":\"quote \\\" backslash \\\\ tab \\t\",\"port\":8080,"
+  "\"ratio\":0.25,\"enabled\":false,\"max-size\":-3,"
+  "\"tls\":{\"certificate\":\"cert.pem\",\"ciphers\":[\"a\",\"b\"]},"
+  "\"backends\":[{\"host\":\"x\",\"weight\":2},{\"host\":\"y\"}]}";
+
+static const char minimal[] = "port = 1;\nname = \"n\";\n";
+
+int main()
+{
+	auto obj  = parse(full, sizeof(full));
+	auto conf = getConfig(obj);
+
+	// Properties are written in schema order, with optional properties
+	// omitted when absent.
+	auto json = to_json(conf);
+	assert(json == expected);
+	assert(to_json(ConfigData(conf)) == expected);
+
+	// The output parses back to the same tree.
+	auto reparsed = parse(json.c_str(), json.size());
+	assert(ucl_object_compare(obj, reparsed) == 0);
+	ucl_object_unref(reparsed);
+	ucl_object_unref(obj);
+
+	obj      = parse(minimal, sizeof(minimal));
+	auto min = getConfig(obj);
+	ucl_object_unref(obj);
+	assert(to_json(min) == "{\"name\":\"n\",\"port\":1}");
+	assert(to_json(ConfigData(min)) == "{\"name\":\"n\",\"port\":1}");
+
+	// A buffer that is too small keeps what fits and reports the full size.
+	char                       small[16];
+	config::detail::BufferSink buffer(small);
+	conf.write_json(buffer);
+	assert(buffer.truncated());
+	assert(buffer.size() == sizeof(expected) - 1);
+	assert(buffer.view() == std::string_view(expected, sizeof(small)));
+	char                       large[sizeof(expected)];
+	config::detail::BufferSink fits(large);
+	conf.write_json(fits);
+	assert(!fits.truncated());
+	assert(fits.view() == expected);
+
+	// File descriptor sinks flush when they are destroyed.
+	FILE *file = tmpfile();
+	{
+		config::detail::FdSink fd(fileno(file));
+		conf.tls()->write_json(fd);
+		assert(!fd.error());
+	}
+	rewind(file);
+	char contents[128] = {};
+	fread(contents, 1, sizeof(contents) - 1, file);
+	fclose(file);
+	assert(std::string_view(contents) ==
+	       "{\"certificate\":\"cert.pem\",\"ciphers\":[\"a\",\"b\"]}");
+	return EXIT_SUCCESS;
+}
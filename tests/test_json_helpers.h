@@ -0,0 +1,13 @@
+#pragma once
+
+#include "config-json.h"
+#include <string>
+
+template<typename T>
+std::string to_json(const T &value)
+{
+	std::string                out;
+	config::detail::StringSink sink(out);
+	value.write_json(sink);
+	return out;
+}
@@ -0,0 +1,62 @@
+#include "test_layers.h"
+#include "test_helpers.h"
+
+static const char base_string[] = "name = \"base\";\n"
+                                  "limits {\n"
+                                  "  rate = 10;\n"
+                                  "  burst = 20;\n"
+                                  "}\n"
+                                  "tls {\n"
+                                  "  certificate = \"base.pem\";\n"
+                                  "}\n";
+
+static const char region_string[] = "limits {\n"
+                                    "  rate = 100;\n"
+                                    "}\n";
+
+static const char host_string[] = "name = \"host\";\n";
+
+static const char host_wrong[] = "limits {\n"
+                                 "  burst = 2000;\n"
+                                 "}\n";
+
+int main()
+{
+	auto base   = parse(base_string, sizeof(base_string));
+	auto region = parse(region_string, sizeof(region_string));
+	auto host   = parse(host_string, sizeof(host_string));
+
+	const ucl_object_t        *stack[] = {base, region, host};
+	config::detail::LayerStack layers{stack};
+	auto                       confOrError = make_config(layers);
+	assert(std::holds_alternative<Config>(confOrError));
+	auto conf = std::get<Config>(confOrError);
+	assert(conf.name() == "host");
+	assert(conf.limits().rate() == 100);
+	assert(conf.limits().burst() == 20);
+	assert(conf.tls()->certificate() == "base.pem");
+	// Subtrees that only one layer defines are shared, not copied.
+	assert(ucl_object_lookup(layers.view(), "tls") ==
+	       ucl_object_lookup(base, "tls"));
+
+	// Replacing the host layer with an invalid one leaves the stack alone.
+	auto wrong = parse(host_wrong, sizeof(host_wrong));
+	assert(std::holds_alternative<ucl_schema_error>(
+	  make_config(layers, 2, wrong)));
+	assert(std::get<Config>(make_config(layers)).name() == "host");
+
+	// Removing the host override exposes the base name.
+	confOrError = make_config(layers, 2, nullptr);
+	assert(std::holds_alternative<Config>(confOrError));
+	assert(std::get<Config>(confOrError).name() == "base");
+	assert(std::get<Config>(confOrError).limits().rate() == 100);
+
+	// A stack that never passed validation is fully validated on replace,
+	// even if the new layer does not touch the invalid property.
+	const ucl_object_t        *invalid[] = {region, host};
+	config::detail::LayerStack unchecked{invalid};
+	assert(std::holds_alternative<ucl_schema_error>(make_config(unchecked)));
+	assert(std::holds_alternative<ucl_schema_error>(
+	  make_config(unchecked, 1, host)));
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,98 @@
+#include "test_load.h"
+#include "test_helpers.h"
+#include <fstream>
+#include <future>
+#include <string>
+#include <unistd.h>
+
+int main()
+{
+	auto dir = std::filesystem::temp_directory_path() /
+	           ("config-gen-test-load-" + std::to_string(getpid()));
+	std::filesystem::create_directories(dir);
+	std::vector<std::filesystem::path> paths;
+	for (int i = 0; i < 64; i++)
+	{
+		paths.push_back(dir / ("tenant" + std::to_string(i) + ".conf"));
+		std::ofstream f(paths.back());
+		if (i == 7)
+		{
+			// Fails validation: rateLimit out of range.
+			f << "name = \"tenant" << i << "\";\nrateLimit = 200000;\n";
+		}
+		else if (i == 13)
+		{
+			// Fails parsing.
+			f << "name = \"unterminated;\n";
+		}
+		else
+		{
+			f << "name = \"tenant" << i << "\";\nrateLimit = " << i * 10
+			  << ";\n";
+		}
+	}
+	paths.push_back(dir / "missing.conf");
+
+	config::detail::ThreadPool pool(4);
+	auto                       results = load_configs(paths, pool);
+	assert(results.size() == paths.size());
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		if ((i == 7) || (i == 13) || (i == paths.size() - 1))
+		{
+			assert(std::holds_alternative<config::detail::LoadError>(
+			  results[i]));
+			continue;
+		}
+		auto &conf = std::get<Config>(results[i]);
+		assert(conf.name() == "tenant" + std::to_string(i));
+		assert(conf.rateLimit() == i * 10);
+	}
+	auto &invalid = std::get<config::detail::LoadError>(results[7]);
+	assert(invalid.code != UCL_SCHEMA_UNKNOWN);
+	auto &unparsed = std::get<config::detail::LoadError>(results[13]);
+	assert(unparsed.code == UCL_SCHEMA_UNKNOWN);
+
+	// Loading from a task on a pool whose workers are all busy loading
+	// would deadlock if it queued work on the same pool.
+	{
+		config::detail::ThreadPool single(1);
+		std::promise<size_t>       loaded;
+		single.execute(
+		  [&]() { loaded.set_value(load_configs(paths, single).size()); });
+		assert(loaded.get_future().get() == paths.size());
+		assert(!single.is_worker());
+	}
+
+	config::detail::InlineExecutor inlineExecutor;
+	auto serial = load_configs(std::span{paths}.first(3), inlineExecutor);
+	assert(serial.size() == 3);
+	assert(std::get<Config>(serial[2]).rateLimit() == 20);
+
+	// Every phase of every file is reported to the observer.  The missing
+	// file and the one that fails to parse stop after parsing, and the one
+	// that fails validation is never materialised.
+	using config::detail::LoadPhase;
+	config::detail::HistogramObserver observer;
+	auto observed = load_configs(paths, pool, observer);
+	assert(observed.size() == paths.size());
+	auto parse = observer.stats(LoadPhase::Parse);
+	assert(parse.count == paths.size());
+	assert(parse.bytes > 0);
+	assert(observer.stats(LoadPhase::SchemaLoad).count == paths.size() - 2);
+	assert(observer.stats(LoadPhase::Validate).count == paths.size() - 2);
+	auto materialize = observer.stats(LoadPhase::Materialize);
+	assert(materialize.count == paths.size() - 3);
+	size_t bucketed = 0;
+	for (auto b : parse.buckets)
+	{
+		bucketed += b;
+	}
+	assert(bucketed == parse.count);
+	assert(parse.quantile(0.5) <= parse.quantile(0.99));
+	observer.reset();
+	assert(observer.stats(LoadPhase::Parse).count == 0);
+
+	std::filesystem::remove_all(dir);
+	return EXIT_SUCCESS;
+}
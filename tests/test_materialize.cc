@@ -0,0 +1,67 @@
+#include "test_materialize.h"
+#include "test_helpers.h"
+
+static const char full[] = "name = \"server\";\n"
+                           "description = \"the main server\";\n"
+                           "enabled = true;\n"
+                           "verbose = false;\n"
+                           "port = 8080;\n"
+                           "retries = 5;\n"
+                           "timeout = 2.5;\n"
+                           "limits { connections = 100000; burst = 20; }\n"
+                           "aliases = [\"www\", \"web\"];\n"
+                           "backends = [{ host = \"a\", weight = 3 },"
+                           " { host = \"b\" }];\n";
+
+static const char minimal[] = "name = \"min\";\n"
+                              "enabled = false;\n"
+                              "port = 1;\n";
+
+int main()
+{
+	auto obj  = parse(full, sizeof(full));
+	auto conf = getConfig(obj);
+	ucl_object_unref(obj);
+	ConfigData data(conf);
+	// The materialised copy does not depend on the UCL tree.
+	obj  = parse(minimal, sizeof(minimal));
+	conf = getConfig(obj);
+	ucl_object_unref(obj);
+
+	assert(data.name() == "server");
+	assert(data.description() == "the main server");
+	assert(data.enabled());
+	assert(data.verbose() == false);
+	assert(data.port() == 8080);
+	assert(data.retries() == 5);
+	assert(data.timeout() == 2.5);
+	assert(data.limits() != nullptr);
+	assert(data.limits()->connections() == 100000);
+	assert(data.limits()->burst() == 20);
+	assert(data.aliases()->size() == 2);
+	assert((*data.aliases())[1] == "web");
+	auto &backends = *data.backends();
+	assert(backends.size() == 2);
+	assert(backends[0].host() == "a");
+	assert(backends[0].weight() == 3);
+	assert(!backends[1].weight());
+
+	ConfigData min(conf);
+	assert(min.name() == "min");
+	assert(!min.enabled());
+	assert(!min.description());
+	assert(!min.verbose());
+	assert(!min.retries());
+	assert(!min.timeout());
+	assert(min.limits() == nullptr);
+	assert(min.aliases() == nullptr);
+
+	// Copies share the out-of-line members.
+	ConfigData copy = data;
+	assert(copy.description()->data() == data.description()->data());
+
+	// The profile makes the hot scalars and the limits object share a
+	// packed word, while the cold strings and arrays are out of line.
+	static_assert(sizeof(ConfigData) <= 64);
+	return EXIT_SUCCESS;
+}
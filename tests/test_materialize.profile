@@ -0,0 +1,14 @@
+100000	enabled
+90000	port
+80000	retries
+50000	timeout
+40000	limits
+40000	limits.connections
+100	limits.burst
+10	name
+5	description
+0	verbose
+0	aliases
+0	backends
+0	backends[].host
+0	backends[].weight
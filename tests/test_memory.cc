@@ -0,0 +1,96 @@
+#include "test_memory.h"
+#include "test_helpers.h"
+
+#include <string>
+
+using config::detail::LiveConfigs;
+using config::detail::MemoryUsage;
+
+static const char small[] = "name = \"small\";\n"
+                            "server { host = \"localhost\"; port = 80; }\n";
+
+std::string large_config(const std::string &name)
+{
+	std::string str = "name = \"" + name + "\";\n"
+	                  "server { host = \"a-rather-long-host-name.example.com\"; "
+	                  "port = 443; }\n"
+	                  "tags = [";
+	for (int i = 0; i < 100; i++)
+	{
+		str += "\"tag" + std::to_string(i) + "\", ";
+	}
+	return str + "];\n";
+}
+
+int main()
+{
+	auto &live = LiveConfigs::global();
+	assert(live.size() == 0);
+	{
+		auto obj   = parse(small, sizeof(small));
+		auto conf  = getConfig(obj);
+		auto other = conf;
+		ucl_object_unref(obj);
+		// Copies of a config share its registration.
+		assert(live.size() == 1);
+
+		auto report = conf.memory_usage();
+		// The root, name, server, host and port.
+		assert(report.total.nodes == 5);
+		assert(report.total.arrayBytes == 0);
+		assert(report.paths.size() == 5);
+		MemoryUsage sum;
+		for (auto &[path, usage] : report.paths)
+		{
+			sum += usage;
+		}
+		assert(sum.total() == report.total.total());
+		// The key and value of `name` are both copied.
+		assert(report.paths["name"].stringBytes ==
+		       sizeof("name") + sizeof("small"));
+		assert(report.paths.contains("server.host"));
+		// Nested classes report paths relative to themselves.
+		auto server = conf.server().memory_usage();
+		assert(server.total.nodes == 3);
+		assert(server.paths.contains("host"));
+		assert(server.paths["host"].stringBytes ==
+		       report.paths["server.host"].stringBytes);
+		assert(live.usage().total.total() == report.total.total());
+	}
+	assert(live.size() == 0);
+	assert(live.usage().total.nodes == 0);
+
+	{
+		auto text = large_config("large");
+		auto obj  = parse(text.c_str(), text.size());
+		auto conf = getConfig(obj);
+		ucl_object_unref(obj);
+		auto report = conf.memory_usage();
+		assert(report.paths["tags[]"].nodes == 100);
+		assert(report.paths[""].nodeBytes > sizeof(ucl_object_t));
+		assert(report.paths["tags"].arrayBytes ==
+		       100 * sizeof(ucl_object_t *));
+	}
+
+	// Interned configs share their common parts, which the live total
+	// counts once.
+	config::detail::InternTable table;
+	{
+		auto textA = large_config("a");
+		auto textB = large_config("b");
+		auto objA  = parse(textA.c_str(), textA.size());
+		auto objB  = parse(textB.c_str(), textB.size());
+		auto a     = make_interned_config(objA, table);
+		auto b     = make_interned_config(objB, table);
+		ucl_object_unref(objA);
+		ucl_object_unref(objB);
+		auto  &confA    = std::get<Config>(a);
+		auto  &confB    = std::get<Config>(b);
+		size_t separate = confA.memory_usage().total.total() +
+		                  confB.memory_usage().total.total();
+		assert(live.size() == 2);
+		assert(live.usage().total.total() < separate * 6 / 10);
+	}
+	assert(live.size() == 0);
+	return EXIT_SUCCESS;
+}
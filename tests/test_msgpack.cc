@@ -0,0 +1,116 @@
+#include "test_msgpack.h"
+#include "test_helpers.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+static const char text[] =
+  "name = \"server\";\n"
+  "port = 8080;\n"
+  "ratio = 0.5;\n"
+  "enabled = true;\n"
+  "tls { certificate = \"cert.pem\"; ciphers = [\"x\", \"y\"]; }\n";
+
+/**
+ * Returns the MessagePack encoding of the UCL config `str`.
+ */
+template<size_t N>
+std::vector<std::byte> encode(const char (&str)[N])
+{
+	auto *obj     = parse(str, N - 1);
+	auto  encoded = config::detail::encode_msgpack(obj);
+	ucl_object_unref(obj);
+	return encoded;
+}
+
+/**
+ * Returns the config from a `LoadError` or config variant, which must hold a
+ * config.
+ */
+Config loaded(std::variant<Config, config::detail::LoadError> result)
+{
+	if (auto *err = std::get_if<config::detail::LoadError>(&result))
+	{
+		std::cerr << "Load failed: " << err->message << std::endl;
+	}
+	assert(std::holds_alternative<Config>(result));
+	return std::get<Config>(result);
+}
+
+int main()
+{
+	// Round trip through the binary encoding.
+	{
+		auto encoded = encode(text);
+		assert(!encoded.empty());
+		auto conf = loaded(make_config_from_msgpack(encoded));
+		assert(conf.name() == "server");
+		assert(conf.port() == 8080);
+		assert(conf.ratio() == 0.5);
+		assert(conf.enabled() == true);
+		assert(conf.tls()->certificate() == "cert.pem");
+		std::vector<std::string_view> ciphers;
+		auto                          cipherRange = *conf.tls()->ciphers();
+		for (auto cipher : cipherRange)
+		{
+			ciphers.push_back(cipher);
+		}
+		assert((ciphers == std::vector<std::string_view>{"x", "y"}));
+	}
+
+	// The parse phase is reported with the size of the input.
+	{
+		auto                              encoded = encode(text);
+		config::detail::HistogramObserver observer;
+		loaded(make_config_from_msgpack(encoded, observer));
+		auto parse = observer.stats(config::detail::LoadPhase::Parse);
+		assert(parse.count == 1);
+		assert(parse.bytes == encoded.size());
+		assert(observer.stats(config::detail::LoadPhase::Validate).count == 1);
+	}
+
+	// Binary input is validated against the schema like text.
+	{
+		static const char outOfRange[] = "name = \"server\";\nport = 70000;\n";
+		auto encoded = encode(outOfRange);
+		auto result  = make_config_from_msgpack(encoded);
+		auto *err    = std::get_if<config::detail::LoadError>(&result);
+		assert(err != nullptr);
+		assert(err->code != UCL_SCHEMA_UNKNOWN);
+	}
+
+	// Input that is not MessagePack is a parse error.
+	{
+		std::vector<std::byte> garbage{std::byte{0xc1}, std::byte{0x00}};
+		auto                   result = make_config_from_msgpack(garbage);
+		auto *err = std::get_if<config::detail::LoadError>(&result);
+		assert(err != nullptr);
+		assert(err->code == UCL_SCHEMA_UNKNOWN);
+	}
+
+	// A config converted by `config-gen --msgpack`.
+	{
+		std::ifstream          file(TEST_MSGPACK_FILE, std::ios::binary);
+		std::vector<std::byte> encoded;
+		std::transform(std::istreambuf_iterator<char>(file),
+		               std::istreambuf_iterator<char>(),
+		               std::back_inserter(encoded),
+		               [](char c) { return std::byte(c); });
+		auto conf = loaded(make_config_from_msgpack(encoded));
+		assert(conf.name() == "packed");
+		assert(conf.port() == 8443);
+		assert(conf.ratio() == 0.25);
+		assert(conf.enabled() == false);
+		size_t ciphers     = 0;
+		auto   cipherRange = *conf.tls()->ciphers();
+		for (auto cipher : cipherRange)
+		{
+			ciphers += !cipher.empty();
+		}
+		assert(ciphers == 3);
+	}
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,80 @@
+#include "test_pattern.h"
+#include "test_helpers.h"
+
+#include <string>
+#include <string_view>
+
+static const char source[] = "name = \"frontend-1\";\n"
+                             "version = \"1.20.3\";\n"
+                             "label = \"Primary\";\n"
+                             "hosts = [\n"
+                             "  { address = \"web1.example.com:8080\"; },\n"
+                             "  { address = \"10.0.0.2\"; owner = \"ops\"; }\n"
+                             "];\n"
+                             "contact { email = \"ops@example.com\"; }\n";
+
+static std::string invalid_message(const char *text)
+{
+	auto *obj         = parse(text, strlen(text));
+	auto  confOrError = make_config(obj);
+	ucl_object_unref(obj);
+	assert(std::holds_alternative<ucl_schema_error>(confOrError));
+	return std::get<ucl_schema_error>(confOrError).msg;
+}
+
+int main()
+{
+	auto *obj  = parse(source, sizeof(source) - 1);
+	auto  conf = getConfig(obj);
+	ucl_object_unref(obj);
+	assert(conf.name() == "frontend-1");
+	assert(conf.version() == "1.20.3");
+
+	// Patterns are removed from the schema that libucl checks and are
+	// checked by the compiled matchers instead.
+	const ucl_object_t *schema = embedded_validation_schema();
+	auto *name = ucl_object_lookup_path(schema, "properties.name");
+	assert(name != nullptr);
+	assert(ucl_object_lookup(name, "pattern") == nullptr);
+	assert(ucl_object_lookup_path(embedded_schema(),
+	                              "properties.name.pattern") != nullptr);
+
+	// Mismatches are reported as libucl reports them, at the top level, in
+	// array elements, and in nested objects.
+	std::string message = invalid_message("name = \"Frontend\";\n"
+	                                       "version = \"1.0.0\";\n");
+	assert(message.starts_with("string doesn't match regexp"));
+	assert(message.find("^[a-z]") != std::string::npos);
+	static const char *invalid[] = {
+	  "name = \"a\";\nversion = \"1.02.0\";\n",
+	  "name = \"a\";\nversion = \"1.0.0\";\n"
+	  "hosts = [{ address = \"a b\"; }];\n",
+	  "name = \"a\";\nversion = \"1.0.0\";\n"
+	  "hosts = [{ address = \"a\"; }, { address = \"b\"; owner = \"9\"; }];\n",
+	  "name = \"a\";\nversion = \"1.0.0\";\ncontact { email = \"nobody\"; }\n",
+	  "name = \"abcdefghijklmnopq\";\nversion = \"1.0.0\";\n",
+	};
+	for (auto *text : invalid)
+	{
+		auto *bad = parse(text, strlen(text));
+		checkInvalidConfig(bad);
+		ucl_object_unref(bad);
+	}
+
+	// Patterns with named classes and strings that are not plain ASCII are
+	// matched with the regular expression.
+	static const char *named[] = {
+	  "name = \"a\";\nversion = \"1.0.0\";\nlabel = \"abc\";\n",
+	  "name = \"a\";\nversion = \"1.0.0\";\nlabel = \"ab1\";\n",
+	  "name = \"a\";\nversion = \"1.0.0\";\n"
+	  "contact { email = \"\xc3\xa9@example.com\"; }\n",
+	  "name = \"\xc3\xa9\";\nversion = \"1.0.0\";\n",
+	};
+	bool expected[] = {true, false, true, false};
+	for (size_t i = 0; i < std::size(named); i++)
+	{
+		auto *o = parse(named[i], strlen(named[i]));
+		assert(std::holds_alternative<Config>(make_config(o)) == expected[i]);
+		ucl_object_unref(o);
+	}
+}
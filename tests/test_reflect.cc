@@ -0,0 +1,90 @@
+#include "test_reflect.h"
+#include "test_helpers.h"
+
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// The property table and IDs are usable in constant expressions.
+static_assert(Config::fields.size() == 5);
+static_assert(Config::fields[Config::field_ids::port].name == "port");
+static_assert(Config::fields[Config::field_ids::port].type == "uint16_t");
+static_assert(Config::fields[Config::field_ids::port].required);
+static_assert(!Config::fields[Config::field_ids::ratio].required);
+static_assert(Config::field_id("tls") == Config::field_ids::tls);
+static_assert(!Config::field_id("missing"));
+static_assert(
+  std::is_same_v<decltype(std::declval<Config>()
+                            .get_field<Config::field_ids::port>()),
+                 uint16_t>);
+static_assert(
+  std::is_same_v<decltype(std::declval<Config>()
+                            .get_field<Config::field_ids::ratio>()),
+                 std::optional<double>>);
+
+/**
+ * Returns a string describing a scalar value, or `-` for values that are
+ * not scalars or are absent.
+ */
+template<typename T>
+std::string describe(const T &value)
+{
+	if constexpr (std::is_same_v<T, std::string_view>)
+	{
+		return std::string(value);
+	}
+	else if constexpr (std::is_arithmetic_v<T>)
+	{
+		return std::to_string(value);
+	}
+	else if constexpr (requires { value.has_value(); })
+	{
+		return value ? describe(*value) : "-";
+	}
+	else
+	{
+		return "-";
+	}
+}
+
+int main()
+{
+	static const char text[] = "name = \"server\";\n"
+	                           "port = 8080;\n"
+	                           "tls { certificate = \"cert.pem\"; }\n"
+	                           "tags = [\"a\"];\n";
+	auto *obj  = parse(text, sizeof(text) - 1);
+	auto  conf = getConfig(obj);
+	ucl_object_unref(obj);
+
+	// Generic code can visit every property without knowing the schema.
+	std::vector<std::string> visited;
+	conf.for_each_field([&](const config::detail::FieldInfo &field,
+	                        const auto                      &value) {
+		visited.push_back(std::string(field.name) + "=" + describe(value));
+	});
+	assert((visited == std::vector<std::string>{
+	                     "name=server", "port=8080", "ratio=-", "tls=-", "tags=-"}));
+
+	// Nested objects have their own tables.
+	auto tls = *conf.tls();
+	static_assert(decltype(tls)::fields.size() == 2);
+	std::vector<std::string> nested;
+	tls.for_each_field([&](auto &field, const auto &value) {
+		nested.push_back(std::string(field.name) + "=" + describe(value));
+	});
+	assert((nested == std::vector<std::string>{"certificate=cert.pem",
+	                                           "verify=-"}));
+
+	// Properties can be read by an ID that is known only at run time, such
+	// as one looked up from a flag override.
+	auto id = Config::field_id("port");
+	assert(id);
+	auto port = conf.get_by_id(*id);
+	assert(port.index() == *id + 1);
+	assert(std::get<Config::field_ids::port + 1>(port) == 8080);
+	auto ratio = conf.get_by_id(Config::field_ids::ratio);
+	assert(!std::get<Config::field_ids::ratio + 1>(ratio));
+	assert(std::holds_alternative<std::monostate>(conf.get_by_id(99)));
+	assert(conf.get_field<Config::field_ids::name>() == "server");
+}
@@ -0,0 +1,169 @@
+#include "test_runtime_schema.h"
+#include "test_helpers.h"
+
+#include <config-schema.h>
+#include <string>
+#include <vector>
+
+using namespace config::detail;
+
+static const char text[] =
+  "name = \"server\";\n"
+  "port = 8080;\n"
+  "ratio = 0.5;\n"
+  "tls { certificate = \"cert.pem\"; }\n"
+  "tags = [\"one\", \"two\"];\n"
+  "backends = [{ host = \"alpha\"; weight = 2; }, { host = \"beta\"; }];\n";
+
+/**
+ * Resolves `path` in `schema`, which must succeed.
+ */
+template<typename T>
+PathHandle<T> resolve(const RuntimeSchema &schema, std::string_view path)
+{
+	auto result = schema.resolve<T>(path);
+	if (auto *err = std::get_if<PathError>(&result))
+	{
+		std::cerr << "Resolving " << path << " failed: " << err->message
+		          << std::endl;
+	}
+	assert(std::holds_alternative<PathHandle<T>>(result));
+	return std::get<PathHandle<T>>(result);
+}
+
+/**
+ * Returns true if resolving `path` in `schema` fails.
+ */
+template<typename T>
+bool unresolvable(const RuntimeSchema &schema, std::string_view path)
+{
+	return std::holds_alternative<PathError>(schema.resolve<T>(path));
+}
+
+int main()
+{
+	auto schemaOrError = load_runtime_schema(TEST_SCHEMA_FILE);
+	assert(std::holds_alternative<std::shared_ptr<const RuntimeSchema>>(
+	  schemaOrError));
+	auto schema =
+	  std::get<std::shared_ptr<const RuntimeSchema>>(schemaOrError);
+
+	// Resolve every path once, up front.
+	auto name        = resolve<std::string_view>(*schema, "name");
+	auto port        = resolve<uint16_t>(*schema, "port");
+	auto portPointer = resolve<int64_t>(*schema, "/port");
+	auto ratio       = resolve<double>(*schema, "ratio");
+	auto verbose     = resolve<bool>(*schema, "verbose");
+	auto tls         = resolve<RuntimeObject>(*schema, "tls");
+	auto certificate = resolve<std::string_view>(*schema, "tls.certificate");
+	auto key         = resolve<std::string_view>(*schema, "/tls/key");
+	auto tags  = resolve<RuntimeArray<std::string_view>>(*schema, "tags");
+	auto backends =
+	  resolve<RuntimeArray<RuntimeObject>>(*schema, "backends");
+	auto host   = resolve<std::string_view>(*schema, "backends[].host");
+	auto weight = resolve<int64_t>(*schema, "backends[].weight");
+
+	// Paths that are not in the schema, or are read with the wrong type,
+	// are rejected when they are resolved.
+	assert(unresolvable<std::string_view>(*schema, "missing"));
+	assert(unresolvable<std::string_view>(*schema, "tls.missing"));
+	assert(unresolvable<std::string_view>(*schema, "port"));
+	assert(unresolvable<int8_t>(*schema, "port"));
+	assert(unresolvable<int>(*schema, "backends[].weight"));
+	assert(unresolvable<bool>(*schema, "name"));
+	assert(unresolvable<RuntimeObject>(*schema, "tags"));
+	assert(unresolvable<RuntimeArray<int>>(*schema, "tags"));
+	assert(unresolvable<std::string_view>(*schema, "tags[].x"));
+	assert(unresolvable<std::string_view>(*schema, "backends[]"));
+	assert(unresolvable<std::string_view>(*schema, ""));
+
+	auto *obj           = parse(text, sizeof(text) - 1);
+	auto  runtimeOrError = make_runtime_config(schema, obj);
+	assert(std::holds_alternative<RuntimeObject>(runtimeOrError));
+	auto conf = std::get<RuntimeObject>(runtimeOrError);
+
+	assert(conf.get(name) == "server");
+	assert(conf.get(port) == 8080);
+	assert(conf.get(portPointer) == 8080);
+	assert(conf.get(ratio) == 0.5);
+	assert(!conf.get(verbose));
+	assert(conf.get_or(verbose, true));
+	assert(conf.get(certificate) == "cert.pem");
+	assert(!conf.get(key));
+	assert(conf.get(tls)->get(certificate) == "cert.pem");
+
+	std::vector<std::string_view> tagValues;
+	auto                          tagRange = *conf.get(tags);
+	for (auto tag : tagRange)
+	{
+		tagValues.push_back(tag);
+	}
+	assert((tagValues == std::vector<std::string_view>{"one", "two"}));
+
+	std::vector<std::string_view> hosts;
+	int64_t                       totalWeight = 0;
+	auto                          backendRange = *conf.get(backends);
+	for (auto backend : backendRange)
+	{
+		hosts.push_back(*backend.get(host));
+		totalWeight += backend.get_or(weight, 1);
+	}
+	assert((hosts == std::vector<std::string_view>{"alpha", "beta"}));
+	assert(totalWeight == 3);
+
+	// Reads through handles agree with the generated accessors for the same
+	// schema.
+	auto generated = getConfig(obj);
+	assert(generated.name() == *conf.get(name));
+	assert(generated.port() == *conf.get(port));
+	assert(generated.tls()->certificate() == *conf.get(certificate));
+
+	// Configs that do not match the schema are rejected.
+	static const char invalid[] = "name = \"server\";\n";
+	auto *invalidObj = parse(invalid, sizeof(invalid) - 1);
+	assert(std::holds_alternative<ucl_schema_error>(
+	  make_runtime_config(schema, invalidObj)));
+	ucl_object_unref(invalidObj);
+
+	// JSON Pointers escape `/` and `~` in keys.
+	static const char escapedSchema[] =
+	  "type = object;\n"
+	  "properties { \"a/b\" { type = string; } \"c~d\" { type = integer; } }\n";
+	auto *escapedObj = parse(escapedSchema, sizeof(escapedSchema) - 1);
+	auto  escaped    = RuntimeSchema::create(escapedObj);
+	ucl_object_unref(escapedObj);
+	auto slash = resolve<std::string_view>(*escaped, "/a~1b");
+	auto tilde = resolve<int64_t>(*escaped, "/c~0d");
+	static const char escapedText[] = "\"a/b\" = \"slash\"; \"c~d\" = 3;\n";
+	auto *escapedConf = parse(escapedText, sizeof(escapedText) - 1);
+	auto  escapedOrError = make_runtime_config(escaped, escapedConf);
+	assert(std::holds_alternative<RuntimeObject>(escapedOrError));
+	assert(std::get<RuntimeObject>(escapedOrError).get(slash) == "slash");
+	assert(std::get<RuntimeObject>(escapedOrError).get(tilde) == 3);
+	ucl_object_unref(escapedConf);
+
+	// Tuples are rewritten only in subschemas, never in data such as
+	// defaults, and only rewritten tuples require their leading items.
+	static const char tupleSchema[] =
+	  "type = object;\n"
+	  "properties {\n"
+	  "  pair { type = array; prefixItems = [{ type = string; }, {}]; }\n"
+	  "  legacy { type = array; items = [{ type = string; }]; }\n"
+	  "}\n"
+	  "default { pair { prefixItems = [1]; items = [2]; } }\n";
+	auto *tupleObj = parse(tupleSchema, sizeof(tupleSchema) - 1);
+	Schema::translate_prefix_items(tupleObj, true);
+	auto *pair = ucl_object_lookup_path(tupleObj, "properties.pair");
+	assert(ucl_object_type(ucl_object_lookup(pair, "items")) == UCL_ARRAY);
+	assert(ucl_object_toint(ucl_object_lookup(pair, "minItems")) == 2);
+	auto *legacy = ucl_object_lookup_path(tupleObj, "properties.legacy");
+	assert(ucl_object_lookup(legacy, "minItems") == nullptr);
+	auto *data = ucl_object_lookup_path(tupleObj, "default.pair");
+	assert(ucl_object_lookup(data, "prefixItems") != nullptr);
+	assert(ucl_object_lookup(data, "minItems") == nullptr);
+	ucl_object_unref(tupleObj);
+
+	// The config keeps its tree alive after the caller drops its reference.
+	ucl_object_unref(obj);
+	assert(conf.get(name) == "server");
+}
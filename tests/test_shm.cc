@@ -0,0 +1,175 @@
+#include "test_shm.h"
+#include "test_helpers.h"
+
+#include <atomic>
+#include <cstddef>
+#include <string>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+
+using namespace config::detail;
+
+/**
+ * Returns the text of a config whose properties all depend on `i`, so that
+ * readers can check that they never see parts of two configs.
+ */
+std::string config_text(int i)
+{
+	std::string text = "name = \"config" + std::to_string(i) + "\";\n";
+	text += "port = " + std::to_string(i % 65536) + ";\n";
+	text += "tls { certificate = \"cert" + std::to_string(i) +
+	        ".pem\"; ciphers = [\"a\", \"b\"]; }\n";
+	text += "backends = [";
+	for (int b = 0; b < (i % 8); b++)
+	{
+		text += "{ host = \"host" + std::to_string(i) + "\"; weight = " +
+		        std::to_string(i) + "; },";
+	}
+	text += "];\n";
+	return text;
+}
+
+/**
+ * Returns true if `conf` is exactly the config produced by `config_text`
+ * for its port.
+ */
+bool consistent(const ConfigShared &conf)
+{
+	int  i      = conf.port();
+	auto suffix = std::to_string(i);
+	if ((conf.name() != "config" + suffix) ||
+	    (conf.tls()->certificate() != "cert" + suffix + ".pem"))
+	{
+		return false;
+	}
+	int  count    = 0;
+	auto backends = *conf.backends();
+	for (auto backend : backends)
+	{
+		if ((backend.host() != "host" + suffix) || (backend.weight() != i))
+		{
+			return false;
+		}
+		count++;
+	}
+	return count == (i % 8);
+}
+
+/**
+ * Parses and publishes the config produced by `config_text(i)`.
+ */
+void publish(SharedConfigRegion &region, int i)
+{
+	auto  text = config_text(i);
+	auto *obj  = parse(text.c_str(), text.size());
+	auto  conf = publish_config(region, obj);
+	ucl_object_unref(obj);
+	assert(std::holds_alternative<Config>(conf));
+	assert(std::get<Config>(conf).port() == i);
+}
+
+int main()
+{
+	std::string name = "/config-gen-test-shm-" + std::to_string(getpid());
+	auto        created = SharedConfigRegion::create(name, 64 * 1024);
+	assert(std::holds_alternative<std::shared_ptr<SharedConfigRegion>>(
+	  created));
+	auto region = std::get<std::shared_ptr<SharedConfigRegion>>(created);
+
+	auto attached = ConfigSharedReader::attach(name);
+	assert(std::holds_alternative<ConfigSharedReader>(attached));
+	auto reader = std::get<ConfigSharedReader>(attached);
+
+	// Nothing has been published yet.
+	assert(!reader.changed());
+	assert(std::holds_alternative<LoadError>(reader.current()));
+
+	publish(*region, 1);
+	assert(reader.changed());
+	auto first = reader.current();
+	assert(std::holds_alternative<ConfigShared>(first));
+	auto &conf = std::get<ConfigShared>(first);
+	assert(conf.name() == "config1");
+	assert(conf.port() == 1);
+	assert(consistent(conf));
+	assert(!reader.changed());
+	assert(reader.generation() == 1);
+
+	// Configs that do not match the schema are not published.
+	static const char invalid[] = "name = \"broken\";\n";
+	auto *invalidObj = parse(invalid, sizeof(invalid) - 1);
+	assert(std::holds_alternative<LoadError>(
+	  publish_config(*region, invalidObj)));
+	ucl_object_unref(invalidObj);
+	assert(!reader.changed());
+
+	// Configs that do not fit are not published.
+	auto small = std::get<std::shared_ptr<SharedConfigRegion>>(
+	  SharedConfigRegion::create(name + "-small", 64));
+	auto  text = config_text(7);
+	auto *obj  = parse(text.c_str(), text.size());
+	assert(std::holds_alternative<LoadError>(publish_config(*small, obj)));
+	ucl_object_unref(obj);
+	SharedConfigRegion::remove(name + "-small");
+
+	// Another process sees the config without parsing it.
+	publish(*region, 2);
+	pid_t child = fork();
+	if (child == 0)
+	{
+		auto childReader =
+		  std::get<ConfigSharedReader>(ConfigSharedReader::attach(name));
+		auto childConf = childReader.current();
+		_exit(std::holds_alternative<ConfigShared>(childConf) &&
+		          (std::get<ConfigShared>(childConf).port() == 2) &&
+		          consistent(std::get<ConfigShared>(childConf))
+		        ? EXIT_SUCCESS
+		        : EXIT_FAILURE);
+	}
+	int status;
+	waitpid(child, &status, 0);
+	assert(WIFEXITED(status) && (WEXITSTATUS(status) == EXIT_SUCCESS));
+
+	// Configs that were read earlier remain valid after later publishes.
+	assert(conf.name() == "config1");
+	assert(consistent(conf));
+
+	// Readers never see a config that is partly overwritten, however many
+	// publishes overtake them.
+	std::atomic<bool> done = false;
+	std::thread       writer([&]() {
+		for (int i = 3; i < 2000; i++)
+		{
+			publish(*region, i);
+		}
+		done = true;
+	});
+	size_t reads = 0;
+	while (!done)
+	{
+		auto latest = reader.current();
+		assert(std::holds_alternative<ConfigShared>(latest));
+		assert(consistent(std::get<ConfigShared>(latest)));
+		reads++;
+	}
+	writer.join();
+	assert(reads > 0);
+	auto last = reader.current();
+	assert(std::get<ConfigShared>(last).port() == 1999);
+
+	// Flat images are checked before they are read.
+	auto  flatText = config_text(5);
+	auto *flatObj  = parse(flatText.c_str(), flatText.size());
+	auto  image    = encode_flat(flatObj);
+	ucl_object_unref(flatObj);
+	assert(std::holds_alternative<FlatNode>(open_flat(image)));
+	assert(std::holds_alternative<LoadError>(
+	  open_flat(std::span(image).first(image.size() - 1))));
+	// Misalign the offset of the root object's members.
+	image[offsetof(FlatHeader, root) + offsetof(FlatValue, payload)] =
+	  std::byte{0xff};
+	assert(std::holds_alternative<LoadError>(open_flat(image)));
+
+	SharedConfigRegion::remove(name);
+}
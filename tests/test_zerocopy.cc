@@ -0,0 +1,110 @@
+#include "test_zerocopy.h"
+#include "test_helpers.h"
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+static const char text[] =
+  "name = \"server\";\n"
+  "port = 8080;\n"
+  "greeting = \"say \\\"hello\\\"\";\n"
+  "hosts = [\"alpha.example.com\", \"beta.example.com\"];\n";
+
+/**
+ * Writes `contents` to a new file in `dir` and returns its path.
+ */
+std::filesystem::path write_file(const std::filesystem::path &dir,
+                                 const char                  *name,
+                                 std::string_view             contents)
+{
+	auto path = dir / name;
+	std::ofstream(path) << contents;
+	return path;
+}
+
+int main()
+{
+	auto dir = std::filesystem::temp_directory_path() /
+	           ("config-gen-test-zerocopy-" + std::to_string(getpid()));
+	std::filesystem::create_directories(dir);
+
+	std::optional<Config> conf;
+	{
+		auto path   = write_file(dir, "server.conf", text);
+		auto result = load_config(path);
+		if (auto *err = std::get_if<config::detail::LoadError>(&result))
+		{
+			std::cerr << "Load failed: " << err->message << std::endl;
+		}
+		assert(std::holds_alternative<Config>(result));
+		// The config holds the mapping, so it remains usable after the
+		// result and the file are gone.
+		conf.emplace(std::get<Config>(result));
+		std::filesystem::remove(path);
+	}
+	assert(conf->name() == "server");
+	assert(conf->port() == 8080);
+	// Strings with escapes cannot point into the file and are copied.
+	assert(conf->greeting() == "say \"hello\"");
+	std::vector<std::string_view> hosts;
+	auto                          hostRange = *conf->hosts();
+	for (auto host : hostRange)
+	{
+		hosts.push_back(host);
+	}
+	assert((hosts == std::vector<std::string_view>{"alpha.example.com",
+	                                               "beta.example.com"}));
+
+	// Of the string values, only the escaped one was copied.  The same
+	// config parsed normally copies every string.
+	auto  zeroCopyUsage = conf->memory_usage().total;
+	auto *obj           = parse(text, sizeof(text) - 1);
+	auto  copied        = getConfig(obj);
+	ucl_object_unref(obj);
+	auto copiedUsage = copied.memory_usage().total;
+	assert(zeroCopyUsage.nodes == copiedUsage.nodes);
+	assert(zeroCopyUsage.stringBytes < copiedUsage.stringBytes);
+
+	// Copies share the mapping.
+	Config copy = *conf;
+	conf.reset();
+	assert(copy.name() == "server");
+
+	// Missing files, invalid configs and empty files are errors.  Errors
+	// from validation keep the object that failed, and its mapping, alive.
+	{
+		auto result = load_config(dir / "missing.conf");
+		auto *err   = std::get_if<config::detail::LoadError>(&result);
+		assert(err != nullptr);
+		assert(err->code == UCL_SCHEMA_UNKNOWN);
+	}
+	{
+		auto path   = write_file(dir, "invalid.conf", "name = \"x\";\n"
+		                                              "port = 70000;\n");
+		auto result = load_config(path);
+		auto *err   = std::get_if<config::detail::LoadError>(&result);
+		assert(err != nullptr);
+		assert(err->code != UCL_SCHEMA_UNKNOWN);
+		assert(err->storage != nullptr);
+	}
+	{
+		auto path   = write_file(dir, "empty.conf", "");
+		auto result = load_config(path);
+		assert(std::holds_alternative<config::detail::LoadError>(result));
+	}
+
+	// Loading through an observer reports the size of the mapping.
+	{
+		auto path = write_file(dir, "observed.conf", text);
+		config::detail::HistogramObserver observer;
+		auto result = load_config(path, observer);
+		assert(std::holds_alternative<Config>(result));
+		auto parse = observer.stats(config::detail::LoadPhase::Parse);
+		assert(parse.bytes == sizeof(text) - 1);
+	}
+	std::filesystem::remove_all(dir);
+	return EXIT_SUCCESS;
+}